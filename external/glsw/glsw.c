@@ -348,6 +348,61 @@ const char* glswGetError()
     return (const char*) (gc->ErrorMessage ? gc->ErrorMessage->data : 0);
 }
 
+// Drops a loaded effect file and its shaders, so the next glswGetShader reads it again.
+// Pointers previously returned for this effect become invalid.
+int glswForgetEffect(const char* pEffectName)
+{
+    glswContext* gc = __glsw__Context;
+    bstring effectName;
+    bstring prefix;
+    glswList** ppNode;
+
+    if (!gc)
+    {
+        return 0;
+    }
+
+    effectName = bfromcstr(pEffectName);
+    prefix = bstrcpy(effectName);
+    bconchar(prefix, '.');
+
+    ppNode = &gc->LoadedEffects;
+    while (*ppNode)
+    {
+        glswList* pNode = *ppNode;
+        if (1 == biseq(pNode->Key, effectName))
+        {
+            *ppNode = pNode->Next;
+            pNode->Next = 0;
+            __glsw__FreeList(pNode);
+        }
+        else
+        {
+            ppNode = &pNode->Next;
+        }
+    }
+
+    ppNode = &gc->ShaderMap;
+    while (*ppNode)
+    {
+        glswList* pNode = *ppNode;
+        if (binstr(pNode->Key, 0, prefix) == 0)
+        {
+            *ppNode = pNode->Next;
+            pNode->Next = 0;
+            __glsw__FreeList(pNode);
+        }
+        else
+        {
+            ppNode = &pNode->Next;
+        }
+    }
+
+    bdestroy(prefix);
+    bdestroy(effectName);
+    return 1;
+}
+
 int glswAddDirectiveToken(const char* token, const char* directive)
 {
     glswContext* gc = __glsw__Context;
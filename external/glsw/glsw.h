@@ -10,6 +10,7 @@ int glswSetPath(const char* pathPrefix, const char* pathSuffix);
 const char* glswGetShader(const char* effectKey);
 const char* glswGetError();
 int glswAddDirectiveToken(const char* token, const char* directive);
+int glswForgetEffect(const char* effectName);
 
 #ifdef __cplusplus
 }
@@ -8,7 +8,7 @@
 #ifndef ZCONF_H
 #define ZCONF_H
 /* #undef Z_PREFIX */
-/* #undef Z_HAVE_UNISTD_H */
+#define Z_HAVE_UNISTD_H
 
 /*
  * If you *really* need a unique prefix for all types and library functions,
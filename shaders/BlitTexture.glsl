@@ -1,26 +1,16 @@
 -- Vertex
 
-// IN
-layout (location = 0) in vec3 inPosition;
-layout (location = 1) in vec3 inNormal;
-layout (location = 2) in vec2 inTexcoords;
-
-// Out
-out vec2 vTexcoords;
-
-void main()
-{
-	vTexcoords = inTexcoords;
-	gl_Position = vec4(inPosition, 1.0);
-}
+#include "Fullscreen.glsli"
 
 -- Fragment
 
-uniform int uExposureMode;
-uniform float uExposure;
+#include "FrameConstants.glsli"
+
 uniform sampler2D uTexSource;
 uniform sampler2D uTexBloom;
 uniform sampler2D uTexAvgLuma;
+uniform sampler1D uTexToneMapLut1D;
+uniform sampler3D uTexToneMapLut3D;
 
 // IN
 in vec2 vTexcoords;
@@ -28,65 +18,38 @@ in vec2 vTexcoords;
 // OUT
 out vec3 fragColor;
 
-uniform float uKeyValue = 0.0050;
 const int ExposureModes_ManualSimple = 0;
 const int ExposureModes_ManualSBS = 1;
 const int ExposureModes_ManualSOS = 2;
 const int ExposureModes_Automatic = 3;
+const int LutType_1D = 0;
+const int LutType_3D = 1;
 
-mat3 mat3_from_rows(vec3 c0, vec3 c1, vec3 c2)
-{
-    mat3 m = mat3(c0, c1, c2);
-    m = transpose(m);
-
-    return m;
-}
-
-vec3 mul(mat3 m, vec3 v)
-{
-    return m * v;
-}
-
-mat3 mul(mat3 m1, mat3 m2)
-{
-    return m1 * m2;
-}
-
-vec3 rrt_odt_fit(vec3 v)
-{
-    vec3 a = v*(         v + 0.0245786) - 0.000090537;
-    vec3 b = v*(0.983729*v + 0.4329510) + 0.238081;
-    return a/b;
+vec3 toSRGB(vec3 v)
+{ 
+    return pow(v, vec3(1.0/2.2)); 
 }
 
-vec3 aces_fitted(vec3 color)
+// Exposure independent tone mapping curve baked by 'tonemap::bake'
+vec3 toneMapLut(vec3 color)
 {
-	mat3 ACES_INPUT_MAT = mat3_from_rows(
-	    vec3( 0.59719, 0.35458, 0.04823),
-	    vec3( 0.07600, 0.90834, 0.01566),
-	    vec3( 0.02840, 0.13383, 0.83777));
-
-	mat3 ACES_OUTPUT_MAT = mat3_from_rows(
-	    vec3( 1.60475,-0.53108,-0.07367),
-	    vec3(-0.10208, 1.10813,-0.00605),
-	    vec3(-0.00327,-0.07276, 1.07602));
-
-    color = mul(ACES_INPUT_MAT, color);
-
-    // Apply RRT and ODT
-    color = rrt_odt_fit(color);
-
-    color = mul(ACES_OUTPUT_MAT, color);
+    float lutScale = (uLutSize - 1.0) / uLutSize;
+    float lutOffset = 0.5 / uLutSize;
 
-    // Clamp to [0, 1]
-    color = clamp(color, 0.0, 1.0);
-
-    return color;
-}
+    if (uLutType == LutType_3D)
+    {
+        vec3 u = clamp((log2(max(color, 1e-20)) - uLutLogRange.x) / (uLutLogRange.y - uLutLogRange.x), 0.0, 1.0);
+        return texture(uTexToneMapLut3D, u * lutScale + lutOffset).rgb;
+    }
 
-vec3 toSRGB(vec3 v)
-{ 
-    return pow(v, vec3(1.0/2.2)); 
+    color = uLutInputMat * color;
+    vec3 u = clamp((log2(max(color, 1e-20)) - uLutLogRange.x) / (uLutLogRange.y - uLutLogRange.x), 0.0, 1.0);
+    u = u * lutScale + lutOffset;
+    color.r = texture(uTexToneMapLut1D, u.r).r;
+    color.g = texture(uTexToneMapLut1D, u.g).g;
+    color.b = texture(uTexToneMapLut1D, u.b).b;
+    color = clamp(uLutOutputMat * color, 0.0, 1.0);
+    return toSRGB(color);
 }
 
 vec3 toneMapAndtoSRGB(vec3 L)
@@ -140,8 +103,7 @@ void main()
 
     float avgLuminance = getAvgLuminance(uTexAvgLuma);
     color = calcExposedColor(color, avgLuminance, 0.0);
-	color = aces_fitted(color);
-	color = toSRGB(color);
+	color = toneMapLut(color);
 
 	fragColor = color;
 }
@@ -0,0 +1,72 @@
+//------------------------------------------------------------------------------
+
+-- Compute
+
+// Reads the scene color once and writes the half resolution bloom source
+// and the first level of the average log luminance reduction.
+// 'PostProcessKernels.cpp' emulates this kernel on the CPU.
+
+const uint GroupSize = 16;
+const uint NumThreads = GroupSize * GroupSize;
+
+layout(local_size_x = GroupSize, local_size_y = GroupSize, local_size_z = 1) in;
+layout(rgba16f, binding=0) uniform readonly image2D uTexSource;
+layout(rgba16f, binding=1) uniform writeonly image2D uTexBloom;
+layout(r16f, binding=2) uniform writeonly image2D uTexLuma;
+
+shared vec3 ColorSample[NumThreads];
+shared float LumSample[NumThreads];
+shared float CountSample[NumThreads];
+
+float Luminance(vec3 color)
+{
+    return dot(color, vec3(0.2126f, 0.7152f, 0.0722f));
+}
+
+void main()
+{
+    ivec2 size = imageSize(uTexSource);
+    ivec2 pos = ivec2(gl_GlobalInvocationID.xy);
+    uvec2 local = gl_LocalInvocationID.xy;
+    uint si = gl_LocalInvocationIndex;
+
+    // Out of bounds threads still have to reach the barriers
+    bool bValid = pos.x < size.x && pos.y < size.y;
+    vec3 color = bValid ? imageLoad(uTexSource, pos).rgb : vec3(0.0);
+    ColorSample[si] = color;
+    LumSample[si] = bValid ? log(max(Luminance(color), 0.00001f)) : 0.0;
+    CountSample[si] = bValid ? 1.0 : 0.0;
+
+    memoryBarrierShared();
+    barrier();
+
+    // Bloom prefilter, 2x2 box down to half resolution
+    if ((local.x & 1u) == 0u && (local.y & 1u) == 0u)
+    {
+        ivec2 halfPos = pos / 2;
+        if (halfPos.x < size.x / 2 && halfPos.y < size.y / 2)
+        {
+            vec3 sum = ColorSample[si] + ColorSample[si + 1u]
+                     + ColorSample[si + GroupSize] + ColorSample[si + GroupSize + 1u];
+            imageStore(uTexBloom, halfPos, vec4(sum * 0.25, 1.0));
+        }
+    }
+
+    // Average log luminance of the tile
+    for (uint s = NumThreads / 2u; s > 0u; s >>= 1)
+    {
+        if (si < s)
+        {
+            LumSample[si] += LumSample[si + s];
+            CountSample[si] += CountSample[si + s];
+        }
+        memoryBarrierShared();
+        barrier();
+    }
+
+    if (si == 0u)
+    {
+        float avgLuma = LumSample[0] / max(CountSample[0], 1.0);
+        imageStore(uTexLuma, ivec2(gl_WorkGroupID.xy), vec4(avgLuma));
+    }
+}
@@ -1,33 +1,26 @@
 -- Vertex
 
-// IN
-layout (location = 0) in vec3 inPosition;
-layout (location = 1) in vec3 inNormal;
-layout (location = 2) in vec2 inTexcoords;
-
 // Out
 out vec3 vTexcoords;
 
-uniform mat4 uView;
-uniform mat4 uProjection;
+#include "FrameConstants.glsli"
 
 void main()
 {
-    // Rotate into view-space, centered on the camera
-    vec3 positionVS = mat3(uView)*inPosition;
-
-    gl_Position = uProjection*vec4(positionVS, 1.0);
-
-    // Make a texture coordinate
-	vTexcoords = inPosition;
+    // Triangle covering the screen at infinity, made from gl_VertexID; the
+    // reverse-Z projection puts infinity at a depth of -uProjection[2][2]
+    vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2)*2.0 - 1.0;
+    gl_Position = vec4(position, -uProjection[2][2], 1.0);
+
+    // View ray through the vertex, rotated back into world-space
+    vec3 rayVS = vec3(position.x/uProjection[0][0], position.y/uProjection[1][1], -1.0);
+	vTexcoords = transpose(mat3(uView))*rayVS;
 }
 
 -- Fragment
 
-uniform bool ubEnableSun;
-uniform float uCosSunAngularRadius;
-uniform vec3 uSunDir;
-uniform vec3 uSunColor;
+#include "FrameConstants.glsli"
+
 uniform samplerCube uTexSource;
 
 // IN
@@ -0,0 +1,208 @@
+#include "Benchmark.h"
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <tools/Logger.hpp>
+
+namespace
+{
+    struct Summary
+    {
+        float avg, min, max, p50, p95, p99;
+    };
+
+    Summary summarize(std::vector<float> times)
+    {
+        Summary summary = { 0.f, 0.f, 0.f, 0.f, 0.f, 0.f };
+        if (times.empty())
+            return summary;
+
+        std::sort(times.begin(), times.end());
+        auto percentile = [&times](float p) {
+            auto index = (std::size_t)std::ceil(p * times.size());
+            return times[std::min(std::max<std::size_t>(index, 1), times.size()) - 1];
+        };
+
+        float sum = 0.f;
+        for (auto time : times)
+            sum += time;
+        summary.avg = sum / times.size();
+        summary.min = times.front();
+        summary.max = times.back();
+        summary.p50 = percentile(0.50f);
+        summary.p95 = percentile(0.95f);
+        summary.p99 = percentile(0.99f);
+        return summary;
+    }
+
+    void printSummary(const char* name, const Summary& summary)
+    {
+        printf("%s avg %8.3f  min %8.3f  max %8.3f  p50 %8.3f  p95 %8.3f  p99 %8.3f ms\n", name,
+            summary.avg, summary.min, summary.max, summary.p50, summary.p95, summary.p99);
+    }
+}
+
+Benchmark::Benchmark() noexcept
+    : m_bEnabled(false)
+    , m_FrameCount(600)
+    , m_WarmupCount(30)
+    , m_FrameRate(60.f)
+{
+}
+
+bool Benchmark::load(const std::string& filename)
+{
+    std::ifstream file(filename);
+    if (!file.is_open())
+    {
+        LOG_WARNING("Benchmark : failed to open %s\n", filename);
+        return false;
+    }
+
+    uint32_t lineNumber = 0;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        lineNumber++;
+        line = line.substr(0, line.find('#'));
+
+        std::istringstream stream(line);
+        std::string first;
+        if (!(stream >> first))
+            continue;
+
+        bool bValid = true;
+        if (first == "frames")
+            bValid = !!(stream >> m_FrameCount);
+        else if (first == "warmup")
+            bValid = !!(stream >> m_WarmupCount);
+        else if (first == "fps")
+            bValid = !!(stream >> m_FrameRate) && m_FrameRate > 0.f;
+        else
+        {
+            float time = 0.f;
+            std::string name;
+            std::vector<float> values;
+            std::istringstream key(first);
+            bValid = !!(key >> time) && !!(stream >> name);
+            for (float value = 0.f; stream >> value;)
+                values.push_back(value);
+
+            if (bValid && values.size() == 1)
+            {
+                m_Scalars[name].setLoop(false);
+                m_Scalars[name].addKey(time, values[0]);
+            }
+            else if (bValid && values.size() == 3)
+            {
+                m_Vectors[name].setLoop(false);
+                m_Vectors[name].addKey(time, glm::vec3(values[0], values[1], values[2]));
+            }
+            else
+                bValid = false;
+        }
+
+        if (!bValid)
+        {
+            LOG_WARNING("Benchmark : %s(%u) : can't parse '%s'\n", filename, lineNumber, line);
+            return false;
+        }
+    }
+
+    m_Samples.clear();
+    m_Samples.reserve(m_FrameCount);
+    m_bEnabled = m_FrameCount > 0;
+    return m_bEnabled;
+}
+
+bool Benchmark::isEnabled() const noexcept
+{
+    return m_bEnabled;
+}
+
+bool Benchmark::isFinished() const noexcept
+{
+    return m_Samples.size() >= m_FrameCount;
+}
+
+uint32_t Benchmark::getFrame() const noexcept
+{
+    return (uint32_t)m_Samples.size();
+}
+
+float Benchmark::getTime() const noexcept
+{
+    return getFrame() / m_FrameRate;
+}
+
+bool Benchmark::hasTrack(const std::string& name) const noexcept
+{
+    return m_Scalars.count(name) > 0 || m_Vectors.count(name) > 0;
+}
+
+float Benchmark::evaluate(const std::string& name, float value) const noexcept
+{
+    auto it = m_Scalars.find(name);
+    if (it == m_Scalars.end())
+        return value;
+    return it->second.evaluate(getTime());
+}
+
+glm::vec3 Benchmark::evaluate(const std::string& name, const glm::vec3& value) const noexcept
+{
+    auto it = m_Vectors.find(name);
+    if (it == m_Vectors.end())
+        return value;
+    return it->second.evaluate(getTime());
+}
+
+void Benchmark::addFrame(float cpuTime, float gpuTime, float skyShaded)
+{
+    if (isFinished())
+        return;
+    Sample sample = { cpuTime, gpuTime, skyShaded };
+    m_Samples.push_back(sample);
+}
+
+bool Benchmark::writeReport(const std::string& filename) const
+{
+    std::ofstream file(filename);
+    if (!file.is_open())
+    {
+        LOG_WARNING("Benchmark : failed to write %s\n", filename);
+        return false;
+    }
+
+    file << "frame,time,cpu_ms,gpu_ms,sky_shaded,warmup\n";
+    std::vector<float> cpuTimes, gpuTimes;
+    float skyShaded = 0.f;
+    for (uint32_t i = 0; i < m_Samples.size(); i++)
+    {
+        bool bWarmup = i < m_WarmupCount;
+        file << i << ',' << i / m_FrameRate << ',' << m_Samples[i].cpuTime << ',' << m_Samples[i].gpuTime << ','
+             << m_Samples[i].skyShaded << ',' << bWarmup << '\n';
+        if (bWarmup)
+            continue;
+        cpuTimes.push_back(m_Samples[i].cpuTime);
+        gpuTimes.push_back(m_Samples[i].gpuTime);
+        skyShaded += m_Samples[i].skyShaded;
+    }
+
+    auto cpu = summarize(cpuTimes);
+    auto gpu = summarize(gpuTimes);
+    printf("Benchmark : %zu frames measured, %u warmup, written to %s\n", cpuTimes.size(), std::min<uint32_t>(m_WarmupCount, (uint32_t)m_Samples.size()), filename.c_str());
+    printSummary("CPU", cpu);
+    printSummary("GPU", gpu);
+    if (cpu.avg > 0.f)
+        printf("%.1f fps\n", 1000.f / cpu.avg);
+    // A sky drawn first without depth test shaded every pixel
+    if (!cpuTimes.empty())
+    {
+        skyShaded /= cpuTimes.size();
+        printf("Sky shaded %.1f%% of the pixels, %.1f%% left to geometry\n", skyShaded * 100.f, (1.f - skyShaded) * 100.f);
+    }
+    return true;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <tools/Animation.h>
+
+// Replays a script of keyframed settings for a fixed number of frames and records
+// the time of each. Script lines, '#' starts a comment:
+//   frames <count>                 frames to render, 600 by default
+//   warmup <count>                 leading frames left out of the statistics, 30 by default
+//   fps <rate>                     script time advances by 1 / rate every frame, 60 by default
+//   <time> <name> <value>          key of a scalar setting
+//   <time> <name> <x> <y> <z>      key of a vector setting, e.g. camera 'eye' and 'target'
+class Benchmark final
+{
+public:
+
+    Benchmark() noexcept;
+
+    bool load(const std::string& filename);
+
+    bool isEnabled() const noexcept;
+    bool isFinished() const noexcept;
+
+    // Frames recorded so far, and the script time of the next one
+    uint32_t getFrame() const noexcept;
+    float getTime() const noexcept;
+
+    bool hasTrack(const std::string& name) const noexcept;
+    float evaluate(const std::string& name, float value) const noexcept;
+    glm::vec3 evaluate(const std::string& name, const glm::vec3& value) const noexcept;
+
+    // 'skyShaded' is the share of the pixels the sky pass shaded, 0 to 1
+    void addFrame(float cpuTime, float gpuTime, float skyShaded);
+
+    // Per frame CSV, plus a summary on stdout
+    bool writeReport(const std::string& filename) const;
+
+private:
+
+    struct Sample
+    {
+        float cpuTime;
+        float gpuTime;
+        float skyShaded;
+    };
+
+    bool m_bEnabled;
+    uint32_t m_FrameCount;
+    uint32_t m_WarmupCount;
+    float m_FrameRate;
+    std::map<std::string, AnimationTrack<float>> m_Scalars;
+    std::map<std::string, AnimationTrack<glm::vec3>> m_Vectors;
+    std::vector<Sample> m_Samples;
+};
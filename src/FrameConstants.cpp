@@ -0,0 +1,24 @@
+#include "FrameConstants.h"
+
+#include <GLType/Std140.h>
+
+const char* FrameConstants::BlockName = "FrameConstants";
+
+void FrameConstants::write(Std140Writer& writer) const noexcept
+{
+    writer.reset();
+    writer.write(view);
+    writer.write(projection);
+    writer.write(lutInputMat);
+    writer.write(lutOutputMat);
+    writer.write(sunDir);
+    writer.write(cosSunAngularRadius);
+    writer.write(sunColor);
+    writer.write(exposure);
+    writer.write(lutLogRange);
+    writer.write(keyValue);
+    writer.write(lutSize);
+    writer.write(exposureMode);
+    writer.write(lutType);
+    writer.write(bEnableSun);
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <glm/glm.hpp>
+
+class Std140Writer;
+
+// Mirrors the 'FrameConstants' uniform block of shaders/FrameConstants.glsli
+struct FrameConstants
+{
+    glm::mat4 view = glm::mat4(1.f);
+    glm::mat4 projection = glm::mat4(1.f);
+    glm::mat3 lutInputMat = glm::mat3(1.f);
+    glm::mat3 lutOutputMat = glm::mat3(1.f);
+    glm::vec3 sunDir = glm::vec3(0.f, 1.f, 0.f);
+    float cosSunAngularRadius = 1.f;
+    glm::vec3 sunColor = glm::vec3(0.f);
+    float exposure = 0.f;
+    glm::vec2 lutLogRange = glm::vec2(0.f, 1.f);
+    float keyValue = 0.005f;
+    float lutSize = 1.f;
+    std::int32_t exposureMode = 0;
+    std::int32_t lutType = 0;
+    bool bEnableSun = true;
+
+    // Block name used with 'ProgramShader::initBlockBinding'
+    static const char* BlockName;
+
+    void write(Std140Writer& writer) const noexcept;
+};
@@ -0,0 +1,464 @@
+#include "FrameGraph.h"
+
+#include <cassert>
+#include <chrono>
+#include <algorithm>
+#include <gli/gli.hpp>
+#include <GLType/GraphicsDevice.h>
+#include <tools/Profile.h>
+
+FrameGraphBuilder::FrameGraphBuilder(FrameGraph& graph, std::uint32_t pass) noexcept
+    : m_Graph(graph)
+    , m_Pass(pass)
+{
+}
+
+FrameGraphResource FrameGraphBuilder::create(const std::string& name, const GraphicsTextureDesc& desc) noexcept
+{
+    auto entry = m_Graph.addEntry(name, desc, nullptr);
+    auto node = m_Graph.createNode(entry, m_Pass);
+    m_Graph.m_Passes[m_Pass].creates.push_back(node);
+    return node;
+}
+
+FrameGraphResource FrameGraphBuilder::read(FrameGraphResource resource) noexcept
+{
+    assert(resource < m_Graph.m_Nodes.size());
+
+    auto& reads = m_Graph.m_Passes[m_Pass].reads;
+    if (std::find(reads.begin(), reads.end(), resource) == reads.end())
+        reads.push_back(resource);
+    return resource;
+}
+
+FrameGraphResource FrameGraphBuilder::write(FrameGraphResource resource) noexcept
+{
+    assert(resource < m_Graph.m_Nodes.size());
+
+    auto entryIndex = m_Graph.m_Nodes[resource].entry;
+    auto& entry = m_Graph.m_Entries[entryIndex];
+    entry.version++;
+
+    // Imported resources are visible outside of the graph
+    if (entry.imported)
+        setSideEffect();
+
+    auto node = m_Graph.createNode(entryIndex, m_Pass);
+    m_Graph.m_Passes[m_Pass].writes.push_back(node);
+    return node;
+}
+
+void FrameGraphBuilder::setSideEffect() noexcept
+{
+    m_Graph.m_Passes[m_Pass].bSideEffect = true;
+}
+
+FrameGraphResources::FrameGraphResources(const FrameGraph& graph) noexcept
+    : m_Graph(graph)
+{
+}
+
+const GraphicsTexturePtr& FrameGraphResources::getTexture(FrameGraphResource resource) const noexcept
+{
+    return m_Graph.getTexture(resource);
+}
+
+FrameGraph::FrameGraph() noexcept
+    : m_bCompiled(false)
+    , m_PassCount(0)
+    , m_EntryCount(0)
+{
+}
+
+FrameGraph::~FrameGraph() noexcept
+{
+    reset();
+    for (auto& pass : m_Passes)
+        ::operator delete(pass.storage);
+}
+
+void FrameGraph::reset() noexcept
+{
+    // Releases what the executors captured
+    for (std::uint32_t i = 0; i < m_PassCount; i++)
+    {
+        m_Passes[i].executor->~PassExecutor();
+        m_Passes[i].executor = nullptr;
+    }
+    for (std::uint32_t i = 0; i < m_EntryCount; i++)
+        m_Entries[i].imported = nullptr;
+
+    m_bCompiled = false;
+    m_PassCount = 0;
+    m_EntryCount = 0;
+    m_Nodes.clear();
+}
+
+std::uint32_t FrameGraph::beginPass(const std::string& name) noexcept
+{
+    if (m_PassCount == m_Passes.size())
+        m_Passes.push_back(PassNode());
+
+    // Assigned over last frame's pass, so its buffers are reused
+    auto& pass = m_Passes[m_PassCount];
+    pass.name = name;
+    pass.executor = nullptr;
+    pass.creates.clear();
+    pass.reads.clear();
+    pass.writes.clear();
+    pass.refCount = 0;
+    pass.bSideEffect = false;
+    pass.bCulled = false;
+
+    m_bCompiled = false;
+    return m_PassCount++;
+}
+
+void* FrameGraph::allocatePass(std::uint32_t index, std::size_t size) noexcept
+{
+    auto& pass = m_Passes[index];
+    if (pass.storageSize < size)
+    {
+        ::operator delete(pass.storage);
+        pass.storage = ::operator new(size);
+        pass.storageSize = size;
+    }
+    return pass.storage;
+}
+
+std::uint32_t FrameGraph::addEntry(const std::string& name, const GraphicsTextureDesc& desc, const GraphicsTexturePtr& imported) noexcept
+{
+    if (m_EntryCount == m_Entries.size())
+        m_Entries.push_back(ResourceEntry());
+
+    auto& entry = m_Entries[m_EntryCount];
+    entry.name = name;
+    entry.desc = desc;
+    entry.imported = imported;
+    entry.version = 0;
+    entry.firstPass = -1;
+    entry.lastPass = -1;
+    entry.physical = -1;
+    return m_EntryCount++;
+}
+
+FrameGraphResource FrameGraph::createNode(std::uint32_t entry, std::int32_t producer) noexcept
+{
+    ResourceNode node;
+    node.entry = entry;
+    node.version = m_Entries[entry].version;
+    node.producer = producer;
+    node.refCount = 0;
+    m_Nodes.push_back(node);
+    return (FrameGraphResource)m_Nodes.size() - 1;
+}
+
+FrameGraphResource FrameGraph::importTexture(const std::string& name, const GraphicsTexturePtr& texture) noexcept
+{
+    assert(texture);
+
+    auto entry = addEntry(name, texture->getGraphicsTextureDesc(), texture);
+    return createNode(entry, -1);
+}
+
+bool FrameGraph::compile() noexcept
+{
+    for (auto& node : m_Nodes)
+        node.refCount = 0;
+
+    for (std::uint32_t i = 0; i < m_PassCount; i++)
+    {
+        auto& pass = m_Passes[i];
+        pass.refCount = (std::uint32_t)(pass.creates.size() + pass.writes.size());
+        pass.bCulled = false;
+        for (auto r : pass.reads)
+            m_Nodes[r].refCount++;
+    }
+
+    // Cull passes whose outputs are never read
+    auto& unreferenced = m_Unreferenced;
+    unreferenced.clear();
+    for (std::uint32_t i = 0; i < m_Nodes.size(); i++)
+    {
+        if (m_Nodes[i].refCount == 0)
+            unreferenced.push_back(i);
+    }
+
+    while (!unreferenced.empty())
+    {
+        auto& node = m_Nodes[unreferenced.back()];
+        unreferenced.pop_back();
+
+        if (node.producer < 0)
+            continue;
+
+        auto& producer = m_Passes[node.producer];
+        if (producer.bSideEffect || producer.refCount == 0)
+            continue;
+
+        if (--producer.refCount > 0)
+            continue;
+
+        producer.bCulled = true;
+        for (auto r : producer.reads)
+        {
+            if (--m_Nodes[r].refCount == 0)
+                unreferenced.push_back(r);
+        }
+    }
+
+    // Resource lifetimes, in pass order
+    for (std::uint32_t i = 0; i < m_EntryCount; i++)
+    {
+        auto& entry = m_Entries[i];
+        entry.firstPass = -1;
+        entry.lastPass = -1;
+        entry.physical = -1;
+    }
+
+    for (std::int32_t i = 0; i < (std::int32_t)m_PassCount; i++)
+    {
+        const auto& pass = m_Passes[i];
+        if (pass.bCulled)
+            continue;
+
+        auto touch = [&](const std::vector<FrameGraphResource>& nodes)
+        {
+            for (auto n : nodes)
+            {
+                auto& entry = m_Entries[m_Nodes[n].entry];
+                if (entry.firstPass < 0)
+                    entry.firstPass = i;
+                entry.lastPass = std::max(entry.lastPass, i);
+            }
+        };
+        touch(pass.creates);
+        touch(pass.reads);
+        touch(pass.writes);
+    }
+
+    // Alias transient resources whose lifetimes do not overlap.
+    // Physical slots persist across frames, so a stable graph never reallocates.
+    for (auto& physical : m_Physicals)
+        physical.lastPass = -1;
+
+    auto& order = m_Order;
+    order.clear();
+    for (std::uint32_t i = 0; i < m_EntryCount; i++)
+    {
+        if (!m_Entries[i].imported && m_Entries[i].firstPass >= 0)
+            order.push_back(i);
+    }
+    std::stable_sort(order.begin(), order.end(), [&](std::uint32_t a, std::uint32_t b) {
+        return m_Entries[a].firstPass < m_Entries[b].firstPass;
+    });
+
+    for (auto i : order)
+    {
+        auto& entry = m_Entries[i];
+
+        std::int32_t slot = -1;
+        std::int32_t unusedSlot = -1;
+        for (std::int32_t k = 0; k < (std::int32_t)m_Physicals.size(); k++)
+        {
+            const auto& physical = m_Physicals[k];
+            bool bFree = physical.lastPass < entry.firstPass;
+            if (bFree && isCompatible(physical.desc, entry.desc))
+            {
+                slot = k;
+                break;
+            }
+            if (unusedSlot < 0 && physical.lastPass < 0)
+                unusedSlot = k;
+        }
+
+        if (slot < 0 && unusedSlot >= 0)
+        {
+            // Repurpose a slot not needed this frame
+            slot = unusedSlot;
+            m_Physicals[slot].desc = entry.desc;
+            m_Physicals[slot].texture = nullptr;
+        }
+
+        if (slot < 0)
+        {
+            PhysicalTexture physical;
+            physical.desc = entry.desc;
+            physical.lastPass = -1;
+            m_Physicals.push_back(physical);
+            slot = (std::int32_t)m_Physicals.size() - 1;
+        }
+
+        m_Physicals[slot].lastPass = entry.lastPass;
+        entry.physical = slot;
+    }
+
+    // Release every slot no resource needed this frame, wherever it is
+    m_Remap.assign(m_Physicals.size(), -1);
+    std::int32_t count = 0;
+    for (std::int32_t k = 0; k < (std::int32_t)m_Physicals.size(); k++)
+    {
+        if (m_Physicals[k].lastPass < 0)
+            continue;
+        if (count != k)
+            m_Physicals[count] = std::move(m_Physicals[k]);
+        m_Remap[k] = count++;
+    }
+    m_Physicals.resize(count);
+
+    for (std::uint32_t i = 0; i < m_EntryCount; i++)
+    {
+        auto& entry = m_Entries[i];
+        if (entry.physical >= 0)
+            entry.physical = m_Remap[entry.physical];
+    }
+
+    m_bCompiled = true;
+    return true;
+}
+
+void FrameGraph::execute(const GraphicsDevicePtr& device)
+{
+    using namespace std::chrono;
+
+    assert(device);
+    assert(m_bCompiled);
+
+    for (auto& physical : m_Physicals)
+    {
+        if (!physical.texture && physical.lastPass >= 0)
+            physical.texture = device->createTexture(physical.desc);
+    }
+
+    m_Report.resize(m_PassCount);
+
+    FrameGraphResources resources(*this);
+    for (std::uint32_t i = 0; i < m_PassCount; i++)
+    {
+        const auto& pass = m_Passes[i];
+        auto& report = m_Report[i];
+        report.name = pass.name;
+        report.bCulled = pass.bCulled;
+        report.submitTime = 0.f;
+        if (pass.bCulled)
+            continue;
+
+        // An aliased slot keeps the sampler state of its previous resource
+        for (auto n : pass.creates)
+        {
+            const auto& entry = m_Entries[m_Nodes[n].entry];
+            const auto& texture = m_Physicals[entry.physical].texture;
+            if (texture && !isSamplerEqual(texture->getGraphicsTextureDesc(), entry.desc))
+                texture->setSamplerState(entry.desc);
+        }
+
+        PROFILE_GPU_SCOPE(pass.name.c_str());
+        auto start = high_resolution_clock::now();
+        pass.executor->execute(resources);
+        auto stop = high_resolution_clock::now();
+        report.submitTime = duration_cast<duration<float, std::milli>>(stop - start).count();
+    }
+}
+
+const GraphicsTexturePtr& FrameGraph::getTexture(FrameGraphResource resource) const noexcept
+{
+    static const GraphicsTexturePtr null;
+
+    assert(resource < m_Nodes.size());
+    const auto& entry = m_Entries[m_Nodes[resource].entry];
+    if (entry.imported)
+        return entry.imported;
+    if (entry.physical < 0)
+        return null;
+    return m_Physicals[entry.physical].texture;
+}
+
+std::uint32_t FrameGraph::getPhysicalCount() const noexcept
+{
+    return (std::uint32_t)m_Physicals.size();
+}
+
+std::uint32_t FrameGraph::getPhysicalIndex(FrameGraphResource resource) const noexcept
+{
+    assert(resource < m_Nodes.size());
+    return (std::uint32_t)m_Entries[m_Nodes[resource].entry].physical;
+}
+
+std::int32_t FrameGraph::getFirstPass(FrameGraphResource resource) const noexcept
+{
+    assert(resource < m_Nodes.size());
+    return m_Entries[m_Nodes[resource].entry].firstPass;
+}
+
+std::int32_t FrameGraph::getLastPass(FrameGraphResource resource) const noexcept
+{
+    assert(resource < m_Nodes.size());
+    return m_Entries[m_Nodes[resource].entry].lastPass;
+}
+
+bool FrameGraph::isCulled(const std::string& passName) const noexcept
+{
+    for (std::uint32_t i = 0; i < m_PassCount; i++)
+    {
+        if (m_Passes[i].name == passName)
+            return m_Passes[i].bCulled;
+    }
+    return true;
+}
+
+std::size_t FrameGraph::getTransientMemory() const noexcept
+{
+    std::size_t size = 0;
+    for (const auto& physical : m_Physicals)
+        size += getMemorySize(physical.desc);
+    return size;
+}
+
+std::size_t FrameGraph::getUnaliasedMemory() const noexcept
+{
+    std::size_t size = 0;
+    for (std::uint32_t i = 0; i < m_EntryCount; i++)
+    {
+        const auto& entry = m_Entries[i];
+        if (!entry.imported && entry.firstPass >= 0)
+            size += getMemorySize(entry.desc);
+    }
+    return size;
+}
+
+const std::vector<FrameGraphPassReport>& FrameGraph::getReport() const noexcept
+{
+    return m_Report;
+}
+
+bool FrameGraph::isCompatible(const GraphicsTextureDesc& a, const GraphicsTextureDesc& b) noexcept
+{
+    return a.getWidth() == b.getWidth()
+        && a.getHeight() == b.getHeight()
+        && a.getDepth() == b.getDepth()
+        && a.getLevels() == b.getLevels()
+        && a.getTarget() == b.getTarget()
+        && a.getFormat() == b.getFormat();
+}
+
+bool FrameGraph::isSamplerEqual(const GraphicsTextureDesc& a, const GraphicsTextureDesc& b) noexcept
+{
+    return a.getWrapS() == b.getWrapS()
+        && a.getWrapT() == b.getWrapT()
+        && a.getWrapR() == b.getWrapR()
+        && a.getMinFilter() == b.getMinFilter()
+        && a.getMagFilter() == b.getMagFilter()
+        && a.getAnisotropyLevel() == b.getAnisotropyLevel();
+}
+
+std::size_t FrameGraph::getMemorySize(const GraphicsTextureDesc& desc) noexcept
+{
+    auto format = desc.getFormat();
+    if (format == gli::FORMAT_UNDEFINED)
+        return 0;
+
+    auto extent = gli::block_extent(format);
+    std::size_t blocksX = (desc.getWidth() + extent.x - 1) / extent.x;
+    std::size_t blocksY = (desc.getHeight() + extent.y - 1) / extent.y;
+    return blocksX * blocksY * desc.getDepth() * gli::block_size(format);
+}
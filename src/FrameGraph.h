@@ -0,0 +1,225 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <type_traits>
+#include <GraphicsTypes.h>
+#include <GLType/GraphicsTexture.h>
+
+// Handle to a versioned virtual resource. Every 'write' produces a new version,
+// so each handle has exactly one producing pass.
+typedef std::uint32_t FrameGraphResource;
+
+const FrameGraphResource FrameGraphInvalidResource = ~0u;
+
+class FrameGraph;
+
+class FrameGraphBuilder final
+{
+public:
+
+    FrameGraphResource create(const std::string& name, const GraphicsTextureDesc& desc) noexcept;
+    FrameGraphResource read(FrameGraphResource resource) noexcept;
+    FrameGraphResource write(FrameGraphResource resource) noexcept;
+
+    // Keep the pass alive even when none of its outputs are consumed
+    void setSideEffect() noexcept;
+
+private:
+
+    friend class FrameGraph;
+
+    FrameGraphBuilder(FrameGraph& graph, std::uint32_t pass) noexcept;
+
+    FrameGraph& m_Graph;
+    std::uint32_t m_Pass;
+};
+
+class FrameGraphResources final
+{
+public:
+
+    const GraphicsTexturePtr& getTexture(FrameGraphResource resource) const noexcept;
+
+private:
+
+    friend class FrameGraph;
+
+    FrameGraphResources(const FrameGraph& graph) noexcept;
+
+    const FrameGraph& m_Graph;
+};
+
+// GPU time of a pass is in its profiler zone
+struct FrameGraphPassReport
+{
+    std::string name;
+    bool bCulled;
+    // CPU time spent recording and submitting the pass
+    float submitTime;
+};
+
+class FrameGraph final
+{
+public:
+
+    FrameGraph() noexcept;
+    ~FrameGraph() noexcept;
+
+    // Clear passes and resources of the previous frame. Pass storage and
+    // physical textures are kept, so a stable graph does not allocate.
+    void reset() noexcept;
+
+    FrameGraphResource importTexture(const std::string& name, const GraphicsTexturePtr& texture) noexcept;
+
+    // 'setup(builder)' runs now, 'execute(resources)' when the graph is executed
+    template<typename Setup, typename Execute>
+    void addPass(const std::string& name, Setup&& setup, Execute&& execute);
+
+    // Pass with its own data, filled by 'setup' and handed to 'execute'
+    template<typename Data, typename Setup, typename Execute>
+    const Data& addPass(const std::string& name, Setup&& setup, Execute&& execute);
+
+    // Cull unused passes, compute lifetimes and alias transient resources.
+    // Does not touch the device, so it can run on the CPU alone.
+    bool compile() noexcept;
+    void execute(const GraphicsDevicePtr& device);
+
+    // Number of physical textures needed by the compiled graph
+    std::uint32_t getPhysicalCount() const noexcept;
+    std::uint32_t getPhysicalIndex(FrameGraphResource resource) const noexcept;
+    // First and last pass using the resource, -1 when only culled passes do
+    std::int32_t getFirstPass(FrameGraphResource resource) const noexcept;
+    std::int32_t getLastPass(FrameGraphResource resource) const noexcept;
+    bool isCulled(const std::string& passName) const noexcept;
+
+    std::size_t getTransientMemory() const noexcept;
+    std::size_t getUnaliasedMemory() const noexcept;
+
+    const std::vector<FrameGraphPassReport>& getReport() const noexcept;
+
+private:
+
+    friend class FrameGraphBuilder;
+    friend class FrameGraphResources;
+
+    struct ResourceEntry
+    {
+        std::string name;
+        GraphicsTextureDesc desc;
+        GraphicsTexturePtr imported;
+        std::uint32_t version;
+        std::int32_t firstPass;
+        std::int32_t lastPass;
+        std::int32_t physical;
+    };
+
+    struct ResourceNode
+    {
+        std::uint32_t entry;
+        std::uint32_t version;
+        std::int32_t producer;
+        std::uint32_t refCount;
+    };
+
+    struct PassExecutor
+    {
+        virtual ~PassExecutor() noexcept {}
+        virtual void execute(const FrameGraphResources& resources) = 0;
+    };
+
+    template<typename Data, typename Execute>
+    struct PassExecutorImpl final : PassExecutor
+    {
+        template<typename Func>
+        PassExecutorImpl(Func&& func) : data(), func(std::forward<Func>(func)) {}
+
+        void execute(const FrameGraphResources& resources) override { func(data, resources); }
+
+        Data data;
+        Execute func;
+    };
+
+    struct NoData
+    {
+    };
+
+    // Entries past the pass count are left over from earlier frames
+    struct PassNode
+    {
+        std::string name;
+        PassExecutor* executor;
+        void* storage;
+        std::size_t storageSize;
+        std::vector<FrameGraphResource> creates;
+        std::vector<FrameGraphResource> reads;
+        std::vector<FrameGraphResource> writes;
+        std::uint32_t refCount;
+        bool bSideEffect;
+        bool bCulled;
+    };
+
+    struct PhysicalTexture
+    {
+        GraphicsTextureDesc desc;
+        GraphicsTexturePtr texture;
+        std::int32_t lastPass;
+    };
+
+    std::uint32_t beginPass(const std::string& name) noexcept;
+    void* allocatePass(std::uint32_t pass, std::size_t size) noexcept;
+    std::uint32_t addEntry(const std::string& name, const GraphicsTextureDesc& desc, const GraphicsTexturePtr& imported) noexcept;
+    FrameGraphResource createNode(std::uint32_t entry, std::int32_t producer) noexcept;
+    const GraphicsTexturePtr& getTexture(FrameGraphResource resource) const noexcept;
+
+    // Same storage; wrap and filter modes are applied when a slot is taken
+    static bool isCompatible(const GraphicsTextureDesc& a, const GraphicsTextureDesc& b) noexcept;
+    static bool isSamplerEqual(const GraphicsTextureDesc& a, const GraphicsTextureDesc& b) noexcept;
+    static std::size_t getMemorySize(const GraphicsTextureDesc& desc) noexcept;
+
+    FrameGraph(const FrameGraph&) = delete;
+    FrameGraph& operator=(const FrameGraph&) = delete;
+
+    bool m_bCompiled;
+    std::uint32_t m_PassCount;
+    std::uint32_t m_EntryCount;
+    std::vector<PassNode> m_Passes;
+    std::vector<ResourceNode> m_Nodes;
+    std::vector<ResourceEntry> m_Entries;
+    std::vector<PhysicalTexture> m_Physicals;
+    std::vector<FrameGraphPassReport> m_Report;
+
+    // Scratch of 'compile', kept to not allocate every frame
+    std::vector<FrameGraphResource> m_Unreferenced;
+    std::vector<std::uint32_t> m_Order;
+    std::vector<std::int32_t> m_Remap;
+};
+
+template<typename Setup, typename Execute>
+void FrameGraph::addPass(const std::string& name, Setup&& setup, Execute&& execute)
+{
+    addPass<NoData>(name,
+        [&](FrameGraphBuilder& builder, NoData&) { setup(builder); },
+        [execute = std::forward<Execute>(execute)](const NoData&, const FrameGraphResources& resources) { execute(resources); });
+}
+
+template<typename Data, typename Setup, typename Execute>
+const Data& FrameGraph::addPass(const std::string& name, Setup&& setup, Execute&& execute)
+{
+    typedef PassExecutorImpl<Data, typename std::decay<Execute>::type> Executor;
+    static_assert(alignof(Executor) <= alignof(std::max_align_t), "Pass data can't be over aligned");
+
+    auto index = beginPass(name);
+    auto executor = new (allocatePass(index, sizeof(Executor))) Executor(std::forward<Execute>(execute));
+    m_Passes[index].executor = executor;
+
+    // The executor does not move when more passes are added
+    FrameGraphBuilder builder(*this, index);
+    setup(builder, executor->data);
+    return executor->data;
+}
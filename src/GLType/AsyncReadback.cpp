@@ -0,0 +1,202 @@
+#include <GLType/AsyncReadback.h>
+
+#include <cassert>
+#include <algorithm>
+#include <gli/gli.hpp>
+#include <GLType/OGLTypes.h>
+#include <GLType/OGLCoreTexture.h>
+
+AsyncReadback::AsyncReadback() noexcept
+    : m_Head(0)
+    , m_Count(0)
+    , m_StallCount(0)
+{
+}
+
+AsyncReadback::~AsyncReadback() noexcept
+{
+    shutdown();
+}
+
+bool AsyncReadback::initialize(uint32_t slotCount)
+{
+    assert(m_Slots.empty());
+    assert(slotCount > 0);
+
+    m_Slots.resize(slotCount);
+    for (auto& slot : m_Slots)
+    {
+        glCreateBuffers(1, &slot.buffer);
+        slot.capacity = 0;
+        slot.fence = nullptr;
+    }
+    m_Head = 0;
+    m_Count = 0;
+    return true;
+}
+
+void AsyncReadback::shutdown() noexcept
+{
+    // Pending reads are dropped, not delivered
+    for (auto& slot : m_Slots)
+    {
+        if (slot.fence)
+            glDeleteSync(slot.fence);
+        glDeleteBuffers(1, &slot.buffer);
+    }
+    m_Slots.clear();
+    m_Head = 0;
+    m_Count = 0;
+}
+
+bool AsyncReadback::readTexture(const GraphicsTexturePtr& texture, uint32_t mipLevel, const ReadbackFunc& callback)
+{
+    assert(texture);
+
+    auto& desc = texture->getGraphicsTextureDesc();
+    uint32_t w = std::max(uint32_t(desc.getWidth()) >> mipLevel, 1u);
+    uint32_t h = std::max(uint32_t(desc.getHeight()) >> mipLevel, 1u);
+    return readTexture(texture, 0, 0, 0, w, h, 1, mipLevel, callback);
+}
+
+bool AsyncReadback::readTexture(const GraphicsTexturePtr& texture, uint32_t x, uint32_t y, uint32_t z, uint32_t w, uint32_t h, uint32_t d, uint32_t mipLevel, const ReadbackFunc& callback)
+{
+    using namespace gli;
+
+    assert(texture);
+    assert(w > 0 && h > 0 && d > 0);
+
+    // Needs glGetTextureSubImage from the core device
+    if (!texture->isA<OGLCoreTexture>())
+        return false;
+    auto coreTexture = texture->downcast_pointer<OGLCoreTexture>();
+
+    const gl GL(gl::PROFILE_GL33);
+    const swizzles swizzle(gl::SWIZZLE_RED, gl::SWIZZLE_GREEN, gl::SWIZZLE_BLUE, gl::SWIZZLE_ALPHA);
+    const auto Format = GL.translate(coreTexture->getGraphicsTextureDesc().getFormat(), swizzle);
+
+    GLsizei numBytes = OGLTypes::getFormatNumbytes(Format.External, Format.Type);
+    if (numBytes == 0)
+        return false;
+
+    GLsizei size = w * h * d * numBytes;
+    Slot* slot = acquire(size);
+    if (!slot)
+        return false;
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->buffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glGetTextureSubImage(coreTexture->getTextureID(), mipLevel, x, y, z, w, h, d, Format.External, Format.Type, size, nullptr);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, GL_NONE);
+
+    slot->image = { nullptr, std::size_t(size), w, h, d, Format.External, Format.Type };
+    slot->callback = callback;
+    submit(*slot);
+    return true;
+}
+
+bool AsyncReadback::readFramebuffer(int32_t x, int32_t y, uint32_t w, uint32_t h, const ReadbackFunc& callback)
+{
+    assert(w > 0 && h > 0);
+
+    GLsizei size = w * h * 4;
+    Slot* slot = acquire(size);
+    if (!slot)
+        return false;
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->buffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(x, y, w, h, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, GL_NONE);
+
+    slot->image = { nullptr, std::size_t(size), w, h, 1, GL_RGBA, GL_UNSIGNED_BYTE };
+    slot->callback = callback;
+    submit(*slot);
+    return true;
+}
+
+AsyncReadback::Slot* AsyncReadback::acquire(GLsizeiptr size)
+{
+    if (m_Slots.empty())
+        return nullptr;
+
+    // Full ring; the oldest read is the one most likely to be done
+    if (m_Count == m_Slots.size())
+    {
+        auto& oldest = m_Slots[m_Head];
+        glClientWaitSync(oldest.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        deliver(oldest);
+        m_StallCount++;
+    }
+
+    auto& slot = m_Slots[(m_Head + m_Count) % m_Slots.size()];
+    if (slot.capacity < size)
+    {
+        glNamedBufferData(slot.buffer, size, nullptr, GL_STREAM_READ);
+        slot.capacity = size;
+    }
+    return &slot;
+}
+
+void AsyncReadback::submit(Slot& slot)
+{
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_Count++;
+}
+
+void AsyncReadback::deliver(Slot& slot)
+{
+    assert(&slot == &m_Slots[m_Head]);
+
+    auto data = glMapNamedBufferRange(slot.buffer, 0, slot.image.size, GL_MAP_READ_BIT);
+    if (data)
+    {
+        slot.image.data = static_cast<const std::uint8_t*>(data);
+        if (slot.callback)
+            slot.callback(slot.image);
+        glUnmapNamedBuffer(slot.buffer);
+    }
+
+    glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+    slot.image.data = nullptr;
+    slot.callback = nullptr;
+
+    m_Head = (m_Head + 1) % m_Slots.size();
+    m_Count--;
+}
+
+void AsyncReadback::update()
+{
+    // Reads finish in order, so stop at the first one still in flight
+    while (m_Count > 0)
+    {
+        auto& slot = m_Slots[m_Head];
+        GLenum status = glClientWaitSync(slot.fence, 0, 0);
+        if (status == GL_TIMEOUT_EXPIRED)
+            break;
+        deliver(slot);
+    }
+}
+
+void AsyncReadback::flush()
+{
+    while (m_Count > 0)
+    {
+        auto& slot = m_Slots[m_Head];
+        glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        deliver(slot);
+    }
+}
+
+uint32_t AsyncReadback::getPendingCount() const noexcept
+{
+    return m_Count;
+}
+
+uint32_t AsyncReadback::getStallCount() const noexcept
+{
+    return m_StallCount;
+}
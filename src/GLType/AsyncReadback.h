@@ -0,0 +1,74 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <vector>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+#include <GraphicsTypes.h>
+
+struct ReadbackImage
+{
+    const std::uint8_t* data;
+    std::size_t size;
+    uint32_t width;
+    uint32_t height;
+    uint32_t depth;
+    GLenum format;
+    GLenum type;
+};
+
+// Copies texture or framebuffer pixels into a ring of pixel pack buffers and hands them
+// to a callback once their fence signals, usually a frame or two later. Unlike
+// OGLCoreTexture::map this never waits on the GPU unless every slot is still in flight.
+class AsyncReadback final
+{
+public:
+
+    // 'data' is only valid during the call, which must not issue another read
+    typedef std::function<void(const ReadbackImage& image)> ReadbackFunc;
+
+    AsyncReadback() noexcept;
+    ~AsyncReadback() noexcept;
+
+    bool initialize(uint32_t slotCount = 3);
+    void shutdown() noexcept;
+
+    bool readTexture(const GraphicsTexturePtr& texture, uint32_t mipLevel, const ReadbackFunc& callback);
+    bool readTexture(const GraphicsTexturePtr& texture, uint32_t x, uint32_t y, uint32_t z, uint32_t w, uint32_t h, uint32_t d, uint32_t mipLevel, const ReadbackFunc& callback);
+
+    // RGBA8 pixels of the bound read framebuffer, bottom row first
+    bool readFramebuffer(int32_t x, int32_t y, uint32_t w, uint32_t h, const ReadbackFunc& callback);
+
+    // Delivers the reads that completed; call once per frame on the GL thread
+    void update();
+    // Blocks until every pending read is delivered
+    void flush();
+
+    uint32_t getPendingCount() const noexcept;
+    // Reads that had to wait because the ring was full
+    uint32_t getStallCount() const noexcept;
+
+private:
+
+    struct Slot
+    {
+        GLuint buffer;
+        GLsizeiptr capacity;
+        GLsync fence;
+        ReadbackImage image;
+        ReadbackFunc callback;
+    };
+
+    Slot* acquire(GLsizeiptr size);
+    void submit(Slot& slot);
+    void deliver(Slot& slot);
+
+    AsyncReadback(const AsyncReadback&) = delete;
+    AsyncReadback& operator=(const AsyncReadback&) = delete;
+
+    std::vector<Slot> m_Slots;
+    uint32_t m_Head;
+    uint32_t m_Count;
+    uint32_t m_StallCount;
+};
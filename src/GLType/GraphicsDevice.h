@@ -26,10 +26,12 @@ public:
     virtual ~GraphicsDevice() noexcept;
 
 	virtual GraphicsDataPtr createGraphicsData(const GraphicsDataDesc& desc) noexcept = 0;
-    virtual GraphicsTexturePtr createTexture(const gli::texture& texture) noexcept = 0;
+    // 'bFlip' turns the images upside down on upload; producers may write them flipped already
+    virtual GraphicsTexturePtr createTexture(const gli::texture& texture, bool bFlip = true) noexcept = 0;
     virtual GraphicsTexturePtr createTexture(const GraphicsTextureDesc& desc) noexcept = 0;
     virtual GraphicsFramebufferPtr createFramebuffer(const GraphicsFramebufferDesc& desc) noexcept = 0;
 
+    // nullptr binds the default framebuffer
     virtual void setFramebuffer(const GraphicsFramebufferPtr& framebuffer) noexcept = 0;
 
 	virtual const GraphicsDeviceDesc& getGraphicsDeviceDesc() const noexcept = 0;
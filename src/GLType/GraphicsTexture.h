@@ -97,6 +97,9 @@ public:
     virtual const GraphicsTextureDesc& getGraphicsTextureDesc() const noexcept = 0;
     virtual const GraphicsFramebufferPtr& getGraphicsRenderTarget() const noexcept = 0;
 
+    // Wrap and filter modes of 'desc'; the storage is left as it is
+    virtual void setSamplerState(const GraphicsTextureDesc& desc) noexcept = 0;
+
 private:
 
     friend class GraphicsDevice;
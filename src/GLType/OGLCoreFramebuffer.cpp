@@ -1,12 +1,14 @@
 #include "GLType/OGLCoreFramebuffer.h"
 #include <GL/glew.h>
 #include <GLType/OGLCoreTexture.h>
+#include <GLType/OGLDevice.h>
 #include <cassert>
 
 __ImplementSubInterface(OGLCoreFramebuffer, GraphicsFramebuffer)
 
 OGLCoreFramebuffer::OGLCoreFramebuffer() noexcept 
     : m_FBO(GL_NONE)
+    , m_OGLDevice(nullptr)
 {
 }
 
@@ -23,12 +25,16 @@ const GraphicsFramebufferDesc& OGLCoreFramebuffer::getGraphicsFramebufferDesc()
 void OGLCoreFramebuffer::bind() noexcept
 {
     assert(m_FBO != GL_NONE);
-    glBindFramebuffer(GL_FRAMEBUFFER, m_FBO);
+    if (m_OGLDevice)
+        m_OGLDevice->bindFramebuffer(m_FBO);
+    else
+        glBindFramebuffer(GL_FRAMEBUFFER, m_FBO);
 }
 
 void OGLCoreFramebuffer::setDevice(GraphicsDevicePtr device) noexcept
 {
     m_Device = device;
+    m_OGLDevice = device ? device->downcast<OGLDevice>() : nullptr;
 }
 
 GraphicsDevicePtr OGLCoreFramebuffer::getDevice() noexcept
@@ -70,6 +76,9 @@ void OGLCoreFramebuffer::destroy() noexcept
 {
     if (m_FBO != GL_NONE)
     {
+        auto device = getDevice();
+        if (device)
+            device->downcast<OGLDevice>()->invalidateFramebuffer(m_FBO);
         glDeleteFramebuffers(1, &m_FBO);
         m_FBO = 0;
     }
@@ -2,6 +2,8 @@
 
 #include "GLType/GraphicsFramebuffer.h"
 
+class OGLDevice;
+
 class OGLCoreFramebuffer final : public GraphicsFramebuffer
 {
     __DeclareSubInterface(OGLCoreFramebuffer, GraphicsFramebuffer)
@@ -27,5 +29,7 @@ private:
 
     std::uint32_t m_FBO;
 	GraphicsDeviceWeakPtr m_Device;
+    // The device outlives the binds of its framebuffers, so they skip the lock
+    OGLDevice* m_OGLDevice;
     GraphicsFramebufferDesc m_FramebufferDesc;
 };
@@ -1,9 +1,13 @@
+#include <cstring>
+#include <algorithm>
 #include <gli/gli.hpp>
 #include <tools/stb_image.h>
 #include <tools/string.h>
 #include <tools/FileUtility.h>
+#include <tools/MappedFile.h>
 #include <GLType/OGLTypes.h>
 #include <GLType/OGLCoreTexture.h>
+#include <GLType/OGLDevice.h>
 
 __ImplementSubInterface(OGLCoreTexture, GraphicsTexture)
 
@@ -13,6 +17,7 @@ OGLCoreTexture::OGLCoreTexture()
     , m_FormatInternal(GL_INVALID_ENUM)
 	, m_PBO(GL_NONE)
 	, m_PBOSize(0)
+    , m_OGLDevice(nullptr)
 {
 }
 
@@ -47,53 +52,48 @@ bool OGLCoreTexture::create(GLint width, GLint height, GLenum target, GraphicsFo
 	return true;
 }
 
-bool OGLCoreTexture::create(const gli::texture& texture) noexcept
+namespace
+{
+    // Writes the rows of a 2D image bottom up
+    void flipRows(std::uint8_t* dst, const std::uint8_t* src, std::size_t rowSize, std::size_t rows) noexcept
+    {
+        for (std::size_t y = 0; y < rows; y++)
+            std::memcpy(dst + rowSize * y, src + rowSize * (rows - y - 1), rowSize);
+    }
+}
+
+bool OGLCoreTexture::create(const gli::texture& texture, bool bFlip) noexcept
 {
 	if (texture.empty())
 		return false;
 
-    auto Texture = gli::flip(texture);
+    // gli::flip only handles 2D images
+    bFlip = bFlip
+        && texture.target() != gli::TARGET_1D
+        && texture.target() != gli::TARGET_1D_ARRAY
+        && texture.target() != gli::TARGET_3D;
 
-	gli::gl GL(gli::gl::PROFILE_GL33);
-	gli::gl::format const Format = GL.translate(Texture.format(), Texture.swizzles());
-	GLenum Target = GL.translate(Texture.target());
+    // Uncompressed images are flipped while copied into a staging buffer;
+    // block compressed ones still need gli::flip to reorder the texels inside each block
+    bool bCompressed = gli::is_compressed(texture.format());
+    bool bStaging = bFlip && !bCompressed;
+    auto Texture = (bFlip && bCompressed) ? gli::flip(texture) : texture;
 
-	GLuint TextureID = 0;
-	glCreateTextures(Target, 1, &TextureID);
-	glTextureParameteri(TextureID, GL_TEXTURE_BASE_LEVEL, 0);
-	glTextureParameteri(TextureID, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(Texture.levels() - 1));
-	glTextureParameteri(TextureID, GL_TEXTURE_SWIZZLE_R, Format.Swizzles[0]);
-	glTextureParameteri(TextureID, GL_TEXTURE_SWIZZLE_G, Format.Swizzles[1]);
-	glTextureParameteri(TextureID, GL_TEXTURE_SWIZZLE_B, Format.Swizzles[2]);
-	glTextureParameteri(TextureID, GL_TEXTURE_SWIZZLE_A, Format.Swizzles[3]);
+	if (!createStorage(Texture))
+		return false;
 
-	glm::tvec3<GLsizei> const Extent(Texture.extent());
-	GLsizei const FaceTotal = static_cast<GLsizei>(Texture.layers() * Texture.faces());
+	gli::gl GL(gli::gl::PROFILE_GL33);
+	gli::gl::format const Format = GL.translate(Texture.format(), Texture.swizzles());
+	GLenum Target = m_Target;
+	GLuint TextureID = m_TextureID;
 
-	switch(Texture.target())
+	// Sized for the largest image and reused for every one of them
+	GLuint StagingBuffer = GL_NONE;
+	if (bStaging)
 	{
-	case gli::TARGET_1D:
-		glTextureStorage1D(
-			TextureID, static_cast<GLint>(Texture.levels()), Format.Internal, Extent.x);
-		break;
-	case gli::TARGET_1D_ARRAY:
-	case gli::TARGET_2D:
-	case gli::TARGET_CUBE:
-		glTextureStorage2D(
-			TextureID, static_cast<GLint>(Texture.levels()), Format.Internal,
-			Extent.x, Extent.y);
-		break;
-	case gli::TARGET_2D_ARRAY:
-	case gli::TARGET_3D:
-	case gli::TARGET_CUBE_ARRAY:
-		glTextureStorage3D(
-			TextureID, static_cast<GLint>(Texture.levels()), Format.Internal,
-			Extent.x, Extent.y,
-			Texture.target() == gli::TARGET_3D ? Extent.z : FaceTotal);
-		break;
-	default:
-		assert(0);
-		break;
+		glCreateBuffers(1, &StagingBuffer);
+		glNamedBufferData(StagingBuffer, Texture.size(0), nullptr, GL_STREAM_DRAW);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, StagingBuffer);
 	}
 
 	for(std::size_t Layer = 0; Layer < Texture.layers(); ++Layer)
@@ -106,6 +106,21 @@ bool OGLCoreTexture::create(const gli::texture& texture) noexcept
 			? static_cast<GLenum>(GL_TEXTURE_CUBE_MAP_POSITIVE_X + Face)
 			: Target;
 
+		// With the staging buffer bound, the pointer below is an offset into it
+		const void* Data = Texture.data(Layer, Face, Level);
+		if (bStaging)
+		{
+			std::size_t const Size = Texture.size(Level);
+			// Invalidating lets the driver orphan the storage still read by the previous upload
+			auto Dst = static_cast<std::uint8_t*>(glMapNamedBufferRange(
+				StagingBuffer, 0, Size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+			if (!Dst)
+				break;
+			flipRows(Dst, static_cast<const std::uint8_t*>(Data), Size / Extent.y, Extent.y);
+			glUnmapNamedBuffer(StagingBuffer);
+			Data = nullptr;
+		}
+
 		switch(Texture.target())
 		{
 		case gli::TARGET_1D:
@@ -113,12 +128,12 @@ bool OGLCoreTexture::create(const gli::texture& texture) noexcept
 				glCompressedTextureSubImage1D(
 					TextureID, static_cast<GLint>(Level), 0, Extent.x,
 					Format.Internal, static_cast<GLsizei>(Texture.size(Level)),
-					Texture.data(Layer, Face, Level));
+					Data);
 			else
 				glTextureSubImage1D(
 					TextureID, static_cast<GLint>(Level), 0, Extent.x,
 					Format.External, Format.Type,
-					Texture.data(Layer, Face, Level));
+					Data);
 			break;
 		case gli::TARGET_1D_ARRAY:
 		case gli::TARGET_2D:
@@ -129,7 +144,7 @@ bool OGLCoreTexture::create(const gli::texture& texture) noexcept
 					Extent.x,
 					Texture.target() == gli::TARGET_1D_ARRAY ? LayerGL : Extent.y,
 					Format.Internal, static_cast<GLsizei>(Texture.size(Level)),
-					Texture.data(Layer, Face, Level));
+					Data);
 			else
 				glTextureSubImage2D(
 					TextureID, static_cast<GLint>(Level),
@@ -137,7 +152,7 @@ bool OGLCoreTexture::create(const gli::texture& texture) noexcept
 					Extent.x,
 					Texture.target() == gli::TARGET_1D_ARRAY ? LayerGL : Extent.y,
 					Format.External, Format.Type,
-					Texture.data(Layer, Face, Level));
+					Data);
 			break;
 		case gli::TARGET_CUBE:
 		case gli::TARGET_2D_ARRAY:
@@ -150,7 +165,7 @@ bool OGLCoreTexture::create(const gli::texture& texture) noexcept
 					Extent.x, Extent.y,
 					Texture.target() == gli::TARGET_3D ? Extent.z : 1,
 					Format.Internal, static_cast<GLsizei>(Texture.size(Level)),
-					Texture.data(Layer, Face, Level));
+					Data);
 			else
 				glTextureSubImage3D(
 					TextureID, static_cast<GLint>(Level),
@@ -158,13 +173,70 @@ bool OGLCoreTexture::create(const gli::texture& texture) noexcept
                     Extent.x, Extent.y,
                     Texture.target() == gli::TARGET_3D ? Extent.z : 1,
 					Format.External, Format.Type,
-					Texture.data(Layer, Face, Level));
+					Data);
 			break;
 		default: 
 			assert(0); 
 			break;
 		}
 	}
+
+	if (bStaging)
+	{
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, GL_NONE);
+		glDeleteBuffers(1, &StagingBuffer);
+	}
+
+	return true;
+}
+
+bool OGLCoreTexture::createStorage(const gli::texture& Texture) noexcept
+{
+	if (Texture.empty())
+		return false;
+
+	gli::gl GL(gli::gl::PROFILE_GL33);
+	gli::gl::format const Format = GL.translate(Texture.format(), Texture.swizzles());
+	GLenum Target = GL.translate(Texture.target());
+
+	GLuint TextureID = 0;
+	glCreateTextures(Target, 1, &TextureID);
+	glTextureParameteri(TextureID, GL_TEXTURE_BASE_LEVEL, 0);
+	glTextureParameteri(TextureID, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(Texture.levels() - 1));
+	glTextureParameteri(TextureID, GL_TEXTURE_SWIZZLE_R, Format.Swizzles[0]);
+	glTextureParameteri(TextureID, GL_TEXTURE_SWIZZLE_G, Format.Swizzles[1]);
+	glTextureParameteri(TextureID, GL_TEXTURE_SWIZZLE_B, Format.Swizzles[2]);
+	glTextureParameteri(TextureID, GL_TEXTURE_SWIZZLE_A, Format.Swizzles[3]);
+
+	glm::tvec3<GLsizei> const Extent(Texture.extent());
+	GLsizei const FaceTotal = static_cast<GLsizei>(Texture.layers() * Texture.faces());
+
+	switch(Texture.target())
+	{
+	case gli::TARGET_1D:
+		glTextureStorage1D(
+			TextureID, static_cast<GLint>(Texture.levels()), Format.Internal, Extent.x);
+		break;
+	case gli::TARGET_1D_ARRAY:
+	case gli::TARGET_2D:
+	case gli::TARGET_CUBE:
+		glTextureStorage2D(
+			TextureID, static_cast<GLint>(Texture.levels()), Format.Internal,
+			Extent.x, Extent.y);
+		break;
+	case gli::TARGET_2D_ARRAY:
+	case gli::TARGET_3D:
+	case gli::TARGET_CUBE_ARRAY:
+		glTextureStorage3D(
+			TextureID, static_cast<GLint>(Texture.levels()), Format.Internal,
+			Extent.x, Extent.y,
+			Texture.target() == gli::TARGET_3D ? Extent.z : FaceTotal);
+		break;
+	default:
+		assert(0);
+		break;
+	}
+
 	m_Target = Target;
 	m_TextureID = TextureID;
 	m_FormatInternal = Format.Internal;
@@ -209,18 +281,19 @@ bool OGLCoreTexture::create(const std::string& filename) noexcept
     if (filename.empty()) 
         return false;
 
-    auto data = util::ReadFileSync(filename);
-    if (data == util::NullFile)
+    // Decoders read the mapped file directly
+    MappedFile data(filename);
+    if (!data.isOpen())
         return false;
 
     const std::string ext = util::getFileExtension(filename);
     if (util::stricmp(ext, "zlib"))
-        return createFromMemoryZIP(data->data(), data->size());
+        return createFromMemoryZIP(data.data(), data.size());
     else if (util::stricmp(ext, "DDS") || util::stricmp(ext, "KTX"))
-        return createFromMemoryDDS(data->data(), data->size());
+        return createFromMemoryDDS(data.data(), data.size());
     else if (util::stricmp(ext, "HDR"))
-        return createFromMemoryHDR(data->data(), data->size());
-    return createFromMemoryLDR(data->data(), data->size());
+        return createFromMemoryHDR(data.data(), data.size());
+    return createFromMemoryLDR(data.data(), data.size());
 } 
 
 bool OGLCoreTexture::createFromMemoryLDR(const char* data, size_t size) noexcept
@@ -249,14 +322,10 @@ bool OGLCoreTexture::createFromMemoryLDR(const char* data, size_t size) noexcept
 
 bool OGLCoreTexture::createFromMemoryZIP(const char* data, size_t dataSize) noexcept
 {
-    int decodesize = 0;
-    // malloc never throws exception
-    char* decodedata = stbi_zlib_decode_malloc(data, (int)dataSize, &decodesize);
-    if (decodedata == nullptr)
+    auto decoded = util::DecompressMemory(data, dataSize);
+    if (decoded->empty())
         return false;
-    bool bSuccess = createFromMemory(decodedata, decodesize);
-    free(decodedata);
-    return bSuccess;
+    return createFromMemory(decoded->data(), decoded->size());
 }
 
 void OGLCoreTexture::setGraphicsRenderTarget(const GraphicsFramebufferPtr& target) noexcept
@@ -287,6 +356,7 @@ const GraphicsFramebufferPtr& OGLCoreTexture::getGraphicsRenderTarget() const no
 void OGLCoreTexture::setDevice(const GraphicsDevicePtr& device) noexcept
 {
     m_Device = device;
+    m_OGLDevice = device ? device->downcast<OGLDevice>() : nullptr;
 }
 
 GraphicsDevicePtr OGLCoreTexture::getDevice() noexcept
@@ -298,6 +368,9 @@ void OGLCoreTexture::destroy() noexcept
 {
 	if (m_TextureID != GL_NONE)
 	{
+		auto device = m_Device.lock();
+		if (device)
+			device->downcast<OGLDevice>()->invalidateTexture(m_TextureID);
 		glDeleteTextures(1, &m_TextureID);
 		m_TextureID = GL_NONE;
 
@@ -316,12 +389,20 @@ void OGLCoreTexture::destroy() noexcept
 void OGLCoreTexture::bind(GLuint unit) const
 {
 	assert( 0u != m_TextureID );  
-    glBindTextureUnit(unit, m_TextureID);
+    bindUnit(unit, m_TextureID);
 }
 
 void OGLCoreTexture::unbind(GLuint unit) const
 {
-    glBindTextureUnit(unit, 0);
+    bindUnit(unit, 0);
+}
+
+void OGLCoreTexture::bindUnit(GLuint unit, GLuint texture) const
+{
+    if (m_OGLDevice)
+        m_OGLDevice->bindTexture(unit, m_Target, texture);
+    else
+        glBindTextureUnit(unit, texture);
 }
 
 void OGLCoreTexture::generateMipmap()
@@ -342,7 +423,7 @@ void OGLCoreTexture::applyParameters(const GraphicsTextureDesc& desc)
     if (wrapS != defaultWrap)
         parameteri(GL_TEXTURE_WRAP_S, wrapS);
     if (wrapT != defaultWrap)
-        parameteri(GL_TEXTURE_WRAP_T, wrapS);
+        parameteri(GL_TEXTURE_WRAP_T, wrapT);
     if (wrapR != defaultWrap)
         parameteri(GL_TEXTURE_WRAP_R, wrapR);
 
@@ -363,6 +444,25 @@ void OGLCoreTexture::applyParameters(const GraphicsTextureDesc& desc)
 }
 
 
+void OGLCoreTexture::setSamplerState(const GraphicsTextureDesc& desc) noexcept
+{
+    // Every mode is set, the texture may not be at the defaults 'applyParameters' assumes
+    parameteri(GL_TEXTURE_WRAP_S, desc.getWrapS());
+    parameteri(GL_TEXTURE_WRAP_T, desc.getWrapT());
+    parameteri(GL_TEXTURE_WRAP_R, desc.getWrapR());
+    parameteri(GL_TEXTURE_MIN_FILTER, desc.getMinFilter());
+    parameteri(GL_TEXTURE_MAG_FILTER, desc.getMagFilter());
+    if (desc.getAnisotropyLevel() != m_TextureDesc.getAnisotropyLevel())
+        parameterf(GL_TEXTURE_MAX_ANISOTROPY_EXT, std::max(desc.getAnisotropyLevel(), 1.f));
+
+    m_TextureDesc.setWrapS(desc.getWrapS());
+    m_TextureDesc.setWrapT(desc.getWrapT());
+    m_TextureDesc.setWrapR(desc.getWrapR());
+    m_TextureDesc.setMinFilter(desc.getMinFilter());
+    m_TextureDesc.setMagFilter(desc.getMagFilter());
+    m_TextureDesc.setAnisotropyLevel(desc.getAnisotropyLevel());
+}
+
 void OGLCoreTexture::parameteri(GLenum pname, GLint param)
 {
 	assert(m_Target != GL_INVALID_ENUM);
@@ -6,6 +6,8 @@
 #include <tools/Rtti.h>
 #include <GLType/GraphicsTexture.h>
 
+class OGLDevice;
+
 class OGLCoreTexture final : public GraphicsTexture
 {
 	__DeclareSubInterface(OGLCoreTexture, GraphicsTexture)
@@ -14,7 +16,7 @@ public:
 	OGLCoreTexture();
     virtual ~OGLCoreTexture();
 
-	bool create(const gli::texture& texture) noexcept;
+	bool create(const gli::texture& texture, bool bFlip = true) noexcept;
     bool create(const GraphicsTextureDesc& desc) noexcept;
 	bool create(const std::string& filename) noexcept;
 	void destroy() noexcept;
@@ -22,6 +24,7 @@ public:
 	void unbind(GLuint unit) const;
 	void generateMipmap();
 
+    // Waits for the GPU to finish the copy; use AsyncReadback for repeated reads
     bool map(std::uint32_t mipLevel, std::uint8_t** data) noexcept override;
     bool map(std::uint32_t x, std::uint32_t y, std::uint32_t z, std::uint32_t w, std::uint32_t h, std::uint32_t d, std::uint32_t mipLevel, std::uint8_t** data) noexcept override; 
 	void unmap() noexcept override;
@@ -31,14 +34,18 @@ public:
 
     const GraphicsTextureDesc& getGraphicsTextureDesc() const noexcept override;
     const GraphicsFramebufferPtr& getGraphicsRenderTarget() const noexcept override;
+    void setSamplerState(const GraphicsTextureDesc& desc) noexcept override;
 
 private:
 
     void applyParameters(const GraphicsTextureDesc& desc);
+	void bindUnit(GLuint unit, GLuint texture) const;
 	void parameteri(GLenum pname, GLint param);
 	void parameterf(GLenum pname, GLfloat param);
 
 	bool create(GLint width, GLint height, GLenum target, GraphicsFormat format, GLuint levels, const uint8_t* data, uint32_t size) noexcept;
+    // Allocates immutable storage shaped like 'texture' without uploading it
+    bool createStorage(const gli::texture& texture) noexcept;
     bool createFromMemory(const char* data, size_t dataSize) noexcept;
     bool createFromMemoryDDS(const char* data, size_t dataSize) noexcept; // DDS, KTX
     bool createFromMemoryHDR(const char* data, size_t dataSize) noexcept; // HDR
@@ -50,6 +57,7 @@ private:
 private:
 
 	friend class OGLDevice;
+	friend class TextureLoader;
 	void setDevice(const GraphicsDevicePtr& device) noexcept;
 	GraphicsDevicePtr getDevice() noexcept;
 
@@ -68,6 +76,8 @@ private:
 	GLuint m_PBO;
 	GLsizei m_PBOSize;
 	GraphicsDeviceWeakPtr m_Device;
+    // The device outlives the binds of its textures, so they skip the lock
+    OGLDevice* m_OGLDevice;
     GraphicsFramebufferPtr m_RenderTarget;
 };
 
@@ -5,30 +5,56 @@
 #include <GLType/OGLCoreTexture.h>
 #include <GLType/OGLFramebuffer.h>
 #include <GLType/OGLCoreFramebuffer.h>
+#include <cstring>
+#include <algorithm>
 
 __ImplementSubInterface(OGLDevice, GraphicsDevice)
 
+namespace
+{
+    const std::int8_t UnknownState = -1;
+    const GLuint UnknownBinding = ~0u;
+}
+
+const GLenum OGLDevice::CachedCaps[] = {
+    GL_DEPTH_TEST, GL_CULL_FACE, GL_BLEND, GL_SCISSOR_TEST, GL_STENCIL_TEST, GL_TEXTURE_CUBE_MAP_SEAMLESS
+};
+
 OGLDevice::OGLDevice() noexcept
+    : m_DeviceType(GraphicsDeviceType::GraphicsDeviceTypeMaxEnum)
+    , m_EmptyVAO(GL_NONE)
 {
+    static_assert(sizeof(CachedCaps) / sizeof(CachedCaps[0]) == NumCachedCaps, "CachedCaps size");
+
+    invalidateState();
+    std::memset(&m_Stats, 0, sizeof(m_Stats));
+    std::memset(&m_FrameStats, 0, sizeof(m_FrameStats));
 }
 
 OGLDevice::~OGLDevice() noexcept
 {
+    destoy();
 }
 
 bool OGLDevice::create(const GraphicsDeviceDesc& desc) noexcept
 {
     m_Desc = desc;
+    m_DeviceType = desc.getDeviceType();
     return true;
 }
 
 void OGLDevice::destoy() noexcept
 {
+    if (m_EmptyVAO != GL_NONE)
+    {
+        glDeleteVertexArrays(1, &m_EmptyVAO);
+        m_EmptyVAO = GL_NONE;
+    }
 }
 
 GraphicsDataPtr OGLDevice::createGraphicsData(const GraphicsDataDesc& desc) noexcept
 {
-    if (m_Desc.getDeviceType() == GraphicsDeviceType::GraphicsDeviceTypeOpenGLCore)
+    if (m_DeviceType == GraphicsDeviceType::GraphicsDeviceTypeOpenGLCore)
     {
         auto data = std::make_shared<OGLCoreGraphicsData>();
         if (!data) return nullptr;
@@ -37,7 +63,7 @@ GraphicsDataPtr OGLDevice::createGraphicsData(const GraphicsDataDesc& desc) noex
             return data;
         return nullptr;
     }
-    else if (m_Desc.getDeviceType() == GraphicsDeviceType::GraphicsDeviceTypeOpenGL)
+    else if (m_DeviceType == GraphicsDeviceType::GraphicsDeviceTypeOpenGL)
     {
         auto data = std::make_shared<OGLGraphicsData>();
         if (!data) return nullptr;
@@ -49,23 +75,23 @@ GraphicsDataPtr OGLDevice::createGraphicsData(const GraphicsDataDesc& desc) noex
     return nullptr;
 }
 
-GraphicsTexturePtr OGLDevice::createTexture(const gli::texture& resource) noexcept
+GraphicsTexturePtr OGLDevice::createTexture(const gli::texture& resource, bool bFlip) noexcept
 {
-    if (m_Desc.getDeviceType() == GraphicsDeviceType::GraphicsDeviceTypeOpenGLCore)
+    if (m_DeviceType == GraphicsDeviceType::GraphicsDeviceTypeOpenGLCore)
     {
         auto texture = std::make_shared<OGLCoreTexture>();
         if (!texture) return nullptr;
 		texture->setDevice(this->downcast_pointer<OGLDevice>());
-        if (texture->create(resource))
+        if (texture->create(resource, bFlip))
             return texture;
         return nullptr;
     }
-    else if (m_Desc.getDeviceType() == GraphicsDeviceType::GraphicsDeviceTypeOpenGL)
+    else if (m_DeviceType == GraphicsDeviceType::GraphicsDeviceTypeOpenGL)
     {
         auto texture = std::make_shared<OGLTexture>();
         if (!texture) return nullptr;
 		texture->setDevice(this->downcast_pointer<OGLDevice>());
-        if (texture->create(resource))
+        if (texture->create(resource, bFlip))
             return texture;
         return nullptr;
     }
@@ -81,7 +107,7 @@ GraphicsFramebufferPtr OGLDevice::createRenderTarget(const GraphicsTexturePtr& t
 
 GraphicsTexturePtr OGLDevice::createTexture(const GraphicsTextureDesc& desc) noexcept
 {
-    if (m_Desc.getDeviceType() == GraphicsDeviceType::GraphicsDeviceTypeOpenGLCore)
+    if (m_DeviceType == GraphicsDeviceType::GraphicsDeviceTypeOpenGLCore)
     {
         auto texture = std::make_shared<OGLCoreTexture>();
         if (!texture) return nullptr;
@@ -91,7 +117,7 @@ GraphicsTexturePtr OGLDevice::createTexture(const GraphicsTextureDesc& desc) noe
         texture->setGraphicsRenderTarget(createRenderTarget(texture));
         return texture;
     }
-    else if (m_Desc.getDeviceType() == GraphicsDeviceType::GraphicsDeviceTypeOpenGL)
+    else if (m_DeviceType == GraphicsDeviceType::GraphicsDeviceTypeOpenGL)
     {
         auto texture = std::make_shared<OGLTexture>();
         if (!texture) return nullptr;
@@ -106,7 +132,7 @@ GraphicsTexturePtr OGLDevice::createTexture(const GraphicsTextureDesc& desc) noe
 
 GraphicsFramebufferPtr OGLDevice::createFramebuffer(const GraphicsFramebufferDesc& desc) noexcept
 {
-    if (m_Desc.getDeviceType() == GraphicsDeviceType::GraphicsDeviceTypeOpenGLCore)
+    if (m_DeviceType == GraphicsDeviceType::GraphicsDeviceTypeOpenGLCore)
     {
         auto fbo = std::make_shared<OGLCoreFramebuffer>();
         if (!fbo) return nullptr;
@@ -115,7 +141,7 @@ GraphicsFramebufferPtr OGLDevice::createFramebuffer(const GraphicsFramebufferDes
             return fbo;
         return nullptr;
     }
-    else if (m_Desc.getDeviceType() == GraphicsDeviceType::GraphicsDeviceTypeOpenGL)
+    else if (m_DeviceType == GraphicsDeviceType::GraphicsDeviceTypeOpenGL)
     {
         auto fbo = std::make_shared<OGLFramebuffer>();
         if (!fbo) return nullptr;
@@ -129,21 +155,147 @@ GraphicsFramebufferPtr OGLDevice::createFramebuffer(const GraphicsFramebufferDes
 
 void OGLDevice::setFramebuffer(const GraphicsFramebufferPtr& framebuffer) noexcept
 {
-    assert(framebuffer);
+    if (!framebuffer)
+        bindFramebuffer(0);
+    else if (m_DeviceType == GraphicsDeviceType::GraphicsDeviceTypeOpenGLCore)
+        framebuffer->downcast<OGLCoreFramebuffer>()->bind();
+    else if (m_DeviceType == GraphicsDeviceType::GraphicsDeviceTypeOpenGL)
+        framebuffer->downcast<OGLFramebuffer>()->bind();
+}
+
+const GraphicsDeviceDesc& OGLDevice::getGraphicsDeviceDesc() const noexcept
+{
+    return m_Desc;
+}
+
+void OGLDevice::setEnabled(GLenum cap, bool bEnable) noexcept
+{
+    auto it = std::find(CachedCaps, CachedCaps + NumCachedCaps, cap);
+    if (it != CachedCaps + NumCachedCaps)
+    {
+        auto& state = m_Caps[it - CachedCaps];
+        bool bRedundant = (state == (bEnable ? 1 : 0));
+        count(RenderStateCallEnable, bRedundant);
+        if (bRedundant)
+            return;
+        state = bEnable ? 1 : 0;
+    }
+    else
+        count(RenderStateCallEnable, false);
+
+    if (bEnable)
+        glEnable(cap);
+    else
+        glDisable(cap);
+}
+
+void OGLDevice::useProgram(GLuint program) noexcept
+{
+    bool bRedundant = (m_Program == program);
+    count(RenderStateCallProgram, bRedundant);
+    if (bRedundant)
+        return;
 
-    if (m_Desc.getDeviceType() == GraphicsDeviceType::GraphicsDeviceTypeOpenGLCore)
+    m_Program = program;
+    glUseProgram(program);
+}
+
+void OGLDevice::bindTexture(GLuint unit, GLenum target, GLuint texture) noexcept
+{
+    if (unit < MaxTextureUnits)
     {
-        auto fbo = framebuffer->downcast_pointer<OGLCoreFramebuffer>();
-        if (fbo) fbo->bind();
+        auto& binding = m_Textures[unit];
+        bool bRedundant = (binding.target == target && binding.texture == texture);
+        count(RenderStateCallTexture, bRedundant);
+        if (bRedundant)
+            return;
+        binding.target = target;
+        binding.texture = texture;
     }
-    else if (m_Desc.getDeviceType() == GraphicsDeviceType::GraphicsDeviceTypeOpenGL)
+    else
+        count(RenderStateCallTexture, false);
+
+    if (m_DeviceType == GraphicsDeviceType::GraphicsDeviceTypeOpenGLCore)
     {
-        auto fbo = framebuffer->downcast_pointer<OGLFramebuffer>();
-        if (fbo) fbo->bind();
+        glBindTextureUnit(unit, texture);
+    }
+    else
+    {
+        if (m_ActiveTexture != unit)
+        {
+            m_ActiveTexture = unit;
+            glActiveTexture(GL_TEXTURE0 + unit);
+        }
+        glBindTexture(target, texture);
     }
 }
 
-const GraphicsDeviceDesc& OGLDevice::getGraphicsDeviceDesc() const noexcept
+void OGLDevice::bindFramebuffer(GLuint framebuffer) noexcept
 {
-    return m_Desc;
+    bool bRedundant = (m_Framebuffer == framebuffer);
+    count(RenderStateCallFramebuffer, bRedundant);
+    if (bRedundant)
+        return;
+
+    m_Framebuffer = framebuffer;
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+}
+
+void OGLDevice::invalidateProgram(GLuint program) noexcept
+{
+    if (m_Program == program)
+        m_Program = UnknownBinding;
+}
+
+void OGLDevice::invalidateTexture(GLuint texture) noexcept
+{
+    for (auto& binding : m_Textures)
+    {
+        if (binding.texture == texture)
+            binding.texture = UnknownBinding;
+    }
+}
+
+void OGLDevice::invalidateFramebuffer(GLuint framebuffer) noexcept
+{
+    if (m_Framebuffer == framebuffer)
+        m_Framebuffer = UnknownBinding;
+}
+
+void OGLDevice::invalidateState() noexcept
+{
+    std::fill(m_Caps, m_Caps + NumCachedCaps, UnknownState);
+    m_Program = UnknownBinding;
+    m_Framebuffer = UnknownBinding;
+    m_ActiveTexture = UnknownBinding;
+    for (auto& binding : m_Textures)
+        binding = { GL_NONE, UnknownBinding };
+}
+
+void OGLDevice::drawAttributeless(GLenum mode, GLsizei count) noexcept
+{
+    // A core profile still wants a vertex array bound
+    if (m_EmptyVAO == GL_NONE)
+        glGenVertexArrays(1, &m_EmptyVAO);
+    glBindVertexArray(m_EmptyVAO);
+    glDrawArrays(mode, 0, count);
+}
+
+void OGLDevice::beginFrame() noexcept
+{
+    m_FrameStats = m_Stats;
+    std::memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+const RenderStateStats& OGLDevice::getRenderStateStats() const noexcept
+{
+    return m_FrameStats;
+}
+
+void OGLDevice::count(RenderStateCall call, bool bRedundant) noexcept
+{
+    if (bRedundant)
+        m_Stats.redundant[call]++;
+    else
+        m_Stats.issued[call]++;
 }
@@ -1,7 +1,24 @@
 #pragma once
 
+#include <GL/glew.h>
 #include <GLType/GraphicsDevice.h>
 
+enum RenderStateCall
+{
+    RenderStateCallEnable = 0,
+    RenderStateCallProgram = 1,
+    RenderStateCallTexture = 2,
+    RenderStateCallFramebuffer = 3,
+    RenderStateCallCount = 4,
+};
+
+// GL calls the render state cache made and skipped over one frame
+struct RenderStateStats
+{
+    std::uint32_t issued[RenderStateCallCount];
+    std::uint32_t redundant[RenderStateCallCount];
+};
+
 class OGLDevice final : public GraphicsDevice
 {
     __DeclareSubInterface(OGLDevice, GraphicsDevice)
@@ -14,7 +31,7 @@ public:
     void destoy() noexcept;
 
     GraphicsDataPtr createGraphicsData(const GraphicsDataDesc& desc) noexcept override;
-    GraphicsTexturePtr createTexture(const gli::texture& texture) noexcept override;
+    GraphicsTexturePtr createTexture(const gli::texture& texture, bool bFlip = true) noexcept override;
     GraphicsTexturePtr createTexture(const GraphicsTextureDesc& desc) noexcept override;
     GraphicsFramebufferPtr createFramebuffer(const GraphicsFramebufferDesc& desc) noexcept override;
 
@@ -22,9 +39,54 @@ public:
 
 	const GraphicsDeviceDesc& getGraphicsDeviceDesc() const noexcept override;
 
+    // Render state cache; a call setting what is already set is skipped.
+    // State changed by raw GL calls must be restored, or invalidated here.
+    void setEnabled(GLenum cap, bool bEnable) noexcept;
+    void useProgram(GLuint program) noexcept;
+    void bindTexture(GLuint unit, GLenum target, GLuint texture) noexcept;
+    void bindFramebuffer(GLuint framebuffer) noexcept;
+
+    // GL may hand a deleted name out again, so bindings to it are forgotten
+    void invalidateProgram(GLuint program) noexcept;
+    void invalidateTexture(GLuint texture) noexcept;
+    void invalidateFramebuffer(GLuint framebuffer) noexcept;
+    void invalidateState() noexcept;
+
+    // Vertices are made from gl_VertexID, no attribute is read
+    void drawAttributeless(GLenum mode, GLsizei count) noexcept;
+
+    // Starts counting the calls of a new frame
+    void beginFrame() noexcept;
+    const RenderStateStats& getRenderStateStats() const noexcept;
+
 private:
 
     GraphicsFramebufferPtr createRenderTarget(const GraphicsTexturePtr& texture) noexcept;
 
+    void count(RenderStateCall call, bool bRedundant) noexcept;
+
+    static const GLuint MaxTextureUnits = 16;
+    static const GLenum CachedCaps[];
+    static const GLuint NumCachedCaps = 6;
+
+    struct TextureBinding
+    {
+        GLenum target;
+        GLuint texture;
+    };
+
     GraphicsDeviceDesc m_Desc;
+    // Copied out of the desc, branched on by every create and bind
+    GraphicsDeviceType m_DeviceType;
+
+    // Unknown until first set through the cache
+    std::int8_t m_Caps[NumCachedCaps];
+    GLuint m_Program;
+    GLuint m_Framebuffer;
+    GLuint m_ActiveTexture;
+    TextureBinding m_Textures[MaxTextureUnits];
+    GLuint m_EmptyVAO;
+
+    RenderStateStats m_Stats;
+    RenderStateStats m_FrameStats;
 };
@@ -1,12 +1,14 @@
 #include "GLType/OGLFramebuffer.h"
 #include <GL/glew.h>
 #include <GLType/OGLTexture.h>
+#include <GLType/OGLDevice.h>
 #include <cassert>
 
 __ImplementSubInterface(OGLFramebuffer, GraphicsFramebuffer)
 
 OGLFramebuffer::OGLFramebuffer() noexcept 
     : m_FBO(GL_NONE)
+    , m_OGLDevice(nullptr)
 {
 }
 
@@ -23,12 +25,16 @@ const GraphicsFramebufferDesc& OGLFramebuffer::getGraphicsFramebufferDesc() cons
 void OGLFramebuffer::bind() noexcept
 {
     assert(m_FBO != GL_NONE);
-    glBindFramebuffer(GL_FRAMEBUFFER, m_FBO);
+    if (m_OGLDevice)
+        m_OGLDevice->bindFramebuffer(m_FBO);
+    else
+        glBindFramebuffer(GL_FRAMEBUFFER, m_FBO);
 }
 
 void OGLFramebuffer::setDevice(GraphicsDevicePtr device) noexcept
 {
     m_Device = device;
+    m_OGLDevice = device ? device->downcast<OGLDevice>() : nullptr;
 }
 
 GraphicsDevicePtr OGLFramebuffer::getDevice() noexcept
@@ -41,7 +47,7 @@ bool OGLFramebuffer::create(const GraphicsFramebufferDesc& desc) noexcept
     assert(m_FBO == GL_NONE);
 
     glGenFramebuffers(1, &m_FBO);
-    glBindFramebuffer(GL_FRAMEBUFFER, m_FBO);
+    bind();
 
 	GLsizei drawCount = 0;
     GLenum drawBuffers[GL_COLOR_ATTACHMENT15 - GL_COLOR_ATTACHMENT0] = { GL_NONE, };
@@ -71,6 +77,9 @@ void OGLFramebuffer::destroy() noexcept
 {
     if (m_FBO != GL_NONE)
     {
+        auto device = getDevice();
+        if (device)
+            device->downcast<OGLDevice>()->invalidateFramebuffer(m_FBO);
         glDeleteFramebuffers(1, &m_FBO);
         m_FBO = 0;
     }
@@ -0,0 +1,114 @@
+#include <GLType/OGLGpuTimer.h>
+#include <cassert>
+#include <tools/Logger.hpp>
+
+OGLGpuTimer::OGLGpuTimer() noexcept
+    : m_bCreated(false)
+    , m_Frame(0)
+    , m_DroppedCount(0)
+{
+}
+
+OGLGpuTimer::~OGLGpuTimer() noexcept
+{
+    destroy();
+}
+
+bool OGLGpuTimer::create()
+{
+    if (!GLEW_ARB_timer_query && !GLEW_VERSION_3_3)
+    {
+        LOG_WARNING("OGLGpuTimer : timestamp queries are not supported\n");
+        return false;
+    }
+    m_bCreated = true;
+    return true;
+}
+
+void OGLGpuTimer::destroy() noexcept
+{
+    for (auto& frame : m_Frames)
+    {
+        for (auto& query : frame.queries)
+        {
+            glDeleteQueries(1, &query.start);
+            glDeleteQueries(1, &query.stop);
+        }
+        frame.queries.clear();
+        frame.used = 0;
+    }
+    m_Open.clear();
+    m_bCreated = false;
+}
+
+void OGLGpuTimer::begin(uint32_t zone) noexcept
+{
+    if (!m_bCreated)
+        return;
+
+    auto& frame = m_Frames[m_Frame];
+    if (frame.used == frame.queries.size())
+    {
+        Query query;
+        query.zone = zone;
+        glGenQueries(1, &query.start);
+        glGenQueries(1, &query.stop);
+        frame.queries.push_back(query);
+    }
+
+    auto& query = frame.queries[frame.used];
+    query.zone = zone;
+    glQueryCounter(query.start, GL_TIMESTAMP);
+    m_Open.push_back(frame.used++);
+}
+
+void OGLGpuTimer::end(uint32_t zone) noexcept
+{
+    if (!m_bCreated || m_Open.empty())
+        return;
+
+    auto& query = m_Frames[m_Frame].queries[m_Open.back()];
+    assert(query.zone == zone);
+    m_Open.pop_back();
+    glQueryCounter(query.stop, GL_TIMESTAMP);
+}
+
+void OGLGpuTimer::endFrame() noexcept
+{
+    if (!m_bCreated)
+        return;
+
+    // Zones left open would straddle two pools
+    assert(m_Open.empty());
+    m_Open.clear();
+
+    m_Frame = (m_Frame + 1) % FrameLatency;
+    collect(m_Frames[m_Frame]);
+}
+
+void OGLGpuTimer::collect(Frame& frame) noexcept
+{
+    for (uint32_t i = 0; i < frame.used; i++)
+    {
+        const auto& query = frame.queries[i];
+
+        GLint available = GL_FALSE;
+        glGetQueryObjectiv(query.stop, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+        {
+            m_DroppedCount++;
+            continue;
+        }
+
+        GLuint64 start = 0, stop = 0;
+        glGetQueryObjectui64v(query.start, GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(query.stop, GL_QUERY_RESULT, &stop);
+        profiler::addGpuTime(query.zone, float((stop - start) / 1e6));
+    }
+    frame.used = 0;
+}
+
+uint32_t OGLGpuTimer::getDroppedCount() const noexcept
+{
+    return m_DroppedCount;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <vector>
+#include <cstdint>
+#include <tools/Profile.h>
+
+// Timestamp query pairs for GPU profiler zones, kept in one pool per frame in flight.
+// A pool is read back only when its frame comes around again, so results are
+// 'FrameLatency - 1' frames late and reading them never waits; anything still
+// unfinished by then is dropped and counted.
+class OGLGpuTimer final : public profiler::GpuTimer
+{
+public:
+
+    enum { FrameLatency = 3 };
+
+    OGLGpuTimer() noexcept;
+    virtual ~OGLGpuTimer() noexcept;
+
+    bool create();
+    void destroy() noexcept;
+
+    virtual void begin(uint32_t zone) noexcept override;
+    virtual void end(uint32_t zone) noexcept override;
+    virtual void endFrame() noexcept override;
+
+    uint32_t getDroppedCount() const noexcept;
+
+private:
+
+    OGLGpuTimer(const OGLGpuTimer&) = delete;
+    OGLGpuTimer& operator=(const OGLGpuTimer&) = delete;
+
+    struct Query
+    {
+        uint32_t zone;
+        GLuint start;
+        GLuint stop;
+    };
+
+    struct Frame
+    {
+        std::vector<Query> queries;
+        uint32_t used = 0;
+    };
+
+    void collect(Frame& frame) noexcept;
+
+    bool m_bCreated;
+    uint32_t m_Frame;
+    uint32_t m_DroppedCount;
+    Frame m_Frames[FrameLatency];
+    std::vector<uint32_t> m_Open;
+};
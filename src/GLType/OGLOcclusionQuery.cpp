@@ -0,0 +1,95 @@
+#include <GLType/OGLOcclusionQuery.h>
+#include <cstdio>
+
+OGLOcclusionQuery::OGLOcclusionQuery() noexcept
+    : m_bCreated(false)
+    , m_bHasResult(false)
+    , m_Frame(0)
+    , m_DroppedCount(0)
+    , m_Samples(0)
+{
+    for (uint32_t i = 0; i < FrameLatency; i++)
+    {
+        m_Queries[i] = GL_NONE;
+        m_bIssued[i] = false;
+    }
+}
+
+OGLOcclusionQuery::~OGLOcclusionQuery() noexcept
+{
+    destroy();
+}
+
+bool OGLOcclusionQuery::create()
+{
+    if (!GLEW_VERSION_3_3 && !GLEW_ARB_occlusion_query)
+    {
+        printf("OGLOcclusionQuery : occlusion queries are not supported\n");
+        return false;
+    }
+    glGenQueries(FrameLatency, m_Queries);
+    m_bCreated = true;
+    return true;
+}
+
+void OGLOcclusionQuery::destroy() noexcept
+{
+    if (m_bCreated)
+        glDeleteQueries(FrameLatency, m_Queries);
+    for (uint32_t i = 0; i < FrameLatency; i++)
+    {
+        m_Queries[i] = GL_NONE;
+        m_bIssued[i] = false;
+    }
+    m_bCreated = false;
+    m_bHasResult = false;
+}
+
+bool OGLOcclusionQuery::isCreated() const noexcept
+{
+    return m_bCreated;
+}
+
+void OGLOcclusionQuery::begin() noexcept
+{
+    if (!m_bCreated)
+        return;
+
+    auto query = m_Queries[m_Frame];
+    if (m_bIssued[m_Frame])
+    {
+        GLint available = GL_FALSE;
+        glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available)
+        {
+            GLuint64 samples = 0;
+            glGetQueryObjectui64v(query, GL_QUERY_RESULT, &samples);
+            m_Samples = samples;
+            m_bHasResult = true;
+        }
+        else
+            m_DroppedCount++;
+    }
+    glBeginQuery(GL_SAMPLES_PASSED, query);
+}
+
+void OGLOcclusionQuery::end() noexcept
+{
+    if (!m_bCreated)
+        return;
+
+    glEndQuery(GL_SAMPLES_PASSED);
+    m_bIssued[m_Frame] = true;
+    m_Frame = (m_Frame + 1) % FrameLatency;
+}
+
+bool OGLOcclusionQuery::getResult(uint64_t& samples) const noexcept
+{
+    samples = m_Samples;
+    return m_bHasResult;
+}
+
+uint32_t OGLOcclusionQuery::getDroppedCount() const noexcept
+{
+    return m_DroppedCount;
+}
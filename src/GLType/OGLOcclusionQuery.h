@@ -0,0 +1,42 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cstdint>
+
+// Counts the samples passing the depth test between 'begin' and 'end', once per
+// frame. As with OGLGpuTimer a query is read back only when its slot comes around
+// again, 'FrameLatency - 1' frames late, so reading never waits; anything still
+// unfinished by then is dropped and counted.
+class OGLOcclusionQuery final
+{
+public:
+
+    enum { FrameLatency = 3 };
+
+    OGLOcclusionQuery() noexcept;
+    ~OGLOcclusionQuery() noexcept;
+
+    bool create();
+    void destroy() noexcept;
+    bool isCreated() const noexcept;
+
+    void begin() noexcept;
+    void end() noexcept;
+
+    // Samples of the latest frame read back, false until there is one
+    bool getResult(uint64_t& samples) const noexcept;
+    uint32_t getDroppedCount() const noexcept;
+
+private:
+
+    OGLOcclusionQuery(const OGLOcclusionQuery&) = delete;
+    OGLOcclusionQuery& operator=(const OGLOcclusionQuery&) = delete;
+
+    GLuint m_Queries[FrameLatency];
+    bool m_bIssued[FrameLatency];
+    bool m_bCreated;
+    bool m_bHasResult;
+    uint32_t m_Frame;
+    uint32_t m_DroppedCount;
+    uint64_t m_Samples;
+};
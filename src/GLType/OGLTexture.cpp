@@ -1,9 +1,13 @@
+#include <cstring>
+#include <algorithm>
 #include <gli/gli.hpp>
 #include <tools/stb_image.h>
 #include <tools/string.h>
 #include <tools/FileUtility.h>
+#include <tools/MappedFile.h>
 #include <GLType/OGLTypes.h>
 #include <GLType/OGLTexture.h>
+#include <GLType/OGLDevice.h>
 
 __ImplementSubInterface(OGLTexture, GraphicsTexture)
 
@@ -13,6 +17,7 @@ OGLTexture::OGLTexture()
     , m_FormatInternal(GL_INVALID_ENUM)
 	, m_PBO(GL_NONE)
 	, m_PBOSize(0)
+    , m_OGLDevice(nullptr)
 {
 }
 
@@ -31,7 +36,7 @@ bool OGLTexture::create(GLint width, GLint height, GLenum target, GraphicsFormat
 
 	GLuint TextureID = 0;
 	glGenTextures(1, &TextureID);
-	glBindTexture(target, TextureID);
+	bindUnit(0, target, TextureID);
     glTexStorage2D(target, levels, Format.Internal, width, height);
     if (data != nullptr && size != 0)
     {
@@ -48,12 +53,32 @@ bool OGLTexture::create(GLint width, GLint height, GLenum target, GraphicsFormat
 	return true;
 }
 
-bool OGLTexture::create(const gli::texture& texture) noexcept
+namespace
+{
+    // Writes the rows of a 2D image bottom up
+    void flipRows(std::uint8_t* dst, const std::uint8_t* src, std::size_t rowSize, std::size_t rows) noexcept
+    {
+        for (std::size_t y = 0; y < rows; y++)
+            std::memcpy(dst + rowSize * y, src + rowSize * (rows - y - 1), rowSize);
+    }
+}
+
+bool OGLTexture::create(const gli::texture& texture, bool bFlip) noexcept
 {
 	if (texture.empty())
 		return false;
 
-    auto Texture = gli::flip(texture);
+    // gli::flip only handles 2D images
+    bFlip = bFlip
+        && texture.target() != gli::TARGET_1D
+        && texture.target() != gli::TARGET_1D_ARRAY
+        && texture.target() != gli::TARGET_3D;
+
+    // Uncompressed images are flipped while copied into a staging buffer;
+    // block compressed ones still need gli::flip to reorder the texels inside each block
+    bool bCompressed = gli::is_compressed(texture.format());
+    bool bStaging = bFlip && !bCompressed;
+    auto Texture = (bFlip && bCompressed) ? gli::flip(texture) : texture;
 
 	gli::gl GL(gli::gl::PROFILE_GL33);
 	gli::gl::format const Format = GL.translate(Texture.format(), Texture.swizzles());
@@ -61,7 +86,7 @@ bool OGLTexture::create(const gli::texture& texture) noexcept
 
 	GLuint TextureID = 0;
 	glGenTextures(1, &TextureID);
-	glBindTexture(Target, TextureID);
+	bindUnit(0, Target, TextureID);
 	glTexParameteri(Target, GL_TEXTURE_BASE_LEVEL, 0);
 	glTexParameteri(Target, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(Texture.levels() - 1));
 	glTexParameteri(Target, GL_TEXTURE_SWIZZLE_R, Format.Swizzles[0]);
@@ -98,6 +123,15 @@ bool OGLTexture::create(const gli::texture& texture) noexcept
 		break;
 	}
 
+	// Sized for the largest image and reused for every one of them
+	GLuint StagingBuffer = GL_NONE;
+	if (bStaging)
+	{
+		glGenBuffers(1, &StagingBuffer);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, StagingBuffer);
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, Texture.size(0), nullptr, GL_STREAM_DRAW);
+	}
+
 	for(std::size_t Layer = 0; Layer < Texture.layers(); ++Layer)
 	for(std::size_t Face = 0; Face < Texture.faces(); ++Face)
 	for(std::size_t Level = 0; Level < Texture.levels(); ++Level)
@@ -108,6 +142,21 @@ bool OGLTexture::create(const gli::texture& texture) noexcept
 			? static_cast<GLenum>(GL_TEXTURE_CUBE_MAP_POSITIVE_X + Face)
 			: Target;
 
+		// With the staging buffer bound, the pointer below is an offset into it
+		const void* Data = Texture.data(Layer, Face, Level);
+		if (bStaging)
+		{
+			std::size_t const Size = Texture.size(Level);
+			// Invalidating lets the driver orphan the storage still read by the previous upload
+			auto Dst = static_cast<std::uint8_t*>(glMapBufferRange(
+				GL_PIXEL_UNPACK_BUFFER, 0, Size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+			if (!Dst)
+				break;
+			flipRows(Dst, static_cast<const std::uint8_t*>(Data), Size / Extent.y, Extent.y);
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			Data = nullptr;
+		}
+
 		switch(Texture.target())
 		{
 		case gli::TARGET_1D:
@@ -115,12 +164,12 @@ bool OGLTexture::create(const gli::texture& texture) noexcept
 				glCompressedTexSubImage1D(
 					_Target, static_cast<GLint>(Level), 0, Extent.x,
 					Format.Internal, static_cast<GLsizei>(Texture.size(Level)),
-					Texture.data(Layer, Face, Level));
+					Data);
 			else
 				glTexSubImage1D(
 					_Target, static_cast<GLint>(Level), 0, Extent.x,
 					Format.External, Format.Type,
-					Texture.data(Layer, Face, Level));
+					Data);
 			break;
 		case gli::TARGET_1D_ARRAY:
 		case gli::TARGET_2D:
@@ -132,7 +181,7 @@ bool OGLTexture::create(const gli::texture& texture) noexcept
 					Extent.x,
 					Texture.target() == gli::TARGET_1D_ARRAY ? LayerGL : Extent.y,
 					Format.Internal, static_cast<GLsizei>(Texture.size(Level)),
-					Texture.data(Layer, Face, Level));
+					Data);
 			else
 				glTexSubImage2D(
 					_Target, static_cast<GLint>(Level),
@@ -140,7 +189,7 @@ bool OGLTexture::create(const gli::texture& texture) noexcept
 					Extent.x,
 					Texture.target() == gli::TARGET_1D_ARRAY ? LayerGL : Extent.y,
 					Format.External, Format.Type,
-					Texture.data(Layer, Face, Level));
+					Data);
 			break;
 		case gli::TARGET_2D_ARRAY:
 		case gli::TARGET_3D:
@@ -152,7 +201,7 @@ bool OGLTexture::create(const gli::texture& texture) noexcept
 					Extent.x, Extent.y,
 					Texture.target() == gli::TARGET_3D ? Extent.z : 1,
 					Format.Internal, static_cast<GLsizei>(Texture.size(Level)),
-					Texture.data(Layer, Face, Level));
+					Data);
 			else
 				glTexSubImage3D(
 					_Target, static_cast<GLint>(Level),
@@ -160,13 +209,20 @@ bool OGLTexture::create(const gli::texture& texture) noexcept
 					Extent.x, Extent.y,
                     Texture.target() == gli::TARGET_3D ? Extent.z : 1,
 					Format.External, Format.Type,
-					Texture.data(Layer, Face, Level));
+					Data);
 			break;
 		default: 
 			assert(0); 
 			break;
 		}
 	}
+
+	if (bStaging)
+	{
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, GL_NONE);
+		glDeleteBuffers(1, &StagingBuffer);
+	}
+
 	m_Target = Target;
 	m_TextureID = TextureID;
 	m_FormatInternal = Format.Internal;
@@ -211,18 +267,19 @@ bool OGLTexture::create(const std::string& filename) noexcept
     if (filename.empty()) 
         return false;
 
-    auto data = util::ReadFileSync(filename);
-    if (data == util::NullFile)
+    // Decoders read the mapped file directly
+    MappedFile data(filename);
+    if (!data.isOpen())
         return false;
 
     const std::string ext = util::getFileExtension(filename);
     if (util::stricmp(ext, "zlib"))
-        return createFromMemoryZIP(data->data(), data->size());
+        return createFromMemoryZIP(data.data(), data.size());
     else if (util::stricmp(ext, "DDS") || util::stricmp(ext, "KTX"))
-        return createFromMemoryDDS(data->data(), data->size());
+        return createFromMemoryDDS(data.data(), data.size());
     else if (util::stricmp(ext, "HDR"))
-        return createFromMemoryHDR(data->data(), data->size());
-    return createFromMemoryLDR(data->data(), data->size());
+        return createFromMemoryHDR(data.data(), data.size());
+    return createFromMemoryLDR(data.data(), data.size());
 } 
 
 bool OGLTexture::createFromMemoryLDR(const char* data, size_t size) noexcept
@@ -251,14 +308,10 @@ bool OGLTexture::createFromMemoryLDR(const char* data, size_t size) noexcept
 
 bool OGLTexture::createFromMemoryZIP(const char* data, size_t dataSize) noexcept
 {
-    int decodesize = 0;
-    // malloc never throws exception
-    char* decodedata = stbi_zlib_decode_malloc(data, (int)dataSize, &decodesize);
-    if (decodedata == nullptr)
+    auto decoded = util::DecompressMemory(data, dataSize);
+    if (decoded->empty())
         return false;
-    bool bSuccess = createFromMemory(decodedata, decodesize);
-    free(decodedata);
-    return bSuccess;
+    return createFromMemory(decoded->data(), decoded->size());
 }
 
 void OGLTexture::setGraphicsRenderTarget(const GraphicsFramebufferPtr& target) noexcept
@@ -289,6 +342,7 @@ const GraphicsTextureDesc& OGLTexture::getGraphicsTextureDesc() const noexcept
 void OGLTexture::setDevice(const GraphicsDevicePtr& device) noexcept
 {
     m_Device = device;
+    m_OGLDevice = device ? device->downcast<OGLDevice>() : nullptr;
 }
 
 GraphicsDevicePtr OGLTexture::getDevice() noexcept
@@ -300,6 +354,9 @@ void OGLTexture::destroy() noexcept
 {
 	if (m_TextureID != GL_NONE)
 	{
+		auto device = m_Device.lock();
+		if (device)
+			device->downcast<OGLDevice>()->invalidateTexture(m_TextureID);
 		glDeleteTextures(1, &m_TextureID);
 		m_TextureID = GL_NONE;
 
@@ -318,14 +375,24 @@ void OGLTexture::destroy() noexcept
 void OGLTexture::bind(GLuint unit) const
 {
 	assert( 0u != m_TextureID );  
-	glActiveTexture(GL_TEXTURE0 + unit);
-	glBindTexture(m_Target, m_TextureID);
+	bindUnit(unit, m_Target, m_TextureID);
 }
 
 void OGLTexture::unbind(GLuint unit) const
 {
+	bindUnit(unit, m_Target, 0u);
+}
+
+void OGLTexture::bindUnit(GLuint unit, GLenum target, GLuint texture) const
+{
+	// Uploads and reads bind too, so the device cache sees every binding
+	if (m_OGLDevice)
+	{
+		m_OGLDevice->bindTexture(unit, target, texture);
+		return;
+	}
 	glActiveTexture(GL_TEXTURE0 + unit);
-	glBindTexture(m_Target, 0u);
+	glBindTexture(target, texture);
 }
 
 void OGLTexture::generateMipmap()
@@ -333,7 +400,7 @@ void OGLTexture::generateMipmap()
 	assert(m_Target != GL_INVALID_ENUM);
 	assert(m_TextureID != 0);
 
-	glBindTexture(m_Target, m_TextureID);
+	bindUnit(0, m_Target, m_TextureID);
 	glGenerateMipmap(m_Target);
 }
 
@@ -347,7 +414,7 @@ void OGLTexture::applyParameters(const GraphicsTextureDesc& desc)
     if (wrapS != defaultWrap)
         parameteri(GL_TEXTURE_WRAP_S, wrapS);
     if (wrapT != defaultWrap)
-        parameteri(GL_TEXTURE_WRAP_T, wrapS);
+        parameteri(GL_TEXTURE_WRAP_T, wrapT);
     if (wrapR != defaultWrap)
         parameteri(GL_TEXTURE_WRAP_R, wrapR);
 
@@ -368,12 +435,31 @@ void OGLTexture::applyParameters(const GraphicsTextureDesc& desc)
 }
 
 
+void OGLTexture::setSamplerState(const GraphicsTextureDesc& desc) noexcept
+{
+    // Every mode is set, the texture may not be at the defaults 'applyParameters' assumes
+    parameteri(GL_TEXTURE_WRAP_S, desc.getWrapS());
+    parameteri(GL_TEXTURE_WRAP_T, desc.getWrapT());
+    parameteri(GL_TEXTURE_WRAP_R, desc.getWrapR());
+    parameteri(GL_TEXTURE_MIN_FILTER, desc.getMinFilter());
+    parameteri(GL_TEXTURE_MAG_FILTER, desc.getMagFilter());
+    if (desc.getAnisotropyLevel() != m_TextureDesc.getAnisotropyLevel())
+        parameterf(GL_TEXTURE_MAX_ANISOTROPY_EXT, std::max(desc.getAnisotropyLevel(), 1.f));
+
+    m_TextureDesc.setWrapS(desc.getWrapS());
+    m_TextureDesc.setWrapT(desc.getWrapT());
+    m_TextureDesc.setWrapR(desc.getWrapR());
+    m_TextureDesc.setMinFilter(desc.getMinFilter());
+    m_TextureDesc.setMagFilter(desc.getMagFilter());
+    m_TextureDesc.setAnisotropyLevel(desc.getAnisotropyLevel());
+}
+
 void OGLTexture::parameteri(GLenum pname, GLint param)
 {
 	assert(m_Target != GL_INVALID_ENUM);
 	assert(m_TextureID != 0);
 
-	glBindTexture(m_Target, m_TextureID);
+	bindUnit(0, m_Target, m_TextureID);
     glTexParameteri(m_Target, pname, param);
 }
 
@@ -382,7 +468,7 @@ void OGLTexture::parameterf(GLenum pname, GLfloat param)
 	assert(m_Target != GL_INVALID_ENUM);
 	assert(m_TextureID != 0);
 
-	glBindTexture(m_Target, m_TextureID);
+	bindUnit(0, m_Target, m_TextureID);
     glTexParameterf(m_Target, pname, param);
 }
 
@@ -453,7 +539,7 @@ bool OGLTexture::map(uint32_t mipLevel, std::uint8_t** data) noexcept
 		glBufferData(GL_PIXEL_PACK_BUFFER, mapSize, nullptr, GL_STREAM_READ);
 		m_PBOSize = mapSize;
 	}
-	glBindTexture(m_Target, m_TextureID);
+	bindUnit(0, m_Target, m_TextureID);
 	glGetTexImage(m_Target, mipLevel, Format.External, Format.Type, nullptr);
 
 	*data = (std::uint8_t*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, mapSize, GL_MAP_READ_BIT);
@@ -6,6 +6,8 @@
 #include <tools/Rtti.h>
 #include <GLType/GraphicsTexture.h>
 
+class OGLDevice;
+
 class OGLTexture final : public GraphicsTexture
 {
 	__DeclareSubInterface(OGLTexture, GraphicsTexture)
@@ -14,7 +16,7 @@ public:
 	OGLTexture();
     virtual ~OGLTexture();
 
-    bool create(const gli::texture& texture) noexcept;
+    bool create(const gli::texture& texture, bool bFlip = true) noexcept;
     bool create(const GraphicsTextureDesc& desc) noexcept;
 	bool create(const std::string& filename) noexcept;
 	void destroy() noexcept;
@@ -31,10 +33,12 @@ public:
 
     const GraphicsTextureDesc& getGraphicsTextureDesc() const noexcept override;
     const GraphicsFramebufferPtr& getGraphicsRenderTarget() const noexcept override;
+    void setSamplerState(const GraphicsTextureDesc& desc) noexcept override;
 
 private:
 
     void applyParameters(const GraphicsTextureDesc& desc);
+	void bindUnit(GLuint unit, GLenum target, GLuint texture) const;
 	void parameteri(GLenum pname, GLint param);
 	void parameterf(GLenum pname, GLfloat param);
 
@@ -68,6 +72,8 @@ private:
 	GLuint m_PBO;
 	GLsizei m_PBOSize;
 	GraphicsDeviceWeakPtr m_Device;
+    // The device outlives the binds of its textures, so they skip the lock
+    OGLDevice* m_OGLDevice;
     GraphicsFramebufferPtr m_RenderTarget;
 };
 
@@ -0,0 +1,149 @@
+#include "ProgramCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <tools/Hash.h>
+#include <tools/FileUtility.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+namespace
+{
+    void makeDirectory(const std::string& path)
+    {
+#ifdef _WIN32
+        _mkdir(path.c_str());
+#else
+        mkdir(path.c_str(), 0755);
+#endif
+    }
+}
+
+ProgramCache::ProgramCache() noexcept
+{
+}
+
+ProgramCache::~ProgramCache() noexcept
+{
+}
+
+bool ProgramCache::create(const std::string& directory)
+{
+    if (directory.empty())
+        return false;
+
+    // Create every component of the path, existing ones are left alone
+    for (std::size_t i = 1; i <= directory.size(); i++)
+    {
+        if (i == directory.size() || directory[i] == '/' || directory[i] == '\\')
+            makeDirectory(directory.substr(0, i));
+    }
+    m_Directory = directory;
+    return true;
+}
+
+void ProgramCache::setDriver(const std::string& driver) noexcept
+{
+    m_Driver = driver;
+}
+
+const std::string& ProgramCache::getDriver() const noexcept
+{
+    return m_Driver;
+}
+
+std::uint64_t ProgramCache::computeKey(const std::vector<ProgramCacheSource>& sources, const std::string& defines) const noexcept
+{
+    return computeKey(sources, defines, m_Driver);
+}
+
+std::uint64_t ProgramCache::computeKey(const std::vector<ProgramCacheSource>& sources, const std::string& defines, const std::string& driver) noexcept
+{
+    // Sizes are hashed too, so moving text between fields changes the key
+    auto hashString = [](const std::string& str, std::uint64_t hash) {
+        std::uint64_t size = str.size();
+        hash = util::fnv1a64(&size, sizeof(size), hash);
+        return util::fnv1a64(str, hash);
+    };
+
+    std::uint32_t version = Version;
+    std::uint64_t hash = util::FNV64Offset;
+    hash = util::fnv1a64(&version, sizeof(version), hash);
+    hash = hashString(driver, hash);
+    hash = hashString(defines, hash);
+    for (const auto& source : sources)
+    {
+        hash = util::fnv1a64(&source.stage, sizeof(source.stage), hash);
+        hash = hashString(source.source, hash);
+    }
+    return hash;
+}
+
+bool ProgramCache::load(std::uint64_t key, std::uint32_t& format, std::vector<std::uint8_t>& binary) const
+{
+    if (m_Directory.empty())
+        return false;
+
+    auto file = util::ReadFileSync(getPath(key));
+    if (file->size() < sizeof(Header))
+        return false;
+
+    Header header;
+    std::memcpy(&header, file->data(), sizeof(Header));
+    if (header.magic != Magic || header.version != Version || header.key != key)
+        return false;
+    if (header.size != file->size() - sizeof(Header))
+        return false;
+
+    auto data = reinterpret_cast<const std::uint8_t*>(file->data()) + sizeof(Header);
+    if (util::fnv1a64(data, header.size) != header.checksum)
+        return false;
+
+    format = header.format;
+    binary.assign(data, data + header.size);
+    return true;
+}
+
+bool ProgramCache::store(std::uint64_t key, std::uint32_t format, const std::vector<std::uint8_t>& binary) const
+{
+    if (m_Directory.empty() || binary.empty())
+        return false;
+
+    Header header;
+    header.magic = Magic;
+    header.version = Version;
+    header.key = key;
+    header.checksum = util::fnv1a64(binary.data(), binary.size());
+    header.format = format;
+    header.size = (std::uint32_t)binary.size();
+
+    auto file = std::make_shared<util::FileContainer>(sizeof(Header) + binary.size());
+    std::memcpy(file->data(), &header, sizeof(Header));
+    std::memcpy(file->data() + sizeof(Header), binary.data(), binary.size());
+
+    // Write then rename, so a crash never leaves a partial entry behind the real name
+    auto path = getPath(key);
+    auto temp = path + ".tmp";
+    if (!util::WriteFileSync(temp, file))
+        return false;
+    std::remove(path.c_str());
+    return std::rename(temp.c_str(), path.c_str()) == 0;
+}
+
+void ProgramCache::remove(std::uint64_t key) const
+{
+    if (m_Directory.empty())
+        return;
+    std::remove(getPath(key).c_str());
+}
+
+std::string ProgramCache::getPath(std::uint64_t key) const
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+    return m_Directory + "/" + name;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+struct ProgramCacheSource
+{
+    std::uint32_t stage;     // GL shader type
+    std::string source;      // Preprocessed source, after includes
+};
+
+// On-disk cache of linked program binaries.
+// One file per program, named after the key; the header guards against stale or torn entries.
+// Only does file I/O, the GL side lives in 'ProgramShader::link'.
+class ProgramCache final
+{
+public:
+
+    ProgramCache() noexcept;
+    ~ProgramCache() noexcept;
+
+    bool create(const std::string& directory);
+
+    // Vendor, renderer and version strings; binaries are invalid across drivers
+    void setDriver(const std::string& driver) noexcept;
+    const std::string& getDriver() const noexcept;
+
+    std::uint64_t computeKey(const std::vector<ProgramCacheSource>& sources, const std::string& defines) const noexcept;
+    static std::uint64_t computeKey(const std::vector<ProgramCacheSource>& sources, const std::string& defines, const std::string& driver) noexcept;
+
+    bool load(std::uint64_t key, std::uint32_t& format, std::vector<std::uint8_t>& binary) const;
+    bool store(std::uint64_t key, std::uint32_t format, const std::vector<std::uint8_t>& binary) const;
+    // Drops an entry the driver refused
+    void remove(std::uint64_t key) const;
+
+    std::string getPath(std::uint64_t key) const;
+
+private:
+
+    struct Header
+    {
+        std::uint32_t magic;
+        std::uint32_t version;
+        std::uint64_t key;
+        std::uint64_t checksum;
+        std::uint32_t format;
+        std::uint32_t size;
+    };
+
+    static const std::uint32_t Magic = 0x4E494250; // "PBIN"
+    static const std::uint32_t Version = 1;
+
+    std::string m_Directory;
+    std::string m_Driver;
+};
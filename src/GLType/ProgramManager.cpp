@@ -1,201 +1,164 @@
-/*-----------------------------------------------------------------------
-  Copyright (c) 2014, NVIDIA. All rights reserved.
-
-  Redistribution and use in source and binary forms, with or without
-  modification, are permitted provided that the following conditions
-  are met:
-   * Redistributions of source code must retain the above copyright
-     notice, this list of conditions and the following disclaimer.
-   * Neither the name of its contributors may be used to endorse 
-     or promote products derived from this software without specific
-     prior written permission.
-
-  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
-  EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
-  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
-  PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
-  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
-  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
-  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
-  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
-  OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
-  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
-  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
------------------------------------------------------------------------*/
-/*
- * This file contains code derived from glf by Christophe Riccio, www.g-truc.net
- */
-
-#define NV_LINE_MARKERS 1
-
 #include <GL/glew.h>
 #include <GLType/ProgramManager.h>
-#include <tools/misc.hpp>
-#include <cstdarg>
+#include <GLType/ProgramShader.h>
+#include <GLType/ShaderPreprocessor.h>
+#include <tools/Logger.hpp>
+#include <glsw/glsw.h>
+#include <algorithm>
 
-namespace nv_helpers_gl
+ProgramManager& ProgramManager::instance()
 {
-    std::string parseInclude(std::string const & Line, std::size_t const & Offset)
-    {
-        std::string Result;
+    static ProgramManager manager;
+    return manager;
+}
 
-        std::string::size_type IncludeFirstQuote = Line.find("\"", Offset);
-        std::string::size_type IncludeSecondQuote = Line.find("\"", IncludeFirstQuote + 1);
+ProgramManager::ProgramManager() noexcept
+{
+}
 
-        return Line.substr(IncludeFirstQuote + 1, IncludeSecondQuote - IncludeFirstQuote - 1);
-    }
+ProgramManager::~ProgramManager() noexcept
+{
+    stopWatching();
+}
 
-    std::string format(const char* msg, ...)
-    {
-        std::size_t const STRING_BUFFER(8192);
-        char text[STRING_BUFFER];
-        va_list list;
+void ProgramManager::add(const ShaderPtr& program, const ReloadFunc& onReload)
+{
+    if (!program)
+        return;
+
+    Entry entry;
+    entry.program = program;
+    entry.onReload = onReload;
+    entry.bDirty = false;
+    m_Entries.push_back(entry);
 
-        if(msg == 0)
-            return std::string();
+    if (m_Watcher.isWatching())
+        watchFiles(program);
+}
 
-        va_start(list, msg);
-        vsprintf(text, msg, list);
-        va_end(list);
+void ProgramManager::clear()
+{
+    m_Entries.clear();
+}
 
-        return std::string(text);
+bool ProgramManager::startWatching(const std::string& directory)
+{
+    m_Directory = ShaderPreprocessor::normalizePath(directory);
+    if (!m_Watcher.start(m_Directory))
+    {
+        LOG_WARNING("ProgramManager : can't watch \"%s\"\n", m_Directory);
+        return false;
+    }
+    for (auto& entry : m_Entries)
+    {
+        auto program = entry.program.lock();
+        if (program)
+            watchFiles(program);
     }
+    return true;
+}
 
+void ProgramManager::stopWatching() noexcept
+{
+    m_Watcher.stop();
+}
 
-    inline std::string fixFilename(std::string const & filename)
+void ProgramManager::watchFiles(const ShaderPtr& program)
+{
+    auto& preprocessor = ProgramShader::getPreprocessor();
+    for (const auto& tag : program->getTags())
     {
-    #ifdef _WIN32
-        // workaround for older versions of nsight
-        std::string fixedname;
-        for(size_t i = 0; i < filename.size(); i++){
-            char c = filename[i];
-            if(c == '/' || c == '\\'){
-                fixedname.append("\\\\");
-            }
-            else{
-                fixedname.append(1, c);
-            }
-        }
-        return fixedname;
-    #else
-        return filename;
-    #endif
+        auto effect = tag.second.substr(0, tag.second.find('.'));
+        m_Watcher.addFile(m_Directory + "/" + effect + ".glsl");
+        for (const auto& include : preprocessor.getDependencies(tag.second))
+            m_Watcher.addFile(include);
     }
+}
 
-    inline std::string markerString(int line, std::string const & filename, int fileid)
+bool ProgramManager::isAffected(const ShaderPtr& program, const std::vector<std::string>& tags, const std::vector<std::string>& effects) const
+{
+    for (const auto& tag : program->getTags())
     {
-        if(GLEW_ARB_shading_language_include){
-	#if __APPLE__
-            return format("//#line %d \"", line) + fixFilename(filename) + std::string("\"\n");
-	#else
-            return format("#line %d \"", line) + fixFilename(filename) + std::string("\"\n");
-	#endif
-        }
-        else{
-	#if __APPLE__
-            return format("//#line %d %d\n", line, fileid);
-	#else
-            return format("#line %d %d\n", line, fileid);
-	#endif
-        }
+        if (std::find(tags.begin(), tags.end(), tag.second) != tags.end())
+            return true;
+        auto effect = tag.second.substr(0, tag.second.find('.'));
+        if (std::find(effects.begin(), effects.end(), effect) != effects.end())
+            return true;
     }
+    return false;
+}
 
-    std::string getContent(std::string const & name, const std::vector<std::string>& directories, 
-        const IncludeRegistry &includes,
-        std::string & filename)
+void ProgramManager::update()
+{
+    // Drop programs released by their owners
+    m_Entries.erase(std::remove_if(m_Entries.begin(), m_Entries.end(),
+        [](const Entry& entry) { return entry.program.expired(); }), m_Entries.end());
+
+    auto changes = m_Watcher.poll();
+    if (!changes.empty())
     {
-        // check registered includes first
-        for(std::size_t i = 0; i < includes.size(); ++i)
+        auto& preprocessor = ProgramShader::getPreprocessor();
+
+        std::vector<std::string> tags;
+        std::vector<std::string> effects;
+        for (const auto& change : changes)
         {
-            if(includes[i].name != name) continue;
+            auto path = ShaderPreprocessor::normalizePath(change);
+            auto affected = preprocessor.invalidate(path);
+            tags.insert(tags.end(), affected.begin(), affected.end());
 
-            filename = nv_helpers::findFile(includes[i].filename, directories);
-            std::string content = nv_helpers::loadFile(filename, includes[i].content.empty());
-            if(content.empty()) return includes[i].content;
-            return content;
+            // An effect file holds every stage of its programs, so glsw has to read it again
+            auto dot = path.rfind('.');
+            if (dot != std::string::npos && path.compare(dot, std::string::npos, ".glsl") == 0)
+            {
+                auto slash = path.rfind('/');
+                auto begin = (slash == std::string::npos) ? 0 : slash + 1;
+                auto effect = path.substr(begin, dot - begin);
+                glswForgetEffect(effect.c_str());
+                effects.push_back(effect);
+            }
         }
 
-        // fall back
-        filename = nv_helpers::findFile(name, directories);
-        return nv_helpers::loadFile(filename);
+        for (auto& entry : m_Entries)
+        {
+            auto program = entry.program.lock();
+            if (program && isAffected(program, tags, effects))
+                entry.bDirty = true;
+        }
     }
 
-    std::string manualInclude (
-        std::string const & filenameorig,
-        std::string const & source,
-        std::string const & prepend,
-        const std::vector<std::string>& directories,
-        const IncludeRegistry &includes)
+    for (auto& entry : m_Entries)
     {
-        std::string filename = filenameorig;
-        // std::string source = getContent(filenameorig, directories, includes, filename);
-
-        if(source.empty()){
-            return std::string();
-        }
+        auto program = entry.program.lock();
 
-        std::stringstream stream;
-        stream << source;
-        std::string line, text;
-
-        // Handle command line defines
-        text += prepend;
-    #if NV_LINE_MARKERS
-        text += markerString(1, filename, 0);
-    #endif
-        int lineCount = 0;
-        while(std::getline(stream, line))
+        // A file saved again while compiling restarts the build from the latest source
+        if (entry.bDirty)
         {
-            std::size_t Offset = 0;
-            lineCount++;
-
-            // Version
-            Offset = line.find("#version");
-            if(Offset != std::string::npos)
-            {
-                std::size_t CommentOffset = line.find("//");
-                if(CommentOffset != std::string::npos && CommentOffset < Offset)
-                    continue;
-
-                // Reorder so that the #version line is always the first of a shader text
-                text = line + std::string("\n") + text + std::string("//") + line + std::string("\n");
-                continue;
-            }
+            entry.bDirty = false;
+            entry.pending = program->beginRebuild();
+            if (!entry.pending)
+                LOG_WARNING("ProgramManager : reload failed, keeping the previous program\n");
+            continue;
+        }
 
-            // Include
-            Offset = line.find("#include");
-            if(Offset != std::string::npos)
-            {
-                std::size_t CommentOffset = line.find("//");
-                if(CommentOffset != std::string::npos && CommentOffset < Offset)
-                    continue;
-
-                std::string Include = parseInclude(line, Offset);
-
-                {
-                    std::string PathName;
-                    std::string Source = getContent(Include, directories, includes, PathName);
-
-                    assert(!Source.empty());
-
-                    if(!Source.empty())
-                    {
-                    #if NV_LINE_MARKERS
-                        text += markerString(1, PathName, 1);
-                    #endif
-                        text += Source;
-                    #if NV_LINE_MARKERS
-                        text += std::string("\n") + markerString(lineCount + 1, filename, 0);
-                    #endif
-                    }
-                }
-
-                continue;
-            }
+        if (!entry.pending || !entry.pending->isLinkComplete())
+            continue;
 
-            text += line + "\n";
+        auto pending = entry.pending;
+        entry.pending = nullptr;
+        if (!pending->endLink())
+        {
+            LOG_WARNING("ProgramManager : reload failed, keeping the previous program\n");
+            continue;
         }
 
-        return text;
+        program->swap(*pending);
+        if (entry.onReload)
+            entry.onReload(program);
+        LOG_INFO("ProgramManager : program reloaded\n");
+
+        // New includes may have been added by the edit
+        if (m_Watcher.isWatching())
+            watchFiles(program);
     }
 }
@@ -1,20 +1,51 @@
+#pragma once
+
 #include <string>
 #include <vector>
+#include <memory>
+#include <functional>
+#include <GL/glew.h>
+#include <tools/FileWatcher.h>
+
+typedef std::shared_ptr<class ProgramShader> ShaderPtr;
 
-namespace nv_helpers_gl
+// Keeps track of the live programs and rebuilds the ones whose files changed.
+// A rebuild replaces the program only when it compiles and links; otherwise the old one stays.
+class ProgramManager final
 {
-    struct IncludeEntry {
-      std::string   name;
-      std::string   filename;
-      std::string   content;
+public:
+
+    typedef std::function<void(const ShaderPtr&)> ReloadFunc;
+
+    static ProgramManager& instance();
+
+    // 'onReload' runs after a successful swap, e.g. to resolve cached uniform handles again
+    void add(const ShaderPtr& program, const ReloadFunc& onReload = nullptr);
+    void clear();
+
+    bool startWatching(const std::string& directory = "shaders");
+    void stopWatching() noexcept;
+
+    // Call once per frame on the GL thread; never blocks on the driver
+    void update();
+
+private:
+
+    struct Entry
+    {
+        std::weak_ptr<ProgramShader> program;
+        ReloadFunc onReload;
+        ShaderPtr pending;
+        bool bDirty;
     };
 
-    typedef std::vector<IncludeEntry> IncludeRegistry;
+    ProgramManager() noexcept;
+    ~ProgramManager() noexcept;
+
+    void watchFiles(const ShaderPtr& program);
+    bool isAffected(const ShaderPtr& program, const std::vector<std::string>& tags, const std::vector<std::string>& effects) const;
 
-    std::string manualInclude (
-        std::string const & filenameorig,
-        std::string const & source,
-        std::string const & prepend,
-        const std::vector<std::string>& directories,
-        const IncludeRegistry &includes);
-}
+    std::string m_Directory;
+    std::vector<Entry> m_Entries;
+    FileWatcher m_Watcher;
+};
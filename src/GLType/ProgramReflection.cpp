@@ -0,0 +1,142 @@
+#include "ProgramReflection.h"
+
+#include <cstring>
+#include <cstdio>
+#include <tools/Hash.h>
+
+namespace
+{
+    const char* getKindName(ProgramResourceKind kind)
+    {
+        switch (kind)
+        {
+        case ProgramResourceKindUniform: return "uniform";
+        case ProgramResourceKindSampler: return "sampler";
+        case ProgramResourceKindImage: return "image";
+        case ProgramResourceKindBlockMember: return "block member";
+        case ProgramResourceKindBlock: return "block";
+        }
+        return "unknown";
+    }
+
+    std::string escapeJson(const std::string& str)
+    {
+        std::string result;
+        for (auto c : str)
+        {
+            if (c == '"' || c == '\\')
+                result += '\\';
+            result += c;
+        }
+        return result;
+    }
+}
+
+ProgramReflection::ProgramReflection() noexcept
+{
+}
+
+ProgramReflection::~ProgramReflection() noexcept
+{
+}
+
+void ProgramReflection::clear() noexcept
+{
+    m_Resources.clear();
+    m_Hashes.clear();
+    m_Slots.clear();
+}
+
+void ProgramReflection::addResource(const ProgramResource& resource)
+{
+    ProgramResource entry = resource;
+
+    // Arrays are reported as "name[0]", callers use the bare name
+    auto length = entry.name.size();
+    if (length > 3 && entry.name.compare(length - 3, 3, "[0]") == 0)
+        entry.name.resize(length - 3);
+
+    if (find(entry.name))
+        return;
+
+    m_Resources.push_back(entry);
+    m_Hashes.push_back(util::fnv1a32(entry.name));
+
+    // Keep the load factor under one half
+    if (m_Resources.size() * 2 > m_Slots.size())
+        rehash(m_Slots.empty() ? 16 : m_Slots.size() * 2);
+    else
+    {
+        std::size_t mask = m_Slots.size() - 1;
+        std::size_t slot = m_Hashes.back() & mask;
+        while (m_Slots[slot] >= 0)
+            slot = (slot + 1) & mask;
+        m_Slots[slot] = (std::int32_t)m_Resources.size() - 1;
+    }
+}
+
+const ProgramResource* ProgramReflection::find(const char* name) const noexcept
+{
+    return find(name, std::strlen(name));
+}
+
+const ProgramResource* ProgramReflection::find(const std::string& name) const noexcept
+{
+    return find(name.data(), name.size());
+}
+
+const ProgramResource* ProgramReflection::find(const char* name, std::size_t length) const noexcept
+{
+    if (m_Slots.empty())
+        return nullptr;
+
+    auto hash = util::fnv1a32(name, length);
+    std::size_t mask = m_Slots.size() - 1;
+    for (std::size_t slot = hash & mask; m_Slots[slot] >= 0; slot = (slot + 1) & mask)
+    {
+        auto index = m_Slots[slot];
+        const auto& resource = m_Resources[index];
+        if (m_Hashes[index] == hash && resource.name.size() == length
+            && std::memcmp(resource.name.data(), name, length) == 0)
+            return &resource;
+    }
+    return nullptr;
+}
+
+const std::vector<ProgramResource>& ProgramReflection::getResources() const noexcept
+{
+    return m_Resources;
+}
+
+std::string ProgramReflection::toJson() const
+{
+    std::string json = "{\n  \"resources\": [";
+    for (std::size_t i = 0; i < m_Resources.size(); i++)
+    {
+        const auto& r = m_Resources[i];
+        char buffer[256];
+        snprintf(buffer, sizeof(buffer),
+            "\"kind\": \"%s\", \"type\": %u, \"location\": %d, \"arraySize\": %d, \"blockIndex\": %d, \"offset\": %d }",
+            getKindName(r.kind), r.type, r.location, r.arraySize, r.blockIndex, r.offset);
+
+        json += (i == 0) ? "\n" : ",\n";
+        json += "    { \"name\": \"" + escapeJson(r.name) + "\", ";
+        json += buffer;
+    }
+    json += "\n  ]\n}\n";
+    return json;
+}
+
+void ProgramReflection::rehash(std::size_t capacity)
+{
+    m_Slots.assign(capacity, -1);
+
+    std::size_t mask = capacity - 1;
+    for (std::size_t i = 0; i < m_Resources.size(); i++)
+    {
+        std::size_t slot = m_Hashes[i] & mask;
+        while (m_Slots[slot] >= 0)
+            slot = (slot + 1) & mask;
+        m_Slots[slot] = (std::int32_t)i;
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+enum ProgramResourceKind
+{
+    ProgramResourceKindUniform = 0,
+    ProgramResourceKindSampler,
+    ProgramResourceKindImage,
+    ProgramResourceKindBlockMember,
+    ProgramResourceKindBlock,
+};
+
+struct ProgramResource
+{
+    std::string name;
+    ProgramResourceKind kind;
+    std::uint32_t type;       // GL type enum, 0 for blocks
+    std::int32_t location;    // Uniform location, or binding point for blocks
+    std::int32_t arraySize;
+    std::int32_t blockIndex;  // Owning block of a block member, -1 otherwise
+    std::int32_t offset;      // Offset in the block, or data size for blocks
+};
+
+// Active resources of a linked program in a flat open-addressing hash table.
+// Filled once by 'ProgramShader::link', does not touch GL.
+class ProgramReflection final
+{
+public:
+
+    ProgramReflection() noexcept;
+    ~ProgramReflection() noexcept;
+
+    void clear() noexcept;
+    void addResource(const ProgramResource& resource);
+
+    const ProgramResource* find(const char* name) const noexcept;
+    const ProgramResource* find(const std::string& name) const noexcept;
+
+    const std::vector<ProgramResource>& getResources() const noexcept;
+
+    std::string toJson() const;
+
+private:
+
+    const ProgramResource* find(const char* name, std::size_t length) const noexcept;
+    void rehash(std::size_t capacity);
+
+    std::vector<ProgramResource> m_Resources;
+    std::vector<std::uint32_t> m_Hashes;
+    // Index into 'm_Resources' or -1; the size is a power of two
+    std::vector<std::int32_t> m_Slots;
+};
@@ -6,7 +6,11 @@
 
 
 #include <cstdio>
+#include <cstring>
 #include <cassert>
+#include <algorithm>
+#include <thread>
+#include <chrono>
 
 #include <GL/glew.h>
 #include <glm/gtc/type_ptr.hpp>
@@ -14,8 +18,10 @@
 
 #include <tools/gltools.hpp>
 #include <tools/Logger.hpp>
-#include <GLType/ProgramManager.h>
+#include <tools/JobSystem.h>
+#include <GLType/ShaderPreprocessor.h>
 #include <GLType/GraphicsDevice.h>
+#include <GLType/OGLDevice.h>
 #include <GLType/OGLGraphicsData.h>
 #include <GLType/OGLCoreGraphicsData.h>
 #include <GLType/OGLTexture.h>
@@ -23,11 +29,21 @@
 
 #include "ProgramShader.h"
 
-static std::vector<std::string> directory = { ".", "./shaders" };
+// Same value for the KHR and ARB flavours of parallel shader compile
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+ProgramCache* ProgramShader::s_ProgramCache = nullptr;
 
 ProgramShader::ProgramShader() noexcept
     : m_ShaderID(0u)
     , m_BlockPointCounter(0u)
+    , m_DeviceType(GraphicsDeviceType::GraphicsDeviceTypeMaxEnum)
+    , m_OGLDevice(nullptr)
+    , m_bPreprocessed(false)
+    , m_bLinkedFromCache(false)
+    , m_CacheKey(0)
 {
 }
 
@@ -45,7 +61,7 @@ bool ProgramShader::create() noexcept
     m_ShaderID = glCreateProgram();
 
 #ifdef GL_ARB_separate_shader_objects
-    glProgramParameteri(m_ShaderID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_FALSE);
+    glProgramParameteri(m_ShaderID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, s_ProgramCache ? GL_TRUE : GL_FALSE);
     glProgramParameteri(m_ShaderID, GL_PROGRAM_SEPARABLE, GL_FALSE);
 #endif
     return true;
@@ -54,18 +70,21 @@ bool ProgramShader::create() noexcept
 void ProgramShader::destroy()
 {
     if (m_ShaderID) {
+        auto device = m_Device.lock();
+        if (device)
+            device->downcast<OGLDevice>()->invalidateProgram(m_ShaderID);
         glDeleteProgram(m_ShaderID);
         m_ShaderID = 0;
     }
 }
 
-void ProgramShader::addShader(GLenum shaderType, const std::string &tag)
+bool ProgramShader::addShader(GLenum shaderType, const std::string &tag)
 {
     // require initialization
     assert(m_ShaderID > 0);
 
     if (glswGetError() != 0) {
-        fprintf(stderr, "GLSW : %s", glswGetError());
+        LOG_ERROR("GLSW : %s\n", glswGetError());
     }
     assert(glswGetError() == 0);
 
@@ -74,44 +93,112 @@ void ProgramShader::addShader(GLenum shaderType, const std::string &tag)
 
     if (0 == source)
     {
-        fprintf(stderr, "Error : shader \"%s\" not found, check your directory.\n", cTag);
-        fprintf(stderr, "Execution terminated.\n");
-        exit(EXIT_FAILURE);
+        LOG_ERROR("ProgramShader : shader \"%s\" not found, check your directory\n", cTag);
+        return false;
     }
 
-    // HACK
-    static nv_helpers_gl::IncludeRegistry m_includes;
-    static std::vector<std::string> directory = { ".", "./shaders" };
-    const std::string content(source);
-    const std::string preprocessed = nv_helpers_gl::manualInclude(tag, content, "", directory, m_includes);
-    char const* sourcePointer = preprocessed.c_str();
-    GLuint shader = glCreateShader(shaderType);
-    glShaderSource(shader, 1, &sourcePointer, 0);
-    glCompileShader(shader);
+    // Preprocessing and compilation are deferred to link(),
+    // which may find the program in the binary cache
+    ShaderStage stage;
+    stage.type = shaderType;
+    stage.tag = tag;
+    stage.source = source;
+    stage.shader = GL_NONE;
+    m_Stages.push_back(stage);
+    m_Tags.push_back({ shaderType, tag });
+    m_bPreprocessed = false;
+    return true;
+}
 
-    GLint status = 0;
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+void ProgramShader::preprocess()
+{
+    if (m_bPreprocessed)
+        return;
 
-    if(status != GL_TRUE)
+    auto& preprocessor = getPreprocessor();
+    for (auto& stage : m_Stages)
+        stage.source = preprocessor.process(stage.tag, stage.source, "");
+    m_bPreprocessed = true;
+}
+
+void ProgramShader::beginLink()
+{
+    preprocess();
+
+    m_CacheKey = 0;
+    m_bLinkedFromCache = false;
+    if (s_ProgramCache)
     {
-        //Logger::getInstance().write( "shader \"%s\" compilation failed.\n", cTag);
-        fprintf(stderr, "%s compilation failed.\n", cTag);
-        gltools::printShaderLog(shader);
-        exit(EXIT_FAILURE);
+        std::vector<ProgramCacheSource> sources;
+        for (const auto& stage : m_Stages)
+            sources.push_back({ stage.type, stage.source });
+
+        m_CacheKey = s_ProgramCache->computeKey(sources, std::string());
+        if (loadBinary(m_CacheKey))
+        {
+            m_bLinkedFromCache = true;
+            return;
+        }
     }
 
-    //Logger::getInstance().write( "%s compiled.\n", cTag);
-    fprintf(stderr, "%s compiled.\n", cTag);
-
-    glAttachShader(m_ShaderID, shader);
-    glDeleteShader(shader);     //flag for deletion
+    // Submit only; status and logs are queried in endLink()
+    for (auto& stage : m_Stages)
+    {
+        char const* sourcePointer = stage.source.c_str();
+        stage.shader = glCreateShader(stage.type);
+        glShaderSource(stage.shader, 1, &sourcePointer, 0);
+        glCompileShader(stage.shader);
+        glAttachShader(m_ShaderID, stage.shader);
+    }
+    glLinkProgram(m_ShaderID);
 }
 
+bool ProgramShader::isLinkComplete() const
+{
+    if (m_bLinkedFromCache || !isParallelCompileSupported())
+        return true;
 
+    GLint status = GL_FALSE;
+    glGetProgramiv(m_ShaderID, GL_COMPLETION_STATUS_KHR, &status);
+    return status == GL_TRUE;
+}
 
-bool ProgramShader::link()
+bool ProgramShader::endLink()
 {
-    glLinkProgram(m_ShaderID);
+    if (m_bLinkedFromCache)
+    {
+        m_Stages.clear();
+        reflect();
+        return true;
+    }
+
+    // A failed compile is reported, not fatal, so a broken edit can be reloaded later
+    bool bCompiled = true;
+    for (auto& stage : m_Stages)
+    {
+        const char* cTag = stage.tag.c_str();
+
+        GLint status = 0;
+        glGetShaderiv(stage.shader, GL_COMPILE_STATUS, &status);
+
+        if(status != GL_TRUE)
+        {
+            LOG_ERROR("%s compilation failed.\n", cTag);
+            gltools::printShaderLog(stage.shader);
+            bCompiled = false;
+        }
+        else
+        {
+            LOG_INFO("%s compiled.\n", cTag);
+        }
+
+        glDetachShader(m_ShaderID, stage.shader);
+        glDeleteShader(stage.shader);
+    }
+    m_Stages.clear();
+
+    if (!bCompiled)
+        return false;
 
     // Test linking
     GLint status = 0;
@@ -119,255 +206,621 @@ bool ProgramShader::link()
 
     if(status != GL_TRUE)
     {
-        fprintf(stderr, "program linking failed.\n");
+        LOG_ERROR("program linking failed.\n");
+        gltools::printProgramLog(m_ShaderID);
         return false;
     }
 
+    if (s_ProgramCache)
+        storeBinary(m_CacheKey);
+
+    reflect();
     return true;
 }
 
-bool ProgramShader::initBlockBinding(const std::string& name)
+ShaderPtr ProgramShader::beginRebuild() const
 {
-    GLint block = glGetUniformBlockIndex(m_ShaderID, name.c_str());
-    if (-1 == block)
+    auto program = std::make_shared<ProgramShader>();
+    program->setDevice(m_Device.lock());
+    program->create();
+    for (const auto& tag : m_Tags)
     {
-        printf("ProgramShader : can't find uniform \"%s\".\n", name.c_str());
-        return false;
+        if (!program->addShader(tag.first, tag.second))
+            return nullptr;
     }
+    program->beginLink();
+    return program;
+}
 
-    glUniformBlockBinding(m_ShaderID, block, m_BlockPointCounter);
-    m_BlockPoints.insert({name, m_BlockPointCounter});
-    m_BlockPointCounter++;
-    return true;
+void ProgramShader::swap(ProgramShader& other)
+{
+    std::swap(m_ShaderID, other.m_ShaderID);
+    std::swap(m_Reflection, other.m_Reflection);
+    m_MissingNames.clear();
+
+    // Keep the binding points handed out by initBlockBinding
+    for (const auto& blockPoint : m_BlockPoints)
+    {
+        auto block = m_Reflection.find(blockPoint.first);
+        if (block && block->kind == ProgramResourceKindBlock)
+            glUniformBlockBinding(m_ShaderID, block->blockIndex, blockPoint.second);
+    }
 }
 
-void ProgramShader::setDevice(const GraphicsDevicePtr& device)
+const std::vector<std::pair<GLenum, std::string>>& ProgramShader::getTags() const noexcept
 {
-    m_Device = device;
+    return m_Tags;
 }
 
-bool ProgramShader::setUniform(const std::string &name, GLint v) const
+bool ProgramShader::link()
 {
-    GLint loc = glGetUniformLocation(m_ShaderID, name.c_str());
+    beginLink();
+    return endLink();
+}
 
-    if(-1 == loc)
+bool ProgramShader::link(const std::vector<ShaderPtr>& programs)
+{
+    // Include expansion is plain CPU work; glsw lookups already happened in addShader
+    JobSystem::instance().parallel_for((uint32_t)programs.size(), 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++)
+            programs[i]->preprocess();
+    });
+
+    // Submit every compile and link before waiting on any of them
+    for (auto& program : programs)
+        program->beginLink();
+
+    bool bSucceeded = true;
+    if (!isParallelCompileSupported())
     {
-        printf("ProgramShader : can't find uniform \"%s\".\n", name.c_str());
+        // The status queries of endLink wait for the driver themselves
+        for (auto& program : programs)
+            bSucceeded &= program->endLink();
+        return bSucceeded;
+    }
+
+    // Finish programs as the driver completes them, sleeping only while none is
+    std::vector<ShaderPtr> pending(programs);
+    while (!pending.empty())
+    {
+        auto completed = std::partition(pending.begin(), pending.end(),
+            [](const ShaderPtr& program) { return !program->isLinkComplete(); });
+        if (completed == pending.end())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        for (auto it = completed; it != pending.end(); ++it)
+            bSucceeded &= (*it)->endLink();
+        pending.erase(completed, pending.end());
+    }
+    return bSucceeded;
+}
+
+bool ProgramShader::isParallelCompileSupported()
+{
+    static const bool bSupported = []() {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count; i++)
+        {
+            auto name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+            if (!name)
+                continue;
+            if (!strcmp(name, "GL_KHR_parallel_shader_compile") || !strcmp(name, "GL_ARB_parallel_shader_compile"))
+                return true;
+        }
         return false;
+    }();
+    return bSupported;
+}
+
+ShaderPreprocessor& ProgramShader::getPreprocessor()
+{
+    static ShaderPreprocessor preprocessor;
+    static bool bInitialized = [&]() {
+        preprocessor.setDirectories({ ".", "./shaders" });
+        preprocessor.setLineMarker(GLEW_ARB_shading_language_include ? ShaderLineMarkerFileName : ShaderLineMarkerFileId);
+        return true;
+    }();
+    (void)bInitialized;
+    return preprocessor;
+}
+
+void ProgramShader::setProgramCache(ProgramCache* cache)
+{
+    if (cache)
+    {
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        if (formats == 0)
+        {
+            LOG_WARNING("ProgramShader : no program binary formats, binary cache disabled.\n");
+            cache = nullptr;
+        }
     }
 
-    glUniform1i(loc, v);
+    if (cache)
+    {
+        auto getString = [](GLenum name) {
+            auto str = reinterpret_cast<const char*>(glGetString(name));
+            return std::string(str ? str : "");
+        };
+        cache->setDriver(getString(GL_VENDOR) + "|" + getString(GL_RENDERER) + "|" + getString(GL_VERSION));
+    }
+    s_ProgramCache = cache;
+}
+
+bool ProgramShader::loadBinary(std::uint64_t key)
+{
+    GLenum format = GL_NONE;
+    std::vector<std::uint8_t> binary;
+    if (!s_ProgramCache->load(key, format, binary))
+        return false;
+
+    glProgramBinary(m_ShaderID, format, binary.data(), (GLsizei)binary.size());
+
+    GLint status = 0;
+    glGetProgramiv(m_ShaderID, GL_LINK_STATUS, &status);
+    if (status != GL_TRUE)
+    {
+        // Driver update or format mismatch, fall back to compiling
+        s_ProgramCache->remove(key);
+        return false;
+    }
     return true;
 }
 
+void ProgramShader::storeBinary(std::uint64_t key)
+{
+    GLint length = 0;
+    glGetProgramiv(m_ShaderID, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    GLenum format = GL_NONE;
+    std::vector<std::uint8_t> binary(length);
+    glGetProgramBinary(m_ShaderID, length, nullptr, &format, binary.data());
+    if (!s_ProgramCache->store(key, format, binary))
+        LOG_WARNING("ProgramShader : can't write \"%s\".\n", s_ProgramCache->getPath(key));
+}
 
-bool ProgramShader::setUniform(const std::string &name, GLfloat v) const
+namespace
 {
-    GLint loc = glGetUniformLocation(m_ShaderID, name.c_str());
+    ProgramResourceKind getResourceKind(GLenum type, GLint blockIndex)
+    {
+        if (blockIndex >= 0)
+            return ProgramResourceKindBlockMember;
+
+        switch (type)
+        {
+        case GL_SAMPLER_1D:
+        case GL_SAMPLER_2D:
+        case GL_SAMPLER_3D:
+        case GL_SAMPLER_CUBE:
+        case GL_SAMPLER_1D_SHADOW:
+        case GL_SAMPLER_2D_SHADOW:
+        case GL_SAMPLER_1D_ARRAY:
+        case GL_SAMPLER_2D_ARRAY:
+        case GL_SAMPLER_1D_ARRAY_SHADOW:
+        case GL_SAMPLER_2D_ARRAY_SHADOW:
+        case GL_SAMPLER_2D_MULTISAMPLE:
+        case GL_SAMPLER_2D_MULTISAMPLE_ARRAY:
+        case GL_SAMPLER_CUBE_SHADOW:
+        case GL_SAMPLER_CUBE_MAP_ARRAY:
+        case GL_SAMPLER_CUBE_MAP_ARRAY_SHADOW:
+        case GL_SAMPLER_BUFFER:
+        case GL_SAMPLER_2D_RECT:
+        case GL_INT_SAMPLER_2D:
+        case GL_INT_SAMPLER_3D:
+        case GL_INT_SAMPLER_2D_ARRAY:
+        case GL_UNSIGNED_INT_SAMPLER_2D:
+        case GL_UNSIGNED_INT_SAMPLER_3D:
+        case GL_UNSIGNED_INT_SAMPLER_2D_ARRAY:
+            return ProgramResourceKindSampler;
+
+        case GL_IMAGE_1D:
+        case GL_IMAGE_2D:
+        case GL_IMAGE_3D:
+        case GL_IMAGE_CUBE:
+        case GL_IMAGE_2D_ARRAY:
+        case GL_IMAGE_BUFFER:
+        case GL_INT_IMAGE_2D:
+        case GL_INT_IMAGE_3D:
+        case GL_UNSIGNED_INT_IMAGE_2D:
+        case GL_UNSIGNED_INT_IMAGE_3D:
+            return ProgramResourceKindImage;
+        }
+        return ProgramResourceKindUniform;
+    }
+}
 
-    if(-1 == loc)
+void ProgramShader::reflect()
+{
+    m_Reflection.clear();
+    m_MissingNames.clear();
+
+    std::vector<GLchar> name(256);
+
+    if (GLEW_ARB_program_interface_query)
+    {
+        GLint count = 0;
+        glGetProgramInterfaceiv(m_ShaderID, GL_UNIFORM, GL_ACTIVE_RESOURCES, &count);
+        for (GLint i = 0; i < count; i++)
+        {
+            const GLenum props[] = { GL_NAME_LENGTH, GL_TYPE, GL_LOCATION, GL_ARRAY_SIZE, GL_BLOCK_INDEX, GL_OFFSET };
+            GLint values[6] = { 0 };
+            glGetProgramResourceiv(m_ShaderID, GL_UNIFORM, i, 6, props, 6, nullptr, values);
+            name.resize(std::max<size_t>(name.size(), values[0] + 1));
+            glGetProgramResourceName(m_ShaderID, GL_UNIFORM, i, (GLsizei)name.size(), nullptr, name.data());
+
+            ProgramResource resource;
+            resource.name = name.data();
+            resource.kind = getResourceKind(values[1], values[4]);
+            resource.type = values[1];
+            resource.location = values[2];
+            resource.arraySize = values[3];
+            resource.blockIndex = values[4];
+            resource.offset = values[5];
+            m_Reflection.addResource(resource);
+        }
+
+        glGetProgramInterfaceiv(m_ShaderID, GL_UNIFORM_BLOCK, GL_ACTIVE_RESOURCES, &count);
+        for (GLint i = 0; i < count; i++)
+        {
+            const GLenum props[] = { GL_NAME_LENGTH, GL_BUFFER_BINDING, GL_BUFFER_DATA_SIZE };
+            GLint values[3] = { 0 };
+            glGetProgramResourceiv(m_ShaderID, GL_UNIFORM_BLOCK, i, 3, props, 3, nullptr, values);
+            name.resize(std::max<size_t>(name.size(), values[0] + 1));
+            glGetProgramResourceName(m_ShaderID, GL_UNIFORM_BLOCK, i, (GLsizei)name.size(), nullptr, name.data());
+
+            ProgramResource resource;
+            resource.name = name.data();
+            resource.kind = ProgramResourceKindBlock;
+            resource.type = 0;
+            resource.location = values[1];
+            resource.arraySize = 1;
+            resource.blockIndex = i;
+            resource.offset = values[2];
+            m_Reflection.addResource(resource);
+        }
+        return;
+    }
+
+    // Pre 4.3 contexts (macOS)
+    GLint count = 0, maxLength = 0;
+    glGetProgramiv(m_ShaderID, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(m_ShaderID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+    name.resize(std::max<size_t>(name.size(), maxLength + 1));
+    for (GLint i = 0; i < count; i++)
+    {
+        GLint size = 0;
+        GLenum type = GL_NONE;
+        glGetActiveUniform(m_ShaderID, i, (GLsizei)name.size(), nullptr, &size, &type, name.data());
+
+        GLuint index = i;
+        GLint blockIndex = -1, offset = -1;
+        glGetActiveUniformsiv(m_ShaderID, 1, &index, GL_UNIFORM_BLOCK_INDEX, &blockIndex);
+        glGetActiveUniformsiv(m_ShaderID, 1, &index, GL_UNIFORM_OFFSET, &offset);
+
+        ProgramResource resource;
+        resource.name = name.data();
+        resource.kind = getResourceKind(type, blockIndex);
+        resource.type = type;
+        resource.location = glGetUniformLocation(m_ShaderID, name.data());
+        resource.arraySize = size;
+        resource.blockIndex = blockIndex;
+        resource.offset = offset;
+        m_Reflection.addResource(resource);
+    }
+
+    glGetProgramiv(m_ShaderID, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+    glGetProgramiv(m_ShaderID, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxLength);
+    name.resize(std::max<size_t>(name.size(), maxLength + 1));
+    for (GLint i = 0; i < count; i++)
+    {
+        GLint binding = 0, dataSize = 0;
+        glGetActiveUniformBlockName(m_ShaderID, i, (GLsizei)name.size(), nullptr, name.data());
+        glGetActiveUniformBlockiv(m_ShaderID, i, GL_UNIFORM_BLOCK_BINDING, &binding);
+        glGetActiveUniformBlockiv(m_ShaderID, i, GL_UNIFORM_BLOCK_DATA_SIZE, &dataSize);
+
+        ProgramResource resource;
+        resource.name = name.data();
+        resource.kind = ProgramResourceKindBlock;
+        resource.type = 0;
+        resource.location = binding;
+        resource.arraySize = 1;
+        resource.blockIndex = i;
+        resource.offset = dataSize;
+        m_Reflection.addResource(resource);
+    }
+}
+
+bool ProgramShader::initBlockBinding(const std::string& name)
+{
+    auto block = m_Reflection.find(name);
+    if (!block || block->kind != ProgramResourceKindBlock)
     {
-        printf("ProgramShader : can't find uniform \"%s\".\n", name.c_str());
+        LOG_WARNING("ProgramShader : can't find uniform block \"%s\".\n", name);
         return false;
     }
 
-    glUniform1f(loc, v);
+    glUniformBlockBinding(m_ShaderID, block->blockIndex, m_BlockPointCounter);
+    m_BlockPoints.insert({name, m_BlockPointCounter});
+    m_BlockPointCounter++;
     return true;
 }
 
+void ProgramShader::setDevice(const GraphicsDevicePtr& device)
+{
+    m_Device = device;
+    m_OGLDevice = device ? device->downcast<OGLDevice>() : nullptr;
+    if (device)
+        m_DeviceType = device->getGraphicsDeviceDesc().getDeviceType();
+}
+
+void ProgramShader::bind() const
+{
+    useProgram(m_ShaderID);
+}
+
+void ProgramShader::unbind() const
+{
+    useProgram(0u);
+}
+
+void ProgramShader::useProgram(GLuint program) const
+{
+    if (m_OGLDevice)
+        m_OGLDevice->useProgram(program);
+    else
+        glUseProgram(program);
+}
+
+const ProgramReflection& ProgramShader::getReflection() const noexcept
+{
+    return m_Reflection;
+}
+
+UniformHandle ProgramShader::getUniformHandle(const std::string& name) const
+{
+    UniformHandle handle;
+    auto resource = m_Reflection.find(name);
+    if (resource && resource->kind != ProgramResourceKindBlock)
+        handle.location = resource->location;
+
+    if (!handle.isValid() && m_MissingNames.insert(name).second)
+        LOG_WARNING("ProgramShader : can't find uniform \"%s\".\n", name);
+    return handle;
+}
+
+UniformBlockHandle ProgramShader::getBlockHandle(const std::string& name) const
+{
+    UniformBlockHandle handle;
+    auto it = m_BlockPoints.find(name);
+    if (it != m_BlockPoints.end())
+        handle.binding = it->second;
+    else if (m_MissingNames.insert(name).second)
+        LOG_WARNING("ProgramShader : can't find uniform block \"%s\".\n", name);
+    return handle;
+}
+
+bool ProgramShader::setUniform(const std::string &name, GLint v) const
+{
+    return setUniform(getUniformHandle(name), v);
+}
+
+bool ProgramShader::setUniform(const std::string &name, GLfloat v) const
+{
+    return setUniform(getUniformHandle(name), v);
+}
+
 bool ProgramShader::setUniform(const std::string& name, const glm::vec2& v) const
 {
-    GLint loc = glGetUniformLocation(m_ShaderID, name.c_str());
+    return setUniform(getUniformHandle(name), v);
+}
 
-    if(-1 == loc)
-    {
-        printf("ProgramShader : can't find uniform \"%s\".\n", name.c_str());
+bool ProgramShader::setUniform(const std::string &name, const glm::vec3 &v) const
+{
+    return setUniform(getUniformHandle(name), v);
+}
+
+bool ProgramShader::setUniform(const std::string &name, const glm::vec4 &v) const
+{
+    return setUniform(getUniformHandle(name), v);
+}
+
+bool ProgramShader::setUniform(const std::string& name, const glm::vec2* v, size_t count) const
+{
+    return setUniform(getUniformHandle(name), v, count);
+}
+
+bool ProgramShader::setUniform(const std::string& name, const glm::vec4* v, size_t count) const
+{
+    return setUniform(getUniformHandle(name), v, count);
+}
+
+bool ProgramShader::setUniform(const std::string& name, const glm::mat3& v) const
+{
+    return setUniform(getUniformHandle(name), v);
+}
+
+bool ProgramShader::setUniform(const std::string &name, const glm::mat4 &v) const
+{
+    return setUniform(getUniformHandle(name), v);
+}
+
+bool ProgramShader::bindTexture(const std::string& name, const GraphicsTexturePtr& texture, GLint unit)
+{
+    return bindTexture(getUniformHandle(name), texture, unit);
+}
+
+bool ProgramShader::bindBuffer(const std::string& name, const GraphicsDataPtr& data)
+{
+    return bindBuffer(getBlockHandle(name), data);
+}
+
+bool ProgramShader::bindImage(const std::string &name, const GraphicsTexturePtr& texture,
+    GLint unit, GLint level, GLboolean layered, GLint layer, GLenum access)
+{
+    return bindImage(getUniformHandle(name), texture, unit, level, layered, layer, access);
+}
+
+bool ProgramShader::setUniform(UniformHandle handle, GLint v) const
+{
+    if (!handle.isValid())
         return false;
-    }
 
-    glUniform2fv(loc, 1, glm::value_ptr(v));
+    glUniform1i(handle.location, v);
     return true;
 }
 
-bool ProgramShader::setUniform(const std::string &name, const glm::vec3 &v) const
+bool ProgramShader::setUniform(UniformHandle handle, GLfloat v) const
 {
-    GLint loc = glGetUniformLocation(m_ShaderID, name.c_str());
+    if (!handle.isValid())
+        return false;
 
-    if(-1 == loc)
-    {
-        printf("ProgramShader : can't find uniform \"%s\".\n", name.c_str());
+    glUniform1f(handle.location, v);
+    return true;
+}
+
+bool ProgramShader::setUniform(UniformHandle handle, const glm::vec2& v) const
+{
+    if (!handle.isValid())
         return false;
-    }
 
-    glUniform3fv(loc, 1, glm::value_ptr(v));
+    glUniform2fv(handle.location, 1, glm::value_ptr(v));
     return true;
 }
 
-bool ProgramShader::setUniform(const std::string &name, const glm::vec4 &v) const
+bool ProgramShader::setUniform(UniformHandle handle, const glm::vec3& v) const
 {
-    GLint loc = glGetUniformLocation(m_ShaderID, name.c_str());
+    if (!handle.isValid())
+        return false;
 
-    if(-1 == loc)
-    {
-        printf("ProgramShader : can't find uniform \"%s\".\n", name.c_str());
+    glUniform3fv(handle.location, 1, glm::value_ptr(v));
+    return true;
+}
+
+bool ProgramShader::setUniform(UniformHandle handle, const glm::vec4& v) const
+{
+    if (!handle.isValid())
         return false;
-    }
 
-    glUniform4fv(loc, 1, glm::value_ptr(v));
+    glUniform4fv(handle.location, 1, glm::value_ptr(v));
     return true;
 }
 
-bool ProgramShader::setUniform(const std::string& name, const glm::vec2* v, size_t count) const
+bool ProgramShader::setUniform(UniformHandle handle, const glm::vec2* v, size_t count) const
 {
-    GLint loc = glGetUniformLocation(m_ShaderID, name.c_str());
-    if (-1 == loc)
-    {
-        printf("ProgramShader : can't find uniform \"%s\".\n", name.c_str());
+    if (!handle.isValid())
         return false;
-    }
 
     if (count == 0)
         return true;
 
-    glUniform2fv(loc, count, glm::value_ptr(*v));
+    glUniform2fv(handle.location, count, glm::value_ptr(*v));
     return true;
 }
 
-bool ProgramShader::setUniform(const std::string& name, const glm::vec4* v, size_t count) const
+bool ProgramShader::setUniform(UniformHandle handle, const glm::vec4* v, size_t count) const
 {
-    GLint loc = glGetUniformLocation(m_ShaderID, name.c_str());
-    if (-1 == loc)
-    {
-        printf("ProgramShader : can't find uniform \"%s\".\n", name.c_str());
+    if (!handle.isValid())
         return false;
-    }
 
     if (count == 0)
         return true;
 
-    glUniform4fv(loc, count, glm::value_ptr(*v));
+    glUniform4fv(handle.location, count, glm::value_ptr(*v));
     return true;
 }
 
-bool ProgramShader::setUniform(const std::string& name, const glm::mat3& v) const
+bool ProgramShader::setUniform(UniformHandle handle, const glm::mat3& v) const
 {
-    GLint loc = glGetUniformLocation(m_ShaderID, name.c_str());
-
-    if(-1 == loc)
-    {
-        printf("ProgramShader : can't find uniform \"%s\".\n", name.c_str());
+    if (!handle.isValid())
         return false;
-    }
 
-    glUniformMatrix3fv(loc, 1, GL_FALSE, glm::value_ptr(v));
+    glUniformMatrix3fv(handle.location, 1, GL_FALSE, glm::value_ptr(v));
     return true;
 }
 
-bool ProgramShader::setUniform(const std::string &name, const glm::mat4 &v) const
+bool ProgramShader::setUniform(UniformHandle handle, const glm::mat4& v) const
 {
-    GLint loc = glGetUniformLocation(m_ShaderID, name.c_str());
-
-    if(-1 == loc)
-    {
-        printf("ProgramShader : can't find uniform \"%s\".\n", name.c_str());
+    if (!handle.isValid())
         return false;
-    }
 
-    glUniformMatrix4fv(loc, 1, GL_FALSE, glm::value_ptr(v));
+    glUniformMatrix4fv(handle.location, 1, GL_FALSE, glm::value_ptr(v));
     return true;
 }
 
-bool ProgramShader::bindTexture(const std::string& name, const GraphicsTexturePtr& texture, GLint unit)
+bool ProgramShader::bindTexture(UniformHandle handle, const GraphicsTexturePtr& texture, GLint unit)
 {
     assert(texture);
     assert(unit >= 0);
 
-    GLint loc = glGetUniformLocation(m_ShaderID, name.c_str());
-
-    if (-1 == loc)
-    {
-        printf("ProgramShader : can't find texture \"%s\".\n", name.c_str());
+    if (!handle.isValid())
         return false;
-    }
-
-    auto device = m_Device.lock();
-    assert(device);
-    if (!device) return false;
-    auto type = device->getGraphicsDeviceDesc().getDeviceType();
 
     // Bind the buffer object to the texture 
-    if (type == GraphicsDeviceType::GraphicsDeviceTypeOpenGLCore)
+    if (m_DeviceType == GraphicsDeviceType::GraphicsDeviceTypeOpenGLCore)
     {
-        auto tex = texture->downcast_pointer<OGLCoreTexture>();
+        auto tex = texture->downcast<OGLCoreTexture>();
         tex->bind(unit);
-        glUniform1i(loc, unit);
+        glUniform1i(handle.location, unit);
         return true;
     }
-    else if (type == GraphicsDeviceType::GraphicsDeviceTypeOpenGL)
+    else if (m_DeviceType == GraphicsDeviceType::GraphicsDeviceTypeOpenGL)
     {
-        auto tex = texture->downcast_pointer<OGLTexture>();
+        auto tex = texture->downcast<OGLTexture>();
         tex->bind(unit);
-        glUniform1i(loc, unit);
+        glUniform1i(handle.location, unit);
         return true;
     }
     return false;
 }
 
-bool ProgramShader::bindBuffer(const std::string& name, const GraphicsDataPtr& data)
+bool ProgramShader::bindBuffer(UniformBlockHandle handle, const GraphicsDataPtr& data)
 {
-    auto device = m_Device.lock();
-    if (!device) return false;
-    auto it = m_BlockPoints.find(name);
-    if (it == m_BlockPoints.end())
+    if (!handle.isValid())
         return false;
 
-    auto blockPoint = it->second;
-    auto type = device->getGraphicsDeviceDesc().getDeviceType();
+    auto blockPoint = handle.binding;
 
     // Bind the buffer object to the uniform block
-    if (type == GraphicsDeviceType::GraphicsDeviceTypeOpenGLCore)
+    if (m_DeviceType == GraphicsDeviceType::GraphicsDeviceTypeOpenGLCore)
     {
-        auto ubo = data->downcast_pointer<OGLCoreGraphicsData>();
+        auto ubo = data->downcast<OGLCoreGraphicsData>();
         glBindBufferBase(GL_UNIFORM_BUFFER, blockPoint, ubo->getInstanceID());
         return true;
     }
-    else if (type == GraphicsDeviceType::GraphicsDeviceTypeOpenGL)
+    else if (m_DeviceType == GraphicsDeviceType::GraphicsDeviceTypeOpenGL)
     {
-        auto ubo = data->downcast_pointer<OGLGraphicsData>();
+        auto ubo = data->downcast<OGLGraphicsData>();
         glBindBufferBase(GL_UNIFORM_BUFFER, blockPoint, ubo->getInstanceID());
         return true;
     }
     return false;
 }
 
-bool ProgramShader::bindImage(const std::string &name, const GraphicsTexturePtr& texture,
+bool ProgramShader::bindImage(UniformHandle handle, const GraphicsTexturePtr& texture,
     GLint unit, GLint level, GLboolean layered, GLint layer, GLenum access)
 {
-    GLint loc = glGetUniformLocation(m_ShaderID, name.c_str());
-
-    if (-1 == loc)
-    {
-        printf("ProgramShader : can't find image \"%s\".\n", name.c_str());
+    if (!handle.isValid())
         return false;
-    }
-
-    auto device = m_Device.lock();
-    if (!device) return false;
-    auto type = device->getGraphicsDeviceDesc().getDeviceType();
 
     // Bind the buffer object to the uniform block
-    if (type == GraphicsDeviceType::GraphicsDeviceTypeOpenGLCore)
+    if (m_DeviceType == GraphicsDeviceType::GraphicsDeviceTypeOpenGLCore)
     {
-        auto tex = texture->downcast_pointer<OGLCoreTexture>();
+        auto tex = texture->downcast<OGLCoreTexture>();
         glBindImageTexture(unit, tex->getTextureID(), level, layered, layer, access, tex->getInternalFormat());
-        glUniform1i(loc, unit);
+        glUniform1i(handle.location, unit);
         return true;
     }
-    else if (type == GraphicsDeviceType::GraphicsDeviceTypeOpenGL)
+    else if (m_DeviceType == GraphicsDeviceType::GraphicsDeviceTypeOpenGL)
     {
-        auto tex = texture->downcast_pointer<OGLTexture>();
+        auto tex = texture->downcast<OGLTexture>();
         glBindImageTexture(unit, tex->getTextureID(), level, layered, layer, access, tex->getInternalFormat());
-        glUniform1i(loc, unit);
+        glUniform1i(handle.location, unit);
         return true;
     }
 
@@ -391,7 +844,7 @@ std::vector<char> ProgramShader::readTextFile(const std::string &filename)
 	FILE *fp = 0;
 	if (!(fp = fopen(filename.c_str(), "r")))
 	{
-		printf("Cannot open \"%s\" for read!\n", filename.c_str());
+		LOG_WARNING("ProgramShader : cannot open \"%s\" for read\n", filename);
 		return std::vector<char>();
 	}
 
@@ -5,8 +5,31 @@
 #include <Math/Common.h>
 #include <string>
 #include <GraphicsTypes.h>
+#include <Types.h>
+#include <GLType/ProgramReflection.h>
+#include <GLType/ProgramCache.h>
 #include <vector>
 #include <map>
+#include <unordered_set>
+
+class ShaderPreprocessor;
+class OGLDevice;
+
+// Pre-resolved uniform location, valid until the program is linked again
+struct UniformHandle
+{
+    GLint location = -1;
+
+    bool isValid() const noexcept { return location >= 0; }
+};
+
+// Binding point assigned by 'ProgramShader::initBlockBinding'
+struct UniformBlockHandle
+{
+    GLint binding = -1;
+
+    bool isValid() const noexcept { return binding >= 0; }
+};
 
 class ProgramShader
 {
@@ -20,15 +43,35 @@ public:
     /** Destroy the program id */
     void destroy();        
     
-    /** Add a shader and compile it */
-    void addShader(GLenum shaderType, const std::string &tag);
+    /** Add a shader, compiled by link() unless the program binary is cached */
+    bool addShader(GLenum shaderType, const std::string &tag);
     
     //bool compile(); //static (with param)?
     
     bool link(); //static (with param)?
+
+    /** Expand includes of the added shaders; touches no GL state */
+    void preprocess();
+    /** Submit compiles and link without waiting on the driver */
+    void beginLink();
+    /** True once the driver finished, always true without parallel shader compile */
+    bool isLinkComplete() const;
+    /** Query compile/link status and logs, then reflect */
+    bool endLink();
+
+    /** Build several programs at once, so the driver can compile them in parallel */
+    static bool link(const std::vector<ShaderPtr>& programs);
+    static bool isParallelCompileSupported();
+
+    /** New program from the same shader tags with its build submitted; finish with endLink() */
+    ShaderPtr beginRebuild() const;
+    /** Exchange the GL programs, keeping handles given out by initBlockBinding valid */
+    void swap(ProgramShader& other);
+    const std::vector<std::pair<GLenum, std::string>>& getTags() const noexcept;
     
-    void bind() const { glUseProgram( m_ShaderID ); }
-    void unbind() const { glUseProgram( 0u ); }
+    /** Goes through the device's state cache, skipped when already in use */
+    void bind() const;
+    void unbind() const;
     
     /** Return the program id */
     GLuint getShaderID() const { return m_ShaderID; }
@@ -37,6 +80,25 @@ public:
 
     void setDevice(const GraphicsDevicePtr& device);
 
+    /** Active uniforms, samplers and blocks, reflected once by link() */
+    const ProgramReflection& getReflection() const noexcept;
+
+    UniformHandle getUniformHandle(const std::string& name) const;
+    UniformBlockHandle getBlockHandle(const std::string& name) const;
+
+    bool setUniform(UniformHandle handle, GLint v) const;
+    bool setUniform(UniformHandle handle, GLfloat v) const;
+    bool setUniform(UniformHandle handle, const glm::vec2& v) const;
+    bool setUniform(UniformHandle handle, const glm::vec3& v) const;
+    bool setUniform(UniformHandle handle, const glm::vec4& v) const;
+    bool setUniform(UniformHandle handle, const glm::vec2* v, size_t count) const;
+    bool setUniform(UniformHandle handle, const glm::vec4* v, size_t count) const;
+    bool setUniform(UniformHandle handle, const glm::mat3& v) const;
+    bool setUniform(UniformHandle handle, const glm::mat4& v) const;
+    bool bindTexture(UniformHandle handle, const GraphicsTexturePtr& texture, GLint unit);
+    bool bindBuffer(UniformBlockHandle handle, const GraphicsDataPtr& data);
+    bool bindImage(UniformHandle handle, const GraphicsTexturePtr& texture, GLint unit, GLint level, GLboolean layered, GLint layer, GLenum access);
+
     bool setUniform(const std::string& name, GLint v) const;
     bool setUniform(const std::string& name, GLfloat v) const;
     bool setUniform(const std::string& name, const glm::vec2& v) const;
@@ -55,17 +117,49 @@ public:
     void Dispatch2D( GLuint ThreadCountX, GLuint ThreadCountY, GLuint GroupSizeX = 8, GLuint GroupSizeY = 8);
     void Dispatch3D( GLuint ThreadCountX, GLuint ThreadCountY, GLuint ThreadCountZ, GLuint GroupSizeX = 4, GLuint GroupSizeY = 4, GLuint GroupSizeZ = 4 );
   
+    /** Include expansion shared by every program, with cached include files */
+    static ShaderPreprocessor& getPreprocessor();
+
+    /** Binary cache used by every program linked afterwards; needs a current context */
+    static void setProgramCache(ProgramCache* cache);
+
     static bool setIncludeFromFile(const std::string &includeName, const std::string &filename);
     static std::vector<char> readTextFile(const std::string &filename);
 
 protected:
 
+    void reflect();
+    void useProgram(GLuint program) const;
+    bool loadBinary(std::uint64_t key);
+    void storeBinary(std::uint64_t key);
+
+    static ProgramCache* s_ProgramCache;
+
     static std::vector<std::string> directory;
 
     GLuint m_ShaderID;
     GLuint m_BlockPointCounter;
     GraphicsDeviceWeakPtr m_Device;
+    // Resolved in setDevice, so binds don't ask the device
+    GraphicsDeviceType m_DeviceType;
+    OGLDevice* m_OGLDevice;
     std::map<std::string, GLuint> m_BlockPoints;
+    ProgramReflection m_Reflection;
+    struct ShaderStage
+    {
+        GLenum type;
+        std::string tag;
+        std::string source;
+        GLuint shader;
+    };
+
+    std::vector<ShaderStage> m_Stages;
+    std::vector<std::pair<GLenum, std::string>> m_Tags;
+    bool m_bPreprocessed;
+    bool m_bLinkedFromCache;
+    std::uint64_t m_CacheKey;
+    // Names already reported as missing, so a miss is printed only once
+    mutable std::unordered_set<std::string> m_MissingNames;
 };
 
 inline void ProgramShader::Dispatch( GLuint GroupCountX, GLuint GroupCountY, GLuint GroupCountZ )
@@ -0,0 +1,275 @@
+#include "ShaderPreprocessor.h"
+
+#include <sstream>
+#include <algorithm>
+#include <tools/Hash.h>
+#include <tools/misc.hpp>
+#include <tools/Logger.hpp>
+
+namespace
+{
+    const std::uint32_t MaxIncludeDepth = 16;
+
+    bool findDirective(const std::string& line, const char* directive, std::size_t& offset)
+    {
+        offset = line.find(directive);
+        if (offset == std::string::npos)
+            return false;
+
+        std::size_t commentOffset = line.find("//");
+        return commentOffset == std::string::npos || commentOffset > offset;
+    }
+
+    std::string parseInclude(const std::string& line, std::size_t offset)
+    {
+        auto first = line.find('"', offset);
+        auto second = line.find('"', first + 1);
+        if (first == std::string::npos || second == std::string::npos)
+            return std::string();
+        return line.substr(first + 1, second - first - 1);
+    }
+}
+
+ShaderPreprocessor::ShaderPreprocessor() noexcept
+    : m_LineMarker(ShaderLineMarkerFileId)
+    , m_Directories({ ".", "./shaders" })
+    , m_FileReads(0)
+    , m_CacheHits(0)
+{
+}
+
+ShaderPreprocessor::~ShaderPreprocessor() noexcept
+{
+}
+
+void ShaderPreprocessor::setDirectories(const std::vector<std::string>& directories)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Directories = directories;
+    m_Files.clear();
+    m_Expansions.clear();
+}
+
+void ShaderPreprocessor::setLineMarker(ShaderLineMarker marker) noexcept
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_LineMarker = marker;
+    m_Expansions.clear();
+}
+
+std::string ShaderPreprocessor::process(const std::string& name, const std::string& source, const std::string& prepend)
+{
+    if (source.empty())
+        return std::string();
+
+    std::uint64_t key = util::fnv1a64(name);
+    key = util::fnv1a64(prepend, key);
+    key = util::fnv1a64(source, key);
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        auto it = m_Expansions.find(key);
+        if (it != m_Expansions.end())
+        {
+            m_CacheHits++;
+            m_Dependencies[name] = it->second.includes;
+            return it->second.text;
+        }
+    }
+
+    Expansion expansion;
+    expansion.text = expand(name, source, prepend, expansion.includes, 0);
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Dependencies[name] = expansion.includes;
+    m_Expansions[key] = expansion;
+    return expansion.text;
+}
+
+std::string ShaderPreprocessor::expand(const std::string& filename, const std::string& source, const std::string& prepend, std::vector<std::string>& includes, std::uint32_t depth)
+{
+    std::stringstream stream(source);
+    std::string line, text;
+
+    // Command line defines, then the marker; included files use id 1
+    text += prepend;
+    text += getMarker(1, filename, depth > 0 ? 1 : 0);
+
+    std::uint32_t lineCount = 0;
+    while (std::getline(stream, line))
+    {
+        std::size_t offset = 0;
+        lineCount++;
+
+        // Reorder so that the #version line is always the first of a shader text
+        if (findDirective(line, "#version", offset))
+        {
+            text = line + "\n" + text + "//" + line + "\n";
+            continue;
+        }
+
+        if (findDirective(line, "#include", offset))
+        {
+            auto include = parseInclude(line, offset);
+            if (depth >= MaxIncludeDepth)
+            {
+                LOG_WARNING("ShaderPreprocessor : includes nested too deep at \"%s\" in \"%s\"\n", include, filename);
+                continue;
+            }
+
+            std::string path, content;
+            if (!loadInclude(include, path, content))
+            {
+                // Depend on every place it may appear, so creating it rebuilds the shader
+                LOG_WARNING("ShaderPreprocessor : can't include \"%s\" in \"%s\"\n", include, filename);
+                for (const auto& candidate : getSearchPaths(include))
+                    addInclude(includes, candidate);
+                continue;
+            }
+
+            addInclude(includes, path);
+
+            text += expand(path, content, std::string(), includes, depth + 1);
+            text += "\n" + getMarker(lineCount + 1, filename, depth > 0 ? 1 : 0);
+            continue;
+        }
+
+        text += line + "\n";
+    }
+
+    return text;
+}
+
+bool ShaderPreprocessor::loadInclude(const std::string& name, std::string& path, std::string& content)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    path = normalizePath(nv_helpers::findFile(name, m_Directories));
+
+    auto it = m_Files.find(path);
+    if (it != m_Files.end())
+    {
+        content = it->second;
+        return !content.empty();
+    }
+
+    content = nv_helpers::loadFile(path, false);
+    m_FileReads++;
+    if (content.empty())
+        return false;
+
+    m_Files[path] = content;
+    return true;
+}
+
+std::vector<std::string> ShaderPreprocessor::getSearchPaths(const std::string& name) const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    std::vector<std::string> paths;
+    for (const auto& directory : m_Directories)
+        paths.push_back(normalizePath(directory + "/" + name));
+    return paths;
+}
+
+void ShaderPreprocessor::addInclude(std::vector<std::string>& includes, const std::string& path)
+{
+    if (std::find(includes.begin(), includes.end(), path) == includes.end())
+        includes.push_back(path);
+}
+
+std::string ShaderPreprocessor::getMarker(std::uint32_t line, const std::string& filename, std::uint32_t fileId) const
+{
+#if __APPLE__
+    const char* prefix = "//#line ";
+#else
+    const char* prefix = "#line ";
+#endif
+
+    switch (m_LineMarker)
+    {
+    case ShaderLineMarkerFileId:
+        return prefix + std::to_string(line) + " " + std::to_string(fileId) + "\n";
+    case ShaderLineMarkerFileName:
+        return prefix + std::to_string(line) + " \"" + filename + "\"\n";
+    default:
+        return std::string();
+    }
+}
+
+std::vector<std::string> ShaderPreprocessor::getDependencies(const std::string& name) const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    auto it = m_Dependencies.find(name);
+    if (it == m_Dependencies.end())
+        return std::vector<std::string>();
+    return it->second;
+}
+
+std::vector<std::string> ShaderPreprocessor::getDependents(const std::string& path) const
+{
+    auto normalized = normalizePath(path);
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    std::vector<std::string> dependents;
+    for (const auto& entry : m_Dependencies)
+    {
+        const auto& includes = entry.second;
+        if (std::find(includes.begin(), includes.end(), normalized) != includes.end())
+            dependents.push_back(entry.first);
+    }
+    std::sort(dependents.begin(), dependents.end());
+    return dependents;
+}
+
+std::vector<std::string> ShaderPreprocessor::invalidate(const std::string& path)
+{
+    auto normalized = normalizePath(path);
+    auto dependents = getDependents(normalized);
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Files.erase(normalized);
+    for (auto it = m_Expansions.begin(); it != m_Expansions.end();)
+    {
+        const auto& includes = it->second.includes;
+        if (std::find(includes.begin(), includes.end(), normalized) != includes.end())
+            it = m_Expansions.erase(it);
+        else
+            ++it;
+    }
+    return dependents;
+}
+
+void ShaderPreprocessor::clear()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Files.clear();
+    m_Expansions.clear();
+    m_Dependencies.clear();
+}
+
+std::uint32_t ShaderPreprocessor::getFileReads() const noexcept
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_FileReads;
+}
+
+std::uint32_t ShaderPreprocessor::getCacheHits() const noexcept
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_CacheHits;
+}
+
+std::string ShaderPreprocessor::normalizePath(const std::string& path)
+{
+    std::string result = path;
+    std::replace(result.begin(), result.end(), '\\', '/');
+
+    std::size_t offset;
+    while ((offset = result.find("//")) != std::string::npos)
+        result.erase(offset, 1);
+    while ((offset = result.find("/./")) != std::string::npos)
+        result.erase(offset, 2);
+    while (result.compare(0, 2, "./") == 0)
+        result.erase(0, 2);
+    return result;
+}
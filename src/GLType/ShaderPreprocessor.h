@@ -0,0 +1,72 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+
+enum ShaderLineMarker
+{
+    ShaderLineMarkerNone = 0,
+    ShaderLineMarkerFileId,     // #line N id
+    ShaderLineMarkerFileName,   // #line N "file", needs ARB_shading_language_include
+};
+
+// Expands '#include' directives and hoists '#version'.
+// Include files are read once, expanded sources are cached by content, and every
+// shader remembers its includes so a changed file invalidates only its dependents.
+// Needs no GL and may be called from several threads.
+class ShaderPreprocessor final
+{
+public:
+
+    ShaderPreprocessor() noexcept;
+    ~ShaderPreprocessor() noexcept;
+
+    void setDirectories(const std::vector<std::string>& directories);
+    void setLineMarker(ShaderLineMarker marker) noexcept;
+
+    // 'name' identifies the shader in the dependency graph, e.g. a glsw tag
+    std::string process(const std::string& name, const std::string& source, const std::string& prepend);
+
+    // Include files read by 'name', nested ones included; a missing one is
+    // listed under each directory it was searched in
+    std::vector<std::string> getDependencies(const std::string& name) const;
+    // Shaders that read 'path'
+    std::vector<std::string> getDependents(const std::string& path) const;
+
+    // Drops the cached content of 'path' and every expansion using it.
+    // Meant to be driven by a file watcher; returns the affected shaders.
+    std::vector<std::string> invalidate(const std::string& path);
+    void clear();
+
+    std::uint32_t getFileReads() const noexcept;
+    std::uint32_t getCacheHits() const noexcept;
+
+    static std::string normalizePath(const std::string& path);
+
+private:
+
+    struct Expansion
+    {
+        std::string text;
+        std::vector<std::string> includes;
+    };
+
+    std::string expand(const std::string& filename, const std::string& source, const std::string& prepend, std::vector<std::string>& includes, std::uint32_t depth);
+    bool loadInclude(const std::string& name, std::string& path, std::string& content);
+    std::vector<std::string> getSearchPaths(const std::string& name) const;
+    static void addInclude(std::vector<std::string>& includes, const std::string& path);
+    std::string getMarker(std::uint32_t line, const std::string& filename, std::uint32_t fileId) const;
+
+    mutable std::mutex m_Mutex;
+    ShaderLineMarker m_LineMarker;
+    std::vector<std::string> m_Directories;
+    std::unordered_map<std::string, std::string> m_Files;
+    std::unordered_map<std::uint64_t, Expansion> m_Expansions;
+    std::unordered_map<std::string, std::vector<std::string>> m_Dependencies;
+    std::uint32_t m_FileReads;
+    std::uint32_t m_CacheHits;
+};
@@ -0,0 +1,148 @@
+#include "Std140.h"
+
+#include <cstring>
+#include <cassert>
+
+Std140Writer::Std140Writer() noexcept
+{
+}
+
+Std140Writer::~Std140Writer() noexcept
+{
+}
+
+void Std140Writer::reset() noexcept
+{
+    m_Data.clear();
+}
+
+std::size_t Std140Writer::write(float v) noexcept
+{
+    return put(&v, sizeof(v), 4);
+}
+
+std::size_t Std140Writer::write(std::int32_t v) noexcept
+{
+    return put(&v, sizeof(v), 4);
+}
+
+std::size_t Std140Writer::write(std::uint32_t v) noexcept
+{
+    return put(&v, sizeof(v), 4);
+}
+
+std::size_t Std140Writer::write(bool v) noexcept
+{
+    // GLSL bool occupies a full 32 bit word
+    std::uint32_t value = v ? 1u : 0u;
+    return put(&value, sizeof(value), 4);
+}
+
+std::size_t Std140Writer::write(const glm::vec2& v) noexcept
+{
+    return put(&v, sizeof(v), 8);
+}
+
+std::size_t Std140Writer::write(const glm::vec3& v) noexcept
+{
+    // vec3 is aligned like a vec4, but the next scalar may fill the last word
+    return put(&v, sizeof(v), 16);
+}
+
+std::size_t Std140Writer::write(const glm::vec4& v) noexcept
+{
+    return put(&v, sizeof(v), 16);
+}
+
+std::size_t Std140Writer::write(const glm::ivec2& v) noexcept
+{
+    return put(&v, sizeof(v), 8);
+}
+
+std::size_t Std140Writer::write(const glm::ivec4& v) noexcept
+{
+    return put(&v, sizeof(v), 16);
+}
+
+std::size_t Std140Writer::write(const glm::mat3& v) noexcept
+{
+    // Column major, stored as an array of three vec3 with a vec4 stride
+    return putArray(&v[0], sizeof(glm::vec3), 3);
+}
+
+std::size_t Std140Writer::write(const glm::mat4& v) noexcept
+{
+    return putArray(&v[0], sizeof(glm::vec4), 4);
+}
+
+std::size_t Std140Writer::write(const float* v, std::size_t count) noexcept
+{
+    return putArray(v, sizeof(float), count);
+}
+
+std::size_t Std140Writer::write(const glm::vec2* v, std::size_t count) noexcept
+{
+    return putArray(v, sizeof(glm::vec2), count);
+}
+
+std::size_t Std140Writer::write(const glm::vec4* v, std::size_t count) noexcept
+{
+    return putArray(v, sizeof(glm::vec4), count);
+}
+
+std::size_t Std140Writer::beginStruct() noexcept
+{
+    return align(VectorAlignment);
+}
+
+void Std140Writer::endStruct() noexcept
+{
+    // Members following a structure start at the next vec4 boundary
+    align(VectorAlignment);
+}
+
+const std::uint8_t* Std140Writer::getData() const noexcept
+{
+    return m_Data.data();
+}
+
+std::size_t Std140Writer::getOffset() const noexcept
+{
+    return m_Data.size();
+}
+
+std::size_t Std140Writer::getSize() const noexcept
+{
+    return (m_Data.size() + VectorAlignment - 1) & ~(VectorAlignment - 1);
+}
+
+std::size_t Std140Writer::align(std::size_t alignment) noexcept
+{
+    assert((alignment & (alignment - 1)) == 0);
+
+    auto offset = (m_Data.size() + alignment - 1) & ~(alignment - 1);
+    m_Data.resize(offset, 0);
+    return offset;
+}
+
+std::size_t Std140Writer::put(const void* data, std::size_t size, std::size_t alignment) noexcept
+{
+    auto offset = align(alignment);
+    m_Data.resize(offset + size);
+    std::memcpy(m_Data.data() + offset, data, size);
+    return offset;
+}
+
+std::size_t Std140Writer::putArray(const void* data, std::size_t size, std::size_t count) noexcept
+{
+    assert(size <= VectorAlignment);
+
+    auto offset = align(VectorAlignment);
+    auto bytes = static_cast<const std::uint8_t*>(data);
+    for (std::size_t i = 0; i < count; i++)
+    {
+        put(bytes + i * size, size, VectorAlignment);
+        align(VectorAlignment);
+    }
+    return offset;
+}
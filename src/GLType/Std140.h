@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <glm/glm.hpp>
+
+// Packs values following the std140 layout rules of the GLSL specification (7.6.2.2).
+// Does not touch GL, so the offsets can be checked against the shader block on the CPU.
+class Std140Writer final
+{
+public:
+
+    Std140Writer() noexcept;
+    ~Std140Writer() noexcept;
+
+    void reset() noexcept;
+
+    // Each write returns the offset of the member in bytes
+    std::size_t write(float v) noexcept;
+    std::size_t write(std::int32_t v) noexcept;
+    std::size_t write(std::uint32_t v) noexcept;
+    std::size_t write(bool v) noexcept;
+    std::size_t write(const glm::vec2& v) noexcept;
+    std::size_t write(const glm::vec3& v) noexcept;
+    std::size_t write(const glm::vec4& v) noexcept;
+    std::size_t write(const glm::ivec2& v) noexcept;
+    std::size_t write(const glm::ivec4& v) noexcept;
+    std::size_t write(const glm::mat3& v) noexcept;
+    std::size_t write(const glm::mat4& v) noexcept;
+
+    // Array elements are padded to a vec4 stride
+    std::size_t write(const float* v, std::size_t count) noexcept;
+    std::size_t write(const glm::vec2* v, std::size_t count) noexcept;
+    std::size_t write(const glm::vec4* v, std::size_t count) noexcept;
+
+    // Structures start and end on a vec4 boundary
+    std::size_t beginStruct() noexcept;
+    void endStruct() noexcept;
+
+    const std::uint8_t* getData() const noexcept;
+    std::size_t getOffset() const noexcept;
+    // Size of the block, rounded up to the base alignment of a vec4
+    std::size_t getSize() const noexcept;
+
+    static const std::size_t VectorAlignment = 16;
+
+private:
+
+    std::size_t align(std::size_t alignment) noexcept;
+    std::size_t put(const void* data, std::size_t size, std::size_t alignment) noexcept;
+    std::size_t putArray(const void* data, std::size_t size, std::size_t count) noexcept;
+
+    std::vector<std::uint8_t> m_Data;
+};
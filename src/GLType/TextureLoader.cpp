@@ -0,0 +1,457 @@
+#include <GLType/TextureLoader.h>
+
+#include <cassert>
+#include <cstring>
+#include <algorithm>
+#include <glm/gtc/packing.hpp>
+#include <tools/stb_image.h>
+#include <tools/string.h>
+#include <tools/FileUtility.h>
+#include <tools/MappedFile.h>
+#include <tools/Logger.hpp>
+#include <GLType/GraphicsDevice.h>
+#include <GLType/GraphicsTexture.h>
+#include <GLType/OGLCoreTexture.h>
+
+namespace
+{
+    const gli::format LDRFormats[] = {
+        gli::FORMAT_R8_UNORM_PACK8,
+        gli::FORMAT_RG8_UNORM_PACK8,
+        gli::FORMAT_RGB8_UNORM_PACK8,
+        gli::FORMAT_RGBA8_UNORM_PACK8,
+    };
+
+    // Matches the half float internal formats picked by OGLTypes::getInternalComponent
+    const gli::format HDRFormats[] = {
+        gli::FORMAT_R16_SFLOAT_PACK16,
+        gli::FORMAT_RG16_SFLOAT_PACK16,
+        gli::FORMAT_RGB16_SFLOAT_PACK16,
+        gli::FORMAT_RGBA16_SFLOAT_PACK16,
+    };
+
+    // stb's global flip flag is not thread safe, so images are decoded top down and flipped on upload
+    gli::texture decodeLDR(const char* data, std::size_t size)
+    {
+        int width = 0, height = 0, nrComponents = 0;
+        stbi_uc* imagedata = stbi_load_from_memory((const stbi_uc*)data, (int)size, &width, &height, &nrComponents, 0);
+        if (!imagedata)
+            return gli::texture();
+
+        gli::texture2d texture(LDRFormats[nrComponents - 1], gli::extent2d(width, height), 1);
+        std::memcpy(texture.data(), imagedata, texture.size());
+        stbi_image_free(imagedata);
+        return texture;
+    }
+
+    gli::texture decodeHDR(const char* data, std::size_t size)
+    {
+        int width = 0, height = 0, nrComponents = 0;
+        float* imagedata = stbi_loadf_from_memory((const stbi_uc*)data, (int)size, &width, &height, &nrComponents, 0);
+        if (!imagedata)
+            return gli::texture();
+
+        gli::texture2d texture(HDRFormats[nrComponents - 1], gli::extent2d(width, height), 1);
+        auto texels = texture.data<std::uint16_t>();
+        std::size_t count = std::size_t(width) * height * nrComponents;
+        for (std::size_t i = 0; i < count; i++)
+            texels[i] = glm::packHalf1x16(imagedata[i]);
+        stbi_image_free(imagedata);
+        return texture;
+    }
+
+    // Same order as OGLCoreTexture::createFromMemory
+    gli::texture decodeMemory(const char* data, std::size_t size)
+    {
+        gli::texture texture = gli::load(data, size);
+        if (!texture.empty())
+            return texture;
+        if (stbi_is_hdr_from_memory((const stbi_uc*)data, (int)size))
+            return decodeHDR(data, size);
+        return decodeLDR(data, size);
+    }
+
+    bool isFlippable(gli::target target)
+    {
+        return target != gli::TARGET_1D
+            && target != gli::TARGET_1D_ARRAY
+            && target != gli::TARGET_3D;
+    }
+
+    // Targets whose images are 2D slices that can be streamed a few rows at a time
+    bool isSliceable(gli::target target)
+    {
+        return target == gli::TARGET_2D
+            || target == gli::TARGET_2D_ARRAY
+            || target == gli::TARGET_CUBE
+            || target == gli::TARGET_CUBE_ARRAY;
+    }
+}
+
+TextureRequest::TextureRequest(const std::string& filename, const GraphicsTexturePtr& placeholder) noexcept
+    : m_Filename(filename)
+    , m_Texture(placeholder)
+    , m_State(TextureLoadStatePending)
+{
+}
+
+TextureRequest::~TextureRequest() noexcept
+{
+}
+
+const GraphicsTexturePtr& TextureRequest::getTexture() const noexcept
+{
+    return m_Texture;
+}
+
+const std::string& TextureRequest::getFileName() const noexcept
+{
+    return m_Filename;
+}
+
+TextureLoadState TextureRequest::getState() const noexcept
+{
+    return m_State;
+}
+
+bool TextureRequest::isReady() const noexcept
+{
+    return m_State == TextureLoadStateReady;
+}
+
+TextureLoader::TextureLoader() noexcept
+    : m_UploadBudget(4 << 20)
+    , m_RingBuffer(GL_NONE)
+    , m_RingData(nullptr)
+    , m_Slot(0)
+    , m_bQuit(false)
+    , m_Count(0)
+{
+    std::fill(m_Fences, m_Fences + SlotCount, nullptr);
+}
+
+TextureLoader::~TextureLoader() noexcept
+{
+    shutdown();
+}
+
+bool TextureLoader::initialize(const GraphicsDevicePtr& device, uint32_t numThreads)
+{
+    assert(device);
+    assert(m_Threads.empty());
+
+    m_Device = device;
+
+    gli::texture2d black(gli::FORMAT_RGBA8_UNORM_PACK8, gli::extent2d(1, 1), 1);
+    black.clear(glm::u8vec4(0, 0, 0, 255));
+    m_Placeholder = device->createTexture(black);
+
+    // Without buffer storage every texture is uploaded at once by the device
+    auto deviceType = device->getGraphicsDeviceDesc().getDeviceType();
+    if (deviceType == GraphicsDeviceType::GraphicsDeviceTypeOpenGLCore && GLEW_ARB_buffer_storage)
+    {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glCreateBuffers(1, &m_RingBuffer);
+        glNamedBufferStorage(m_RingBuffer, SlotCount * SlotSize, nullptr, flags);
+        m_RingData = (std::uint8_t*)glMapNamedBufferRange(m_RingBuffer, 0, SlotCount * SlotSize, flags);
+        if (!m_RingData)
+        {
+            glDeleteBuffers(1, &m_RingBuffer);
+            m_RingBuffer = GL_NONE;
+        }
+    }
+
+    m_bQuit = false;
+    for (uint32_t i = 0; i < std::max(numThreads, 1u); i++)
+        m_Threads.emplace_back(&TextureLoader::worker, this);
+    return true;
+}
+
+void TextureLoader::shutdown() noexcept
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_bQuit = true;
+    }
+    m_WakeCondition.notify_all();
+    for (auto& thread : m_Threads)
+        thread.join();
+    m_Threads.clear();
+
+    for (auto& job : m_Pending)
+        job->request->m_State = TextureLoadStateFailed;
+    for (auto& job : m_Decoded)
+        job->request->m_State = TextureLoadStateFailed;
+    for (auto& job : m_Uploads)
+        job->request->m_State = TextureLoadStateFailed;
+    m_Pending.clear();
+    m_Decoded.clear();
+    m_Uploads.clear();
+    m_Count = 0;
+
+    for (auto& fence : m_Fences)
+    {
+        if (fence)
+            glDeleteSync(fence);
+        fence = nullptr;
+    }
+    if (m_RingBuffer != GL_NONE)
+    {
+        glUnmapNamedBuffer(m_RingBuffer);
+        glDeleteBuffers(1, &m_RingBuffer);
+        m_RingBuffer = GL_NONE;
+        m_RingData = nullptr;
+    }
+    m_Placeholder = nullptr;
+}
+
+TextureRequestPtr TextureLoader::load(const std::string& filename, const GraphicsTexturePtr& placeholder)
+{
+    assert(!m_Threads.empty());
+
+    auto request = std::make_shared<TextureRequest>(filename, placeholder ? placeholder : m_Placeholder);
+    auto job = std::make_shared<Job>();
+    job->request = request;
+    job->bFlipRows = false;
+    job->layer = job->face = job->level = job->row = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Pending.push_back(job);
+    }
+    m_Count++;
+    m_WakeCondition.notify_one();
+    return request;
+}
+
+void TextureLoader::worker() noexcept
+{
+    for (;;)
+    {
+        JobPtr job;
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_WakeCondition.wait(lock, [this]() { return m_bQuit || !m_Pending.empty(); });
+            if (m_bQuit)
+                return;
+            job = m_Pending.front();
+            m_Pending.pop_front();
+        }
+
+        decodeJob(*job);
+
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Decoded.push_back(job);
+    }
+}
+
+void TextureLoader::decodeJob(Job& job) noexcept
+{
+    const auto& filename = job.request->getFileName();
+    MappedFile data(filename);
+    if (!data.isOpen())
+        return;
+
+    job.texture = decode(filename, data.data(), data.size());
+    if (job.texture.empty() || !isFlippable(job.texture.target()))
+        return;
+
+    // Block compressed texels are reordered here, off the render thread;
+    // plain rows are flipped while they are copied into the staging ring
+    if (gli::is_compressed(job.texture.format()))
+        job.texture = gli::flip(job.texture);
+    else
+        job.bFlipRows = true;
+}
+
+gli::texture TextureLoader::decode(const std::string& filename, const char* data, std::size_t size)
+{
+    const std::string ext = util::getFileExtension(filename);
+    if (util::stricmp(ext, "zlib"))
+    {
+        auto decoded = util::DecompressMemory(data, size);
+        if (decoded->empty())
+            return gli::texture();
+        return decodeMemory(decoded->data(), decoded->size());
+    }
+    else if (util::stricmp(ext, "DDS") || util::stricmp(ext, "KTX"))
+        return gli::load(data, size);
+    else if (util::stricmp(ext, "HDR"))
+        return decodeHDR(data, size);
+    return decodeLDR(data, size);
+}
+
+void TextureLoader::update()
+{
+    std::vector<JobPtr> decoded;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        decoded.swap(m_Decoded);
+    }
+    for (auto& job : decoded)
+    {
+        if (job->texture.empty())
+            finish(*job, nullptr);
+        else
+            m_Uploads.push_back(job);
+    }
+
+    uint32_t budget = m_UploadBudget;
+    while (!m_Uploads.empty() && budget > 0)
+    {
+        auto job = m_Uploads.front();
+        if (!job->target && !beginUpload(*job))
+        {
+            m_Uploads.pop_front();
+            continue;
+        }
+        if (!uploadSlice(*job, budget))
+            break;
+        if (job->layer == job->texture.layers())
+        {
+            finish(*job, job->target);
+            m_Uploads.pop_front();
+        }
+    }
+}
+
+bool TextureLoader::beginUpload(Job& job)
+{
+    auto device = m_Device.lock();
+    if (!device)
+    {
+        finish(job, nullptr);
+        return false;
+    }
+
+    if (!m_RingData || !isSliceable(job.texture.target()))
+    {
+        finish(job, device->createTexture(job.texture, job.bFlipRows));
+        return false;
+    }
+
+    auto texture = std::make_shared<OGLCoreTexture>();
+    texture->setDevice(device);
+    if (!texture->createStorage(job.texture))
+    {
+        finish(job, nullptr);
+        return false;
+    }
+    job.target = texture;
+    job.request->m_State = TextureLoadStateUploading;
+    return true;
+}
+
+bool TextureLoader::uploadSlice(Job& job, uint32_t& budget)
+{
+    // The slot may still be read by an upload of an earlier frame
+    GLsync& fence = m_Fences[m_Slot];
+    if (fence)
+    {
+        if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+            return false;
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    const auto& texture = job.texture;
+    const auto extent = texture.extent(job.level);
+    const auto blockExtent = gli::block_extent(texture.format());
+    const std::size_t rows = (extent.y + blockExtent.y - 1) / blockExtent.y;
+    const std::size_t rowSize = texture.size(job.level) / rows;
+    assert(rowSize <= SlotSize);
+
+    std::size_t count = std::min(rows - job.row, SlotSize / rowSize);
+    count = std::min(count, std::max<std::size_t>(budget / rowSize, 1));
+    budget -= std::min<uint32_t>(budget, uint32_t(count * rowSize));
+
+    auto src = static_cast<const std::uint8_t*>(texture.data(job.layer, job.face, job.level));
+    auto dst = m_RingData + m_Slot * SlotSize;
+    for (std::size_t i = 0; i < count; i++)
+    {
+        std::size_t row = job.row + i;
+        std::size_t srcRow = job.bFlipRows ? rows - row - 1 : row;
+        std::memcpy(dst + i * rowSize, src + srcRow * rowSize, rowSize);
+    }
+
+    gli::gl GL(gli::gl::PROFILE_GL33);
+    gli::gl::format const Format = GL.translate(texture.format(), texture.swizzles());
+    GLuint TextureID = job.target->getTextureID();
+    GLint Level = static_cast<GLint>(job.level);
+    GLint OffsetY = static_cast<GLint>(job.row * blockExtent.y);
+    GLsizei Height = std::min(static_cast<GLsizei>(count * blockExtent.y), extent.y - OffsetY);
+    GLint OffsetZ = static_cast<GLint>(job.layer * texture.faces() + job.face);
+    GLsizei Size = static_cast<GLsizei>(count * rowSize);
+    const void* Offset = reinterpret_cast<const void*>(std::uintptr_t(m_Slot * SlotSize));
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_RingBuffer);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    if (texture.target() == gli::TARGET_2D)
+    {
+        if (gli::is_compressed(texture.format()))
+            glCompressedTextureSubImage2D(TextureID, Level, 0, OffsetY, extent.x, Height, Format.Internal, Size, Offset);
+        else
+            glTextureSubImage2D(TextureID, Level, 0, OffsetY, extent.x, Height, Format.External, Format.Type, Offset);
+    }
+    else
+    {
+        if (gli::is_compressed(texture.format()))
+            glCompressedTextureSubImage3D(TextureID, Level, 0, OffsetY, OffsetZ, extent.x, Height, 1, Format.Internal, Size, Offset);
+        else
+            glTextureSubImage3D(TextureID, Level, 0, OffsetY, OffsetZ, extent.x, Height, 1, Format.External, Format.Type, Offset);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, GL_NONE);
+
+    fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_Slot = (m_Slot + 1) % SlotCount;
+
+    // Next image once every row of this one is sent
+    job.row += count;
+    if (job.row == rows)
+    {
+        job.row = 0;
+        if (++job.level == texture.levels())
+        {
+            job.level = 0;
+            if (++job.face == texture.faces())
+            {
+                job.face = 0;
+                job.layer++;
+            }
+        }
+    }
+    return true;
+}
+
+void TextureLoader::finish(Job& job, const GraphicsTexturePtr& texture)
+{
+    auto& request = *job.request;
+    if (texture)
+    {
+        request.m_Texture = texture;
+        request.m_State = TextureLoadStateReady;
+    }
+    else
+    {
+        LOG_WARNING("TextureLoader : can't load \"%s\"\n", request.getFileName());
+        request.m_State = TextureLoadStateFailed;
+    }
+    job.texture = gli::texture();
+    job.target = nullptr;
+    m_Count--;
+}
+
+void TextureLoader::setUploadBudget(uint32_t bytes) noexcept
+{
+    m_UploadBudget = bytes;
+}
+
+uint32_t TextureLoader::getUploadBudget() const noexcept
+{
+    return m_UploadBudget;
+}
+
+uint32_t TextureLoader::getPendingCount() const noexcept
+{
+    return m_Count;
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <gli/gli.hpp>
+#include <GraphicsTypes.h>
+
+enum TextureLoadState
+{
+    TextureLoadStatePending = 0,
+    TextureLoadStateUploading,
+    TextureLoadStateReady,
+    TextureLoadStateFailed,
+};
+
+// Handle returned by TextureLoader::load; hands out the placeholder until the upload is done
+class TextureRequest final
+{
+public:
+
+    TextureRequest(const std::string& filename, const GraphicsTexturePtr& placeholder) noexcept;
+    ~TextureRequest() noexcept;
+
+    const GraphicsTexturePtr& getTexture() const noexcept;
+    const std::string& getFileName() const noexcept;
+    TextureLoadState getState() const noexcept;
+    bool isReady() const noexcept;
+
+private:
+
+    friend class TextureLoader;
+
+    TextureRequest(const TextureRequest&) = delete;
+    TextureRequest& operator=(const TextureRequest&) = delete;
+
+    std::string m_Filename;
+    GraphicsTexturePtr m_Texture;
+    std::atomic<TextureLoadState> m_State;
+};
+
+typedef std::shared_ptr<TextureRequest> TextureRequestPtr;
+
+// Reads and decodes texture files on worker threads, then streams them to the GPU
+// through a ring of persistently mapped pixel unpack buffers, a bounded amount per frame.
+// Devices without buffer storage, and 1D/3D textures, are uploaded in one go once decoded.
+class TextureLoader final
+{
+public:
+
+    TextureLoader() noexcept;
+    ~TextureLoader() noexcept;
+
+    bool initialize(const GraphicsDevicePtr& device, uint32_t numThreads = 1);
+    void shutdown() noexcept;
+
+    // 'placeholder' defaults to a black 1x1 2D texture
+    TextureRequestPtr load(const std::string& filename, const GraphicsTexturePtr& placeholder = nullptr);
+
+    // Call once per frame on the GL thread
+    void update();
+
+    void setUploadBudget(uint32_t bytes) noexcept;
+    uint32_t getUploadBudget() const noexcept;
+    uint32_t getPendingCount() const noexcept;
+
+    // Turns a DDS, KTX, HDR, LDR or zlib wrapped file into an unflipped texture; needs no GL
+    static gli::texture decode(const std::string& filename, const char* data, std::size_t size);
+
+    static const uint32_t SlotCount = 4;
+    static const uint32_t SlotSize = 1 << 20;
+
+private:
+
+    struct Job
+    {
+        TextureRequestPtr request;
+        gli::texture texture;
+        bool bFlipRows;
+        OGLCoreTexturePtr target;
+        std::size_t layer, face, level;
+        std::size_t row;
+    };
+
+    typedef std::shared_ptr<Job> JobPtr;
+
+    void worker() noexcept;
+    void decodeJob(Job& job) noexcept;
+    bool beginUpload(Job& job);
+    bool uploadSlice(Job& job, uint32_t& budget);
+    void finish(Job& job, const GraphicsTexturePtr& texture);
+
+    TextureLoader(const TextureLoader&) = delete;
+    TextureLoader& operator=(const TextureLoader&) = delete;
+
+    GraphicsDeviceWeakPtr m_Device;
+    GraphicsTexturePtr m_Placeholder;
+    uint32_t m_UploadBudget;
+
+    // Staging ring, one fence per slot
+    GLuint m_RingBuffer;
+    std::uint8_t* m_RingData;
+    GLsync m_Fences[SlotCount];
+    uint32_t m_Slot;
+
+    bool m_bQuit;
+    std::mutex m_Mutex;
+    std::condition_variable m_WakeCondition;
+    std::deque<JobPtr> m_Pending;
+    std::vector<JobPtr> m_Decoded;
+    std::deque<JobPtr> m_Uploads;
+    std::atomic<uint32_t> m_Count;
+    std::vector<std::thread> m_Threads;
+};
@@ -1,18 +1,33 @@
 /**
- * 
- *    \file VertexBuffer.cpp  
- * 
+ *
+ *    \file VertexBuffer.cpp
+ *
  */
- 
+
 
 #include <GL/glew.h>
 #include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
 #include <vector>
+#include <cstring>
+#include <cassert>
+#include <limits>
 
 #include "VertexBuffer.h"
 
 
-    
+namespace
+{
+  // Appends 'size' bytes of 'value' to each vertex, 'offset' bytes into it
+  template<typename T>
+  void interleave( std::vector<uint8_t>& data, GLsizei stride, GLintptr offset, const std::vector<T>& values )
+  {
+    for (std::size_t i = 0; i < values.size(); i++)
+      memcpy( &data[i * stride + offset], &values[i], sizeof(T));
+  }
+}
+
+
 void VertexBuffer::initialize()
 {
   if (!m_vao) glGenVertexArrays( 1, &m_vao);
@@ -23,10 +38,14 @@ void VertexBuffer::destroy()
 {
   if (m_vao) glDeleteVertexArrays( 1, &m_vao);
   if (m_vbo) glDeleteBuffers( 1, &m_vbo);
-  
+  if (m_ibo) glDeleteBuffers( 1, &m_ibo);
+
   cleanData();
   m_vao = 0;
   m_vbo = 0;
+  m_ibo = 0;
+  m_vertexCount = m_indexCount = 0;
+  m_memorySize = 0;
 }
 
 void VertexBuffer::cleanData()
@@ -34,46 +53,100 @@ void VertexBuffer::cleanData()
   m_position.clear();
   m_normal.clear();
   m_texcoord.clear();
+  m_index.clear();
 }
 
-void VertexBuffer::complete(GLenum usage)
+void VertexBuffer::complete(GLenum usage, bool bQuantize)
 {
   assert( m_vao && m_vbo );
-  
-  
-  m_positionSize = m_normalSize = m_texcoordSize = 0;  
-  if (!m_position.empty()) m_positionSize = m_position.size() * sizeof(glm::vec3);
-  if (!m_normal.empty()) m_normalSize = m_normal.size() * sizeof(glm::vec3);
-  if (!m_texcoord.empty()) m_texcoordSize  = m_texcoord.size() * sizeof(glm::vec2);  
-  
-  GLsizeiptr bufferSize = m_positionSize + m_normalSize + m_texcoordSize;
-    
-  
+  assert( m_normal.empty() || m_normal.size() == m_position.size());
+  assert( m_texcoord.empty() || m_texcoord.size() == m_position.size());
+
+  m_vertexCount = (GLsizei)m_position.size();
+  m_indexCount = (GLsizei)m_index.size();
+
+  // position | normal | texcoord, in one buffer
+  const GLintptr positionOffset = 0;
+  const GLintptr normalOffset = bQuantize ? 8 : 12;
+  const GLintptr texcoordOffset = normalOffset + (m_normal.empty() ? 0 : (bQuantize ? 4 : 12));
+  const GLsizei stride = (GLsizei)(texcoordOffset + (m_texcoord.empty() ? 0 : (bQuantize ? 4 : 8)));
+
+  std::vector<uint8_t> vertices( m_vertexCount * stride);
+  if (bQuantize)
+  {
+    std::vector<uint64_t> positions( m_position.size());
+    std::vector<uint32_t> normals( m_normal.size());
+    std::vector<uint32_t> texcoords( m_texcoord.size());
+    for (std::size_t i = 0; i < m_position.size(); i++)
+      positions[i] = glm::packHalf4x16( glm::vec4( m_position[i], 1.f));
+    for (std::size_t i = 0; i < m_normal.size(); i++)
+      normals[i] = glm::packSnorm3x10_1x2( glm::vec4( m_normal[i], 0.f));
+    for (std::size_t i = 0; i < m_texcoord.size(); i++)
+      texcoords[i] = glm::packHalf2x16( m_texcoord[i]);
+
+    interleave( vertices, stride, positionOffset, positions);
+    interleave( vertices, stride, normalOffset, normals);
+    interleave( vertices, stride, texcoordOffset, texcoords);
+  }
+  else
+  {
+    interleave( vertices, stride, positionOffset, m_position);
+    interleave( vertices, stride, normalOffset, m_normal);
+    interleave( vertices, stride, texcoordOffset, m_texcoord);
+  }
+  m_memorySize = (GLsizeiptr)vertices.size();
+
+  // Attribute arrays and the index buffer binding are part of the VAO
   bind();
-  {    
-    glBufferData( GL_ARRAY_BUFFER, bufferSize, 0, usage);
-      
-    m_offset = 0;
-    
-    if (!m_position.empty())
-    {
-      glBufferSubData( GL_ARRAY_BUFFER, m_offset, m_positionSize, &m_position[0]);
-      glVertexAttribPointer( VATTRIB_POSITION, 3, GL_FLOAT, GL_FALSE, 0, (void*)(m_offset));
-      m_offset += m_positionSize;
-    }
-    
+  {
+    glBufferData( GL_ARRAY_BUFFER, vertices.size(), vertices.data(), usage);
+
+    glEnableVertexAttribArray( VATTRIB_POSITION );
+    if (bQuantize)
+      glVertexAttribPointer( VATTRIB_POSITION, 4, GL_HALF_FLOAT, GL_FALSE, stride, (void*)(positionOffset));
+    else
+      glVertexAttribPointer( VATTRIB_POSITION, 3, GL_FLOAT, GL_FALSE, stride, (void*)(positionOffset));
+
     if (!m_normal.empty())
     {
-      glBufferSubData( GL_ARRAY_BUFFER, m_offset, m_normalSize, &m_normal[0]);
-      glVertexAttribPointer( VATTRIB_NORMAL, 3, GL_FLOAT, GL_FALSE, 0, (void*)(m_offset));
-      m_offset += m_normalSize;
+      glEnableVertexAttribArray( VATTRIB_NORMAL );
+      if (bQuantize)
+        glVertexAttribPointer( VATTRIB_NORMAL, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (void*)(normalOffset));
+      else
+        glVertexAttribPointer( VATTRIB_NORMAL, 3, GL_FLOAT, GL_FALSE, stride, (void*)(normalOffset));
     }
-    
+    else
+      glDisableVertexAttribArray( VATTRIB_NORMAL );
+
     if (!m_texcoord.empty())
     {
-      glBufferSubData( GL_ARRAY_BUFFER, m_offset, m_texcoordSize, &m_texcoord[0]);
-      glVertexAttribPointer( VATTRIB_TEXCOORD, 2, GL_FLOAT, GL_FALSE, 0, (void*)(m_offset));  
-      m_offset += m_texcoordSize;
+      glEnableVertexAttribArray( VATTRIB_TEXCOORD );
+      if (bQuantize)
+        glVertexAttribPointer( VATTRIB_TEXCOORD, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void*)(texcoordOffset));
+      else
+        glVertexAttribPointer( VATTRIB_TEXCOORD, 2, GL_FLOAT, GL_FALSE, stride, (void*)(texcoordOffset));
+    }
+    else
+      glDisableVertexAttribArray( VATTRIB_TEXCOORD );
+
+    if (!m_index.empty())
+    {
+      if (!m_ibo) glGenBuffers( 1, &m_ibo);
+      glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, m_ibo);
+
+      if (m_vertexCount <= std::numeric_limits<uint16_t>::max() + 1)
+      {
+        std::vector<uint16_t> indices( m_index.begin(), m_index.end());
+        glBufferData( GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint16_t), indices.data(), usage);
+        m_indexType = GL_UNSIGNED_SHORT;
+        m_memorySize += indices.size() * sizeof(uint16_t);
+      }
+      else
+      {
+        glBufferData( GL_ELEMENT_ARRAY_BUFFER, m_index.size() * sizeof(uint32_t), m_index.data(), usage);
+        m_indexType = GL_UNSIGNED_INT;
+        m_memorySize += m_index.size() * sizeof(uint32_t);
+      }
     }
   }
   unbind();
@@ -88,24 +161,27 @@ void VertexBuffer::bind() const
 
 void VertexBuffer::unbind()
 {
-  glBindBuffer( GL_ARRAY_BUFFER, 0u);
   glBindVertexArray( 0u );
+  glBindBuffer( GL_ARRAY_BUFFER, 0u);
 }
 
 void VertexBuffer::enable() const
-{  
-  bind();
-  
-  if (m_positionSize != 0)  glEnableVertexAttribArray( VATTRIB_POSITION );
-  if (m_normalSize != 0)    glEnableVertexAttribArray( VATTRIB_NORMAL );
-  if (m_texcoordSize != 0)  glEnableVertexAttribArray( VATTRIB_TEXCOORD );
+{
+  // Attribute arrays were enabled in 'complete'
+  glBindVertexArray( m_vao );
 }
 
 void VertexBuffer::disable()
-{    
- 	glDisableVertexAttribArray( VATTRIB_POSITION );
-  glDisableVertexAttribArray( VATTRIB_NORMAL );
-  glDisableVertexAttribArray( VATTRIB_TEXCOORD );
-  
-  unbind();
+{
+  glBindVertexArray( 0u );
+}
+
+void VertexBuffer::draw(GLenum mode) const
+{
+  enable();
+  if (m_indexCount > 0)
+    glDrawElements( mode, m_indexCount, m_indexType, nullptr);
+  else
+    glDrawArrays( mode, 0, m_vertexCount);
+  disable();
 }
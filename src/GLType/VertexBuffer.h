@@ -2,9 +2,11 @@
  * 
  *    \file VertexBuffer.hpp  
  * 
- *    \todo # allow index buffer
- *          # allow interleaving
- *          # add tangent ?
+ *    Attributes are interleaved in a single buffer, optionally quantized
+ *    (half float position and texcoord, 10:10:10:2 normal: 16 bytes a vertex
+ *    instead of 32). Indices are stored in 16 bits when the vertex count allows.
+ *
+ *    \todo # add tangent ?
  */
  
 
@@ -16,6 +18,7 @@
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 #include <vector>
+#include <cstdint>
 
 
 enum VertexAttribLocation
@@ -30,23 +33,25 @@ class VertexBuffer
   protected:
     GLuint m_vao;
     GLuint m_vbo;    
+    GLuint m_ibo;
 
     std::vector<glm::vec3> m_position;
     std::vector<glm::vec3> m_normal;
     std::vector<glm::vec2> m_texcoord;
-        
-    GLsizeiptr m_positionSize;
-    GLsizeiptr m_normalSize;
-    GLsizeiptr m_texcoordSize;
-    
-    GLintptr m_offset;
+    std::vector<uint32_t> m_index;
+
+    GLsizei m_vertexCount;
+    GLsizei m_indexCount;
+    GLenum m_indexType;
+    GLsizeiptr m_memorySize;
     
 
   public:
     VertexBuffer() 
-      : m_vao(0u), m_vbo(0u),
-        m_positionSize(0), m_normalSize(0), m_texcoordSize(0),
-        m_offset(0)
+      : m_vao(0u), m_vbo(0u), m_ibo(0u),
+        m_vertexCount(0), m_indexCount(0),
+        m_indexType(GL_UNSIGNED_INT),
+        m_memorySize(0)
     {}
                      
     virtual ~VertexBuffer() { destroy(); }
@@ -58,7 +63,7 @@ class VertexBuffer
     void cleanData();
 
     /** Set the VAO parameters & send data to the GPU */
-    void complete(GLenum usage);
+    void complete(GLenum usage, bool bQuantize = false);
     
     void bind() const;        
     static void unbind();
@@ -68,6 +73,9 @@ class VertexBuffer
     
     /** Disable vertex attribs arrays */
     static void disable();    
+
+    /** Draws the indices if there are any, otherwise every vertex */
+    void draw(GLenum mode) const;
     
     
     GLuint getVBO() const {return m_vbo;}
@@ -75,8 +83,12 @@ class VertexBuffer
     std::vector<glm::vec3>& getPosition() {return m_position;}
     std::vector<glm::vec3>& getNormal() {return m_normal;}
     std::vector<glm::vec2>& getTexcoord() {return m_texcoord;}
-    
-    GLintptr getOffset() const { return m_offset; }
+    std::vector<uint32_t>& getIndex() {return m_index;}
+
+    GLsizei getVertexCount() const { return m_vertexCount; }
+    GLsizei getIndexCount() const { return m_indexCount; }
+    /** Bytes uploaded for vertices and indices */
+    GLsizeiptr getMemorySize() const { return m_memorySize; }
 };
 
 
@@ -89,8 +101,9 @@ class VertexBuffer
   std::vector<glm::vec3> &pos = vertexBuffer.getPosition();
   std::vector<glm::vec3> &nor = vertexBuffer.getNormal();
   std::vector<glm::vec2> &tex = vertexBuffer.getTexcoord();
+  std::vector<uint32_t> &ind = vertexBuffer.getIndex(); // [optional]
 
-  // Update pos, nor, tex
+  // Update pos, nor, tex, ind
   // ..
 
   // Generate buffer's id
@@ -5,6 +5,7 @@
 #include <cstdlib>
 #include <cstdio>
 #include <cstring>
+#include <algorithm>
 
 #include <GL/glew.h>
 #include <glfw3.h>
@@ -16,6 +17,9 @@
 #include <tools/Timer.hpp>
 #include <tools/imgui.h>
 #include <tools/TCamera.h>
+#include <tools/FramePacer.h>
+#include <tools/JobSystem.h>
+#include <tools/Profile.h>
 
 #include <imgui/imgui_impl_glfw_gl3.h>
 
@@ -59,8 +63,11 @@ namespace gamecore {
 	int32_t m_WindowHeight = 0;
 	int32_t m_FrameWidth = 0;
 	int32_t m_FrameHeight = 0;
+	std::vector<std::string> m_Arguments;
+	FramePacer m_FramePacer;
 
     bool m_bWireframe = false;
+	bool m_bDepthZeroToOne = false;
 	bool m_bCloseApp = false;
 
 	GLFWwindow* m_Window = nullptr;  
@@ -205,8 +212,13 @@ namespace gamecore {
 		}
 #endif
 
+		// Reverse-Z: near is 1 and infinity 0, cleared to 0
+		m_bDepthZeroToOne = GLEW_VERSION_4_5 || GLEW_ARB_clip_control;
+		if (m_bDepthZeroToOne)
+			glClipControl(GL_LOWER_LEFT, GL_ZERO_TO_ONE);
 		glEnable(GL_DEPTH_TEST);
-		glDepthFunc(GL_LEQUAL);
+		glDepthFunc(GL_GEQUAL);
+		glClearDepth(0.0);
 
 		glDisable(GL_STENCIL_TEST);
 		glClearStencil(0);
@@ -245,6 +257,10 @@ namespace gamecore {
 		glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
 		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+		// Still renders, for benchmarks on machines without a desktop (see Readme)
+		if (std::find(m_Arguments.begin(), m_Arguments.end(), "--hidden") != m_Arguments.end())
+			glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
 		
 		auto window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, name.c_str(), NULL, NULL );
 		if ( window == NULL ) {
@@ -411,6 +427,10 @@ bool IGameApp::isDone() const noexcept
 	return !m_bCloseApp && glfwWindowShouldClose(m_Window) == 0;
 }
 
+void IGameApp::fixedUpdate(float deltaTime) noexcept
+{
+}
+
 void IGameApp::update() noexcept
 {
 }
@@ -432,6 +452,11 @@ bool IGameApp::isWireframe() const noexcept
 	return m_bWireframe;
 }
 
+bool IGameApp::isDepthZeroToOne() const noexcept
+{
+	return m_bDepthZeroToOne;
+}
+
 int32_t IGameApp::getWindowWidth() const noexcept
 {
 	return m_WindowWidth;
@@ -452,6 +477,21 @@ int32_t IGameApp::getFrameHeight() const noexcept
 	return m_FrameHeight;
 }
 
+const std::vector<std::string>& IGameApp::getArguments() const noexcept
+{
+	return m_Arguments;
+}
+
+FramePacer& IGameApp::getFramePacer() const noexcept
+{
+	return m_FramePacer;
+}
+
+JobSystem& IGameApp::getJobSystem() const noexcept
+{
+	return JobSystem::instance();
+}
+
 void gamecore::update(IGameApp& app)
 {
 	Timer::getInstance().update();
@@ -466,29 +506,47 @@ void gamecore::updateHUD(IGameApp& app)
 
 bool gamecore::updateApplication(IGameApp& app)
 {
-	app.update();
+	m_FramePacer.beginFrame();
+
+	// Closes the previous frame, before any zone of this one opens
+	profiler::endFrame();
+
+	while (m_FramePacer.step())
+		app.fixedUpdate((float)m_FramePacer.getFixedDelta());
+
+	update(app);
 	updateHUD(app);
 	app.render();
 	app.renderHUD();
 	renderHUD(app);
 
+	// Whatever is left of the frame, while the GPU catches up
+	m_FramePacer.runIdleTasks();
+
 	/* Swap front and back buffers */
 	glfwSwapBuffers(m_Window);
 
 	/* Poll for and process events */
 	glfwPollEvents();
 
+	m_FramePacer.endFrame();
+
 	return app.isDone();
 }
 
-void gamecore::runApplication(IGameApp& app, std::string name)
+void gamecore::runApplication(IGameApp& app, std::string name, int argc, char** argv)
 {
+	m_Arguments.assign(argv + std::min(argc, 1), argv + argc);
+
 	Timer::getInstance().start();
 
 	initialize(app, name);
 
 	app.startup();
 
+	// GL work handed back by job workers, one per slice
+	m_FramePacer.addIdleTask([] { return JobSystem::instance().runMainThreadJob(); });
+
     glfwGetFramebufferSize(m_Window, &m_FrameWidth, &m_FrameHeight);
     glfw_framesize_callback(m_Window, m_FrameWidth, m_FrameHeight);
     glfw_reshape_callback(m_Window, WINDOW_WIDTH, WINDOW_HEIGHT);
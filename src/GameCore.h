@@ -2,6 +2,10 @@
 
 #include <tools/Rtti.h>
 #include <string>
+#include <vector>
+
+class FramePacer;
+class JobSystem;
 
 namespace gamecore
 {
@@ -15,6 +19,8 @@ namespace gamecore
 		virtual void startup() = 0;
 		virtual void closeup() = 0;
 
+		// Called at the pacer's fixed rate, before update
+		virtual void fixedUpdate(float deltaTime) noexcept;
 		virtual void update() noexcept;
 		virtual void updateHUD() noexcept;
 		virtual void render() noexcept;
@@ -22,12 +28,21 @@ namespace gamecore
 
 		virtual bool isDone() const noexcept;
 		virtual bool isWireframe() const noexcept;
+		// Clip control gave depth a [0, 1] range, for reverse-Z projections
+		bool isDepthZeroToOne() const noexcept;
 
 		int32_t getWindowWidth() const noexcept;
 		int32_t getWindowHeight() const noexcept;
 		int32_t getFrameWidth() const noexcept;
 		int32_t getFrameHeight() const noexcept;
 
+		// Command line, without the program name
+		const std::vector<std::string>& getArguments() const noexcept;
+
+		FramePacer& getFramePacer() const noexcept;
+		// Results of 'runAsync' arrive on this thread, in spare frame time
+		JobSystem& getJobSystem() const noexcept;
+
 		virtual void charCallback(uint32_t c) noexcept;
 		virtual void keyboardCallback(uint32_t c, bool bPressed) noexcept;
 		virtual void reshapeCallback(int32_t width, int32_t height) noexcept;
@@ -39,13 +54,13 @@ namespace gamecore
 
 	bool updateApplication(IGameApp& app);
 	void terminateApplication(IGameApp& app);
-	void runApplication(IGameApp& app, std::string name);
+	void runApplication(IGameApp& app, std::string name, int argc = 0, char** argv = nullptr);
 }
 
 #define CREATE_APPLICATION(app_class) \
-	int main()\
+	int main(int argc, char** argv)\
 	{\
 		app_class app;\
-		gamecore::runApplication(app, #app_class);\
+		gamecore::runApplication(app, #app_class, argc, argv);\
 		return 0;\
 	}
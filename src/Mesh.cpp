@@ -9,6 +9,7 @@
 #include <cstdio>
 #include <cassert>
 #include <vector>
+#include <map>
 
 #include <GL/glew.h>
 #include <glm/glm.hpp>
@@ -16,208 +17,154 @@
 #include <tools/gltools.hpp>
 #include "Mesh.h"
 
-
-void Mesh::destroy()
+namespace
 {
-    m_vertexBuffer.destroy();
+    // Meshes are only created and drawn on the GL thread
+    std::map<std::string, std::weak_ptr<VertexBuffer>> s_MeshCache;
 }
 
-/** PLANE MESH ----------------------------------------- */
-
-void PlaneMesh::create()
+void Mesh::destroy()
 {
-    /**
-     *  todo : use indexed tristrip instead
-     */
-
-    assert(!m_bInitialized);
-    m_bInitialized = true;
-
-    const float SIZE = m_size; //
-    const int RES = static_cast<int>(m_res); //  
-
-    m_count = 3 * 2 * (RES*RES);
-
-    std::vector<glm::vec3> &positions = m_vertexBuffer.getPosition();
-    std::vector<glm::vec3> &normals = m_vertexBuffer.getNormal();
-    std::vector<glm::vec2> &texCoords = m_vertexBuffer.getTexcoord();
-
-    positions.resize(m_count);
-    normals.resize(m_count, glm::vec3(0.0f, 1.0f, 0.0f));
-    texCoords.resize(m_count);
-
-    glm::vec3 *pPos = &(positions[0]);
-    glm::vec2 *pUV = &(texCoords[0]);
-
-	float UVScale = m_UVScale;
-
-    const float Delta = 1.0f / float(RES);
-
-    for(int j = 0; j < RES; ++j)
-    {
-        for(int i = 0; i < RES; ++i)
-        {
-            glm::vec4 vInd = Delta * glm::vec4(i, j, i + 1, j + 1);
-
-            *pUV = glm::vec2(vInd.x, vInd.y);
-            *pPos = SIZE * glm::vec3(pUV->x - 0.5f, 0.0f, pUV->y - 0.5f);
-			*pUV *= UVScale;
-            ++pPos; ++pUV;
-
-            *pUV = glm::vec2(vInd.x, vInd.w);
-            *pPos = SIZE * glm::vec3(pUV->x - 0.5f, 0.0f, pUV->y - 0.5f);
-			*pUV *= UVScale;
-            ++pPos; ++pUV;
-
-            *pUV = glm::vec2(vInd.z, vInd.y);
-            *pPos = SIZE * glm::vec3(pUV->x - 0.5f, 0.0f, pUV->y - 0.5f);
-			*pUV *= UVScale;
-            ++pPos; ++pUV;
-
-
-            *pUV = pUV[-1];
-            *pPos = pPos[-1];
-            ++pPos; ++pUV;
-
-            *pUV = pUV[-3];
-            *pPos = pPos[-3];
-            ++pPos; ++pUV;
-
-            *pUV = glm::vec2(vInd.z, vInd.w);
-            *pPos = SIZE * glm::vec3(pUV->x - 0.5f, 0.0f, pUV->y - 0.5f);
-			*pUV *= UVScale;
-            ++pPos; ++pUV;
-        }
-    }
-
-    for (auto& coord : texCoords)
-        coord.g = 1 - coord.g;
-
-    m_vertexBuffer.initialize();
-    m_vertexBuffer.complete(GL_STATIC_DRAW);
-    m_vertexBuffer.cleanData();
-
-    CHECKGLERROR();
+    m_vertexBuffer.reset();
+    m_bInitialized = false;
 }
 
-void PlaneMesh::draw() const
+void Mesh::draw() const
 {
     assert(m_bInitialized);
 
-    m_vertexBuffer.enable();
-    glDrawArrays(GL_TRIANGLES, 0, m_count);
-    m_vertexBuffer.disable();
+    m_vertexBuffer->draw(m_mode);
 
     CHECKGLERROR();
 }
 
+GLsizeiptr Mesh::getMemorySize() const
+{
+    return m_vertexBuffer ? m_vertexBuffer->getMemorySize() : 0;
+}
 
-
-/** SPHERE MESH ----------------------------------------- */
-
-void SphereMesh::create()
+void Mesh::createShared(const std::string& key, GLenum mode, const std::function<void(VertexBuffer&)>& generate)
 {
     assert(!m_bInitialized);
     m_bInitialized = true;
+    m_mode = mode;
 
+    auto& entry = s_MeshCache[m_bQuantize ? key + " quantized" : key];
+    m_vertexBuffer = entry.lock();
+    if (m_vertexBuffer)
+        return;
 
-    const float RADIUS = m_radius; //
-
-    m_count = 2 * m_meshResolution*(m_meshResolution + 2);
-
-    std::vector<glm::vec3> &positions = m_vertexBuffer.getPosition();
-    std::vector<glm::vec3> &normals = m_vertexBuffer.getNormal();
-    std::vector<glm::vec2> &texCoords = m_vertexBuffer.getTexcoord();
+    m_vertexBuffer = std::make_shared<VertexBuffer>();
+    generate(*m_vertexBuffer);
+    m_vertexBuffer->initialize();
+    m_vertexBuffer->complete(GL_STATIC_DRAW, m_bQuantize);
+    m_vertexBuffer->cleanData();
+    entry = m_vertexBuffer;
 
-    positions.resize(m_count);
-    normals.resize(m_count);
-    texCoords.resize(m_count);
-
-    glm::vec3 *pPos = &(positions[0]);
-    glm::vec3 *pNor = &(normals[0]);
-    glm::vec2 *pUV = &(texCoords[0]);
+    CHECKGLERROR();
+}
 
+/** PLANE MESH ----------------------------------------- */
 
-    float theta2, phi;    // next theta angle, phi angle
-    float ct, st;         // cos(theta), sin(theta)
-    float ct2, st2;       // cos(next theta), sin(next theta)
-    float cp, sp;         // cos(phi), sin(phi)
+void PlaneMesh::create()
+{
+    const float SIZE = m_size; //
+    const int RES = static_cast<int>(m_res); //  
+    const float UVScale = m_UVScale;
 
+    char key[64];
+    snprintf(key, sizeof(key), "Plane %g %d %g", SIZE, RES, UVScale);
+    createShared(key, GL_TRIANGLES, [=](VertexBuffer& vertexBuffer)
+    {
+        std::vector<glm::vec3> &positions = vertexBuffer.getPosition();
+        std::vector<glm::vec3> &normals = vertexBuffer.getNormal();
+        std::vector<glm::vec2> &texCoords = vertexBuffer.getTexcoord();
+        std::vector<uint32_t> &indices = vertexBuffer.getIndex();
 
-    const float TwoPI = 2.0f*(float)M_PI;
-    const float Delta = 1.0f / float(m_meshResolution);
+        // (RES+1)^2 shared corners instead of 6 vertices a quad
+        const int Stride = RES + 1;
+        const float Delta = 1.0f / float(RES);
 
-    ct2 = 0.0f; st2 = -1.0f;
+        positions.resize(Stride*Stride);
+        normals.resize(Stride*Stride, glm::vec3(0.0f, 1.0f, 0.0f));
+        texCoords.resize(Stride*Stride);
 
-    /* Create the sphere from bottom to top (like a spiral) as a tristrip */
-    for(int j = 0; j < m_meshResolution; ++j)
-    {
-        ct = ct2;
-        st = st2;
-
-        theta2 = ((j + 1) * Delta - 0.5f) * (float)M_PI;
-        ct2 = cos(theta2);
-        st2 = sin(theta2);
-
-        pNor->x = ct;
-        pNor->y = st;
-        pNor->z = 0.0f;
-        *pPos = RADIUS * (*pNor);
-        pUV->x = 0.0f;
-        pUV->y = j * Delta;
-        ++pPos; ++pNor; ++pUV;
-
-        for(int i = 0; i < m_meshResolution + 1; ++i)
+        for(int j = 0; j < Stride; ++j)
         {
-            phi = TwoPI * i * Delta;
-            cp = cos(phi);
-            sp = sin(phi);
-
-            pNor->x = ct2 * cp;
-            pNor->y = st2;
-            pNor->z = ct2 * sp;
-            *pPos = RADIUS * (*pNor);
-            pUV->x = i * Delta;
-            pUV->y = (j + 1) * Delta;
-            ++pPos; ++pNor; ++pUV;
+            for(int i = 0; i < Stride; ++i)
+            {
+                glm::vec2 uv = Delta * glm::vec2(i, j);
+                positions[j*Stride + i] = SIZE * glm::vec3(uv.x - 0.5f, 0.0f, uv.y - 0.5f);
+                texCoords[j*Stride + i] = UVScale * uv;
+                texCoords[j*Stride + i].g = 1 - texCoords[j*Stride + i].g;
+            }
+        }
 
-            pNor->x = ct * cp;
-            pNor->y = st;
-            pNor->z = ct * sp;
-            *pPos = RADIUS * (*pNor);
-            pUV->x = i * Delta;
-            pUV->y = j * Delta;
-            ++pPos; ++pNor; ++pUV;
+        indices.reserve(3 * 2 * (RES*RES));
+        for(int j = 0; j < RES; ++j)
+        {
+            for(int i = 0; i < RES; ++i)
+            {
+                uint32_t a = j*Stride + i, b = a + Stride, c = a + 1, d = b + 1;
+                indices.insert(indices.end(), { a, b, c, c, b, d });
+            }
         }
+    });
+}
 
-        pNor->x = ct2;
-        pNor->y = st2;
-        pNor->z = 0.0f;
-        *pPos = RADIUS * (*pNor);
-        pUV->x = 1.0f;
-        pUV->y = 1.0f;
-        ++pPos; ++pNor; ++pUV;
-    }
 
-    //-------------------------
+/** SPHERE MESH ----------------------------------------- */
 
+void SphereMesh::create()
+{
+    const float RADIUS = m_radius; //
+    const int RES = m_meshResolution;
 
-    m_vertexBuffer.initialize();
-    m_vertexBuffer.complete(GL_STATIC_DRAW);
-    m_vertexBuffer.cleanData();
+    char key[64];
+    snprintf(key, sizeof(key), "Sphere %d %g", RES, RADIUS);
+    createShared(key, GL_TRIANGLES, [=](VertexBuffer& vertexBuffer)
+    {
+        std::vector<glm::vec3> &positions = vertexBuffer.getPosition();
+        std::vector<glm::vec3> &normals = vertexBuffer.getNormal();
+        std::vector<glm::vec2> &texCoords = vertexBuffer.getTexcoord();
+        std::vector<uint32_t> &indices = vertexBuffer.getIndex();
 
-    CHECKGLERROR();
-}
+        const float TwoPI = 2.0f*(float)M_PI;
+        const float Delta = 1.0f / float(RES);
+        const int Stride = RES + 1;
 
-void SphereMesh::draw() const
-{
-    assert(m_bInitialized);
+        positions.resize(Stride*Stride);
+        normals.resize(Stride*Stride);
+        texCoords.resize(Stride*Stride);
 
-    m_vertexBuffer.enable();
-    glDrawArrays(GL_TRIANGLE_STRIP, 0, m_count);
-    m_vertexBuffer.disable();
+        /* Rings from bottom to top, the seam column is doubled for the texcoords */
+        for(int j = 0; j < Stride; ++j)
+        {
+            float theta = (j * Delta - 0.5f) * (float)M_PI;
+            float ct = cos(theta), st = sin(theta);
+
+            for(int i = 0; i < Stride; ++i)
+            {
+                float phi = TwoPI * i * Delta;
+                glm::vec3 normal(ct * cos(phi), st, ct * sin(phi));
+
+                normals[j*Stride + i] = normal;
+                positions[j*Stride + i] = RADIUS * normal;
+                texCoords[j*Stride + i] = glm::vec2(i * Delta, j * Delta);
+            }
+        }
 
-    CHECKGLERROR();
+        // Same winding as the former strip
+        indices.reserve(3 * 2 * (RES*RES));
+        for(int j = 0; j < RES; ++j)
+        {
+            for(int i = 0; i < RES; ++i)
+            {
+                uint32_t bottom = j*Stride + i, top = bottom + Stride;
+                indices.insert(indices.end(), { bottom, top, top + 1, bottom, top + 1, bottom + 1 });
+            }
+        }
+    });
 }
 
 
@@ -226,111 +173,90 @@ void SphereMesh::draw() const
 
 void ConeMesh::create()
 {
-    assert(!m_bInitialized);
-    m_bInitialized = true;
-
-    const float RADIUS = 1.0f; //
-    const float HEIGHT = 1.0f; //
-    const unsigned int RES = 24;
-
-    m_count = 2 * 3 * (RES);
-
-    std::vector<glm::vec3> &positions = m_vertexBuffer.getPosition();
-    std::vector<glm::vec3> &normals = m_vertexBuffer.getNormal();
-    std::vector<glm::vec2> &texCoords = m_vertexBuffer.getTexcoord();
-    // Note : not sure for the uv coords
-
-    positions.resize(m_count);
-    normals.resize(m_count);
-    texCoords.resize(m_count);
-
-    glm::vec3 *pPos = &(positions[0]);
-    glm::vec3 *pNor = &(normals[0]);
-    glm::vec2 *pUV = &(texCoords[0]);
-
-
-    std::vector<glm::vec3> baseVertex(RES);
-
-    float theta2;     // next theta angle
-    float ct, st;     // cos(theta), sin(theta)
-    float ct2, st2;   // cos(next theta), sin(next theta)  
-
-    const float TwoPI = 2.0f * (float)M_PI;
-    const float Delta = 1.0f / float(RES);
+    createShared("Cone", GL_TRIANGLES, [](VertexBuffer& vertexBuffer)
+    {
+        const float RADIUS = 1.0f; //
+        const float HEIGHT = 1.0f; //
+        const unsigned int RES = 24;
 
-    ct2 = -1.0f; st2 = 0.0f;
+        const GLsizei count = 2 * 3 * (RES);
 
-    size_t i;
+        std::vector<glm::vec3> &positions = vertexBuffer.getPosition();
+        std::vector<glm::vec3> &normals = vertexBuffer.getNormal();
+        std::vector<glm::vec2> &texCoords = vertexBuffer.getTexcoord();
+        // Note : not sure for the uv coords
 
-    // Structure
-    for(i = 0; i < RES; ++i)
-    {
-        ct = ct2;
-        st = st2;
+        positions.resize(count);
+        normals.resize(count);
+        texCoords.resize(count);
 
-        theta2 = ((i + 1) * Delta - 0.5f) * TwoPI;
-        ct2 = cos(theta2);
-        st2 = sin(theta2);
+        glm::vec3 *pPos = &(positions[0]);
+        glm::vec3 *pNor = &(normals[0]);
+        glm::vec2 *pUV = &(texCoords[0]);
 
-        *pUV = glm::vec2(i*Delta, 1.0f);
-        *pPos = glm::vec3(0.0f);
-        ++pPos; ++pUV;
 
-        *pUV = glm::vec2(i*Delta, 0.0f);
-        *pPos = glm::vec3(RADIUS*ct, RADIUS*st, -HEIGHT);
-        ++pPos; ++pUV;
+        std::vector<glm::vec3> baseVertex(RES);
 
-        *pUV = glm::vec2((i + 1)*Delta, 0.0f);
-        *pPos = glm::vec3(RADIUS*ct2, RADIUS*st2, -HEIGHT);
-        baseVertex[i] = *pPos;
-        ++pPos; ++pUV;
+        float theta2;     // next theta angle
+        float ct, st;     // cos(theta), sin(theta)
+        float ct2, st2;   // cos(next theta), sin(next theta)  
 
-        pNor[0] = pNor[1] = pNor[2] = glm::normalize(glm::cross(pPos[-2], pPos[-1]));
-        pNor += 3;
-    }
+        const float TwoPI = 2.0f * (float)M_PI;
+        const float Delta = 1.0f / float(RES);
 
-    // Adding the first one to loop
-    baseVertex.push_back(baseVertex[0]);
+        ct2 = -1.0f; st2 = 0.0f;
 
-    // Base
-    for(i = 0; i < baseVertex.size() - 1u; ++i)
-    {
-        *pNor = glm::vec3(0.0f, 0.0f, -1.0f);
-        *pUV = glm::vec2(0.5f, 0.0f); //
-        *pPos = glm::vec3(0.0f, 0.0f, -HEIGHT);
-        ++pPos; ++pNor; ++pUV;
+        size_t i;
 
-        *pNor = glm::vec3(0.0f, 0.0f, -1.0f);
-        *pUV = glm::vec2((i + 1)*Delta, 0.0f); //
-        *pPos = baseVertex[i + 1];
-        ++pPos; ++pNor; ++pUV;
+        // Structure
+        for(i = 0; i < RES; ++i)
+        {
+            ct = ct2;
+            st = st2;
 
-        *pNor = glm::vec3(0.0f, 0.0f, -1.0f);
-        *pUV = glm::vec2((i)*Delta, 0.0f); //
-        *pPos = baseVertex[i];
-        ++pPos; ++pNor; ++pUV;
-    }
+            theta2 = ((i + 1) * Delta - 0.5f) * TwoPI;
+            ct2 = cos(theta2);
+            st2 = sin(theta2);
 
+            *pUV = glm::vec2(i*Delta, 1.0f);
+            *pPos = glm::vec3(0.0f);
+            ++pPos; ++pUV;
 
-    //-------------------------
+            *pUV = glm::vec2(i*Delta, 0.0f);
+            *pPos = glm::vec3(RADIUS*ct, RADIUS*st, -HEIGHT);
+            ++pPos; ++pUV;
 
+            *pUV = glm::vec2((i + 1)*Delta, 0.0f);
+            *pPos = glm::vec3(RADIUS*ct2, RADIUS*st2, -HEIGHT);
+            baseVertex[i] = *pPos;
+            ++pPos; ++pUV;
 
-    m_vertexBuffer.initialize();
-    m_vertexBuffer.complete(GL_STATIC_DRAW);
-    m_vertexBuffer.cleanData();
+            pNor[0] = pNor[1] = pNor[2] = glm::normalize(glm::cross(pPos[-2], pPos[-1]));
+            pNor += 3;
+        }
 
-    CHECKGLERROR();
-}
+        // Adding the first one to loop
+        baseVertex.push_back(baseVertex[0]);
 
-void ConeMesh::draw() const
-{
-    assert(m_bInitialized);
+        // Base
+        for(i = 0; i < baseVertex.size() - 1u; ++i)
+        {
+            *pNor = glm::vec3(0.0f, 0.0f, -1.0f);
+            *pUV = glm::vec2(0.5f, 0.0f); //
+            *pPos = glm::vec3(0.0f, 0.0f, -HEIGHT);
+            ++pPos; ++pNor; ++pUV;
 
-    m_vertexBuffer.enable();
-    glDrawArrays(GL_TRIANGLES, 0, m_count);
-    m_vertexBuffer.disable();
+            *pNor = glm::vec3(0.0f, 0.0f, -1.0f);
+            *pUV = glm::vec2((i + 1)*Delta, 0.0f); //
+            *pPos = baseVertex[i + 1];
+            ++pPos; ++pNor; ++pUV;
 
-    CHECKGLERROR();
+            *pNor = glm::vec3(0.0f, 0.0f, -1.0f);
+            *pUV = glm::vec2((i)*Delta, 0.0f); //
+            *pPos = baseVertex[i];
+            ++pPos; ++pNor; ++pUV;
+        }
+    });
 }
 
 
@@ -339,152 +265,74 @@ void ConeMesh::draw() const
 
 void CubeMesh::create()
 {
-    /// not optimized at all, better with indices
-
-    assert(!m_bInitialized);
-    m_bInitialized = true;
-
     /**
      *  note : for cubemap, texcoord are object space position coords.
      */
 
-    m_count = 2u * 3u * 6u;
-
-    std::vector<glm::vec3> &positions = m_vertexBuffer.getPosition();
-    std::vector<glm::vec3> &normals = m_vertexBuffer.getNormal();
-    std::vector<glm::vec2> &coords = m_vertexBuffer.getTexcoord();
-
-    positions.resize(m_count);
-    normals.resize(m_count);
-    coords.resize(m_count);
-
-#define PX  0u
-#define NX  6u
-#define PY  12u
-#define NY  18u
-#define PZ  24u
-#define NZ  30u
-
-    glm::vec3 default_normals[] =
+    createShared("Cube", GL_TRIANGLES, [](VertexBuffer& vertexBuffer)
     {
-        glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f)
-    };
-
-    /// POSITIVE-X
-    positions[PX + 0u] = positions[PX + 5u] = glm::vec3(1.0f, -1.0f, 1.0f);
-    positions[PX + 1u] = glm::vec3(1.0f, -1.0f, -1.0f);
-    positions[PX + 2u] = positions[PX + 3u] = glm::vec3(1.0f, 1.0f, -1.0f);
-    positions[PX + 4u] = glm::vec3(1.0f, 1.0f, 1.0f);
-    normals[PX + 0u] = normals[PX + 1u] = normals[PX + 2u] =
-        normals[PX + 3u] = normals[PX + 4u] = normals[PX + 5u] = default_normals[0u];
-
-    /// NEGATIVE-X
-    positions[NX + 0u] = positions[NX + 5u] = glm::vec3(-1.0f, -1.0f, -1.0f);
-    positions[NX + 1u] = glm::vec3(-1.0f, -1.0f, 1.0f);
-    positions[NX + 2u] = positions[NX + 3u] = glm::vec3(-1.0f, 1.0f, 1.0f);
-    positions[NX + 4u] = glm::vec3(-1.0f, 1.0f, -1.0f);
-    normals[NX + 0u] = normals[NX + 1u] = normals[NX + 2u] =
-        normals[NX + 3u] = normals[NX + 4u] = normals[NX + 5u] = -default_normals[0u];
-
-    /// POSITIVE-Y
-    positions[PY + 0u] = positions[PY + 5u] = glm::vec3(-1.0f, 1.0f, 1.0f);
-    positions[PY + 1u] = glm::vec3(1.0f, 1.0f, 1.0f);
-    positions[PY + 2u] = positions[PY + 3u] = glm::vec3(1.0f, 1.0f, -1.0f);
-    positions[PY + 4u] = glm::vec3(-1.0f, 1.0f, -1.0f);
-    normals[PY + 0u] = normals[PY + 1u] = normals[PY + 2u] =
-        normals[PY + 3u] = normals[PY + 4u] = normals[PY + 5u] = default_normals[1u];
-
-    /// NEGATIVE-Y
-    positions[NY + 0u] = positions[NY + 5u] = glm::vec3(-1.0f, -1.0f, -1.0f);
-    positions[NY + 1u] = glm::vec3(1.0f, -1.0f, -1.0f);
-    positions[NY + 2u] = positions[NY + 3u] = glm::vec3(1.0f, -1.0f, 1.0f);
-    positions[NY + 4u] = glm::vec3(-1.0f, -1.0f, 1.0f);
-    normals[NY + 0u] = normals[NY + 1u] = normals[NY + 2u] =
-        normals[NY + 3u] = normals[NY + 4u] = normals[NY + 5u] = -default_normals[1u];
-
-    /// POSITIVE-Z
-    positions[PZ + 0u] = positions[PZ + 5u] = glm::vec3(-1.0f, -1.0f, 1.0f);
-    positions[PZ + 1u] = glm::vec3(1.0f, -1.0f, 1.0f);
-    positions[PZ + 2u] = positions[PZ + 3u] = glm::vec3(1.0f, 1.0f, 1.0f);
-    positions[PZ + 4u] = glm::vec3(-1.0f, 1.0f, 1.0f);
-    normals[PZ + 0u] = normals[PZ + 1u] = normals[PZ + 2u] =
-        normals[PZ + 3u] = normals[PZ + 4u] = normals[PZ + 5u] = default_normals[2u];
-
-    /// NEGATIVE-Z
-    positions[NZ + 0u] = positions[NZ + 5u] = glm::vec3(1.0f, -1.0f, -1.0f);
-    positions[NZ + 1u] = glm::vec3(-1.0f, -1.0f, -1.0f);
-    positions[NZ + 2u] = positions[NZ + 3u] = glm::vec3(-1.0f, 1.0f, -1.0f);
-    positions[NZ + 4u] = glm::vec3(1.0f, 1.0f, -1.0f);
-    normals[NZ + 0u] = normals[NZ + 1u] = normals[NZ + 2u] =
-        normals[NZ + 3u] = normals[NZ + 4u] = normals[NZ + 5u] = -default_normals[2u];
-
-    coords[PX + 0u] = coords[NX + 0u] = coords[PY + 0u] = coords[NY + 0u] = coords[PZ + 0u] = coords[NZ + 0u] = glm::vec2(1.0f, 0.f);
-    coords[PX + 1u] = coords[NX + 1u] = coords[PY + 1u] = coords[NY + 1u] = coords[PZ + 1u] = coords[NZ + 1u] = glm::vec2(0.0f, 0.f);
-    coords[PX + 2u] = coords[NX + 2u] = coords[PY + 2u] = coords[NY + 2u] = coords[PZ + 2u] = coords[NZ + 2u] = glm::vec2(0.0f, 1.f);
-    coords[PX + 3u] = coords[NX + 3u] = coords[PY + 3u] = coords[NY + 3u] = coords[PZ + 3u] = coords[NZ + 3u] = glm::vec2(0.0f, 1.f);
-    coords[PX + 4u] = coords[NX + 4u] = coords[PY + 4u] = coords[NY + 4u] = coords[PZ + 4u] = coords[NZ + 4u] = glm::vec2(1.0f, 1.f);
-    coords[PX + 5u] = coords[NX + 5u] = coords[PY + 5u] = coords[NY + 5u] = coords[PZ + 5u] = coords[NZ + 5u] = glm::vec2(1.0f, 0.f);
-
-    //-------------------------
-
-    m_vertexBuffer.initialize();
-    m_vertexBuffer.complete(GL_STATIC_DRAW);
-    m_vertexBuffer.cleanData();
-
-    CHECKGLERROR();
-}
-
-void CubeMesh::draw() const
-{
-    assert(m_bInitialized);
+        std::vector<glm::vec3> &positions = vertexBuffer.getPosition();
+        std::vector<glm::vec3> &normals = vertexBuffer.getNormal();
+        std::vector<glm::vec2> &coords = vertexBuffer.getTexcoord();
+        std::vector<uint32_t> &indices = vertexBuffer.getIndex();
 
-    m_vertexBuffer.enable();
-    glDrawArrays(GL_TRIANGLES, 0, m_count);
-    m_vertexBuffer.disable();
+        // +x, -x, +y, -y, +z, -z; four corners each
+        const glm::vec3 corners[6][4] =
+        {
+            { glm::vec3(1.0f, -1.0f, 1.0f), glm::vec3(1.0f, -1.0f, -1.0f), glm::vec3(1.0f, 1.0f, -1.0f), glm::vec3(1.0f, 1.0f, 1.0f) },
+            { glm::vec3(-1.0f, -1.0f, -1.0f), glm::vec3(-1.0f, -1.0f, 1.0f), glm::vec3(-1.0f, 1.0f, 1.0f), glm::vec3(-1.0f, 1.0f, -1.0f) },
+            { glm::vec3(-1.0f, 1.0f, 1.0f), glm::vec3(1.0f, 1.0f, 1.0f), glm::vec3(1.0f, 1.0f, -1.0f), glm::vec3(-1.0f, 1.0f, -1.0f) },
+            { glm::vec3(-1.0f, -1.0f, -1.0f), glm::vec3(1.0f, -1.0f, -1.0f), glm::vec3(1.0f, -1.0f, 1.0f), glm::vec3(-1.0f, -1.0f, 1.0f) },
+            { glm::vec3(-1.0f, -1.0f, 1.0f), glm::vec3(1.0f, -1.0f, 1.0f), glm::vec3(1.0f, 1.0f, 1.0f), glm::vec3(-1.0f, 1.0f, 1.0f) },
+            { glm::vec3(1.0f, -1.0f, -1.0f), glm::vec3(-1.0f, -1.0f, -1.0f), glm::vec3(-1.0f, 1.0f, -1.0f), glm::vec3(1.0f, 1.0f, -1.0f) },
+        };
+        const glm::vec3 faceNormals[6] =
+        {
+            glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f),
+            glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+            glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f),
+        };
+        const glm::vec2 faceCoords[4] =
+        {
+            glm::vec2(1.0f, 0.f), glm::vec2(0.0f, 0.f), glm::vec2(0.0f, 1.f), glm::vec2(1.0f, 1.f)
+        };
 
-    CHECKGLERROR();
+        for (uint32_t face = 0; face < 6; face++)
+        {
+            uint32_t base = (uint32_t)positions.size();
+            for (uint32_t corner = 0; corner < 4; corner++)
+            {
+                positions.push_back(corners[face][corner]);
+                normals.push_back(faceNormals[face]);
+                coords.push_back(faceCoords[corner]);
+            }
+            indices.insert(indices.end(), { base, base + 1, base + 2, base + 2, base + 3, base });
+        }
+    });
 }
 
 /** FULL SCREEN TRIANGLE MESH -------------------------- */
 
 void FullscreenTriangleMesh::create()
 {
-    assert(!m_bInitialized);
-    m_bInitialized = true;
-
-    m_count = 3;
-
-    std::vector<glm::vec3> &positions = m_vertexBuffer.getPosition();
-    std::vector<glm::vec3> &normals = m_vertexBuffer.getNormal();
-    std::vector<glm::vec2> &texCoords = m_vertexBuffer.getTexcoord();
-
-    positions.resize(m_count);
-    normals.resize(m_count, glm::vec3(0.0f, 0.0f, -1.0f));
-    texCoords.resize(m_count);
-
-    positions[0] = glm::vec3(-1, -1, 0);
-    positions[1] = glm::vec3(3, -1, 0);
-    positions[2] = glm::vec3(-1, 3, 0);
-
-    texCoords[0] = glm::vec2(0, 0);
-    texCoords[1] = glm::vec2(2, 0);
-    texCoords[2] = glm::vec2(0, 2);
-
-    m_vertexBuffer.initialize();
-    m_vertexBuffer.complete(GL_STATIC_DRAW);
-    m_vertexBuffer.cleanData();
-
-    CHECKGLERROR();
-}
+    createShared("FullscreenTriangle", GL_TRIANGLES, [](VertexBuffer& vertexBuffer)
+    {
+        const GLsizei count = 3;
 
+        std::vector<glm::vec3> &positions = vertexBuffer.getPosition();
+        std::vector<glm::vec3> &normals = vertexBuffer.getNormal();
+        std::vector<glm::vec2> &texCoords = vertexBuffer.getTexcoord();
 
-void FullscreenTriangleMesh::draw() const
-{
-    assert(m_bInitialized);
+        positions.resize(count);
+        normals.resize(count, glm::vec3(0.0f, 0.0f, -1.0f));
+        texCoords.resize(count);
 
-    m_vertexBuffer.enable();
-    glDrawArrays(GL_TRIANGLES, 0, m_count);
-    m_vertexBuffer.disable();
+        positions[0] = glm::vec3(-1, -1, 0);
+        positions[1] = glm::vec3(3, -1, 0);
+        positions[2] = glm::vec3(-1, 3, 0);
 
-    CHECKGLERROR();
+        texCoords[0] = glm::vec2(0, 0);
+        texCoords[1] = glm::vec2(2, 0);
+        texCoords[2] = glm::vec2(0, 2);
+    });
 }
@@ -17,6 +17,9 @@
 
 #include <GL/glew.h>
 #include <glm/glm.hpp>
+#include <string>
+#include <memory>
+#include <functional>
 
 #include <GLType/VertexBuffer.h>
 
@@ -36,9 +39,11 @@ class Mesh
 {
 protected:
 	bool m_bInitialized;    
+	bool m_bQuantize;
 
-	VertexBuffer m_vertexBuffer;
-	GLsizei m_count;
+	// Shared by every mesh created with the same key
+	std::shared_ptr<VertexBuffer> m_vertexBuffer;
+	GLenum m_mode;
 
 	/* TODO Move in another object */
 	glm::mat4 m_model;
@@ -49,20 +54,30 @@ protected:
 
 public:
 	Mesh()
-		: m_bInitialized(false), m_model(1.f), m_normal(1.f)
+		: m_bInitialized(false), m_bQuantize(false), m_mode(GL_TRIANGLES), m_model(1.f), m_normal(1.f)
 	{}
 
 	virtual ~Mesh() { destroy(); }
 
 	virtual void create() {}
-	virtual void draw() const {}
+	virtual void draw() const;
 	virtual void destroy();
 
+	/** 16 bits attributes, to be set before 'create' */
+	void setQuantized(bool bQuantize)    {m_bQuantize = bQuantize;}
+
+	/** Bytes of the shared vertex and index data */
+	GLsizeiptr getMemorySize() const;
+
 	void setModelMatrix(const glm::mat4 &model)     {m_model = model;}
 	void setNormalMatrix(const glm::mat3 &normal)   {m_normal = normal;}
 
 	const glm::mat4& getModelMatrix() const   {return m_model;}
 	const glm::mat3& getNormalMatrix() const  {return m_normal;}
+
+protected:
+	// Generates and uploads the data once per distinct key and quantization
+	void createShared(const std::string& key, GLenum mode, const std::function<void(VertexBuffer&)>& generate);
 };
 
 
@@ -85,7 +100,6 @@ public:
 	}
 
 	void create() override;
-	void draw() const override;
 };
 
 
@@ -105,7 +119,6 @@ public:
 	{}
 
 	void create() override;
-	void draw() const override;
 };
 
 
@@ -119,7 +132,6 @@ public:
 	{}
 
 	void create() override;
-	void draw() const override;
 };
 
 
@@ -133,7 +145,6 @@ public:
 	{}
 
 	void create() override;
-	void draw() const override;
 };
 
 /** FULL SCREEN TRIANGLE MESH -------------------------- */
@@ -146,7 +157,6 @@ public:
 	{}
 
 	void create() override;
-	void draw() const override;
 };
 
 #endif //MESH_HPP
@@ -0,0 +1,457 @@
+#include "Offline.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cassert>
+#include <cstring>
+#include <limits>
+#include <algorithm>
+#include <glm/gtc/packing.hpp>
+#include <glm/gtc/constants.hpp>
+#include <HosekSky/ArHosekSkyModel.h>
+#include <prefilter/stb_image_write.h>
+#include <tools/stb_image.h>
+#include <tools/string.h>
+#include <tools/JobSystem.h>
+#include <Atmosphere.h>
+#include <PostProcessKernels.h>
+
+namespace offline
+{
+    // Rows per task
+    const uint32_t TileSize = 16;
+    const uint32_t DownsampleGroupSize = 16;
+
+    // Scale factor used for storing physical light units in fp16 floats (equal to 2^-10).
+    const float FP16Scale = 0.0009765625f;
+
+    // Intermediate targets are fp16 on the GPU
+    float toHalf(float v) noexcept;
+    glm::vec3 toHalf(const glm::vec3& v) noexcept;
+
+    struct Plane
+    {
+        uint32_t width, height;
+        std::vector<glm::vec3> texels;
+    };
+
+    glm::vec3 fetch(const Plane& plane, int32_t x, int32_t y) noexcept;
+    glm::vec3 sampleBilinear(const Plane& plane, float u, float v) noexcept;
+    void blur(const Plane& source, Plane& target, const glm::ivec2& direction, float sigma) noexcept;
+    float reduceLuma(std::vector<float> luma, uint32_t width, uint32_t height) noexcept;
+    float log2Exposure(const Settings& settings, float avgLuminance) noexcept;
+    void flipRows(const Image& image, std::vector<glm::vec4>& rows) noexcept;
+}
+
+float offline::toHalf(float v) noexcept
+{
+    return glm::unpackHalf1x16(glm::packHalf1x16(v));
+}
+
+glm::vec3 offline::toHalf(const glm::vec3& v) noexcept
+{
+    return glm::vec3(toHalf(v.x), toHalf(v.y), toHalf(v.z));
+}
+
+glm::vec3 offline::fetch(const Plane& plane, int32_t x, int32_t y) noexcept
+{
+    // GL_CLAMP_TO_EDGE
+    x = glm::clamp(x, 0, int32_t(plane.width) - 1);
+    y = glm::clamp(y, 0, int32_t(plane.height) - 1);
+    return plane.texels[y * plane.width + x];
+}
+
+glm::vec3 offline::sampleBilinear(const Plane& plane, float u, float v) noexcept
+{
+    float x = u * plane.width - 0.5f;
+    float y = v * plane.height - 0.5f;
+    int32_t x0 = (int32_t)std::floor(x);
+    int32_t y0 = (int32_t)std::floor(y);
+    float tx = x - x0, ty = y - y0;
+
+    glm::vec3 c0 = glm::mix(fetch(plane, x0, y0), fetch(plane, x0 + 1, y0), tx);
+    glm::vec3 c1 = glm::mix(fetch(plane, x0, y0 + 1), fetch(plane, x0 + 1, y0 + 1), tx);
+    return glm::mix(c0, c1, ty);
+}
+
+// Same taps and weights as 'Blur.glsli'
+void offline::blur(const Plane& source, Plane& target, const glm::ivec2& direction, float sigma) noexcept
+{
+    float weights[14];
+    for (int32_t i = -7; i < 7; i++)
+    {
+        float g = 1.f / std::sqrt(2.f * 3.14159f * sigma * sigma);
+        weights[i + 7] = g * std::exp(-float(i * i) / (2.f * sigma * sigma));
+    }
+
+    target.width = source.width;
+    target.height = source.height;
+    target.texels.resize(source.texels.size());
+
+    JobSystem::instance().parallel_for(source.height, TileSize, [&](uint32_t begin, uint32_t end)
+    {
+        for (uint32_t y = begin; y < end; y++)
+        for (uint32_t x = 0; x < source.width; x++)
+        {
+            glm::vec3 color(0.f);
+            for (int32_t i = -7; i < 7; i++)
+                color += fetch(source, x + i * direction.x, y + i * direction.y) * weights[i + 7];
+            target.texels[y * target.width + x] = toHalf(color);
+        }
+    });
+}
+
+// 'DownsamplingLuma.Compute' down to the last level, which the blit reads at texel (0, 0)
+float offline::reduceLuma(std::vector<float> luma, uint32_t width, uint32_t height) noexcept
+{
+    const uint32_t NumThreads = DownsampleGroupSize * DownsampleGroupSize;
+
+    while (width > 1 && height > 1)
+    {
+        uint32_t w = (width + DownsampleGroupSize - 1) / DownsampleGroupSize;
+        uint32_t h = (height + DownsampleGroupSize - 1) / DownsampleGroupSize;
+
+        std::vector<float> reduced(w * h);
+        for (uint32_t gy = 0; gy < h; gy++)
+        for (uint32_t gx = 0; gx < w; gx++)
+        {
+            // Out of bounds threads contribute zero, the total is still divided by the group size
+            float total = 0.f;
+            for (uint32_t y = gy * DownsampleGroupSize; y < std::min(height, (gy + 1) * DownsampleGroupSize); y++)
+            for (uint32_t x = gx * DownsampleGroupSize; x < std::min(width, (gx + 1) * DownsampleGroupSize); x++)
+                total += luma[y * width + x];
+            reduced[gy * w + gx] = toHalf(total / NumThreads);
+        }
+
+        luma.swap(reduced);
+        width = w;
+        height = h;
+    }
+    return luma.front();
+}
+
+float offline::log2Exposure(const Settings& settings, float avgLuminance) noexcept
+{
+    const int ExposureModes_ManualSimple = 0;
+    const int ExposureModes_Automatic = 3;
+
+    float exposure = 0.f;
+    if (settings.exposureMode == ExposureModes_ManualSimple)
+    {
+        exposure = settings.exposure;
+        exposure -= std::log2(FP16Scale);
+    }
+    else if (settings.exposureMode == ExposureModes_Automatic)
+    {
+        avgLuminance = std::max(avgLuminance, 0.00001f);
+        float linearExposure = settings.keyValue / avgLuminance;
+        exposure = std::log2(std::max(linearExposure, 0.00001f));
+    }
+    return exposure;
+}
+
+void offline::render(const Image& source, const Settings& settings, Image& output) noexcept
+{
+    assert(source.pixels.size() == source.width * source.height);
+
+    const uint32_t width = source.width, height = source.height;
+
+    // Scene color target is RGBA16F
+    std::vector<glm::vec4> scene(source.pixels.size());
+    for (std::size_t i = 0; i < scene.size(); i++)
+        scene[i] = glm::vec4(toHalf(glm::vec3(source.pixels[i])), 1.f);
+
+    postprocess::PrefilterOutput prefiltered;
+    postprocess::prefilter(scene, width, height, prefiltered);
+
+    for (auto& luma : prefiltered.luma)
+        luma = toHalf(luma);
+    float avgLuminance = reduceLuma(prefiltered.luma, prefiltered.lumaWidth, prefiltered.lumaHeight);
+
+    Plane bloom, temp;
+    bloom.width = prefiltered.bloomWidth;
+    bloom.height = prefiltered.bloomHeight;
+    bloom.texels.resize(prefiltered.bloom.size());
+    for (std::size_t i = 0; i < bloom.texels.size(); i++)
+        bloom.texels[i] = toHalf(prefiltered.bloom[i]);
+
+    for (int i = 0; i < settings.numBlurTimes; i++)
+    {
+        blur(bloom, temp, glm::ivec2(0, 1), settings.blurSigma);
+        blur(temp, bloom, glm::ivec2(1, 0), settings.blurSigma);
+    }
+
+    auto lut = tonemap::bake(settings.toneMapOperator, settings.lutType, settings.lutSize);
+    float exposure = std::exp2(log2Exposure(settings, avgLuminance));
+
+    output.width = width;
+    output.height = height;
+    output.pixels.resize(scene.size());
+
+    JobSystem::instance().parallel_for(height, TileSize, [&](uint32_t begin, uint32_t end)
+    {
+        for (uint32_t y = begin; y < end; y++)
+        for (uint32_t x = 0; x < width; x++)
+        {
+            float u = (x + 0.5f) / width, v = (y + 0.5f) / height;
+            glm::vec3 color = glm::vec3(scene[y * width + x]) + sampleBilinear(bloom, u, v);
+            color = tonemap::sample(lut, settings.toneMapOperator, color * exposure);
+            output.pixels[y * width + x] = glm::vec4(color, 1.f);
+        }
+    });
+}
+
+void offline::renderHosekSky(Image& image, const glm::vec3& sunDirection, float turbidity, const glm::vec3& groundAlbedo) noexcept
+{
+    // Same view as 'Atmosphere::renderSkyDome'
+    const float aspect = (float)image.width / image.height;
+    const float angle = glm::tan(glm::radians(45.f / 2));
+
+    glm::vec3 sunDir = sunDirection;
+    sunDir.y = glm::clamp(sunDir.y, 0.f, 1.f);
+    sunDir = glm::normalize(sunDir);
+
+    turbidity = glm::clamp(turbidity, 1.f, 10.f);
+    float elevation = glm::half_pi<float>() - std::acos(sunDir.y);
+
+    ArHosekSkyModelState* states[3];
+    for (int i = 0; i < 3; i++)
+        states[i] = arhosek_rgb_skymodelstate_alloc_init(turbidity, groundAlbedo[i], elevation);
+
+    image.pixels.resize(image.width * image.height);
+    JobSystem::instance().parallel_for(image.height, TileSize, [&](uint32_t begin, uint32_t end)
+    {
+        for (uint32_t y = begin; y < end; y++)
+        for (uint32_t x = 0; x < image.width; x++)
+        {
+            float rayx = (2 * x / float(image.width) - 1) * aspect * angle;
+            float rayy = (2 * y / float(image.height) - 1) * angle;
+            glm::vec3 dir = glm::normalize(glm::vec3(rayx, rayy, -1));
+
+            glm::vec3 radiance(0.f);
+            if (dir.y > 0.f)
+            {
+                float gamma = std::acos(std::max(glm::dot(dir, sunDir), 0.00001f));
+                float theta = std::acos(std::max(dir.y, 0.00001f));
+                for (int i = 0; i < 3; i++)
+                    radiance[i] = (float)arhosek_tristim_skymodel_radiance(states[i], theta, gamma, i);
+            }
+
+            // Photometric units, fp16 scaled as in 'Skybox::SampleSky'
+            image.pixels[y * image.width + x] = glm::vec4(radiance * 683.f * FP16Scale, 1.f);
+        }
+    });
+
+    for (int i = 0; i < 3; i++)
+        arhosekskymodelstate_free(states[i]);
+}
+
+void offline::renderAtmosphere(Image& image, const glm::vec3& sunDir) noexcept
+{
+    Atmosphere atmosphere(sunDir);
+    image.pixels.assign(image.width * image.height, glm::vec4(0.f));
+    atmosphere.renderSkyDome(image.pixels, image.width, image.height);
+}
+
+bool offline::loadImage(const std::string& filename, Image& image) noexcept
+{
+    // LDR files are display values, keep them as is
+    stbi_set_flip_vertically_on_load(true);
+    stbi_ldr_to_hdr_gamma(1.f);
+    stbi_ldr_to_hdr_scale(1.f);
+
+    int width = 0, height = 0, components = 0;
+    float* data = stbi_loadf(filename.c_str(), &width, &height, &components, 4);
+    if (data == nullptr)
+    {
+        fprintf(stderr, "Failed to load '%s': %s\n", filename.c_str(), stbi_failure_reason());
+        return false;
+    }
+
+    image.width = width;
+    image.height = height;
+    image.pixels.resize(width * height);
+    for (int i = 0; i < width * height; i++)
+        image.pixels[i] = glm::vec4(data[4*i + 0], data[4*i + 1], data[4*i + 2], data[4*i + 3]);
+    stbi_image_free(data);
+    return true;
+}
+
+void offline::flipRows(const Image& image, std::vector<glm::vec4>& rows) noexcept
+{
+    rows.resize(image.pixels.size());
+    for (uint32_t y = 0; y < image.height; y++)
+    {
+        auto src = image.pixels.begin() + (image.height - 1 - y) * image.width;
+        std::copy(src, src + image.width, rows.begin() + y * image.width);
+    }
+}
+
+bool offline::writeImage(const std::string& filename, const Image& image) noexcept
+{
+    const std::string ext = util::getFileExtension(filename);
+    if (util::stricmp(ext, "png"))
+        return writePNG(filename, image);
+    if (util::stricmp(ext, "hdr"))
+        return writeHDR(filename, image);
+    if (util::stricmp(ext, "exr"))
+        return writeEXR(filename, image);
+
+    fprintf(stderr, "Unsupported image format '%s'\n", filename.c_str());
+    return false;
+}
+
+bool offline::writePNG(const std::string& filename, const Image& image) noexcept
+{
+    std::vector<glm::vec4> rows;
+    flipRows(image, rows);
+
+    std::vector<uint8_t> data(rows.size() * 3);
+    for (std::size_t i = 0; i < rows.size(); i++)
+    {
+        glm::vec3 c = glm::clamp(glm::vec3(rows[i]), 0.f, 1.f);
+        data[3*i + 0] = (uint8_t)std::lround(c.r * 255.f);
+        data[3*i + 1] = (uint8_t)std::lround(c.g * 255.f);
+        data[3*i + 2] = (uint8_t)std::lround(c.b * 255.f);
+    }
+    return stbi_write_png(filename.c_str(), image.width, image.height, 3, data.data(), image.width * 3) != 0;
+}
+
+bool offline::writeHDR(const std::string& filename, const Image& image) noexcept
+{
+    std::vector<glm::vec4> rows;
+    flipRows(image, rows);
+
+    std::vector<float> data(rows.size() * 3);
+    for (std::size_t i = 0; i < rows.size(); i++)
+    {
+        data[3*i + 0] = rows[i].r;
+        data[3*i + 1] = rows[i].g;
+        data[3*i + 2] = rows[i].b;
+    }
+    return stbi_write_hdr(filename.c_str(), image.width, image.height, 3, data.data()) != 0;
+}
+
+// Minimal single part scanline OpenEXR: uncompressed half RGB
+bool offline::writeEXR(const std::string& filename, const Image& image) noexcept
+{
+    FILE* fp = fopen(filename.c_str(), "wb");
+    if (fp == nullptr)
+    {
+        fprintf(stderr, "Failed to open '%s'\n", filename.c_str());
+        return false;
+    }
+
+    std::vector<uint8_t> header;
+    auto putBytes = [&](const void* data, std::size_t size) {
+        header.insert(header.end(), (const uint8_t*)data, (const uint8_t*)data + size);
+    };
+    auto putString = [&](const char* str) { putBytes(str, strlen(str) + 1); };
+    auto putInt = [&](int32_t v) { putBytes(&v, sizeof(v)); };
+    auto putFloat = [&](float v) { putBytes(&v, sizeof(v)); };
+    auto putAttribute = [&](const char* name, const char* type, int32_t size) {
+        putString(name);
+        putString(type);
+        putInt(size);
+    };
+
+    const uint8_t magic[] = { 0x76, 0x2f, 0x31, 0x01 };
+    putBytes(magic, sizeof(magic));
+    putInt(2);
+
+    // Channels are stored in alphabetical order
+    const char* channels[] = { "B", "G", "R" };
+    putAttribute("channels", "chlist", 3 * (2 + 16) + 1);
+    for (auto channel : channels)
+    {
+        putString(channel);
+        putInt(1); // HALF
+        putInt(0); // pLinear and reserved
+        putInt(1); // xSampling
+        putInt(1); // ySampling
+    }
+    header.push_back(0);
+
+    putAttribute("compression", "compression", 1);
+    header.push_back(0); // NO_COMPRESSION
+
+    const int32_t window[] = { 0, 0, int32_t(image.width) - 1, int32_t(image.height) - 1 };
+    putAttribute("dataWindow", "box2i", sizeof(window));
+    putBytes(window, sizeof(window));
+    putAttribute("displayWindow", "box2i", sizeof(window));
+    putBytes(window, sizeof(window));
+
+    putAttribute("lineOrder", "lineOrder", 1);
+    header.push_back(0); // INCREASING_Y
+
+    putAttribute("pixelAspectRatio", "float", 4);
+    putFloat(1.f);
+    putAttribute("screenWindowCenter", "v2f", 8);
+    putFloat(0.f);
+    putFloat(0.f);
+    putAttribute("screenWindowWidth", "float", 4);
+    putFloat(1.f);
+    header.push_back(0);
+
+    const uint32_t lineSize = image.width * 3 * sizeof(uint16_t);
+    const uint64_t tableOffset = header.size();
+    const uint64_t dataOffset = tableOffset + image.height * sizeof(uint64_t);
+
+    std::vector<uint64_t> offsets(image.height);
+    for (uint32_t y = 0; y < image.height; y++)
+        offsets[y] = dataOffset + y * (8 + lineSize);
+
+    bool bSuccess = fwrite(header.data(), 1, header.size(), fp) == header.size();
+    bSuccess &= fwrite(offsets.data(), sizeof(uint64_t), offsets.size(), fp) == offsets.size();
+
+    std::vector<uint16_t> line(image.width * 3);
+    for (uint32_t y = 0; bSuccess && y < image.height; y++)
+    {
+        // EXR is stored top row first
+        auto row = image.pixels.data() + (image.height - 1 - y) * image.width;
+        for (uint32_t x = 0; x < image.width; x++)
+        {
+            line[0 * image.width + x] = glm::packHalf1x16(row[x].b);
+            line[1 * image.width + x] = glm::packHalf1x16(row[x].g);
+            line[2 * image.width + x] = glm::packHalf1x16(row[x].r);
+        }
+
+        int32_t chunk[] = { int32_t(y), int32_t(lineSize) };
+        bSuccess &= fwrite(chunk, sizeof(chunk), 1, fp) == 1;
+        bSuccess &= fwrite(line.data(), 1, lineSize, fp) == lineSize;
+    }
+
+    fclose(fp);
+    if (!bSuccess)
+        fprintf(stderr, "Failed to write '%s'\n", filename.c_str());
+    return bSuccess;
+}
+
+offline::CompareResult offline::compare(const Image& a, const Image& b, float tolerance) noexcept
+{
+    CompareResult result;
+    result.maxError = 0.f;
+    result.avgError = 0.f;
+    result.numMismatches = 0;
+
+    if (a.width != b.width || a.height != b.height)
+    {
+        result.maxError = std::numeric_limits<float>::infinity();
+        result.numMismatches = std::max(a.width * a.height, b.width * b.height);
+        return result;
+    }
+
+    double sum = 0.0;
+    for (std::size_t i = 0; i < a.pixels.size(); i++)
+    {
+        glm::vec3 diff = glm::abs(glm::vec3(a.pixels[i]) - glm::vec3(b.pixels[i]));
+        float error = glm::max(diff.x, glm::max(diff.y, diff.z));
+        result.maxError = std::max(result.maxError, error);
+        if (error > tolerance)
+            result.numMismatches++;
+        sum += error;
+    }
+    if (!a.pixels.empty())
+        result.avgError = float(sum / a.pixels.size());
+    return result;
+}
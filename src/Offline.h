@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include <ToneMapping.h>
+
+// CPU implementation of the 'postprocess' chain, for machines without a GL context.
+// Images are stored bottom row first, as read back from GL.
+namespace offline
+{
+    struct Image
+    {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        std::vector<glm::vec4> pixels;
+    };
+
+    // Mirrors the state 'postprocess::update' and 'postprocess::setToneMapping' send to the blit
+    struct Settings
+    {
+        int exposureMode = 3;
+        float exposure = -16.f;
+        float keyValue = 0.005f;
+        int numBlurTimes = 2;
+        float blurSigma = 2.5f;
+        tonemap::ToneMapOperator toneMapOperator = tonemap::ToneMapOperatorACES;
+        tonemap::LutType lutType = tonemap::LutType1D;
+        uint32_t lutSize = 256;
+    };
+
+    struct CompareResult
+    {
+        float maxError;
+        float avgError;
+        uint32_t numMismatches;
+    };
+
+    // Scene color in, display referred sRGB out
+    void render(const Image& source, const Settings& settings, Image& output) noexcept;
+
+    void renderHosekSky(Image& image, const glm::vec3& sunDir, float turbidity, const glm::vec3& groundAlbedo) noexcept;
+    void renderAtmosphere(Image& image, const glm::vec3& sunDir) noexcept;
+
+    bool loadImage(const std::string& filename, Image& image) noexcept;
+
+    // Format from the extension: PNG, HDR or EXR
+    bool writeImage(const std::string& filename, const Image& image) noexcept;
+    bool writePNG(const std::string& filename, const Image& image) noexcept;
+    bool writeHDR(const std::string& filename, const Image& image) noexcept;
+    bool writeEXR(const std::string& filename, const Image& image) noexcept;
+
+    // Per channel difference, a pixel mismatches when any channel is above 'tolerance'
+    CompareResult compare(const Image& a, const Image& b, float tolerance) noexcept;
+}
@@ -0,0 +1,142 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <glm/glm.hpp>
+#include <Offline.h>
+
+// Batch tone mapping without a window or GL context:
+//
+//   ArHosekSky.offline --hosek --sun-angle=76 sky.png
+//   ArHosekSky.offline --input=render.hdr --operator=hable --raw=render.exr out.png
+//   ArHosekSky.offline --input=render.hdr --reference=gl.png --tolerance=2 out.png
+
+namespace
+{
+    bool parseOption(const char* arg, const char* name, std::string& value)
+    {
+        auto length = strlen(name);
+        if (strncmp(arg, name, length) != 0 || arg[length] != '=')
+            return false;
+        value = arg + length + 1;
+        return true;
+    }
+
+    void printUsage()
+    {
+        printf("usage: ArHosekSky.offline [options] output.(png|hdr|exr)\n"
+               "  --input=file        scene color to tone map (hdr, or any stb_image format)\n"
+               "  --hosek             render the Hosek sky model on the CPU\n"
+               "  --atmosphere        render the single scattering atmosphere on the CPU\n"
+               "  --width=N --height=N\n"
+               "  --sun-angle=deg --turbidity=T\n"
+               "  --exposure-mode=0|3 --exposure=EV\n"
+               "  --operator=aces|reinhard|hable --lut=1d|3d32|3d64\n"
+               "  --raw=file          also write the scene color before post processing\n"
+               "  --reference=file    compare against an image read back from GL\n"
+               "  --tolerance=N       per channel tolerance in 1/255 steps (default 2)\n");
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    std::string input, output, raw, reference, value;
+    bool bHosek = false, bAtmosphere = false;
+    uint32_t width = 1280, height = 720;
+    float sunAngle = 76.f, turbidity = 1.f, tolerance = 2.f;
+    offline::Settings settings;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char* arg = argv[i];
+        if (strcmp(arg, "--hosek") == 0)
+            bHosek = true;
+        else if (strcmp(arg, "--atmosphere") == 0)
+            bAtmosphere = true;
+        else if (parseOption(arg, "--input", value))
+            input = value;
+        else if (parseOption(arg, "--raw", value))
+            raw = value;
+        else if (parseOption(arg, "--reference", value))
+            reference = value;
+        else if (parseOption(arg, "--width", value))
+            width = (uint32_t)atoi(value.c_str());
+        else if (parseOption(arg, "--height", value))
+            height = (uint32_t)atoi(value.c_str());
+        else if (parseOption(arg, "--sun-angle", value))
+            sunAngle = (float)atof(value.c_str());
+        else if (parseOption(arg, "--turbidity", value))
+            turbidity = (float)atof(value.c_str());
+        else if (parseOption(arg, "--exposure-mode", value))
+            settings.exposureMode = atoi(value.c_str());
+        else if (parseOption(arg, "--exposure", value))
+            settings.exposure = (float)atof(value.c_str());
+        else if (parseOption(arg, "--tolerance", value))
+            tolerance = (float)atof(value.c_str());
+        else if (parseOption(arg, "--operator", value))
+        {
+            if (value == "aces") settings.toneMapOperator = tonemap::ToneMapOperatorACES;
+            else if (value == "reinhard") settings.toneMapOperator = tonemap::ToneMapOperatorReinhard;
+            else if (value == "hable") settings.toneMapOperator = tonemap::ToneMapOperatorHable;
+            else { printUsage(); return EXIT_FAILURE; }
+        }
+        else if (parseOption(arg, "--lut", value))
+        {
+            if (value == "1d") settings.lutType = tonemap::LutType1D, settings.lutSize = 256;
+            else if (value == "3d32") settings.lutType = tonemap::LutType3D, settings.lutSize = 32;
+            else if (value == "3d64") settings.lutType = tonemap::LutType3D, settings.lutSize = 64;
+            else { printUsage(); return EXIT_FAILURE; }
+        }
+        else if (arg[0] != '-' && output.empty())
+            output = arg;
+        else
+        {
+            printUsage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (output.empty() || (input.empty() && !bHosek && !bAtmosphere))
+    {
+        printUsage();
+        return EXIT_FAILURE;
+    }
+
+    float angle = glm::radians(sunAngle);
+    glm::vec3 sunDir = glm::normalize(glm::vec3(0.0f, glm::cos(angle), -glm::sin(angle)));
+
+    offline::Image scene;
+    scene.width = width;
+    scene.height = height;
+    if (!input.empty())
+    {
+        if (!offline::loadImage(input, scene))
+            return EXIT_FAILURE;
+    }
+    else if (bHosek)
+        offline::renderHosekSky(scene, sunDir, turbidity, glm::vec3(0.5f));
+    else
+        offline::renderAtmosphere(scene, sunDir);
+
+    if (!raw.empty() && !offline::writeImage(raw, scene))
+        return EXIT_FAILURE;
+
+    offline::Image result;
+    offline::render(scene, settings, result);
+    if (!offline::writeImage(output, result))
+        return EXIT_FAILURE;
+
+    if (!reference.empty())
+    {
+        offline::Image image;
+        if (!offline::loadImage(reference, image))
+            return EXIT_FAILURE;
+
+        auto diff = offline::compare(result, image, tolerance / 255.f);
+        printf("max error %.2f/255, avg error %.4f/255, %u pixels above tolerance\n",
+            diff.maxError * 255.f, diff.avgError * 255.f, diff.numMismatches);
+        if (diff.numMismatches > 0)
+            return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -1,12 +1,17 @@
 #include "PostProcess.h"
 
+#include <string>
 #include <vector>
 #include <Types.h>
-#include <Mesh.h>
 #include <GLType/ProgramShader.h>
+#include <GLType/ProgramManager.h>
 #include <GLType/GraphicsDevice.h>
+#include <GLType/OGLDevice.h>
 #include <GLType/GraphicsTexture.h>
 #include <GLType/GraphicsFramebuffer.h>
+#include <FrameGraph.h>
+#include <FrameConstants.h>
+#include <tools/Logger.hpp>
 
 namespace postprocess
 {
@@ -14,78 +19,106 @@ namespace postprocess
 
     GraphicsDevicePtr getDevice();
 
-    void extractLuminance(const GraphicsTexturePtr& source, GraphicsTexturePtr& target) noexcept;
-    void processBloom(const GraphicsTexturePtr& source, GraphicsTexturePtr target) noexcept;
-    void updateExposure(std::vector<GraphicsTexturePtr>& textures) noexcept;
+    void prefilterScene(const GraphicsTexturePtr& source, const GraphicsTexturePtr& bloom, const GraphicsTexturePtr& luma) noexcept;
+    void downsampleLuma(const GraphicsTexturePtr& source, const GraphicsTexturePtr& target) noexcept;
+    void drawFullscreen(const ShaderPtr& shader, UniformHandle sourceHandle, const GraphicsTexturePtr& source, const GraphicsTexturePtr& dest) noexcept;
+    void resolveHandles() noexcept;
+    const std::string& getNumberedName(std::vector<std::string>& names, const char* prefix, int index) noexcept;
 
-    int m_ExposureMode;
-    float m_Exposure;
-    float m_KeyValue;
     uint32_t m_FrameWidth, m_FrameHeight;
     GraphicsDeviceWeakPtr m_Device;
-    ShaderPtr m_ExtractLuminance;
+    ShaderPtr m_Prefilter;
     ShaderPtr m_DownsamplingLuma;
     ShaderPtr m_BlurVert, m_BlurHori;
-    ShaderPtr m_Bloom;
     ShaderPtr m_BlitColor;
-    FullscreenTriangleMesh m_ScreenTraingle;
-    GraphicsTexturePtr m_BlurTexture;
-    GraphicsTexturePtr m_BloomTexture;
-    std::vector<GraphicsTexturePtr> m_DownsampledLumaTextures;
+    // Resolved once after linking, so the per-frame path does no name lookups
+    UniformHandle m_PrefilterSource, m_PrefilterBloom, m_PrefilterLuma;
+    UniformHandle m_DownsampleSource, m_DownsampleTarget;
+    UniformHandle m_BlurVertSource, m_BlurHoriSource;
+    UniformHandle m_BlitSource, m_BlitBloom, m_BlitAvgLuma, m_BlitLut1D, m_BlitLut3D;
+    UniformBlockHandle m_BlitFrameConstants;
+    tonemap::ToneMapOperator m_ToneMapOperator = tonemap::ToneMapOperatorCount;
+    tonemap::LutType m_LutType = tonemap::LutType1D;
+    uint32_t m_LutSize = 0;
+    GraphicsTexturePtr m_ToneMapLut;
+    // Pass and resource names of the loops, built once instead of every frame
+    std::vector<std::string> m_DownsampleNames, m_LumaNames, m_BlurVertNames, m_BlurHoriNames, m_BlurNames;
+}
+
+const std::string& postprocess::getNumberedName(std::vector<std::string>& names, const char* prefix, int index) noexcept
+{
+    while ((int)names.size() <= index)
+        names.push_back(prefix + std::to_string(names.size()));
+    return names[index];
+}
+
+void postprocess::resolveHandles() noexcept
+{
+    m_BlitSource = m_BlitColor->getUniformHandle("uTexSource");
+    m_BlitBloom = m_BlitColor->getUniformHandle("uTexBloom");
+    m_BlitAvgLuma = m_BlitColor->getUniformHandle("uTexAvgLuma");
+    m_BlitLut1D = m_BlitColor->getUniformHandle("uTexToneMapLut1D");
+    m_BlitLut3D = m_BlitColor->getUniformHandle("uTexToneMapLut3D");
+    m_BlitFrameConstants = m_BlitColor->getBlockHandle(FrameConstants::BlockName);
+    m_PrefilterSource = m_Prefilter->getUniformHandle("uTexSource");
+    m_PrefilterBloom = m_Prefilter->getUniformHandle("uTexBloom");
+    m_PrefilterLuma = m_Prefilter->getUniformHandle("uTexLuma");
+    m_DownsampleSource = m_DownsamplingLuma->getUniformHandle("uSource");
+    m_DownsampleTarget = m_DownsamplingLuma->getUniformHandle("uTarget");
+    m_BlurVertSource = m_BlurVert->getUniformHandle("uTexSource");
+    m_BlurHoriSource = m_BlurHori->getUniformHandle("uTexSource");
 }
 
 void postprocess::initialize(const GraphicsDevicePtr& device) noexcept
 {
     assert(device);
 
-    m_ScreenTraingle.create();
-
     m_BlitColor = std::make_shared<ProgramShader>();
 	m_BlitColor->setDevice(device);
 	m_BlitColor->create();
 	m_BlitColor->addShader(GL_VERTEX_SHADER, "BlitTexture.Vertex");
 	m_BlitColor->addShader(GL_FRAGMENT_SHADER, "BlitTexture.Fragment");
-	m_BlitColor->link();
 
-    m_ExtractLuminance = std::make_shared<ProgramShader>();
-    m_ExtractLuminance->setDevice(device);
-    m_ExtractLuminance->create();
-    m_ExtractLuminance->addShader(GL_COMPUTE_SHADER, "ExtractLuminance.Compute");
-    m_ExtractLuminance->link();
+    m_Prefilter = std::make_shared<ProgramShader>();
+    m_Prefilter->setDevice(device);
+    m_Prefilter->create();
+    m_Prefilter->addShader(GL_COMPUTE_SHADER, "PostProcessPrefilter.Compute");
 
     m_DownsamplingLuma = std::make_shared<ProgramShader>();
     m_DownsamplingLuma->setDevice(device);
     m_DownsamplingLuma->create();
     m_DownsamplingLuma->addShader(GL_COMPUTE_SHADER, "DownsamplingLuma.Compute");
-    m_DownsamplingLuma->link();
-
-    m_Bloom = std::make_shared<ProgramShader>();
-    m_Bloom->setDevice(device);
-    m_Bloom->create();
-    m_Bloom->addShader(GL_VERTEX_SHADER, "Bloom.Vertex");
-    m_Bloom->addShader(GL_FRAGMENT_SHADER, "Bloom.Fragment");
-    m_Bloom->link();
 
     m_BlurHori = std::make_shared<ProgramShader>();
     m_BlurHori->setDevice(device);
     m_BlurHori->create();
 	m_BlurHori->addShader(GL_VERTEX_SHADER, "BlurHorizontal.Vertex");
 	m_BlurHori->addShader(GL_FRAGMENT_SHADER, "BlurHorizontal.Fragment");
-    m_BlurHori->link();
 
     m_BlurVert = std::make_shared<ProgramShader>();
     m_BlurVert->setDevice(device);
     m_BlurVert->create();
 	m_BlurVert->addShader(GL_VERTEX_SHADER, "BlurVertical.Vertex");
 	m_BlurVert->addShader(GL_FRAGMENT_SHADER, "BlurVertical.Fragment");
-    m_BlurVert->link();
+
+    // Compiled and linked as one batch
+    ProgramShader::link({ m_BlitColor, m_Prefilter, m_DownsamplingLuma, m_BlurHori, m_BlurVert });
+    m_BlitColor->initBlockBinding(FrameConstants::BlockName);
+
+    resolveHandles();
+
+    // Handles are resolved again whenever a program is hot reloaded
+    for (auto& program : { m_BlitColor, m_Prefilter, m_DownsamplingLuma, m_BlurHori, m_BlurVert })
+        ProgramManager::instance().add(program, [](const ShaderPtr&) { resolveHandles(); });
 
     m_Device = device;
+
+    setToneMapping(tonemap::ToneMapOperatorACES, tonemap::LutType1D, 256);
 }
 
 void postprocess::shutdown() noexcept
 {
-    m_ScreenTraingle.destroy();
+    m_ToneMapLut.reset();
 }
 
 GraphicsDevicePtr postprocess::getDevice()
@@ -95,132 +128,197 @@ GraphicsDevicePtr postprocess::getDevice()
     return device;
 }
 
-void postprocess::extractLuminance(const GraphicsTexturePtr& source, GraphicsTexturePtr& target) noexcept
+void postprocess::prefilterScene(const GraphicsTexturePtr& source, const GraphicsTexturePtr& bloom, const GraphicsTexturePtr& luma) noexcept
 {
     auto width = source->getGraphicsTextureDesc().getWidth();
     auto height = source->getGraphicsTextureDesc().getHeight();
 
-    m_ExtractLuminance->bind();
-    m_ExtractLuminance->bindImage("uTexSource", source, 0, 0, false, 0, GL_READ_ONLY);
-    m_ExtractLuminance->bindImage("uTexTarget", target, 1, 0, false, 0, GL_WRITE_ONLY);
-    m_ExtractLuminance->Dispatch2D(width, height, DownsampleGroudSize, DownsampleGroudSize);
+    m_Prefilter->bind();
+    m_Prefilter->bindImage(m_PrefilterSource, source, 0, 0, false, 0, GL_READ_ONLY);
+    m_Prefilter->bindImage(m_PrefilterBloom, bloom, 1, 0, false, 0, GL_WRITE_ONLY);
+    m_Prefilter->bindImage(m_PrefilterLuma, luma, 2, 0, false, 0, GL_WRITE_ONLY);
+    m_Prefilter->Dispatch2D(width, height, DownsampleGroudSize, DownsampleGroudSize);
 }
 
-void postprocess::updateExposure(std::vector<GraphicsTexturePtr>& textures) noexcept
+void postprocess::downsampleLuma(const GraphicsTexturePtr& source, const GraphicsTexturePtr& target) noexcept
 {
-    const int numReduction = textures.size();
+    auto width = source->getGraphicsTextureDesc().getWidth();
+    auto height = source->getGraphicsTextureDesc().getHeight();
 
     m_DownsamplingLuma->bind();
-    for (int i = 0; i < numReduction - 1; i++)
-    {
-        auto& source = textures[i];
-        auto& target = textures[i+1];
-        auto width = source->getGraphicsTextureDesc().getWidth();
-        auto height = source->getGraphicsTextureDesc().getHeight();
-        m_DownsamplingLuma->bindImage("uSource", source, 0, 0, false, 0, GL_READ_ONLY);
-        m_DownsamplingLuma->bindImage("uTarget", target, 1, 0, false, 0, GL_WRITE_ONLY);
-        m_DownsamplingLuma->Dispatch2D(width, height, DownsampleGroudSize, DownsampleGroudSize);
-    }
+    m_DownsamplingLuma->bindImage(m_DownsampleSource, source, 0, 0, false, 0, GL_READ_ONLY);
+    m_DownsamplingLuma->bindImage(m_DownsampleTarget, target, 1, 0, false, 0, GL_WRITE_ONLY);
+    m_DownsamplingLuma->Dispatch2D(width, height, DownsampleGroudSize, DownsampleGroudSize);
 }
 
-void postprocess::processBloom(const GraphicsTexturePtr& source, GraphicsTexturePtr dest) noexcept
+void postprocess::drawFullscreen(const ShaderPtr& shader, UniformHandle sourceHandle, const GraphicsTexturePtr& source, const GraphicsTexturePtr& dest) noexcept
 {
-    auto device = getDevice();
+    auto device = getDevice()->downcast_pointer<OGLDevice>();
 
-    auto desc = dest->getGraphicsTextureDesc();
-    auto width = desc.getWidth();
-    auto height = desc.getHeight();
-
-    glViewport(0, 0, width, height);
+    auto& desc = dest->getGraphicsTextureDesc();
+    glViewport(0, 0, desc.getWidth(), desc.getHeight());
     device->setFramebuffer(dest->getGraphicsRenderTarget());
 
-    m_Bloom->bind();
-    m_Bloom->bindTexture("uTexSource", source, 0);
-    m_ScreenTraingle.draw();
-
-    const int numBlurTimes = 2;
-    for (int i = 0; i < numBlurTimes; i++)
-    {
-        device->setFramebuffer(m_BlurTexture->getGraphicsRenderTarget());
-        m_BlurVert->bind();
-        m_BlurVert->bindTexture("uTexSource", dest, 0);
-        m_ScreenTraingle.draw();
-
-        device->setFramebuffer(dest->getGraphicsRenderTarget());
-        m_BlurHori->bind();
-        m_BlurHori->bindTexture("uTexSource", m_BlurTexture, 0);
-        m_ScreenTraingle.draw();
-    }
-}
-
-void postprocess::render(const GraphicsTexturePtr& source) noexcept
-{
-    assert(m_DownsampledLumaTextures.size() > 1);
-
-    auto logLumaFullTexture = m_DownsampledLumaTextures.front();
-    auto logLumaAvgTexture = m_DownsampledLumaTextures.back();
-
-    extractLuminance(source, logLumaFullTexture);
-    updateExposure(m_DownsampledLumaTextures);
-    processBloom(source, m_BloomTexture);
-
-    // tone mapping
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glViewport(0, 0, m_FrameWidth, m_FrameHeight);
-
-    glDisable(GL_DEPTH_TEST);
-    m_BlitColor->bind();
-    m_BlitColor->setUniform("uExposureMode", m_ExposureMode);
-    m_BlitColor->setUniform("uExposure", m_Exposure);
-    m_BlitColor->bindTexture("uTexSource", source, 0);
-    m_BlitColor->bindTexture("uTexBloom", m_BloomTexture, 1);
-    m_BlitColor->bindTexture("uTexAvgLuma", logLumaAvgTexture, 2);
-    m_ScreenTraingle.draw();
-    glEnable(GL_DEPTH_TEST);
+    shader->bind();
+    shader->bindTexture(sourceHandle, source, 0);
+    device->drawAttributeless(GL_TRIANGLES, 3);
 }
 
-void postprocess::update(float exposure) noexcept
+void postprocess::render(FrameGraph& graph, FrameGraphResource source, const GraphicsDataPtr& frameConstants) noexcept
 {
-    m_Exposure = exposure;
-    m_ExposureMode = 3;
-    // 0.1150f, 0.0000f, 0.5000f, 0.0100f
-    m_KeyValue = 0.1150f;
-}
+    struct PassData
+    {
+        FrameGraphResource input;
+        FrameGraphResource output;
+    };
 
-void postprocess::framesizeChange(int32_t width, int32_t height) noexcept
-{
-    auto device = getDevice();
+    GraphicsTextureDesc halfDesc;
+    halfDesc.setWidth(m_FrameWidth/2);
+    halfDesc.setHeight(m_FrameHeight/2);
+    halfDesc.setFormat(gli::FORMAT_RGBA16_SFLOAT_PACK16);
+    halfDesc.setWrapS(GL_CLAMP_TO_EDGE);
+    halfDesc.setWrapT(GL_CLAMP_TO_EDGE);
 
-    auto w = width, h = height;
+    auto w = Math::DivideByMultiple(m_FrameWidth, DownsampleGroudSize);
+    auto h = Math::DivideByMultiple(m_FrameHeight, DownsampleGroudSize);
 
     GraphicsTextureDesc lumaDesc;
     lumaDesc.setWidth(w);
     lumaDesc.setHeight(h);
     lumaDesc.setFormat(gli::FORMAT_R16_SFLOAT_PACK16);
-    m_DownsampledLumaTextures.emplace_back(std::move(device->createTexture(lumaDesc)));
 
-    while (w > 1 && h > 1)
+    struct PrefilterData
+    {
+        FrameGraphResource source;
+        FrameGraphResource bloom;
+        FrameGraphResource luma;
+    };
+
+    // Single read of the scene color for both bloom and exposure
+    auto& prefilter = graph.addPass<PrefilterData>("Prefilter",
+        [&](FrameGraphBuilder& builder, PrefilterData& data) {
+            data.source = builder.read(source);
+            data.bloom = builder.create("Bloom", halfDesc);
+            data.luma = builder.create("LogLuma1", lumaDesc);
+        },
+        [](const PrefilterData& data, const FrameGraphResources& resources) {
+            prefilterScene(resources.getTexture(data.source), resources.getTexture(data.bloom), resources.getTexture(data.luma));
+        });
+
+    auto luma = prefilter.luma;
+    for (int i = 2; w > 1 && h > 1; i++)
     {
         w = Math::DivideByMultiple(w, DownsampleGroudSize);
         h = Math::DivideByMultiple(h, DownsampleGroudSize);
-
         lumaDesc.setWidth(w);
         lumaDesc.setHeight(h);
-        m_DownsampledLumaTextures.emplace_back(std::move(device->createTexture(lumaDesc)));
+
+        auto& downsample = graph.addPass<PassData>(getNumberedName(m_DownsampleNames, "DownsampleLuma", i),
+            [&](FrameGraphBuilder& builder, PassData& data) {
+                data.input = builder.read(luma);
+                data.output = builder.create(getNumberedName(m_LumaNames, "LogLuma", i), lumaDesc);
+            },
+            [](const PassData& data, const FrameGraphResources& resources) {
+                downsampleLuma(resources.getTexture(data.input), resources.getTexture(data.output));
+            });
+        luma = downsample.output;
     }
 
-    auto halfwidth = width/2;
-    auto halfheight = height/2;
+    auto bloom = prefilter.bloom;
+    const int numBlurTimes = 2;
+    for (int i = 0; i < numBlurTimes; i++)
+    {
+        auto& vertical = graph.addPass<PassData>(getNumberedName(m_BlurVertNames, "BlurVertical", i),
+            [&](FrameGraphBuilder& builder, PassData& data) {
+                data.input = builder.read(bloom);
+                data.output = builder.create(getNumberedName(m_BlurNames, "Blur", i), halfDesc);
+            },
+            [](const PassData& data, const FrameGraphResources& resources) {
+                drawFullscreen(m_BlurVert, m_BlurVertSource, resources.getTexture(data.input), resources.getTexture(data.output));
+            });
+
+        auto& horizontal = graph.addPass<PassData>(getNumberedName(m_BlurHoriNames, "BlurHorizontal", i),
+            [&](FrameGraphBuilder& builder, PassData& data) {
+                data.input = builder.read(vertical.output);
+                data.output = builder.write(bloom);
+            },
+            [](const PassData& data, const FrameGraphResources& resources) {
+                drawFullscreen(m_BlurHori, m_BlurHoriSource, resources.getTexture(data.input), resources.getTexture(data.output));
+            });
+        bloom = horizontal.output;
+    }
 
-    GraphicsTextureDesc halfDesc;
-    halfDesc.setWidth(halfwidth);
-    halfDesc.setHeight(halfheight);
-    halfDesc.setFormat(gli::FORMAT_RGBA16_SFLOAT_PACK16);
-    halfDesc.setWrapS(GL_CLAMP);
-    halfDesc.setWrapT(GL_CLAMP);
-    m_BlurTexture = device->createTexture(halfDesc);
-    m_BloomTexture = device->createTexture(halfDesc);
+    struct ToneMappingData
+    {
+        FrameGraphResource source;
+        FrameGraphResource bloom;
+        FrameGraphResource luma;
+    };
+
+    graph.addPass<ToneMappingData>("ToneMapping",
+        [&](FrameGraphBuilder& builder, ToneMappingData& data) {
+            data.source = builder.read(source);
+            data.bloom = builder.read(bloom);
+            data.luma = builder.read(luma);
+            // Presents to the default framebuffer
+            builder.setSideEffect();
+        },
+        [frameConstants](const ToneMappingData& data, const FrameGraphResources& resources) {
+            auto device = getDevice()->downcast_pointer<OGLDevice>();
+            device->setFramebuffer(nullptr);
+            glViewport(0, 0, m_FrameWidth, m_FrameHeight);
+
+            device->setEnabled(GL_DEPTH_TEST, false);
+            m_BlitColor->bind();
+            m_BlitColor->bindBuffer(m_BlitFrameConstants, frameConstants);
+            m_BlitColor->bindTexture(m_BlitSource, resources.getTexture(data.source), 0);
+            m_BlitColor->bindTexture(m_BlitBloom, resources.getTexture(data.bloom), 1);
+            m_BlitColor->bindTexture(m_BlitAvgLuma, resources.getTexture(data.luma), 2);
+            // Samplers of different types must not share a unit, even when unused
+            if (m_LutType == tonemap::LutType3D)
+            {
+                m_BlitColor->bindTexture(m_BlitLut3D, m_ToneMapLut, 3);
+                m_BlitColor->setUniform(m_BlitLut1D, 4);
+            }
+            else
+            {
+                m_BlitColor->bindTexture(m_BlitLut1D, m_ToneMapLut, 4);
+                m_BlitColor->setUniform(m_BlitLut3D, 3);
+            }
+            device->drawAttributeless(GL_TRIANGLES, 3);
+            device->setEnabled(GL_DEPTH_TEST, true);
+        });
+}
+
+void postprocess::update(FrameConstants& constants) noexcept
+{
+    constants.lutType = (int32_t)m_LutType;
+    constants.lutSize = (float)m_LutSize;
+    constants.lutLogRange = glm::vec2(tonemap::LutMinLog2, tonemap::LutMaxLog2);
+    constants.lutInputMat = tonemap::getInputMatrix(m_ToneMapOperator);
+    constants.lutOutputMat = tonemap::getOutputMatrix(m_ToneMapOperator);
+}
+
+void postprocess::setToneMapping(tonemap::ToneMapOperator op, tonemap::LutType type, uint32_t size) noexcept
+{
+    if (m_ToneMapOperator == op && m_LutType == type && m_LutSize == size)
+        return;
+
+    auto lut = tonemap::bake(op, type, size);
+    auto error = tonemap::measureError(lut, op);
+    LOG_INFO("Tonemap LUT %s %s%u: max error %f (%.2f/255), avg error %f\n",
+        tonemap::getOperatorName(op), type == tonemap::LutType3D ? "3D " : "1D ", size,
+        error.maxError, error.maxError * 255.f, error.avgError);
+
+    m_ToneMapLut = getDevice()->createTexture(lut);
+    m_ToneMapOperator = op;
+    m_LutType = type;
+    m_LutSize = size;
+}
 
+void postprocess::framesizeChange(int32_t width, int32_t height) noexcept
+{
+    // Intermediate targets are transient resources of the frame graph
     m_FrameWidth = width;
     m_FrameHeight = height;
 }
@@ -2,12 +2,20 @@
 
 #include <cstdint>
 #include <GraphicsTypes.h>
+#include <FrameGraph.h>
+#include <ToneMapping.h>
+
+struct FrameConstants;
 
 namespace postprocess
 {
     void initialize(const GraphicsDevicePtr& device) noexcept;
     void shutdown() noexcept;
-    void update(float exposure) noexcept;
-    void render(const GraphicsTexturePtr& source) noexcept;
+    // Fills the tone mapping part of the per-frame constants
+    void update(FrameConstants& constants) noexcept;
+    // Rebakes the LUT only when the selection changes
+    void setToneMapping(tonemap::ToneMapOperator op, tonemap::LutType type, uint32_t size) noexcept;
+    // Adds the luminance, bloom and tone mapping passes reading 'source'
+    void render(FrameGraph& graph, FrameGraphResource source, const GraphicsDataPtr& frameConstants) noexcept;
     void framesizeChange(int32_t width, int32_t height) noexcept;
 }
\ No newline at end of file
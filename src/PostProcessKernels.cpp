@@ -0,0 +1,120 @@
+#include "PostProcessKernels.h"
+
+#include <cmath>
+#include <cassert>
+#include <algorithm>
+#include <tools/JobSystem.h>
+
+namespace postprocess
+{
+    float luminance(const glm::vec3& color) noexcept;
+    void resize(uint32_t width, uint32_t height, PrefilterOutput& output) noexcept;
+}
+
+float postprocess::luminance(const glm::vec3& color) noexcept
+{
+    return glm::dot(color, glm::vec3(0.2126f, 0.7152f, 0.0722f));
+}
+
+void postprocess::resize(uint32_t width, uint32_t height, PrefilterOutput& output) noexcept
+{
+    output.bloomWidth = width / 2;
+    output.bloomHeight = height / 2;
+    output.lumaWidth = (width + PrefilterGroupSize - 1) / PrefilterGroupSize;
+    output.lumaHeight = (height + PrefilterGroupSize - 1) / PrefilterGroupSize;
+    output.bloom.assign(output.bloomWidth * output.bloomHeight, glm::vec3(0.f));
+    output.luma.assign(output.lumaWidth * output.lumaHeight, 0.f);
+}
+
+void postprocess::prefilter(const std::vector<glm::vec4>& source, uint32_t width, uint32_t height, PrefilterOutput& output) noexcept
+{
+    assert(source.size() >= width * height);
+
+    const uint32_t NumThreads = PrefilterGroupSize * PrefilterGroupSize;
+
+    resize(width, height, output);
+
+    // Rows of work groups are independent
+    JobSystem::instance().parallel_for(output.lumaHeight, 1, [&](uint32_t begin, uint32_t end)
+    {
+        glm::vec3 colorSample[NumThreads];
+        float lumSample[NumThreads];
+        float countSample[NumThreads];
+
+        for (uint32_t gy = begin; gy < end; gy++)
+        for (uint32_t gx = 0; gx < output.lumaWidth; gx++)
+        {
+            // Load phase, every thread of the group
+            for (uint32_t si = 0; si < NumThreads; si++)
+            {
+                uint32_t x = gx * PrefilterGroupSize + si % PrefilterGroupSize;
+                uint32_t y = gy * PrefilterGroupSize + si / PrefilterGroupSize;
+                bool bValid = x < width && y < height;
+                glm::vec3 color = bValid ? glm::vec3(source[y * width + x]) : glm::vec3(0.f);
+                colorSample[si] = color;
+                lumSample[si] = bValid ? std::log(std::max(luminance(color), 0.00001f)) : 0.f;
+                countSample[si] = bValid ? 1.f : 0.f;
+            }
+
+            for (uint32_t si = 0; si < NumThreads; si++)
+            {
+                uint32_t lx = si % PrefilterGroupSize, ly = si / PrefilterGroupSize;
+                if ((lx & 1) != 0 || (ly & 1) != 0)
+                    continue;
+
+                uint32_t hx = (gx * PrefilterGroupSize + lx) / 2;
+                uint32_t hy = (gy * PrefilterGroupSize + ly) / 2;
+                if (hx >= output.bloomWidth || hy >= output.bloomHeight)
+                    continue;
+
+                glm::vec3 sum = colorSample[si] + colorSample[si + 1]
+                              + colorSample[si + PrefilterGroupSize] + colorSample[si + PrefilterGroupSize + 1];
+                output.bloom[hy * output.bloomWidth + hx] = sum * 0.25f;
+            }
+
+            // Same tree order as the shader
+            for (uint32_t s = NumThreads / 2; s > 0; s >>= 1)
+            {
+                for (uint32_t si = 0; si < s; si++)
+                {
+                    lumSample[si] += lumSample[si + s];
+                    countSample[si] += countSample[si + s];
+                }
+            }
+            output.luma[gy * output.lumaWidth + gx] = lumSample[0] / std::max(countSample[0], 1.f);
+        }
+    });
+}
+
+void postprocess::prefilterReference(const std::vector<glm::vec4>& source, uint32_t width, uint32_t height, PrefilterOutput& output) noexcept
+{
+    assert(source.size() >= width * height);
+
+    resize(width, height, output);
+
+    std::vector<float> logLuma(width * height);
+    for (uint32_t i = 0; i < width * height; i++)
+        logLuma[i] = std::log(std::max(luminance(glm::vec3(source[i])), 0.00001f));
+
+    for (uint32_t gy = 0; gy < output.lumaHeight; gy++)
+    for (uint32_t gx = 0; gx < output.lumaWidth; gx++)
+    {
+        double total = 0.0;
+        uint32_t count = 0;
+        for (uint32_t y = gy * PrefilterGroupSize; y < std::min(height, (gy + 1) * PrefilterGroupSize); y++)
+        for (uint32_t x = gx * PrefilterGroupSize; x < std::min(width, (gx + 1) * PrefilterGroupSize); x++)
+        {
+            total += logLuma[y * width + x];
+            count++;
+        }
+        output.luma[gy * output.lumaWidth + gx] = float(total / std::max(count, 1u));
+    }
+
+    for (uint32_t y = 0; y < output.bloomHeight; y++)
+    for (uint32_t x = 0; x < output.bloomWidth; x++)
+    {
+        glm::vec3 sum = glm::vec3(source[(2*y) * width + 2*x]) + glm::vec3(source[(2*y) * width + 2*x + 1])
+                      + glm::vec3(source[(2*y + 1) * width + 2*x]) + glm::vec3(source[(2*y + 1) * width + 2*x + 1]);
+        output.bloom[y * output.bloomWidth + x] = sum * 0.25f;
+    }
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+// CPU versions of the post process compute kernels, following the same
+// work group tiling so their output can be checked without a GL context.
+namespace postprocess
+{
+    const uint32_t PrefilterGroupSize = 16;
+
+    struct PrefilterOutput
+    {
+        uint32_t bloomWidth, bloomHeight;
+        uint32_t lumaWidth, lumaHeight;
+        std::vector<glm::vec3> bloom;
+        std::vector<float> luma;
+    };
+
+    // Emulates 'PostProcessPrefilter.Compute', one work group at a time
+    void prefilter(const std::vector<glm::vec4>& source, uint32_t width, uint32_t height, PrefilterOutput& output) noexcept;
+
+    // Separate passes as done before the fused kernel: log luminance,
+    // first reduction level and 2x2 bloom downsample
+    void prefilterReference(const std::vector<glm::vec4>& source, uint32_t width, uint32_t height, PrefilterOutput& output) noexcept;
+}
@@ -5,15 +5,22 @@
 #include <HosekSky/ArHosekSkyModel.h>
 
 #include <GLType/GraphicsDevice.h>
+#include <GLType/OGLDevice.h>
 #include <GLType/ProgramShader.h>
+#include <GLType/ProgramManager.h>
 #include <GLType/GraphicsTexture.h>
 #include <tools/gltools.hpp>
+#include <tools/Profile.h>
+#include <tools/JobSystem.h>
 #include <Types.h>
-#include <Mesh.h>
 #include <gli/gli.hpp>
+#include <FrameConstants.h>
 
 namespace
 {
+    const uint32_t CubemapFaces = 6;
+    const uint32_t CubemapSize = 128;
+
     // Scale factor used for storing physical light units in fp16 floats (equal to 2^-10).
     const float FP16Scale = 0.0009765625f;
 
@@ -132,6 +139,8 @@ void SkyCache::destroy()
 }
 
 Skybox::Skybox()
+    : m_bBakePending(false)
+    , m_bBaking(false)
 {
 }
 
@@ -142,7 +151,8 @@ Skybox::~Skybox()
 
 void Skybox::destroy()
 {
-    m_CubeMesh.destroy();
+    m_SkyCubemapTex.reset();
+    m_Environment.reset();
 }
 
 void Skybox::create()
@@ -155,72 +165,131 @@ void Skybox::create()
     m_SkyShader->addShader(GL_VERTEX_SHADER, "Skybox.Vertex");
     m_SkyShader->addShader(GL_FRAGMENT_SHADER, "Skybox.Fragment");
     m_SkyShader->link();
-
-    m_CubeMesh.create();
+    m_SkyShader->initBlockBinding(FrameConstants::BlockName);
+    m_TexSourceHandle = m_SkyShader->getUniformHandle("uTexSource");
+    m_FrameConstantsHandle = m_SkyShader->getBlockHandle(FrameConstants::BlockName);
+    ProgramManager::instance().add(m_SkyShader, [this](const ShaderPtr& program) {
+        m_TexSourceHandle = program->getUniformHandle("uTexSource");
+    });
 }
 
 void Skybox::update(const SkyboxParam& param)
 {
-    //
-    // Use code from 'BakingLab'
-    //
+    PROFILE_SCOPE("Skybox::update");
+
     // Update the cache, if necessary
     if (!m_SkyCache.update(param) && m_SkyCubemapTex)
         return;
 
-    const uint32_t numFace = 6;
-    const uint32_t cubemapRes = 128;
-    std::vector<uint64_t> texels;
-    texels.resize(cubemapRes * cubemapRes * numFace);
+    // Changes during a bake are picked up when it is done
+    m_BakeParam = param;
+    m_bBakePending = true;
+
+    // Nothing to draw yet
+    if (!m_SkyCubemapTex)
+    {
+        auto device = getDevice();
+        m_SkyCubemapTex = device->createTexture(BakeCubemap(param), false);
+        m_bBakePending = false;
+        CHECKGLERROR();
+        return;
+    }
+    bake();
+}
+
+bool Skybox::isBaking() const noexcept
+{
+    return m_bBaking || m_bBakePending;
+}
+
+void Skybox::bake()
+{
+    if (!m_bBakePending || m_bBaking)
+        return;
+
+    m_bBakePending = false;
+    m_bBaking = true;
+
+    // The texture is created where the GL context is current
+    SkyboxParam param = m_BakeParam;
+    JobSystem::instance().runAsync(
+        [param] { return BakeCubemap(param); },
+        [this](const gli::texture& texture) {
+            auto device = getDevice();
+            m_SkyCubemapTex = device->createTexture(texture, false);
+            m_bBaking = false;
+            CHECKGLERROR();
+            bake();
+        });
+}
 
+gli::texture Skybox::BakeCubemap(const SkyboxParam& param)
+{
+    PROFILE_SCOPE("Skybox::bake");
+
+    // Hosek states are not shared with the main thread's cache
+    SkyCache cache;
+    cache.update(param);
+
+    //
+    // Use code from 'BakingLab'
+    //
     gli::texture texture(
         gli::texture::target_type::TARGET_CUBE,
         gli::texture::format_type::FORMAT_RGBA16_SFLOAT_PACK16,
-        gli::extent3d(cubemapRes, cubemapRes, 1),
-        1, numFace, 1);
+        gli::extent3d(CubemapSize, CubemapSize, 1),
+        1, CubemapFaces, 1);
 
-    assert(texture.size() == cubemapRes*cubemapRes*numFace*sizeof(uint64_t));
+    assert(texture.size() == CubemapSize*CubemapSize*CubemapFaces*sizeof(uint64_t));
 
-    for (int s = 0; s < numFace; s++)
+    JobSystem::instance().parallel_for(CubemapFaces*CubemapSize, 16, [&](uint32_t begin, uint32_t end)
     {
-        auto texels = texture.data<uint64_t>(0, s, 0);
-        for (int y = 0; y < cubemapRes; y++)
+        for (uint32_t row = begin; row < end; row++)
         {
-            for (int x = 0; x < cubemapRes; x++)
+            uint32_t s = row / CubemapSize, y = row % CubemapSize;
+            auto texels = texture.data<uint64_t>(0, s, 0);
+            for (uint32_t x = 0; x < CubemapSize; x++)
             {
-                glm::vec3 dir = MapXYSToDirection(x, y, s, cubemapRes, cubemapRes);
-                glm::vec3 radiance = SampleSky(m_SkyCache, dir);
-                
-                uint32_t idx = y*cubemapRes + x;
+                glm::vec3 dir = MapXYSToDirection(x, y, s, CubemapSize, CubemapSize);
+                glm::vec3 radiance = SampleSky(cache, dir);
+
+                // Rows are stored bottom up, as the upload would otherwise flip them
+                uint32_t idx = (CubemapSize - y - 1)*CubemapSize + x;
                 texels[idx] = glm::packHalf4x16(glm::vec4(radiance, 1.f));
             }
         }
-    }
-
-    auto device = getDevice();
-    m_SkyCubemapTex = device->createTexture(texture);
+    });
+    cache.destroy();
 
-    CHECKGLERROR();
+    return texture;
 }
 
-void Skybox::render(bool bEnableSun, float sunSize, glm::vec3 sunColor, glm::mat4 view, glm::mat4 projection)
+void Skybox::render(const GraphicsDataPtr& frameConstants)
 {
-    glDisable(GL_CULL_FACE);
-    glDisable(GL_DEPTH_TEST);
-    glDepthMask(GL_TRUE);
-    glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+    auto device = getDevice()->downcast_pointer<OGLDevice>();
+
+    // A file that failed to load falls back to the model
+    auto texture = m_SkyCubemapTex;
+    if (m_Environment && m_Environment->getState() != TextureLoadStateFailed)
+        texture = m_Environment->getTexture();
+
+    device->setEnabled(GL_TEXTURE_CUBE_MAP_SEAMLESS, true);
     m_SkyShader->bind();
-    m_SkyShader->setUniform("ubEnableSun", bEnableSun);
-    m_SkyShader->setUniform("uSunColor", sunColor);
-    m_SkyShader->setUniform("uSunDir", glm::normalize(m_SkyCache.m_SunDir));
-    m_SkyShader->setUniform("uCosSunAngularRadius", std::cos(glm::radians(sunSize)));
-    m_SkyShader->setUniform("uView", view);
-    m_SkyShader->setUniform("uProjection", projection);
-    m_SkyShader->bindTexture("uTexSource", m_SkyCubemapTex, 0);
-    m_CubeMesh.draw();
-    glDepthMask(GL_FALSE);
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_CULL_FACE);
+    m_SkyShader->bindBuffer(m_FrameConstantsHandle, frameConstants);
+    m_SkyShader->bindTexture(m_TexSourceHandle, texture, 0);
+    // A front facing triangle at infinity passes GL_GEQUAL only where the
+    // depth is still cleared, so only pixels no geometry covers are shaded
+    device->drawAttributeless(GL_TRIANGLES, 3);
+}
+
+void Skybox::setEnvironment(const TextureRequestPtr& environment) noexcept
+{
+    m_Environment = environment;
+}
+
+glm::vec3 Skybox::getSunDir() const noexcept
+{
+    return m_SkyCache.m_SunDir;
 }
 
 glm::vec3 Skybox::SampleSky(const SkyCache& cache, glm::vec3 sampleDir)
@@ -6,6 +6,8 @@
 #include <Types.h>
 #include <Mesh.h>
 #include <GraphicsTypes.h>
+#include <GLType/ProgramShader.h>
+#include <GLType/TextureLoader.h>
 
 #include "Spectrum.h"
 
@@ -57,19 +59,36 @@ public:
 
     void create();
     void destroy();
+    // Only the first bake is done here, later changes are baked on a job worker
     void update(const SkyboxParam& param);
-    void render(bool bEnableSun, float sunSize, glm::vec3 sunColor, glm::mat4 view, glm::mat4 projection);
+    bool isBaking() const noexcept;
+    // View, projection and sun parameters come from the 'FrameConstants' block.
+    // Drawn after opaque geometry, into the depth buffer it left
+    void render(const GraphicsDataPtr& frameConstants);
+
+    // Draws a loaded cubemap instead of the model, its placeholder until the upload is done
+    void setEnvironment(const TextureRequestPtr& environment) noexcept;
+
+    glm::vec3 getSunDir() const noexcept;
 
     GraphicsDevicePtr getDevice() noexcept;
     void setDevice(const GraphicsDevicePtr& device) noexcept;
 
     static glm::vec3 SampleSky(const SkyCache& cache, glm::vec3 sampleDir);
+    static gli::texture BakeCubemap(const SkyboxParam& param);
 
 private:
 
+    void bake();
+
     SkyCache m_SkyCache;
+    SkyboxParam m_BakeParam;
+    bool m_bBakePending;
+    bool m_bBaking;
     ShaderPtr m_SkyShader;
-    CubeMesh m_CubeMesh;
+    UniformHandle m_TexSourceHandle;
+    UniformBlockHandle m_FrameConstantsHandle;
     GraphicsTexturePtr m_SkyCubemapTex;
+    TextureRequestPtr m_Environment;
     GraphicsDeviceWeakPtr m_Device;
 };
\ No newline at end of file
@@ -0,0 +1,240 @@
+#include "ToneMapping.h"
+
+#include <cmath>
+#include <cassert>
+#include <vector>
+#include <algorithm>
+#include <glm/gtc/packing.hpp>
+#include <gli/gli.hpp>
+#include <tools/JobSystem.h>
+
+namespace tonemap
+{
+    const gli::format LutFormat = gli::FORMAT_RGBA16_SFLOAT_PACK16;
+
+    glm::mat3 mat3FromRows(const glm::vec3& r0, const glm::vec3& r1, const glm::vec3& r2) noexcept;
+    glm::vec3 rrtOdtFit(const glm::vec3& v) noexcept;
+    glm::vec3 hableCurve(const glm::vec3& x) noexcept;
+    glm::vec3 toSRGB(const glm::vec3& v) noexcept;
+    float encodeLog(float x) noexcept;
+    float decodeLog(float u) noexcept;
+    glm::vec3 fetch(const gli::texture& lut, int32_t x, int32_t y, int32_t z) noexcept;
+    glm::vec3 sample1D(const gli::texture& lut, float u) noexcept;
+    glm::vec3 sample3D(const gli::texture& lut, const glm::vec3& u) noexcept;
+}
+
+glm::mat3 tonemap::mat3FromRows(const glm::vec3& r0, const glm::vec3& r1, const glm::vec3& r2) noexcept
+{
+    return glm::transpose(glm::mat3(r0, r1, r2));
+}
+
+glm::vec3 tonemap::rrtOdtFit(const glm::vec3& v) noexcept
+{
+    glm::vec3 a = v*(         v + 0.0245786f) - 0.000090537f;
+    glm::vec3 b = v*(0.983729f*v + 0.4329510f) + 0.238081f;
+    return a/b;
+}
+
+// John Hable, 'Uncharted 2: HDR Lighting'
+glm::vec3 tonemap::hableCurve(const glm::vec3& x) noexcept
+{
+    const float A = 0.15f, B = 0.50f, C = 0.10f, D = 0.20f, E = 0.02f, F = 0.30f;
+    return ((x*(A*x + C*B) + D*E) / (x*(A*x + B) + D*F)) - E/F;
+}
+
+glm::vec3 tonemap::toSRGB(const glm::vec3& v) noexcept
+{
+    return glm::pow(v, glm::vec3(1.f/2.2f));
+}
+
+float tonemap::encodeLog(float x) noexcept
+{
+    float u = (std::log2(std::max(x, 1e-20f)) - LutMinLog2) / (LutMaxLog2 - LutMinLog2);
+    return glm::clamp(u, 0.f, 1.f);
+}
+
+float tonemap::decodeLog(float u) noexcept
+{
+    return std::exp2(LutMinLog2 + u * (LutMaxLog2 - LutMinLog2));
+}
+
+const char* tonemap::getOperatorName(ToneMapOperator op) noexcept
+{
+    switch (op)
+    {
+    case ToneMapOperatorACES: return "ACES";
+    case ToneMapOperatorReinhard: return "Reinhard";
+    case ToneMapOperatorHable: return "Hable";
+    default: return "Unknown";
+    }
+}
+
+glm::mat3 tonemap::getInputMatrix(ToneMapOperator op) noexcept
+{
+    if (op != ToneMapOperatorACES)
+        return glm::mat3(1.f);
+
+    return mat3FromRows(
+        glm::vec3(0.59719f, 0.35458f, 0.04823f),
+        glm::vec3(0.07600f, 0.90834f, 0.01566f),
+        glm::vec3(0.02840f, 0.13383f, 0.83777f));
+}
+
+glm::mat3 tonemap::getOutputMatrix(ToneMapOperator op) noexcept
+{
+    if (op != ToneMapOperatorACES)
+        return glm::mat3(1.f);
+
+    return mat3FromRows(
+        glm::vec3( 1.60475f,-0.53108f,-0.07367f),
+        glm::vec3(-0.10208f, 1.10813f,-0.00605f),
+        glm::vec3(-0.00327f,-0.07276f, 1.07602f));
+}
+
+glm::vec3 tonemap::evaluateCurve(ToneMapOperator op, const glm::vec3& color) noexcept
+{
+    switch (op)
+    {
+    case ToneMapOperatorACES:
+        return rrtOdtFit(color);
+    case ToneMapOperatorReinhard:
+        return color / (1.f + color);
+    case ToneMapOperatorHable:
+    {
+        const float ExposureBias = 2.0f;
+        const float W = 11.2f;
+        return hableCurve(color * ExposureBias) / hableCurve(glm::vec3(W));
+    }
+    default:
+        assert(false);
+        return color;
+    }
+}
+
+glm::vec3 tonemap::evaluate(ToneMapOperator op, const glm::vec3& color) noexcept
+{
+    glm::vec3 c = getInputMatrix(op) * color;
+    c = evaluateCurve(op, c);
+    c = getOutputMatrix(op) * c;
+    c = glm::clamp(c, 0.f, 1.f);
+    return toSRGB(c);
+}
+
+gli::texture tonemap::bake(ToneMapOperator op, LutType type, uint32_t size) noexcept
+{
+    assert(size > 1);
+
+    const float scale = 1.f / (size - 1);
+
+    if (type == LutType1D)
+    {
+        gli::texture1d lut(LutFormat, gli::extent1d(size), 1);
+        for (uint32_t i = 0; i < size; i++)
+        {
+            glm::vec3 c = evaluateCurve(op, glm::vec3(decodeLog(i * scale)));
+            lut.store(gli::extent1d(i), 0, glm::packHalf4x16(glm::vec4(c, 1.f)));
+        }
+        return lut;
+    }
+
+    gli::texture3d lut(LutFormat, gli::extent3d(size), 1);
+
+    // One slice per task
+    JobSystem::instance().parallel_for(size, 1, [&](uint32_t begin, uint32_t end)
+    {
+        for (uint32_t z = begin; z < end; z++)
+        for (uint32_t y = 0; y < size; y++)
+        for (uint32_t x = 0; x < size; x++)
+        {
+            glm::vec3 color(decodeLog(x * scale), decodeLog(y * scale), decodeLog(z * scale));
+            glm::vec3 c = evaluate(op, color);
+            lut.store(gli::extent3d(x, y, z), 0, glm::packHalf4x16(glm::vec4(c, 1.f)));
+        }
+    });
+    return lut;
+}
+
+glm::vec3 tonemap::fetch(const gli::texture& lut, int32_t x, int32_t y, int32_t z) noexcept
+{
+    auto extent = lut.extent();
+    x = glm::clamp(x, 0, extent.x - 1);
+    y = glm::clamp(y, 0, extent.y - 1);
+    z = glm::clamp(z, 0, extent.z - 1);
+
+    auto data = lut.data<glm::u16vec4>(0, 0, 0);
+    auto texel = data[(z * extent.y + y) * extent.x + x];
+    return glm::vec3(glm::unpackHalf4x16(*reinterpret_cast<const glm::uint64*>(&texel)));
+}
+
+glm::vec3 tonemap::sample1D(const gli::texture& lut, float u) noexcept
+{
+    float f = u * (lut.extent().x - 1);
+    int32_t i = (int32_t)std::floor(f);
+    float t = f - i;
+    return glm::mix(fetch(lut, i, 0, 0), fetch(lut, i + 1, 0, 0), t);
+}
+
+glm::vec3 tonemap::sample3D(const gli::texture& lut, const glm::vec3& u) noexcept
+{
+    glm::vec3 f = u * float(lut.extent().x - 1);
+    glm::ivec3 i = glm::ivec3(glm::floor(f));
+    glm::vec3 t = f - glm::vec3(i);
+
+    glm::vec3 c00 = glm::mix(fetch(lut, i.x, i.y, i.z), fetch(lut, i.x + 1, i.y, i.z), t.x);
+    glm::vec3 c10 = glm::mix(fetch(lut, i.x, i.y + 1, i.z), fetch(lut, i.x + 1, i.y + 1, i.z), t.x);
+    glm::vec3 c01 = glm::mix(fetch(lut, i.x, i.y, i.z + 1), fetch(lut, i.x + 1, i.y, i.z + 1), t.x);
+    glm::vec3 c11 = glm::mix(fetch(lut, i.x, i.y + 1, i.z + 1), fetch(lut, i.x + 1, i.y + 1, i.z + 1), t.x);
+    return glm::mix(glm::mix(c00, c10, t.y), glm::mix(c01, c11, t.y), t.z);
+}
+
+glm::vec3 tonemap::sample(const gli::texture& lut, ToneMapOperator op, const glm::vec3& color) noexcept
+{
+    if (lut.target() == gli::TARGET_3D)
+    {
+        glm::vec3 u(encodeLog(color.r), encodeLog(color.g), encodeLog(color.b));
+        return sample3D(lut, u);
+    }
+
+    glm::vec3 c = getInputMatrix(op) * color;
+    c = glm::vec3(
+        sample1D(lut, encodeLog(c.r)).r,
+        sample1D(lut, encodeLog(c.g)).g,
+        sample1D(lut, encodeLog(c.b)).b);
+    c = getOutputMatrix(op) * c;
+    c = glm::clamp(c, 0.f, 1.f);
+    return toSRGB(c);
+}
+
+tonemap::LutError tonemap::measureError(const gli::texture& lut, ToneMapOperator op) noexcept
+{
+    // Test points fall between texels, inside the encoded range
+    const uint32_t count = 48;
+    const float offset = 0.37f;
+
+    std::vector<float> maxErrors(count, 0.f);
+    std::vector<double> sumErrors(count, 0.0);
+
+    JobSystem::instance().parallel_for(count, 1, [&](uint32_t begin, uint32_t end)
+    {
+        for (uint32_t z = begin; z < end; z++)
+        for (uint32_t y = 0; y < count; y++)
+        for (uint32_t x = 0; x < count; x++)
+        {
+            glm::vec3 u = (glm::vec3(x, y, z) + offset) / float(count);
+            glm::vec3 color(decodeLog(u.x), decodeLog(u.y), decodeLog(u.z));
+            glm::vec3 diff = glm::abs(sample(lut, op, color) - evaluate(op, color));
+            float error = glm::max(diff.x, glm::max(diff.y, diff.z));
+            maxErrors[z] = std::max(maxErrors[z], error);
+            sumErrors[z] += error;
+        }
+    });
+
+    LutError result;
+    result.numSamples = count * count * count;
+    result.maxError = *std::max_element(maxErrors.begin(), maxErrors.end());
+    double sum = 0.0;
+    for (auto s : sumErrors)
+        sum += s;
+    result.avgError = float(sum / result.numSamples);
+    return result;
+}
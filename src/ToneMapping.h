@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <gli/texture.hpp>
+
+// Bakes the exposure independent part of the tone mapping into a LUT.
+// The LUT is indexed by log2 of the exposed color, so it covers the whole HDR range.
+namespace tonemap
+{
+    enum ToneMapOperator
+    {
+        ToneMapOperatorACES = 0,
+        ToneMapOperatorReinhard,
+        ToneMapOperatorHable,
+        ToneMapOperatorCount,
+    };
+
+    // 1D: per channel curve, the shader still applies the operator's color matrices
+    // 3D: the full operator including the sRGB encoding
+    enum LutType
+    {
+        LutType1D = 0,
+        LutType3D,
+    };
+
+    const float LutMinLog2 = -12.f;
+    const float LutMaxLog2 = 8.f;
+
+    struct LutError
+    {
+        float maxError;
+        float avgError;
+        uint32_t numSamples;
+    };
+
+    const char* getOperatorName(ToneMapOperator op) noexcept;
+
+    glm::mat3 getInputMatrix(ToneMapOperator op) noexcept;
+    glm::mat3 getOutputMatrix(ToneMapOperator op) noexcept;
+    glm::vec3 evaluateCurve(ToneMapOperator op, const glm::vec3& color) noexcept;
+
+    // Analytic reference: exposed linear color to display value
+    glm::vec3 evaluate(ToneMapOperator op, const glm::vec3& color) noexcept;
+
+    gli::texture bake(ToneMapOperator op, LutType type, uint32_t size) noexcept;
+
+    // Same lookup as 'BlitTexture.Fragment', on the CPU
+    glm::vec3 sample(const gli::texture& lut, ToneMapOperator op, const glm::vec3& color) noexcept;
+
+    // Compares the LUT against the analytic curve in display space
+    LutError measureError(const gli::texture& lut, ToneMapOperator op) noexcept;
+}
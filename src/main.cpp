@@ -5,17 +5,28 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp> 
+#include <glm/gtc/quaternion.hpp>
 
 #include <tools/gltools.hpp>
 #include <tools/Profile.h>
 #include <tools/imgui.h>
 #include <tools/TCamera.h>
+#include <tools/Animation.h>
+#include <tools/FramePacer.h>
+#include <tools/JobSystem.h>
+#include <tools/Logger.hpp>
 
 #include <GLType/GraphicsDevice.h>
 #include <GLType/GraphicsData.h>
 #include <GLType/OGLDevice.h>
 #include <GLType/ProgramShader.h>
+#include <GLType/ProgramManager.h>
+#include <GLType/TextureLoader.h>
+#include <GLType/AsyncReadback.h>
+#include <GLType/OGLGpuTimer.h>
+#include <GLType/OGLOcclusionQuery.h>
 #include <GLType/GraphicsFramebuffer.h>
+#include <GLType/Std140.h>
 
 #include <GLType/OGLTexture.h>
 #include <GLType/OGLCoreTexture.h>
@@ -25,23 +36,21 @@
 #include <Skybox.h>
 
 #include <fstream>
+#include <chrono>
+#include <functional>
 #include <memory>
 #include <vector>
 #include <algorithm>
 #include <GameCore.h>
 
 #include "HosekSky/ArHosekSkyModel.h"
+#include "FrameConstants.h"
+#include "FrameGraph.h"
 #include "PostProcess.h"
 #include "Sampling.h"
 #include "Spectrum.h"
-
-enum ProfilerType { ProfilerTypeRender = 0 };
-
-namespace 
-{
-    float s_CpuTick = 0.f;
-    float s_GpuTick = 0.f;
-}
+#include "Benchmark.h"
+#include <prefilter/stb_image_write.h>
 
 struct SceneSettings
 {
@@ -54,8 +63,14 @@ struct SceneSettings
     float angle = 76.f;
     float turbidity = 1.f;
     float exposure = -16.0f;
+    float keyValue = 0.005f;
+    int exposureMode = 1;
+    bool bAnimateExposure = false;
     float sunSize = 0.27f;
     glm::vec3 groundAlbedo = glm::vec3(0.5f);
+    int toneMapOperator = 0;
+    // 1D, the 3D LUTs are off by up to 20/255 with ACES
+    int toneMapLut = 0;
 
     const float baseSunSize = 0.27f;
 };
@@ -68,9 +83,11 @@ public:
 
 	virtual void startup() noexcept override;
 	virtual void closeup() noexcept override;
+	virtual void fixedUpdate(float deltaTime) noexcept override;
 	virtual void update() noexcept override;
     virtual void updateHUD() noexcept override;
 	virtual void render() noexcept override;
+	virtual bool isDone() const noexcept override;
 
 	virtual void keyboardCallback(uint32_t c, bool bPressed) noexcept override;
 	virtual void framesizeCallback(int32_t width, int32_t height) noexcept override;
@@ -84,14 +101,43 @@ private:
     glm::vec3 SunIlluminance();
     glm::vec3 SunLuminance();
     glm::vec3 SunLuminance(bool& cached);
+    void captureScreenshot() noexcept;
+    void captureTrace(uint32_t frameCount) noexcept;
+    void benchmarkRtti() noexcept;
+    bool updateBenchmark() noexcept;
+    glm::mat4 getRenderView() const noexcept;
 
     std::vector<glm::vec2> m_Samples;
     Skybox m_Skybox;
     SceneSettings m_Settings;
 	TCamera m_Camera;
+    glm::mat4 m_PrevCameraView;
+    glm::vec3 m_PrevCameraPosition;
+    bool m_bCameraUpdated = false;
+    bool m_bSkyBaking = false;
     GraphicsTexturePtr m_ScreenColorTex;
     GraphicsFramebufferPtr m_ColorRenderTarget;
     GraphicsDevicePtr m_Device;
+    FrameGraph m_FrameGraph;
+    ProgramCache m_ProgramCache;
+    TextureLoader m_TextureLoader;
+    AsyncReadback m_Readback;
+    OGLGpuTimer m_GpuTimer;
+    OGLOcclusionQuery m_SkyQuery;
+    bool m_bScreenshot = false;
+    uint32_t m_ScreenshotCount = 0;
+    uint32_t m_TraceCount = 0;
+    Benchmark m_Benchmark;
+    bool m_bBenchmarkStarted = false;
+    std::string m_BenchmarkOutput = "benchmark.csv";
+    JobCounter m_ScreenshotWrites;
+    FrameConstants m_FrameConstants;
+    Std140Writer m_FrameConstantsWriter;
+    GraphicsDataPtr m_FrameConstantsBuffer;
+    AnimationTrack<float> m_ExposureTrack;
+    AnimationTrack<float> m_KeyValueTrack;
+    float m_AnimationTime = 0.f;
+    int m_FrameRateLimit = 0;
 };
 
 CREATE_APPLICATION(ArHosekSky);
@@ -115,26 +161,142 @@ void ArHosekSky::startup() noexcept
 	m_Device = createDevice(deviceDesc);
 	assert(m_Device);
 
+    // Programs linked from here on are looked up in the binary cache first
+    if (m_ProgramCache.create("cache/programs"))
+        ProgramShader::setProgramCache(&m_ProgramCache);
+
     SampledSpectrum::initialize();
-	profiler::initialize();
+	profiler::initialize(m_GpuTimer.create() ? &m_GpuTimer : nullptr);
+    profiler::setThreadName("main");
+
+    // --trace-frames=N writes the first N frames as a trace
+    bool bBenchmarkRtti = false;
+    std::string skyCubemap;
+    for (auto& argument : getArguments())
+    {
+        // --bench-rtti times the type checks on the texture bind path, before and after
+        if (argument == "--bench-rtti")
+            bBenchmarkRtti = true;
+
+        uint32_t frameCount = 0;
+        if (sscanf(argument.c_str(), "--trace-frames=%u", &frameCount) == 1)
+            captureTrace(frameCount);
+
+        // --benchmark=<script> [--benchmark-output=<csv>], see Benchmark.h
+        const std::string benchmark = "--benchmark=", benchmarkOutput = "--benchmark-output=";
+        if (argument.compare(0, benchmark.size(), benchmark) == 0)
+            m_Benchmark.load(argument.substr(benchmark.size()));
+        else if (argument.compare(0, benchmarkOutput.size(), benchmarkOutput) == 0)
+            m_BenchmarkOutput = argument.substr(benchmarkOutput.size());
+
+        // --sky-cubemap=<file> draws a cubemap instead of the model, e.g. resources/cubemap.dds
+        const std::string cubemap = "--sky-cubemap=";
+        if (argument.compare(0, cubemap.size(), cubemap) == 0)
+            skyCubemap = argument.substr(cubemap.size());
+    }
+
+    // Unthrottled, and every frame is drawn; sky pixels are counted for the overdraw
+    if (m_Benchmark.isEnabled())
+    {
+        glfwSwapInterval(0);
+        m_Settings.bProfile = true;
+        m_SkyQuery.create();
+    }
+    m_Camera.setDepthZeroToOne(isDepthZeroToOne());
     postprocess::initialize(m_Device);
 
     m_Skybox.setDevice(m_Device);
     m_Skybox.create();
 
+    if (bBenchmarkRtti)
+        benchmarkRtti();
+
+    // Edited shaders are rebuilt while running; see ProgramManager::update
+    ProgramManager::instance().startWatching("shaders");
+
+    // Files are decoded on a worker and streamed in over several frames;
+    // the loader only runs when there is something to load
+    if (!skyCubemap.empty() && m_TextureLoader.initialize(m_Device))
+    {
+        gli::texture_cube black(gli::FORMAT_RGBA8_UNORM_PACK8, gli::extent2d(1, 1), 1);
+        black.clear(glm::u8vec4(0, 0, 0, 255));
+        m_Skybox.setEnvironment(m_TextureLoader.load(skyCubemap, m_Device->createTexture(black)));
+    }
+    m_Readback.initialize();
+
+    // Written once per frame and shared by every program including 'FrameConstants.glsli'
+    m_FrameConstants.write(m_FrameConstantsWriter);
+    GraphicsDataDesc constantsDesc(
+        GraphicsDataType::UniformBuffer,
+        GraphicsUsageFlagWriteBit | GraphicsUsageFlagDynamicStorageBit,
+        m_FrameConstantsWriter.getData(),
+        (uint32_t)m_FrameConstantsWriter.getSize());
+    m_FrameConstantsBuffer = m_Device->createGraphicsData(constantsDesc);
+    assert(m_FrameConstantsBuffer);
+
+    m_ExposureTrack.addKey(0.f, -16.f);
+    m_ExposureTrack.addKey(4.f, -14.f);
+    m_ExposureTrack.addKey(8.f, -18.f);
+    m_ExposureTrack.addKey(12.f, -16.f);
+    m_ExposureTrack.setInterpolation(AnimationInterpolationSmooth);
+
+    m_KeyValueTrack.addKey(0.f, 0.005f);
+    m_KeyValueTrack.addKey(6.f, 0.02f);
+    m_KeyValueTrack.addKey(12.f, 0.005f);
+    m_KeyValueTrack.setInterpolation(AnimationInterpolationSmooth);
+
     m_Camera.setFov(80.f);
 	m_Camera.setViewParams(glm::vec3(2.0f, 5.0f, 15.0f), glm::vec3(2.0f, 0.0f, 0.0f));
 	m_Camera.setMoveCoefficient(0.35f);
+    m_PrevCameraView = m_Camera.getViewMatrix();
+    m_PrevCameraPosition = m_Camera.getPosition();
 }
 
 void ArHosekSky::closeup() noexcept
 {
 	profiler::shutdown();
+    m_GpuTimer.destroy();
+    ProgramManager::instance().stopWatching();
+    ProgramManager::instance().clear();
+    m_TextureLoader.shutdown();
+    m_Readback.flush();
+    m_Readback.shutdown();
+    getJobSystem().wait(m_ScreenshotWrites);
+    ProgramShader::setProgramCache(nullptr);
+
+    if (m_Benchmark.isEnabled())
+        m_Benchmark.writeReport(m_BenchmarkOutput);
+}
+
+void ArHosekSky::fixedUpdate(float deltaTime) noexcept
+{
+    PROFILE_SCOPE("fixedUpdate");
+
+    // Movement and look speeds are per step, so independent of the frame rate
+    m_PrevCameraView = m_Camera.getViewMatrix();
+    m_PrevCameraPosition = m_Camera.getPosition();
+    m_bCameraUpdated |= m_Camera.update(deltaTime);
+
+    if (m_Settings.bAnimateExposure)
+        m_AnimationTime += deltaTime;
 }
 
 void ArHosekSky::update() noexcept
 {
-    bool bCameraUpdated = m_Camera.update();
+    PROFILE_SCOPE("update");
+
+    ProgramManager::instance().update();
+    // Frames are only drawn on changes, a finished upload is one
+    uint32_t texturesPending = m_TextureLoader.getPendingCount();
+    m_TextureLoader.update();
+    bool bTexturesLoaded = m_TextureLoader.getPendingCount() < texturesPending;
+    m_Readback.update();
+
+    // Moving cameras are drawn between steps, which changes every frame
+    bool bCameraUpdated = m_bCameraUpdated || m_PrevCameraView != m_Camera.getViewMatrix();
+    m_bCameraUpdated = false;
+    bool bBenchmarkUpdated = updateBenchmark();
+    bool bSkyBaked = m_bSkyBaking && !m_Skybox.isBaking();
 
     static int32_t preWidth = 0;
     static int32_t preHeight = 0;
@@ -147,7 +309,7 @@ void ArHosekSky::update() noexcept
         preWidth = width, preHeight = height;
         bResized = true;
     }
-    m_Settings.bUpdated = (m_Settings.bUiChanged || bCameraUpdated || bResized);
+    m_Settings.bUpdated = (m_Settings.bUiChanged || bCameraUpdated || bResized || bBenchmarkUpdated || bSkyBaked || bTexturesLoaded);
     if (m_Settings.bUpdated)
     {
         float angle = glm::radians(m_Settings.angle);
@@ -156,7 +318,7 @@ void ArHosekSky::update() noexcept
         SkyboxParam param;
         param.groundAlbedo = m_Settings.groundAlbedo;
         param.position = m_Camera.getPosition();
-        param.view = m_Camera.getViewMatrix();
+        param.view = getRenderView();
         param.projection = m_Camera.getProjectionMatrix();
         param.turbidity = m_Settings.turbidity;
         param.sunDir = normalize(sunDir);
@@ -164,8 +326,36 @@ void ArHosekSky::update() noexcept
 
         m_Skybox.update(param);
     }
+    m_bSkyBaking = m_Skybox.isBaking();
+
+    const tonemap::LutType lutTypes[] = { tonemap::LutType1D, tonemap::LutType3D, tonemap::LutType3D };
+    const uint32_t lutSizes[] = { 256, 32, 64 };
+    postprocess::setToneMapping(
+        (tonemap::ToneMapOperator)m_Settings.toneMapOperator,
+        lutTypes[m_Settings.toneMapLut],
+        lutSizes[m_Settings.toneMapLut]);
+
+    auto& constants = m_FrameConstants;
+    constants.view = getRenderView();
+    constants.projection = m_Camera.getProjectionMatrix();
+    constants.sunDir = m_Skybox.getSunDir();
+    constants.sunColor = SunLuminance();
+    constants.cosSunAngularRadius = std::cos(glm::radians(m_Settings.sunSize));
+    constants.bEnableSun = m_Settings.bEnableSun;
+    const int32_t exposureModes[] = { 0, 3 };
+    constants.exposureMode = exposureModes[m_Settings.exposureMode];
+    constants.exposure = m_Settings.exposure;
+    constants.keyValue = m_Settings.keyValue;
+    if (m_Settings.bAnimateExposure)
+    {
+        constants.exposure = m_ExposureTrack.evaluate(m_AnimationTime);
+        constants.keyValue = m_KeyValueTrack.evaluate(m_AnimationTime);
+    }
+    postprocess::update(constants);
 
-    postprocess::update(m_Settings.exposure);
+    // Single upload for all the programs of the frame
+    constants.write(m_FrameConstantsWriter);
+    m_FrameConstantsBuffer->update(0, m_FrameConstantsWriter.getSize(), (void*)m_FrameConstantsWriter.getData());
 }
 
 void ArHosekSky::updateHUD() noexcept
@@ -185,10 +375,60 @@ void ArHosekSky::updateHUD() noexcept
     bUpdated |= ImGui::SliderFloat("Sun Angle", &m_Settings.angle, 0.f, 120.f);
     bUpdated |= ImGui::SliderFloat("Sun Size", &m_Settings.sunSize, 0.01f, 120.f);
     bUpdated |= ImGui::SliderFloat("Turbidity", &m_Settings.turbidity, 1.f, 10.f);
+    bUpdated |= ImGui::Combo("Exposure Mode", &m_Settings.exposureMode, "Manual\0Automatic\0\0");
     bUpdated |= ImGui::SliderFloat("Exposure", &m_Settings.exposure, -20.f, -12.f);
+    bUpdated |= ImGui::SliderFloat("Key Value", &m_Settings.keyValue, 0.001f, 0.5f, "%.4f", 3.f);
+    bUpdated |= ImGui::Checkbox("Animate Exposure", &m_Settings.bAnimateExposure);
+    bUpdated |= ImGui::Combo("Tone Mapping", &m_Settings.toneMapOperator, "ACES\0Reinhard\0Hable\0\0");
+    bUpdated |= ImGui::Combo("Tone Map LUT", &m_Settings.toneMapLut, "1D 256\0" "3D 32\0" "3D 64\0\0");
     ImGui::ColorWheel("Ground albedo", glm::value_ptr<float>(m_Settings.groundAlbedo), 12.f);
-    ImGui::Text("CPU %s: %10.5f ms\n", "main", s_CpuTick);
-    ImGui::Text("GPU %s: %10.5f ms\n", "main", s_GpuTick);
+    if (ImGui::CollapsingHeader("Frame Pacing"))
+    {
+        // 0 leaves it to vsync
+        if (ImGui::SliderInt("FPS Limit", &m_FrameRateLimit, 0, 240))
+            getFramePacer().setFrameRateLimit(m_FrameRateLimit);
+
+        auto stats = getFramePacer().getStats();
+        ImGui::Text("%.1f fps, step %.2f ms\n", stats.fps, getFramePacer().getFixedDelta() * 1000.0);
+        ImGui::Text("Frame %7.3f %7.3f %7.3f %7.3f ms\n", stats.avg, stats.min, stats.max, stats.p99);
+        if (m_Skybox.isBaking())
+            ImGui::Text("Baking sky\n");
+    }
+    if (ImGui::CollapsingHeader("Profiler"))
+    {
+        // avg / min / max / p99 over the recorded frames
+        for (auto& zone : profiler::getReport())
+        {
+            ImGui::Text("%*s%s (%u)\n", zone.depth * 2, "", zone.name.c_str(), zone.calls);
+            ImGui::Text("%*s  CPU %7.3f %7.3f %7.3f %7.3f ms\n", zone.depth * 2, "",
+                zone.cpu.avg, zone.cpu.min, zone.cpu.max, zone.cpu.p99);
+            if (zone.bGpu)
+                ImGui::Text("%*s  GPU %7.3f %7.3f %7.3f %7.3f ms\n", zone.depth * 2, "",
+                    zone.gpu.avg, zone.gpu.min, zone.gpu.max, zone.gpu.p99);
+        }
+    }
+    if (ImGui::CollapsingHeader("Frame Graph"))
+    {
+        // CPU time to submit each pass; their GPU time is under 'Profiler'
+        for (auto& pass : m_FrameGraph.getReport())
+        {
+            if (pass.bCulled)
+                ImGui::Text("%s: culled\n", pass.name.c_str());
+            else
+                ImGui::Text("%s: %10.5f ms submit\n", pass.name.c_str(), pass.submitTime);
+        }
+        ImGui::Text("Transient: %zu KB (unaliased %zu KB)\n",
+            m_FrameGraph.getTransientMemory() / 1024,
+            m_FrameGraph.getUnaliasedMemory() / 1024);
+    }
+    if (ImGui::CollapsingHeader("Render State"))
+    {
+        // GL calls made and skipped as redundant by the device over the last frame
+        static const char* names[RenderStateCallCount] = { "Enable", "Program", "Texture", "Framebuffer" };
+        auto& stats = m_Device->downcast<OGLDevice>()->getRenderStateStats();
+        for (uint32_t i = 0; i < RenderStateCallCount; i++)
+            ImGui::Text("%-12s %4u issued %4u redundant\n", names[i], stats.issued[i], stats.redundant[i]);
+    }
     ImGui::PushItemWidth(180.0f);
     ImGui::Indent();
     ImGui::Unindent();
@@ -201,29 +441,236 @@ void ArHosekSky::render() noexcept
 {
     bool bUpdate = m_Settings.bProfile || m_Settings.bUpdated;
 
-    profiler::start(ProfilerTypeRender);
+    PROFILE_GPU_SCOPE("render");
+
+    m_Device->downcast<OGLDevice>()->beginFrame();
+
+    m_FrameGraph.reset();
+    auto sceneColor = m_FrameGraph.importTexture("SceneColor", m_ScreenColorTex);
     if (bUpdate)
     {
-        auto& desc = m_ScreenColorTex->getGraphicsTextureDesc();
-        m_Device->setFramebuffer(m_ColorRenderTarget);
-        GLenum clearFlag = GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT;
-        glViewport(0, 0, desc.getWidth(), desc.getHeight());
-        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
-        glClearDepthf(1.0f);
-        glClear(clearFlag);
-
-        m_Skybox.render(
-            m_Settings.bEnableSun,
-            m_Settings.sunSize,
-            SunLuminance(),
-            m_Camera.getViewMatrix(),
-            m_Camera.getProjectionMatrix());
+        // Opaque geometry goes here, before the sky fills what it left uncovered
+        m_FrameGraph.addPass("Scene",
+            [&](FrameGraphBuilder& builder) {
+                sceneColor = builder.write(sceneColor);
+            },
+            [this](const FrameGraphResources&) {
+                auto& desc = m_ScreenColorTex->getGraphicsTextureDesc();
+                m_Device->setFramebuffer(m_ColorRenderTarget);
+                GLenum clearFlag = GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT;
+                glViewport(0, 0, desc.getWidth(), desc.getHeight());
+                glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+                // Reverse-Z, 0 is infinitely far
+                glClearDepthf(0.0f);
+                glClear(clearFlag);
+            });
+        m_FrameGraph.addPass("Skybox",
+            [&](FrameGraphBuilder& builder) {
+                sceneColor = builder.write(sceneColor);
+            },
+            [this](const FrameGraphResources&) {
+                auto& desc = m_ScreenColorTex->getGraphicsTextureDesc();
+                m_Device->setFramebuffer(m_ColorRenderTarget);
+                glViewport(0, 0, desc.getWidth(), desc.getHeight());
+
+                m_SkyQuery.begin();
+                m_Skybox.render(m_FrameConstantsBuffer);
+                m_SkyQuery.end();
+            });
+    }
+    postprocess::render(m_FrameGraph, sceneColor, m_FrameConstantsBuffer);
+
+    m_FrameGraph.compile();
+    m_FrameGraph.execute(m_Device);
+
+    // Before the HUD is drawn on top
+    if (m_bScreenshot)
+        captureScreenshot();
+}
+
+void ArHosekSky::captureScreenshot() noexcept
+{
+    m_bScreenshot = false;
+
+    char filename[64];
+    snprintf(filename, sizeof(filename), "screenshot_%04u.png", m_ScreenshotCount++);
+
+    // Pixels arrive a frame or two later; encoding runs off the render thread.
+    // Read from the back buffer, bound through the device so its cache stays right
+    std::string name = filename;
+    m_Device->setFramebuffer(nullptr);
+    m_Readback.readFramebuffer(0, 0, getFrameWidth(), getFrameHeight(), [this, name](const ReadbackImage& image) {
+        const std::size_t stride = image.width * 4;
+        std::vector<uint8_t> pixels(image.size);
+        for (uint32_t y = 0; y < image.height; y++)
+            std::memcpy(&pixels[y * stride], image.data + (image.height - y - 1) * stride, stride);
+
+        uint32_t width = image.width, height = image.height;
+        getJobSystem().run([name, width, height, pixels]() {
+            if (stbi_write_png(name.c_str(), width, height, 4, pixels.data(), width * 4))
+                LOG_INFO("ArHosekSky : saved %s\n", name);
+            else
+                LOG_WARNING("ArHosekSky : failed to save %s\n", name);
+        }, &m_ScreenshotWrites);
+    });
+}
+
+glm::mat4 ArHosekSky::getRenderView() const noexcept
+{
+    // Scripted cameras are placed per frame, not stepped
+    if (m_Benchmark.isEnabled())
+        return m_Camera.getViewMatrix();
+
+    float alpha = getFramePacer().getAlpha();
+    glm::quat rotation = glm::slerp(
+        glm::quat_cast(glm::mat3(m_PrevCameraView)),
+        glm::quat_cast(glm::mat3(m_Camera.getViewMatrix())),
+        alpha);
+    glm::vec3 position = glm::mix(m_PrevCameraPosition, m_Camera.getPosition(), alpha);
+
+    glm::mat4 view = glm::mat4_cast(rotation);
+    view[3] = glm::vec4(-(glm::mat3(view) * position), 1.f);
+    return view;
+}
+
+bool ArHosekSky::isDone() const noexcept
+{
+    if (m_Benchmark.isEnabled() && m_Benchmark.isFinished())
+        return false;
+    return IGameApp::isDone();
+}
+
+bool ArHosekSky::updateBenchmark() noexcept
+{
+    if (!m_Benchmark.isEnabled() || m_Benchmark.isFinished())
+        return false;
+
+    // Timings of the frame the profiler just closed; GPU times trail by the timer latency
+    if (m_bBenchmarkStarted)
+    {
+        float cpuTime = 0.f, gpuTime = 0.f;
+        for (auto& zone : profiler::getReport())
+        {
+            if (zone.depth == 0)
+                cpuTime = zone.cpu.last;
+            else if (zone.depth == 1 && zone.name == "render")
+                gpuTime = zone.gpu.last;
+        }
+        // Share of the pixels the sky shaded; all of them before it was depth tested
+        uint64_t skySamples = 0;
+        float skyShaded = 0.f;
+        if (m_SkyQuery.getResult(skySamples))
+            skyShaded = float(skySamples) / (getFrameWidth() * getFrameHeight());
+        m_Benchmark.addFrame(cpuTime, gpuTime, skyShaded);
+    }
+    m_bBenchmarkStarted = true;
+
+    m_Settings.angle = m_Benchmark.evaluate("angle", m_Settings.angle);
+    m_Settings.turbidity = m_Benchmark.evaluate("turbidity", m_Settings.turbidity);
+    m_Settings.sunSize = m_Benchmark.evaluate("sunSize", m_Settings.sunSize);
+    m_Settings.exposure = m_Benchmark.evaluate("exposure", m_Settings.exposure);
+    m_Settings.keyValue = m_Benchmark.evaluate("keyValue", m_Settings.keyValue);
+    m_Settings.groundAlbedo = m_Benchmark.evaluate("groundAlbedo", m_Settings.groundAlbedo);
+    if (m_Benchmark.hasTrack("eye") || m_Benchmark.hasTrack("target"))
+    {
+        glm::vec3 eye = m_Benchmark.evaluate("eye", m_Camera.getPosition());
+        glm::vec3 target = m_Benchmark.evaluate("target", m_Camera.getTarget());
+        m_Camera.setViewParams(eye, target);
     }
-    postprocess::render(m_ScreenColorTex);
+    return true;
+}
+
+void ArHosekSky::captureTrace(uint32_t frameCount) noexcept
+{
+    char filename[64];
+    snprintf(filename, sizeof(filename), "trace_%04u.json", m_TraceCount);
+    if (profiler::captureTrace(filename, frameCount))
+    {
+        m_TraceCount++;
+        LOG_INFO("ArHosekSky : tracing %u frames to %s\n", frameCount, filename);
+    }
+}
 
-    profiler::stop(ProfilerTypeRender);
-    profiler::tick(ProfilerTypeRender, s_CpuTick, s_GpuTick);
+void ArHosekSky::benchmarkRtti() noexcept
+{
+    const uint32_t iterations = 1000000;
+
+    GraphicsTextureDesc desc;
+    desc.setWidth(4);
+    desc.setHeight(4);
+    desc.setFormat(gli::FORMAT_RGBA8_UNORM_PACK8);
+    GraphicsTexturePtr texture = m_Device->createTexture(desc);
+    assert(texture);
+    if (!texture->isA<OGLCoreTexture>())
+    {
+        LOG_WARNING("ArHosekSky : --bench-rtti needs the OpenGL core device\n");
+        return;
+    }
 
+    auto shader = std::make_shared<ProgramShader>();
+    shader->setDevice(m_Device);
+    shader->create();
+    shader->addShader(GL_VERTEX_SHADER, "BlitTexture.Vertex");
+    shader->addShader(GL_FRAGMENT_SHADER, "BlitTexture.Fragment");
+    shader->link();
+    UniformHandle handle = shader->getUniformHandle("uTexSource");
+    shader->bind();
+
+    // The sink keeps the loops from being folded away
+    volatile uintptr_t sink = 0;
+    auto measure = [&](const char* name, const std::function<void()>& func) {
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < iterations; i++)
+            func();
+        auto end = std::chrono::steady_clock::now();
+        double ns = std::chrono::duration<double, std::nano>(end - start).count();
+        printf("ArHosekSky : %-24s %7.2f ns/op\n", name, ns / iterations);
+    };
+    // The checks as they were before the compile-time type ids, kept as the baseline:
+    // a walk up the parents, by pointer or by name, and a dynamic cast to downcast
+    auto legacyIsA = [](const rtti::Rtti* type, const rtti::Rtti* other) {
+        for (; type; type = type->getParent())
+        {
+            if (type == other)
+                return true;
+        }
+        return false;
+    };
+    auto legacyIsAByName = [](const rtti::Rtti* type, const std::string& name) {
+        for (; type; type = type->getParent())
+        {
+            if (name == type->getName())
+                return true;
+        }
+        return false;
+    };
+    auto legacyDowncast = [&](const GraphicsTexturePtr& source) {
+        assert(legacyIsA(source->rtti(), OGLCoreTexture::getRtti()));
+        return std::dynamic_pointer_cast<OGLCoreTexture>(source);
+    };
+    const std::string typeName = OGLCoreTexture::getRtti()->getName();
+    GraphicsDeviceWeakPtr weakDevice = m_Device;
+
+    measure("legacy isA", [&] { sink += legacyIsA(texture->rtti(), OGLCoreTexture::getRtti()); });
+    measure("legacy isA by name", [&] { sink += legacyIsAByName(texture->rtti(), typeName); });
+    measure("legacy downcast_pointer", [&] { sink += (uintptr_t)legacyDowncast(texture).get(); });
+    // Looked the uniform and the device up on every call
+    measure("legacy bindTexture", [&] {
+        GLint location = glGetUniformLocation(shader->getShaderID(), "uTexSource");
+        auto device = weakDevice.lock();
+        if (device->getGraphicsDeviceDesc().getDeviceType() == GraphicsDeviceType::GraphicsDeviceTypeOpenGLCore)
+            legacyDowncast(texture)->bind(0);
+        glUniform1i(location, 0);
+    });
+
+    measure("isA", [&] { sink += texture->isA<OGLCoreTexture>(); });
+    measure("downcast", [&] { sink += (uintptr_t)texture->downcast<OGLCoreTexture>(); });
+    measure("downcast_pointer", [&] { sink += (uintptr_t)texture->downcast_pointer<OGLCoreTexture>().get(); });
+    measure("dynamic_pointer_cast", [&] { sink += (uintptr_t)std::dynamic_pointer_cast<OGLCoreTexture>(texture).get(); });
+    measure("ProgramShader::bindTexture", [&] { shader->bindTexture(handle, texture, 0); });
+
+    shader->unbind();
+    shader->destroy();
 }
 
 void ArHosekSky::keyboardCallback(uint32_t key, bool isPressed) noexcept
@@ -245,13 +692,21 @@ void ArHosekSky::keyboardCallback(uint32_t key, bool isPressed) noexcept
 	case GLFW_KEY_RIGHT:
 		m_Camera.keyboardHandler(MOVE_RIGHT, isPressed);
 		break;
+
+	case GLFW_KEY_F11:
+		if (isPressed) captureTrace(30);
+		break;
+
+	case GLFW_KEY_F12:
+		if (isPressed) m_bScreenshot = true;
+		break;
 	}
 }
 
 void ArHosekSky::framesizeCallback(int32_t width, int32_t height) noexcept
 {
 	float aspectRatio = (float)width/height;
-	m_Camera.setProjectionParams(45.0f, aspectRatio, 0.1f, 100.0f);
+	m_Camera.setProjectionParams(45.0f, aspectRatio, 0.1f);
 
     GraphicsTextureDesc colorDesc;
     colorDesc.setWidth(width);
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <glm/glm.hpp>
+
+enum AnimationInterpolation
+{
+    AnimationInterpolationStep = 0,
+    AnimationInterpolationLinear,
+    AnimationInterpolationSmooth,
+};
+
+// Keyframe track evaluated on the CPU; 'T' needs glm::mix
+template<typename T>
+class AnimationTrack final
+{
+public:
+
+    AnimationTrack() noexcept
+        : m_Interpolation(AnimationInterpolationLinear)
+        , m_bLoop(true)
+    {
+    }
+
+    void clear() noexcept
+    {
+        m_Keys.clear();
+    }
+
+    // Keys are kept sorted by time
+    void addKey(float time, const T& value)
+    {
+        Key key = { time, value };
+        auto it = std::upper_bound(m_Keys.begin(), m_Keys.end(), time,
+            [](float t, const Key& k) { return t < k.time; });
+        m_Keys.insert(it, key);
+    }
+
+    void setInterpolation(AnimationInterpolation interpolation) noexcept
+    {
+        m_Interpolation = interpolation;
+    }
+
+    void setLoop(bool bLoop) noexcept
+    {
+        m_bLoop = bLoop;
+    }
+
+    bool empty() const noexcept
+    {
+        return m_Keys.empty();
+    }
+
+    float getDuration() const noexcept
+    {
+        return m_Keys.empty() ? 0.f : m_Keys.back().time - m_Keys.front().time;
+    }
+
+    T evaluate(float time) const noexcept
+    {
+        if (m_Keys.empty())
+            return T();
+        if (m_Keys.size() == 1)
+            return m_Keys.front().value;
+
+        float start = m_Keys.front().time;
+        float duration = getDuration();
+        if (m_bLoop && duration > 0.f)
+            time = start + std::fmod(std::fmod(time - start, duration) + duration, duration);
+
+        if (time <= start)
+            return m_Keys.front().value;
+        if (time >= m_Keys.back().time)
+            return m_Keys.back().value;
+
+        auto next = std::upper_bound(m_Keys.begin(), m_Keys.end(), time,
+            [](float t, const Key& k) { return t < k.time; });
+        auto prev = next - 1;
+
+        if (m_Interpolation == AnimationInterpolationStep)
+            return prev->value;
+
+        float t = (time - prev->time) / (next->time - prev->time);
+        if (m_Interpolation == AnimationInterpolationSmooth)
+            t = t * t * (3.f - 2.f * t);
+        return glm::mix(prev->value, next->value, t);
+    }
+
+private:
+
+    struct Key
+    {
+        float time;
+        T value;
+    };
+
+    std::vector<Key> m_Keys;
+    AnimationInterpolation m_Interpolation;
+    bool m_bLoop;
+};
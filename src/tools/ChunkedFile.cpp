@@ -0,0 +1,263 @@
+#include <tools/ChunkedFile.h>
+
+#include <zlib.h>
+#include <atomic>
+#include <cstring>
+#include <algorithm>
+#include <tools/JobSystem.h>
+
+namespace
+{
+    const char Magic[4] = { 'Z', 'C', 'H', 'K' };
+    const std::uint32_t Version = 1;
+    const std::size_t HeaderSize = 24;
+    const std::size_t EntrySize = 16;
+
+    template<typename T>
+    void put(char*& dst, const T& value) noexcept
+    {
+        std::memcpy(dst, &value, sizeof(T));
+        dst += sizeof(T);
+    }
+
+    template<typename T>
+    T get(const char*& src) noexcept
+    {
+        T value;
+        std::memcpy(&value, src, sizeof(T));
+        src += sizeof(T);
+        return value;
+    }
+}
+
+bool ChunkedFile::isChunked(const char* data, std::size_t size) noexcept
+{
+    return data != nullptr && size >= HeaderSize && std::memcmp(data, Magic, sizeof(Magic)) == 0;
+}
+
+util::BytesArray ChunkedFile::compress(const char* data, std::size_t size, std::uint32_t chunkSize, std::int32_t level)
+{
+    if (chunkSize == 0)
+        return util::NullFile;
+
+    const std::uint32_t chunkCount = static_cast<std::uint32_t>((size + chunkSize - 1) / chunkSize);
+
+    // Every block is deflated into its own buffer, then the blocks are packed behind the index
+    std::vector<std::vector<char>> blocks(chunkCount);
+    std::atomic<bool> bFailed(false);
+    JobSystem::instance().parallel_for(chunkCount, 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++)
+        {
+            std::size_t plainSize = std::min<std::size_t>(chunkSize, size - std::size_t(i) * chunkSize);
+            uLongf compressedSize = compressBound(static_cast<uLong>(plainSize));
+            blocks[i].resize(compressedSize);
+            int err = compress2(reinterpret_cast<Bytef*>(blocks[i].data()), &compressedSize,
+                reinterpret_cast<const Bytef*>(data + std::size_t(i) * chunkSize), static_cast<uLong>(plainSize), level);
+            if (err != Z_OK)
+                bFailed = true;
+            blocks[i].resize(compressedSize);
+        }
+    });
+    if (bFailed)
+        return util::NullFile;
+
+    std::size_t total = HeaderSize + EntrySize * chunkCount;
+    for (auto& block : blocks)
+        total += block.size();
+
+    auto bytesArray = std::make_shared<util::FileContainer>(total);
+    char* dst = bytesArray->data();
+    std::memcpy(dst, Magic, sizeof(Magic));
+    dst += sizeof(Magic);
+    put(dst, Version);
+    put(dst, chunkSize);
+    put(dst, chunkCount);
+    put(dst, std::uint64_t(size));
+
+    std::uint64_t offset = HeaderSize + EntrySize * chunkCount;
+    for (uint32_t i = 0; i < chunkCount; i++)
+    {
+        put(dst, offset);
+        put(dst, std::uint32_t(blocks[i].size()));
+        put(dst, std::uint32_t(std::min<std::size_t>(chunkSize, size - std::size_t(i) * chunkSize)));
+        offset += blocks[i].size();
+    }
+    for (auto& block : blocks)
+    {
+        std::memcpy(dst, block.data(), block.size());
+        dst += block.size();
+    }
+    return bytesArray;
+}
+
+util::BytesArray ChunkedFile::decompress(const char* data, std::size_t size)
+{
+    Header header;
+    if (!parseHeader(data, size, header))
+        return util::NullFile;
+
+    // Block offsets in the output follow from the fixed chunk size
+    auto bytesArray = std::make_shared<util::FileContainer>(header.plainSize);
+    std::atomic<bool> bFailed(false);
+    JobSystem::instance().parallel_for((uint32_t)header.entries.size(), 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++)
+        {
+            char* dst = bytesArray->data() + std::uint64_t(i) * header.chunkSize;
+            if (!inflateChunk(data, header.entries[i], dst))
+                bFailed = true;
+        }
+    });
+    if (bFailed)
+        return util::NullFile;
+    return bytesArray;
+}
+
+bool ChunkedFile::parseHeader(const char* data, std::size_t size, Header& header) noexcept
+{
+    if (!isChunked(data, size))
+        return false;
+
+    const char* src = data + sizeof(Magic);
+    if (get<std::uint32_t>(src) != Version)
+        return false;
+    header.chunkSize = get<std::uint32_t>(src);
+    std::uint32_t chunkCount = get<std::uint32_t>(src);
+    header.plainSize = get<std::uint64_t>(src);
+
+    if (header.chunkSize == 0 || std::uint64_t(chunkCount) * EntrySize > size - HeaderSize)
+        return false;
+    // Rounded up without adding to 'plainSize', which may be close to its maximum
+    if (chunkCount != header.plainSize / header.chunkSize + (header.plainSize % header.chunkSize != 0))
+        return false;
+
+    // Blocks are inflated at multiples of the chunk size, so only the last may be short
+    header.entries.resize(chunkCount);
+    for (std::uint32_t i = 0; i < chunkCount; i++)
+    {
+        auto& entry = header.entries[i];
+        entry.offset = get<std::uint64_t>(src);
+        entry.compressedSize = get<std::uint32_t>(src);
+        entry.plainSize = get<std::uint32_t>(src);
+        if (entry.offset > size || entry.compressedSize > size - entry.offset)
+            return false;
+        if (entry.plainSize != std::min<std::uint64_t>(header.chunkSize, header.plainSize - std::uint64_t(i) * header.chunkSize))
+            return false;
+    }
+    return true;
+}
+
+bool ChunkedFile::inflateChunk(const char* data, const Entry& entry, char* dst) noexcept
+{
+    uLongf plainSize = entry.plainSize;
+    int err = uncompress(reinterpret_cast<Bytef*>(dst), &plainSize,
+        reinterpret_cast<const Bytef*>(data + entry.offset), entry.compressedSize);
+    return err == Z_OK && plainSize == entry.plainSize;
+}
+
+ChunkedFile::ChunkedFile() noexcept
+    : m_ChunkIndex(-1)
+    , m_Position(0)
+{
+}
+
+ChunkedFile::~ChunkedFile() noexcept
+{
+}
+
+bool ChunkedFile::open(const std::string& filename)
+{
+    close();
+
+    if (!m_File.open(filename))
+        return false;
+    if (!parseHeader(m_File.data(), m_File.size(), m_Header))
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void ChunkedFile::close() noexcept
+{
+    m_File.close();
+    m_Header = Header();
+    m_Chunk.clear();
+    m_ChunkIndex = -1;
+    m_Position = 0;
+}
+
+bool ChunkedFile::isOpen() const noexcept
+{
+    return m_File.isOpen();
+}
+
+std::uint64_t ChunkedFile::getSize() const noexcept
+{
+    return m_Header.plainSize;
+}
+
+std::uint32_t ChunkedFile::getChunkCount() const noexcept
+{
+    return static_cast<std::uint32_t>(m_Header.entries.size());
+}
+
+std::size_t ChunkedFile::read(void* buffer, std::size_t size)
+{
+    std::size_t count = readAt(m_Position, buffer, size);
+    m_Position += count;
+    return count;
+}
+
+bool ChunkedFile::seek(std::uint64_t position) noexcept
+{
+    if (position > m_Header.plainSize)
+        return false;
+    m_Position = position;
+    return true;
+}
+
+std::uint64_t ChunkedFile::tell() const noexcept
+{
+    return m_Position;
+}
+
+std::size_t ChunkedFile::readAt(std::uint64_t offset, void* buffer, std::size_t size)
+{
+    if (!isOpen() || offset >= m_Header.plainSize)
+        return 0;
+
+    size = static_cast<std::size_t>(std::min<std::uint64_t>(size, m_Header.plainSize - offset));
+
+    auto dst = static_cast<char*>(buffer);
+    std::size_t count = 0;
+    while (count < size)
+    {
+        std::uint64_t position = offset + count;
+        auto index = static_cast<std::uint32_t>(position / m_Header.chunkSize);
+        if (!loadChunk(index))
+            break;
+
+        std::size_t begin = static_cast<std::size_t>(position - std::uint64_t(index) * m_Header.chunkSize);
+        std::size_t length = std::min(size - count, m_Chunk.size() - begin);
+        std::memcpy(dst + count, m_Chunk.data() + begin, length);
+        count += length;
+    }
+    return count;
+}
+
+bool ChunkedFile::loadChunk(std::uint32_t index)
+{
+    if (m_ChunkIndex == index)
+        return true;
+
+    const Entry& entry = m_Header.entries[index];
+    m_Chunk.resize(entry.plainSize);
+    if (!inflateChunk(m_File.data(), entry, m_Chunk.data()))
+    {
+        m_ChunkIndex = -1;
+        return false;
+    }
+    m_ChunkIndex = index;
+    return true;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <tools/FileUtility.h>
+#include <tools/MappedFile.h>
+
+// Container of independently deflated blocks behind an offset index, so blocks
+// are compressed and inflated in parallel and any byte range is reachable without
+// inflating what precedes it. Layout, little endian:
+//   "ZCHK", version, chunk size, chunk count, plain size (u64)
+//   chunk count x { offset (u64), compressed size (u32), plain size (u32) }
+//   zlib streams
+class ChunkedFile final
+{
+public:
+
+    static const std::uint32_t DefaultChunkSize = 1 << 20;
+
+    static bool isChunked(const char* data, std::size_t size) noexcept;
+
+    // 'level' is a zlib level, -1 picks its default
+    static util::BytesArray compress(const char* data, std::size_t size, std::uint32_t chunkSize = DefaultChunkSize, std::int32_t level = -1);
+    static util::BytesArray decompress(const char* data, std::size_t size);
+
+    ChunkedFile() noexcept;
+    ~ChunkedFile() noexcept;
+
+    // Reads from a mapped file, inflating one block at a time
+    bool open(const std::string& filename);
+    void close() noexcept;
+    bool isOpen() const noexcept;
+
+    std::uint64_t getSize() const noexcept;
+    std::uint32_t getChunkCount() const noexcept;
+
+    // Sequential reads from the current position; returns the bytes read
+    std::size_t read(void* buffer, std::size_t size);
+    bool seek(std::uint64_t position) noexcept;
+    std::uint64_t tell() const noexcept;
+
+    // Random access, leaves the read position alone
+    std::size_t readAt(std::uint64_t offset, void* buffer, std::size_t size);
+
+private:
+
+    struct Entry
+    {
+        std::uint64_t offset;
+        std::uint32_t compressedSize;
+        std::uint32_t plainSize;
+    };
+
+    struct Header
+    {
+        std::uint32_t chunkSize;
+        std::uint64_t plainSize;
+        std::vector<Entry> entries;
+    };
+
+    static bool parseHeader(const char* data, std::size_t size, Header& header) noexcept;
+    static bool inflateChunk(const char* data, const Entry& entry, char* dst) noexcept;
+
+    bool loadChunk(std::uint32_t index);
+
+    ChunkedFile(const ChunkedFile&) = delete;
+    ChunkedFile& operator=(const ChunkedFile&) = delete;
+
+    MappedFile m_File;
+    Header m_Header;
+    std::vector<char> m_Chunk;
+    std::int64_t m_ChunkIndex;
+    std::uint64_t m_Position;
+};
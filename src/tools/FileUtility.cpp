@@ -1,6 +1,12 @@
 #include <fstream>
 #include <tools/FileUtility.h>
+#include <tools/MappedFile.h>
+#include <tools/ChunkedFile.h>
+#include <tools/Logger.hpp>
 #include <zlib.h>
+#include <limits>
+#include <cstring>
+#include <cstdio>
 #include <algorithm>
 
 using namespace util;
@@ -11,17 +17,10 @@ namespace util
 
     BytesArray ReadFileSync(const std::string& fileName)
     {
-        std::ifstream inputFile;
-        inputFile.open(fileName, std::ios::binary | std::ios::ate);
-        if(!inputFile.is_open())
+        MappedFile file(fileName);
+        if (!file.isOpen())
             return NullFile;
-        auto filesize = static_cast<size_t>(inputFile.tellg());
-        BytesArray buf = std::make_shared<FileContainer>(filesize * sizeof(char));
-        inputFile.ignore(std::numeric_limits<std::streamsize>::max());
-        inputFile.seekg(std::ios::beg);
-        inputFile.read(reinterpret_cast<char*>(buf->data()), filesize);
-        inputFile.close();
-        return buf;
+        return std::make_shared<FileContainer>(file.data(), file.data() + file.size());
     }
 
     bool WriteFileSync(const std::string& fileName, const BytesArray& plainSource)
@@ -37,26 +36,45 @@ namespace util
         return true;
     }
 
-    BytesArray inflate(const BytesArray& compressedSource, int32_t& errnum, std::uint32_t chunkSize = 0x100000)
+    // The gzip trailer stores the plain size; zlib streams have none, so guess and grow
+    std::size_t getInflatedSize(const Bytef* data, std::size_t size)
     {
-        // Create a dynamic buffer to hold compressed blocks
-        std::vector<std::unique_ptr<Bytef>> blocks;
+        const std::size_t gzipHeaderSize = 10, gzipTrailerSize = 8;
+        if (size >= gzipHeaderSize + gzipTrailerSize && data[0] == 0x1f && data[1] == 0x8b)
+        {
+            const Bytef* isize = data + size - 4;
+            std::uint32_t plainSize = isize[0] | (isize[1] << 8) | (isize[2] << 16) | (std::uint32_t(isize[3]) << 24);
+            if (plainSize > 0)
+                return plainSize;
+        }
+        return std::max<std::size_t>(size * 4, 0x10000);
+    }
+
+    // Inflates straight into the output buffer, sized up front when the stream tells how
+    BytesArray inflate(const void* source, std::size_t sourceSize, int32_t& errnum)
+    {
+        auto compressed = static_cast<const Bytef*>(source);
+        BytesArray bytesArray = std::make_shared<FileContainer>(getInflatedSize(compressed, sourceSize));
 
         z_stream stream = { 0, };
         stream.data_type = Z_BINARY;
-        stream.total_in = compressedSource->size();
-        stream.avail_in = compressedSource->size();
-        stream.next_in = (Bytef*)compressedSource->data();
+        stream.avail_in = static_cast<uInt>(sourceSize);
+        stream.next_in = const_cast<Bytef*>(compressed);
 
         // 15 window bits, and the +32 tells zlib to to detect if using gzip or zlib
         errnum = inflateInit2(&stream, (15 + 32));
 
         while (errnum == Z_OK || errnum == Z_BUF_ERROR)
         {
-            stream.avail_out = chunkSize;
-            stream.next_out = new Bytef[chunkSize];
-            blocks.emplace_back(stream.next_out);
+            if (stream.total_out == bytesArray->size())
+                bytesArray->resize(bytesArray->size() + std::max<std::size_t>(bytesArray->size() / 2, 0x10000));
+            stream.next_out = reinterpret_cast<Bytef*>(bytesArray->data()) + stream.total_out;
+            stream.avail_out = static_cast<uInt>(bytesArray->size() - stream.total_out);
             errnum = inflate(&stream, Z_NO_FLUSH);
+
+            // Truncated input, no more progress possible
+            if (errnum == Z_BUF_ERROR && stream.avail_in == 0)
+                break;
         }
 
         if (errnum != Z_STREAM_END)
@@ -66,81 +84,35 @@ namespace util
         }
 
         assert(stream.total_out > 0);
-
-        BytesArray bytesArray = std::make_shared<FileContainer>(stream.total_out);
-
-        void* curDest = bytesArray->data();
-        size_t remaining = bytesArray->size();
-
-        for (size_t i = 0; i < blocks.size(); i++)
-        {
-            assert(remaining > 0);
-            size_t copySize = std::min(remaining, (size_t)chunkSize);
-            memcpy(curDest, blocks[i].get(), copySize);
-            curDest = (uint8_t*)curDest + copySize;  
-            remaining -= copySize;
-        }
+        bytesArray->resize(stream.total_out);
 
         inflateEnd(&stream);
 
         return bytesArray;
     }
 
-    BytesArray deflate(const BytesArray& planeSource, int32_t& errnum, std::uint32_t chunkSize = 0x100000)
+    BytesArray DecompressMemory(const char* data, std::size_t size)
     {
-        std::vector<std::unique_ptr<Bytef>> blocks;
-        Bytef* curPos = reinterpret_cast<Bytef*>(planeSource->data());
-        z_stream stream = { 0, };
-        stream.avail_in = planeSource->size();
-        stream.next_in = curPos;
-
-        errnum = deflateInit(&stream, Z_DEFAULT_COMPRESSION);
-        while (errnum == Z_OK || errnum == Z_BUF_ERROR)
-        {
-            stream.avail_out = chunkSize;
-            stream.next_out = new Bytef[chunkSize];
-            blocks.emplace_back(stream.next_out);
-            errnum = deflate(&stream, Z_FINISH);
-        }
-
-        if (errnum != Z_STREAM_END)
-        {
-            deflateEnd(&stream);
+        if (data == nullptr || size == 0)
             return NullFile;
-        }
 
-        assert(stream.total_out > 0);
-
-        BytesArray bytesArray = std::make_shared<FileContainer>(stream.total_out);
+        if (ChunkedFile::isChunked(data, size))
+            return ChunkedFile::decompress(data, size);
 
-        void* curDest = bytesArray->data();
-        size_t remaining = bytesArray->size();
-
-        for (size_t i = 0; i < blocks.size(); i++)
-        {
-            assert(remaining > 0);
-            size_t copySize = std::min(remaining, (size_t)chunkSize);
-            memcpy(curDest, blocks[i].get(), copySize);
-            curDest = (uint8_t*)curDest + copySize;  
-            remaining -= copySize;
-        }
-
-        deflateEnd(&stream);
-
-        return bytesArray;
+        int32_t errorno = 0;
+        return inflate(data, size, errorno);
     }
 
     BytesArray DecompressFile(const std::string& fileName)
     {
-        BytesArray compressed = ReadFileSync(fileName);
-        if (compressed == NullFile)
+        MappedFile compressed(fileName);
+        if (!compressed.isOpen())
             return NullFile;
 
-        int32_t errorno = 0;
-        BytesArray decompressed = inflate(compressed, errorno);
+        BytesArray decompressed = DecompressMemory(compressed.data(), compressed.size());
         if (decompressed->size() == 0)
         {
-            printf("Failed to decompress file %s\n", fileName.c_str());
+            LOG_WARNING("FileUtility : failed to decompress file %s\n", fileName);
             return NullFile;
         }
         return decompressed;
@@ -148,11 +120,10 @@ namespace util
 
     bool CompressFile(const std::string& fileName, const BytesArray& plainSource)
     {
-        int32_t errorno = 0;
-        BytesArray compressed = deflate(plainSource, errorno);
+        BytesArray compressed = ChunkedFile::compress(plainSource->data(), plainSource->size());
         if (compressed->size() == 0)
         {
-            printf("Failed to decompress file %s\n", fileName.c_str());
+            LOG_WARNING("FileUtility : failed to compress file %s\n", fileName);
             return false;
         }
         return WriteFileSync(fileName, compressed);
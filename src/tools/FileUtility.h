@@ -44,7 +44,10 @@ namespace util
     BytesArray ReadFileSync(const std::string& fileName);
     bool WriteFileSync(const std::string& fileName, const BytesArray& plainSource);
 
+    // Accepts chunked containers, zlib and gzip streams; gzip output is sized from its trailer without regrowing
+    BytesArray DecompressMemory(const char* data, std::size_t size);
     BytesArray DecompressFile(const std::string& fileName);
+    // Writes a chunked container, see tools/ChunkedFile.h
     bool CompressFile(const std::string& fileName, const BytesArray& plainSource);
 
     template <typename T, typename R>
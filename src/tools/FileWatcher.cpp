@@ -0,0 +1,163 @@
+#include "FileWatcher.h"
+
+#include <cstdio>
+#include <chrono>
+#include <algorithm>
+#include <sys/stat.h>
+#include <tools/Logger.hpp>
+
+#ifdef __linux__
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#endif
+
+namespace
+{
+    std::int64_t getModifiedTime(const std::string& path)
+    {
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0)
+            return 0;
+        return (std::int64_t)info.st_mtime;
+    }
+}
+
+FileWatcher::FileWatcher() noexcept
+    : m_bQuit(false)
+    , m_NotifyFd(-1)
+{
+}
+
+FileWatcher::~FileWatcher() noexcept
+{
+    stop();
+}
+
+bool FileWatcher::start(const std::string& directory)
+{
+    if (m_Thread.joinable())
+        return false;
+
+    m_Directory = directory;
+    m_bQuit = false;
+
+#ifdef __linux__
+    m_NotifyFd = inotify_init1(IN_NONBLOCK);
+    if (m_NotifyFd >= 0)
+    {
+        // Editors often save through a rename, so moves count as writes
+        if (inotify_add_watch(m_NotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) >= 0)
+        {
+            m_Thread = std::thread(&FileWatcher::watchNotify, this);
+            return true;
+        }
+        close(m_NotifyFd);
+        m_NotifyFd = -1;
+    }
+    LOG_WARNING("FileWatcher : inotify unavailable for \"%s\", polling instead\n", directory);
+#endif
+
+    m_Thread = std::thread(&FileWatcher::watchPolling, this);
+    return true;
+}
+
+void FileWatcher::stop() noexcept
+{
+    m_bQuit = true;
+    if (m_Thread.joinable())
+        m_Thread.join();
+
+#ifdef __linux__
+    if (m_NotifyFd >= 0)
+    {
+        close(m_NotifyFd);
+        m_NotifyFd = -1;
+    }
+#endif
+}
+
+bool FileWatcher::isWatching() const noexcept
+{
+    return m_Thread.joinable();
+}
+
+void FileWatcher::addFile(const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    for (const auto& file : m_Files)
+    {
+        if (file.path == path)
+            return;
+    }
+    m_Files.push_back({ path, getModifiedTime(path) });
+}
+
+std::vector<std::string> FileWatcher::poll()
+{
+    std::vector<std::string> changes;
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    changes.swap(m_Changes);
+    return changes;
+}
+
+void FileWatcher::push(const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (std::find(m_Changes.begin(), m_Changes.end(), path) == m_Changes.end())
+        m_Changes.push_back(path);
+}
+
+void FileWatcher::watchNotify() noexcept
+{
+#ifdef __linux__
+    alignas(struct inotify_event) char buffer[4096];
+
+    while (!m_bQuit)
+    {
+        // Wake up regularly to notice 'stop'
+        struct pollfd fd = { m_NotifyFd, POLLIN, 0 };
+        if (::poll(&fd, 1, 100) <= 0)
+            continue;
+
+        ssize_t length = read(m_NotifyFd, buffer, sizeof(buffer));
+        for (ssize_t offset = 0; offset < length;)
+        {
+            auto event = reinterpret_cast<const struct inotify_event*>(buffer + offset);
+            if (event->len > 0)
+                push(m_Directory + "/" + event->name);
+            offset += sizeof(struct inotify_event) + event->len;
+        }
+    }
+#endif
+}
+
+void FileWatcher::watchPolling() noexcept
+{
+    while (!m_bQuit)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(250));
+
+        std::vector<WatchedFile> files;
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            files = m_Files;
+        }
+
+        for (auto& file : files)
+        {
+            auto modifiedTime = getModifiedTime(file.path);
+            if (modifiedTime == file.modifiedTime)
+                continue;
+
+            push(file.path);
+
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            for (auto& watched : m_Files)
+            {
+                if (watched.path == file.path)
+                    watched.modifiedTime = modifiedTime;
+            }
+        }
+    }
+}
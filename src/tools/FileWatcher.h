@@ -0,0 +1,48 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+// Reports files changed on disk from a background thread.
+// Uses inotify on Linux; elsewhere it polls the modification time of the files added with 'addFile'.
+class FileWatcher final
+{
+public:
+
+    FileWatcher() noexcept;
+    ~FileWatcher() noexcept;
+
+    bool start(const std::string& directory);
+    void stop() noexcept;
+    bool isWatching() const noexcept;
+
+    // Only needed by the polling fallback; inotify sees the whole directory
+    void addFile(const std::string& path);
+
+    // Paths changed since the last call, relative like "shaders/Skybox.glsl"
+    std::vector<std::string> poll();
+
+private:
+
+    struct WatchedFile
+    {
+        std::string path;
+        std::int64_t modifiedTime;
+    };
+
+    void watchNotify() noexcept;
+    void watchPolling() noexcept;
+    void push(const std::string& path);
+
+    std::string m_Directory;
+    std::thread m_Thread;
+    std::atomic<bool> m_bQuit;
+    std::mutex m_Mutex;
+    std::vector<std::string> m_Changes;
+    std::vector<WatchedFile> m_Files;
+    int m_NotifyFd;
+};
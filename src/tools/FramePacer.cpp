@@ -0,0 +1,198 @@
+#include <tools/FramePacer.h>
+
+#include <cmath>
+#include <thread>
+#include <algorithm>
+
+namespace
+{
+    // Longer frames (a breakpoint, a resize) are not caught up with
+    const double MaxFrameDelta = 0.25;
+
+    // Frames an idle task with work left may be skipped for lack of time
+    const uint32_t MaxIdleDelay = 8;
+
+    // The last stretch of a capped frame is spun, sleeping is too coarse
+    const double SpinTime = 0.002;
+}
+
+FramePacer::FramePacer() noexcept
+    : m_FixedDelta(1.0 / 60.0)
+    , m_FrameRateLimit(0.0)
+    , m_Accumulator(0.0)
+    , m_SimulationTime(0.0)
+    , m_MaxSteps(8)
+    , m_Steps(0)
+    , m_bStarted(false)
+    , m_IdleTaskId(0)
+    , m_NextIdleTask(0)
+    , m_StarvedFrames(0)
+    , m_IdleSliceCost(0.0)
+    , m_FrameTimes(HistorySize, 0.f)
+    , m_FrameTimeNext(0)
+    , m_FrameTimeCount(0)
+{
+}
+
+void FramePacer::setFixedDelta(double seconds) noexcept
+{
+    m_FixedDelta = std::max(seconds, 1e-4);
+}
+
+double FramePacer::getFixedDelta() const noexcept
+{
+    return m_FixedDelta;
+}
+
+void FramePacer::setMaxSteps(uint32_t count) noexcept
+{
+    m_MaxSteps = std::max(count, 1u);
+}
+
+void FramePacer::setFrameRateLimit(double fps) noexcept
+{
+    m_FrameRateLimit = std::max(fps, 0.0);
+}
+
+double FramePacer::getFrameRateLimit() const noexcept
+{
+    return m_FrameRateLimit;
+}
+
+void FramePacer::beginFrame() noexcept
+{
+    auto now = Clock::now();
+    if (m_bStarted)
+    {
+        double delta = std::chrono::duration<double>(now - m_FrameStart).count();
+
+        m_FrameTimes[m_FrameTimeNext] = float(delta * 1000.0);
+        m_FrameTimeNext = (m_FrameTimeNext + 1) % HistorySize;
+        m_FrameTimeCount = std::min<uint32_t>(m_FrameTimeCount + 1, HistorySize);
+
+        m_Accumulator += std::min(delta, MaxFrameDelta);
+    }
+    m_bStarted = true;
+    m_FrameStart = now;
+    m_Steps = 0;
+}
+
+bool FramePacer::step() noexcept
+{
+    if (m_Accumulator < m_FixedDelta)
+        return false;
+
+    if (m_Steps >= m_MaxSteps)
+    {
+        // Drop the backlog but keep the phase
+        m_Accumulator = std::fmod(m_Accumulator, m_FixedDelta);
+        return false;
+    }
+
+    m_Accumulator -= m_FixedDelta;
+    m_SimulationTime += m_FixedDelta;
+    m_Steps++;
+    return true;
+}
+
+float FramePacer::getAlpha() const noexcept
+{
+    return float(std::min(m_Accumulator / m_FixedDelta, 1.0));
+}
+
+double FramePacer::getSimulationTime() const noexcept
+{
+    return m_SimulationTime;
+}
+
+uint32_t FramePacer::addIdleTask(const IdleTask& task)
+{
+    IdleEntry entry = { ++m_IdleTaskId, task, true };
+    m_IdleTasks.push_back(entry);
+    return entry.id;
+}
+
+void FramePacer::removeIdleTask(uint32_t id) noexcept
+{
+    m_IdleTasks.erase(std::remove_if(m_IdleTasks.begin(), m_IdleTasks.end(),
+        [id](const IdleEntry& entry) { return entry.id == id; }), m_IdleTasks.end());
+}
+
+void FramePacer::runIdleTasks() noexcept
+{
+    if (m_IdleTasks.empty())
+        return;
+
+    // A slice is only started when the last one would still fit
+    bool bForce = m_StarvedFrames >= MaxIdleDelay;
+    bool bStarved = false;
+    const uint32_t count = (uint32_t)m_IdleTasks.size();
+    for (uint32_t visited = 0; visited < count;)
+    {
+        auto& entry = m_IdleTasks[m_NextIdleTask % count];
+        if (!bForce && getElapsed() + m_IdleSliceCost > getFrameBudget())
+        {
+            for (auto& task : m_IdleTasks)
+                bStarved |= task.bBusy;
+            break;
+        }
+
+        auto start = Clock::now();
+        entry.bBusy = entry.task();
+        m_NextIdleTask = (m_NextIdleTask + 1) % count;
+        if (entry.bBusy)
+        {
+            double cost = std::chrono::duration<double>(Clock::now() - start).count();
+            m_IdleSliceCost = m_IdleSliceCost > 0.0 ? std::max(cost, m_IdleSliceCost * 0.9 + cost * 0.1) : cost;
+            bForce = false;
+            visited = 0;
+        }
+        else
+            visited++;
+    }
+    m_StarvedFrames = bStarved ? m_StarvedFrames + 1 : 0;
+}
+
+void FramePacer::endFrame() noexcept
+{
+    if (m_FrameRateLimit <= 0.0)
+        return;
+
+    double remaining = 1.0 / m_FrameRateLimit - getElapsed();
+    if (remaining > SpinTime)
+        std::this_thread::sleep_for(std::chrono::duration<double>(remaining - SpinTime));
+    while (getElapsed() < 1.0 / m_FrameRateLimit)
+        std::this_thread::yield();
+}
+
+FramePacer::Stats FramePacer::getStats() const noexcept
+{
+    Stats stats;
+    if (m_FrameTimeCount == 0)
+        return stats;
+
+    std::vector<float> sorted(m_FrameTimes.begin(), m_FrameTimes.begin() + m_FrameTimeCount);
+    std::sort(sorted.begin(), sorted.end());
+
+    float sum = 0.f;
+    for (auto time : sorted)
+        sum += time;
+
+    stats.last = m_FrameTimes[(m_FrameTimeNext + HistorySize - 1) % HistorySize];
+    stats.avg = sum / m_FrameTimeCount;
+    stats.min = sorted.front();
+    stats.max = sorted.back();
+    stats.p99 = sorted[(uint32_t)std::ceil(0.99f * m_FrameTimeCount) - 1];
+    stats.fps = stats.avg > 0.f ? 1000.f / stats.avg : 0.f;
+    return stats;
+}
+
+double FramePacer::getFrameBudget() const noexcept
+{
+    return m_FrameRateLimit > 0.0 ? 1.0 / m_FrameRateLimit : m_FixedDelta;
+}
+
+double FramePacer::getElapsed() const noexcept
+{
+    return std::chrono::duration<double>(Clock::now() - m_FrameStart).count();
+}
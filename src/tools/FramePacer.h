@@ -0,0 +1,91 @@
+#pragma once
+
+#include <chrono>
+#include <vector>
+#include <cstdint>
+#include <functional>
+
+// Splits real time into fixed simulation steps, optionally caps the frame rate
+// and keeps frame time statistics. Idle tasks are sliced into what is left of
+// the frame budget after rendering.
+class FramePacer final
+{
+public:
+
+    // Does one slice of work; false when there was nothing to do
+    typedef std::function<bool()> IdleTask;
+
+    enum { HistorySize = 120 };
+
+    // Frame times in milliseconds over the last 'HistorySize' frames
+    struct Stats
+    {
+        float last = 0.f;
+        float avg = 0.f;
+        float min = 0.f;
+        float max = 0.f;
+        float p99 = 0.f;
+        float fps = 0.f;
+    };
+
+    FramePacer() noexcept;
+
+    void setFixedDelta(double seconds) noexcept;
+    double getFixedDelta() const noexcept;
+
+    // Beyond this many steps in one frame the simulation falls behind real time
+    void setMaxSteps(uint32_t count) noexcept;
+
+    // 0 leaves the rate to vsync
+    void setFrameRateLimit(double fps) noexcept;
+    double getFrameRateLimit() const noexcept;
+
+    void beginFrame() noexcept;
+    // True while another fixed step is due this frame
+    bool step() noexcept;
+    // Fraction of a step not simulated yet, to interpolate what is rendered
+    float getAlpha() const noexcept;
+    double getSimulationTime() const noexcept;
+
+    uint32_t addIdleTask(const IdleTask& task);
+    void removeIdleTask(uint32_t id) noexcept;
+    void runIdleTasks() noexcept;
+
+    // Waits out the frame rate limit
+    void endFrame() noexcept;
+
+    Stats getStats() const noexcept;
+
+private:
+
+    typedef std::chrono::steady_clock Clock;
+
+    struct IdleEntry
+    {
+        uint32_t id;
+        IdleTask task;
+        bool bBusy;
+    };
+
+    double getFrameBudget() const noexcept;
+    double getElapsed() const noexcept;
+
+    double m_FixedDelta;
+    double m_FrameRateLimit;
+    double m_Accumulator;
+    double m_SimulationTime;
+    uint32_t m_MaxSteps;
+    uint32_t m_Steps;
+    bool m_bStarted;
+    Clock::time_point m_FrameStart;
+
+    std::vector<IdleEntry> m_IdleTasks;
+    uint32_t m_IdleTaskId;
+    uint32_t m_NextIdleTask;
+    uint32_t m_StarvedFrames;
+    double m_IdleSliceCost;
+
+    std::vector<float> m_FrameTimes;
+    uint32_t m_FrameTimeNext;
+    uint32_t m_FrameTimeCount;
+};
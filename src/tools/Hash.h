@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+namespace util
+{
+    const std::uint32_t FNV32Offset = 2166136261u;
+    const std::uint32_t FNV32Prime = 16777619u;
+    const std::uint64_t FNV64Offset = 14695981039346656037ull;
+    const std::uint64_t FNV64Prime = 1099511628211ull;
+
+    // FNV-1a, 'seed' chains the hash over several buffers
+    inline std::uint32_t fnv1a32(const void* data, std::size_t size, std::uint32_t seed = FNV32Offset) noexcept
+    {
+        auto bytes = static_cast<const std::uint8_t*>(data);
+        std::uint32_t hash = seed;
+        for (std::size_t i = 0; i < size; i++)
+        {
+            hash ^= bytes[i];
+            hash *= FNV32Prime;
+        }
+        return hash;
+    }
+
+    inline std::uint64_t fnv1a64(const void* data, std::size_t size, std::uint64_t seed = FNV64Offset) noexcept
+    {
+        auto bytes = static_cast<const std::uint8_t*>(data);
+        std::uint64_t hash = seed;
+        for (std::size_t i = 0; i < size; i++)
+        {
+            hash ^= bytes[i];
+            hash *= FNV64Prime;
+        }
+        return hash;
+    }
+
+    inline std::uint32_t fnv1a32(const std::string& str, std::uint32_t seed = FNV32Offset) noexcept
+    {
+        return fnv1a32(str.data(), str.size(), seed);
+    }
+
+    inline std::uint64_t fnv1a64(const std::string& str, std::uint64_t seed = FNV64Offset) noexcept
+    {
+        return fnv1a64(str.data(), str.size(), seed);
+    }
+}
@@ -0,0 +1,222 @@
+#include "JobSystem.h"
+#include "Profile.h"
+
+#include <algorithm>
+
+namespace
+{
+    // Queue of the calling thread; 0 is shared by every thread that is not a worker
+    thread_local uint32_t t_QueueIndex = 0;
+}
+
+JobCounter::JobCounter() noexcept
+    : m_Count(0)
+{
+}
+
+bool JobCounter::isDone() const noexcept
+{
+    return m_Count.load(std::memory_order_acquire) == 0;
+}
+
+JobSystem::JobSystem(uint32_t numThreads) noexcept
+    : m_Pending(0)
+    , m_bQuit(false)
+{
+    if (numThreads == 0)
+    {
+        // Leave the main thread its own core
+        uint32_t hardware = std::thread::hardware_concurrency();
+        numThreads = std::max(hardware, 2u) - 1;
+    }
+
+    for (uint32_t i = 0; i <= numThreads; i++)
+        m_Queues.emplace_back(new Queue);
+    for (uint32_t i = 0; i < numThreads; i++)
+        m_Threads.emplace_back(&JobSystem::worker, this, i + 1);
+}
+
+JobSystem::~JobSystem() noexcept
+{
+    {
+        std::lock_guard<std::mutex> lock(m_SleepMutex);
+        m_bQuit = true;
+    }
+    m_WakeCondition.notify_all();
+    for (auto& thread : m_Threads)
+        thread.join();
+}
+
+JobSystem& JobSystem::instance() noexcept
+{
+    static JobSystem jobs;
+    return jobs;
+}
+
+uint32_t JobSystem::getThreadCount() const noexcept
+{
+    return (uint32_t)m_Threads.size();
+}
+
+void JobSystem::run(const Job& job, JobCounter* counter, JobCounter* dependency) noexcept
+{
+    if (counter)
+        counter->m_Count.fetch_add(1, std::memory_order_relaxed);
+
+    Entry entry = { job, counter };
+    if (dependency)
+    {
+        // Checked under the lock 'finish' takes the continuations with
+        std::lock_guard<std::mutex> lock(dependency->m_Mutex);
+        if (!dependency->isDone())
+        {
+            dependency->m_Continuations.push_back([this, entry] { push(entry); });
+            return;
+        }
+    }
+    push(entry);
+}
+
+void JobSystem::wait(const JobCounter& counter) noexcept
+{
+    while (!counter.isDone())
+    {
+        if (!runOne())
+            std::this_thread::yield();
+    }
+
+    // The last 'finish' may still hold the lock
+    std::lock_guard<std::mutex> lock(counter.m_Mutex);
+}
+
+void JobSystem::parallel_for(uint32_t count, uint32_t grainSize, const RangeFunc& func) noexcept
+{
+    if (count == 0)
+        return;
+
+    grainSize = std::max(grainSize, 1u);
+    if (m_Threads.empty() || count <= grainSize)
+    {
+        func(0, count);
+        return;
+    }
+
+    JobCounter counter;
+    for (uint32_t begin = 0; begin < count; begin += grainSize)
+    {
+        uint32_t end = std::min(begin + grainSize, count);
+        run([&func, begin, end] { func(begin, end); }, &counter);
+    }
+    wait(counter);
+}
+
+void JobSystem::runOnMainThread(const Job& job) noexcept
+{
+    std::lock_guard<std::mutex> lock(m_MainMutex);
+    m_MainJobs.push_back(job);
+}
+
+bool JobSystem::runMainThreadJob() noexcept
+{
+    Job job;
+    {
+        std::lock_guard<std::mutex> lock(m_MainMutex);
+        if (m_MainJobs.empty())
+            return false;
+        job = std::move(m_MainJobs.front());
+        m_MainJobs.pop_front();
+    }
+    job();
+    return true;
+}
+
+void JobSystem::push(Entry entry) noexcept
+{
+    {
+        auto& queue = *m_Queues[t_QueueIndex];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.entries.push_back(std::move(entry));
+    }
+    m_Pending.fetch_add(1, std::memory_order_release);
+
+    // Taking the lock keeps a worker from missing the wake between its check and wait
+    {
+        std::lock_guard<std::mutex> lock(m_SleepMutex);
+    }
+    m_WakeCondition.notify_one();
+}
+
+bool JobSystem::pop(uint32_t index, Entry& entry) noexcept
+{
+    // Own deque newest first; the shared deque and stolen work oldest first
+    const uint32_t count = (uint32_t)m_Queues.size();
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint32_t victim = (index + i) % count;
+        auto& queue = *m_Queues[victim];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.entries.empty())
+            continue;
+
+        if (i == 0 && victim != 0)
+        {
+            entry = std::move(queue.entries.back());
+            queue.entries.pop_back();
+        }
+        else
+        {
+            entry = std::move(queue.entries.front());
+            queue.entries.pop_front();
+        }
+        m_Pending.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+bool JobSystem::runOne() noexcept
+{
+    Entry entry;
+    if (!pop(t_QueueIndex, entry))
+        return false;
+
+    {
+        PROFILE_SCOPE("JobSystem::run");
+        entry.job();
+    }
+    finish(entry.counter);
+    return true;
+}
+
+void JobSystem::finish(JobCounter* counter) noexcept
+{
+    if (!counter)
+        return;
+
+    // Nothing of the counter is touched past the lock, a waiter may free it then
+    std::vector<std::function<void()>> continuations;
+    {
+        std::lock_guard<std::mutex> lock(counter->m_Mutex);
+        if (counter->m_Count.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            continuations.swap(counter->m_Continuations);
+    }
+    for (auto& continuation : continuations)
+        continuation();
+}
+
+void JobSystem::worker(uint32_t index) noexcept
+{
+    t_QueueIndex = index;
+    profiler::setThreadName("Job worker");
+
+    while (!m_bQuit.load(std::memory_order_relaxed))
+    {
+        if (runOne())
+            continue;
+
+        std::unique_lock<std::mutex> lock(m_SleepMutex);
+        m_WakeCondition.wait(lock, [this] {
+            return m_bQuit.load(std::memory_order_relaxed) || m_Pending.load(std::memory_order_acquire) > 0;
+        });
+    }
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <utility>
+#include <functional>
+#include <condition_variable>
+
+// Counts unfinished jobs. Jobs depending on it are queued once it reaches zero.
+// Only destroyed after 'JobSystem::wait' on it has returned.
+class JobCounter final
+{
+public:
+
+    JobCounter() noexcept;
+
+    bool isDone() const noexcept;
+
+private:
+
+    friend class JobSystem;
+
+    JobCounter(const JobCounter&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+
+    std::atomic<uint32_t> m_Count;
+    mutable std::mutex m_Mutex;
+    std::vector<std::function<void()>> m_Continuations;
+};
+
+// Work stealing job system. A worker pushes and pops at the back of its own
+// deque and steals from the front of the others when it runs dry; threads that
+// are not workers share one more deque. Work needing the GL context is queued
+// for the main thread, which runs it in 'runMainThreadJob'.
+class JobSystem final
+{
+public:
+
+    typedef std::function<void()> Job;
+    typedef std::function<void(uint32_t begin, uint32_t end)> RangeFunc;
+
+    JobSystem(uint32_t numThreads = 0) noexcept;
+    ~JobSystem() noexcept;
+
+    static JobSystem& instance() noexcept;
+
+    uint32_t getThreadCount() const noexcept;
+
+    // 'counter' is raised now and lowered once the job has run.
+    // With a 'dependency', the job is not started before it is done.
+    void run(const Job& job, JobCounter* counter = nullptr, JobCounter* dependency = nullptr) noexcept;
+
+    // Runs other jobs until 'counter' is done
+    void wait(const JobCounter& counter) noexcept;
+
+    // Blocks until every chunk is done; the calling thread helps
+    void parallel_for(uint32_t count, uint32_t grainSize, const RangeFunc& func) noexcept;
+
+    void runOnMainThread(const Job& job) noexcept;
+    // False when there was nothing queued
+    bool runMainThreadJob() noexcept;
+
+    // 'work' runs on a worker, 'done' is given its result on the main thread
+    template<typename Work, typename Done>
+    void runAsync(Work work, Done done, JobCounter* counter = nullptr) noexcept
+    {
+        typedef decltype(work()) Result;
+        run([this, work, done] {
+            auto result = std::make_shared<Result>(work());
+            runOnMainThread([done, result] { done(*result); });
+        }, counter);
+    }
+
+private:
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    struct Entry
+    {
+        Job job;
+        JobCounter* counter;
+    };
+
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Entry> entries;
+    };
+
+    void worker(uint32_t index) noexcept;
+    void push(Entry entry) noexcept;
+    bool pop(uint32_t index, Entry& entry) noexcept;
+    bool runOne() noexcept;
+    void finish(JobCounter* counter) noexcept;
+
+    std::vector<std::unique_ptr<Queue>> m_Queues;
+    std::vector<std::thread> m_Threads;
+    std::atomic<uint32_t> m_Pending;
+    std::atomic<bool> m_bQuit;
+    std::mutex m_SleepMutex;
+    std::condition_variable m_WakeCondition;
+
+    std::mutex m_MainMutex;
+    std::deque<Job> m_MainJobs;
+};
@@ -1,30 +1,233 @@
 /**
- * 
+ *
     \file Logger.cpp
- * 
+ *
  */
 
 #include <cstdarg>
 #include <cstdio>
 #include <cassert>
+#include <chrono>
+#include <algorithm>
 
 #include "Logger.hpp"
 
 
+namespace
+{
+  const int64_t RateWindow = 1000000000; // 1s in ns
+  const unsigned int MaxBackups = 3u;
+  const char* const LevelNames[] = { "D", "I", "W", "E" };
+
+  int64_t now()
+  {
+    using namespace std::chrono;
+    static const steady_clock::time_point start = steady_clock::now();
+    return duration_cast<nanoseconds>(steady_clock::now() - start).count();
+  }
+
+  // Formats one conversion with the length modifier the stored argument needs
+  void formatArgument( std::string& out, std::string spec, char conversion, const LogRecord& record, const LogArgument* argument )
+  {
+    char buffer[64];
+    int size = 0;
+    if (!argument)
+    {
+      out += "<missing>";
+      return;
+    }
+
+    switch (conversion)
+    {
+    case 'd': case 'i':
+      spec += "ll";
+      spec += conversion;
+      size = snprintf(buffer, sizeof(buffer), spec.c_str(), argument->type == LogArgument::Double ? (long long)argument->d : argument->i);
+      break;
+
+    case 'u': case 'o': case 'x': case 'X':
+      spec += "ll";
+      spec += conversion;
+      size = snprintf(buffer, sizeof(buffer), spec.c_str(), argument->type == LogArgument::Double ? (unsigned long long)argument->d : argument->u);
+      break;
+
+    case 'c':
+      spec += conversion;
+      size = snprintf(buffer, sizeof(buffer), spec.c_str(), (int)argument->i);
+      break;
+
+    case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+      spec += conversion;
+      if (argument->type == LogArgument::Double)
+        size = snprintf(buffer, sizeof(buffer), spec.c_str(), argument->d);
+      else if (argument->type == LogArgument::Int)
+        size = snprintf(buffer, sizeof(buffer), spec.c_str(), (double)argument->i);
+      else
+        size = snprintf(buffer, sizeof(buffer), spec.c_str(), (double)argument->u);
+      break;
+
+    case 's':
+      {
+        spec += conversion;
+        const char* s = argument->type == LogArgument::String ? record.text + argument->offset : "<?>";
+        int length = snprintf(nullptr, 0, spec.c_str(), s);
+        if (length > 0)
+        {
+          std::string text(length + 1, '\0');
+          snprintf(&text[0], text.size(), spec.c_str(), s);
+          out.append(text.c_str(), length);
+        }
+        return;
+      }
+
+    case 'p':
+      spec += conversion;
+      size = snprintf(buffer, sizeof(buffer), spec.c_str(), argument->p);
+      break;
+
+    default:
+      out += '%';
+      out += conversion;
+      return;
+    }
+
+    if (size > 0)
+      out.append(buffer, std::min<std::size_t>(size, sizeof(buffer) - 1));
+  }
+
+  std::string format( const LogRecord& record )
+  {
+    std::string out;
+    uint8_t next = 0;
+    auto argument = [&]() -> const LogArgument* {
+      return next < record.count ? &record.arguments[next++] : nullptr;
+    };
+
+    for (const char* c = record.format; *c; c++)
+    {
+      if (*c != '%')
+      {
+        out += *c;
+        continue;
+      }
+      if (*++c == '%')
+      {
+        out += '%';
+        continue;
+      }
+
+      // flags, width and precision are kept, length modifiers are replaced
+      std::string spec = "%";
+      for (; *c && strchr("-+ #0123456789.*", *c); c++)
+      {
+        if (*c != '*')
+          spec += *c;
+        else if (auto width = argument())
+          spec += std::to_string(width->i);
+      }
+      while (*c && strchr("hljztL", *c))
+        c++;
+      if (!*c)
+        break;
+
+      formatArgument(out, spec, *c, record, argument());
+    }
+    return out;
+  }
+}
+
+void LogRecord::add( const char* s ) noexcept
+{
+  auto& argument = next(LogArgument::String);
+  if (!s)
+    s = "(null)";
+
+  // Truncated once the text buffer is full, whose last byte is then a terminator
+  if (textSize >= TextSize)
+  {
+    argument.offset = TextSize - 1;
+    return;
+  }
+  std::size_t length = std::min<std::size_t>(strlen(s), TextSize - textSize - 1);
+  argument.offset = textSize;
+  memcpy(text + textSize, s, length);
+  text[textSize + length] = '\0';
+  textSize = (uint16_t)(textSize + length + 1);
+}
+
+LogArgument& LogRecord::next( LogArgument::Type type ) noexcept
+{
+  // Arguments past the limit overwrite the last one
+  if (count < MaxArguments)
+    count++;
+  auto& argument = arguments[count - 1];
+  argument.type = type;
+  return argument;
+}
+
+Logger::Logger()
+  : m_cells(new Cell[RING_SIZE]),
+    m_enqueue(0u),
+    m_dequeue(0u),
+    m_dropped(0u),
+    m_level(LogLevelDebug),
+    m_reportedDropped(0u),
+    m_bQuit(false),
+    m_fd(0),
+    m_fileSize(0u),
+    m_maxFileSize(MAX_LOGGER_FILESIZE),
+    m_rateLimit(20u)
+{
+  static_assert((RING_SIZE & (RING_SIZE - 1)) == 0, "ring size must be a power of two");
+  for (std::size_t i = 0; i < RING_SIZE; i++)
+    m_cells[i].sequence.store(i, std::memory_order_relaxed);
+  start();
+}
+
+Logger::~Logger()
+{
+  close();
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_bQuit = true;
+  }
+  m_wakeCondition.notify_all();
+  if (m_thread.joinable())
+    m_thread.join();
+}
+
+Logger& Logger::getInstance()
+{
+  static Logger logger;
+  return logger;
+}
+
 void Logger::open( const std::string filename )
 {
+  flush();
+
+  std::lock_guard<std::mutex> lock(m_mutex);
   if (0 != m_fd)
   {
     fprintf( stderr, "Logger : an output file is already specify.\n");
     return;
   }
-  
+
   m_fd = fopen( filename.c_str(), "w");
-  assert( 0 != m_fd );
+  if (0 == m_fd)
+  {
+    fprintf( stderr, "Logger : can't open \"%s\".\n", filename.c_str());
+    return;
+  }
+  m_filename = filename;
+  m_fileSize = 0u;
 }
 
 void Logger::close()
 {
+  flush();
+
+  std::lock_guard<std::mutex> lock(m_mutex);
   if (0 != m_fd)
   {
     fclose( m_fd );
@@ -32,57 +235,174 @@ void Logger::close()
   }
 }
 
-void Logger::write( const std::string format, ...)
+void Logger::flush()
+{
+  auto target = m_enqueue.load(std::memory_order_acquire);
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_wakeCondition.notify_one();
+  m_flushCondition.wait(lock, [this, target] {
+    return m_bQuit || m_dequeue.load(std::memory_order_acquire) >= target;
+  });
+  if (m_fd)
+    fflush(m_fd);
+  fflush(stdout);
+}
+
+void Logger::setLevel( LogLevel level )
+{
+  m_level.store(level, std::memory_order_relaxed);
+}
+
+void Logger::setMaxFileSize( std::size_t size )
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_maxFileSize = size;
+}
+
+void Logger::setRateLimit( unsigned int count )
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_rateLimit = count;
+}
+
+LogRecord* Logger::acquire( std::size_t& position )
+{
+  // Bounded MPMC queue of Dmitry Vyukov, with a single consumer
+  position = m_enqueue.load(std::memory_order_relaxed);
+  for (;;)
+  {
+    auto& cell = m_cells[position & (RING_SIZE - 1)];
+    auto sequence = cell.sequence.load(std::memory_order_acquire);
+    auto diff = (intptr_t)sequence - (intptr_t)position;
+    if (diff == 0)
+    {
+      if (m_enqueue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+      {
+        cell.record.time = now();
+        return &cell.record;
+      }
+    }
+    else if (diff < 0)
+    {
+      // Full; never wait on the writer
+      m_dropped.fetch_add(1u, std::memory_order_relaxed);
+      return nullptr;
+    }
+    else
+      position = m_enqueue.load(std::memory_order_relaxed);
+  }
+}
+
+void Logger::publish( std::size_t position, LogLevel level )
+{
+  m_cells[position & (RING_SIZE - 1)].sequence.store(position + 1, std::memory_order_release);
+
+  // Otherwise the writer picks it up within its polling interval
+  if (level >= LogLevelError || position - m_dequeue.load(std::memory_order_relaxed) >= RING_SIZE / 2)
+    m_wakeCondition.notify_one();
+}
+
+void Logger::start()
+{
+  m_thread = std::thread(&Logger::run, this);
+}
+
+void Logger::run()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (!m_bQuit)
+  {
+    while (consume())
+      ;
+    m_flushCondition.notify_all();
+
+    // Producers only wake the writer for errors and flushes
+    m_wakeCondition.wait_for(lock, std::chrono::milliseconds(10));
+  }
+  while (consume())
+    ;
+  m_flushCondition.notify_all();
+}
+
+bool Logger::consume()
 {
-  int ret=0;
-   
-  va_list args;
-  va_start( args, format );
-  
-  if (0 == m_fd) {
-    fprintf( stderr, "Logger : no output specify.\n");
-    ret = vfprintf( stderr, format.c_str(), args);     
-  } else {
-    ret = vfprintf( m_fd, format.c_str(), args);
+  auto position = m_dequeue.load(std::memory_order_relaxed);
+  auto& cell = m_cells[position & (RING_SIZE - 1)];
+  if (cell.sequence.load(std::memory_order_acquire) != position + 1)
+    return false;
+
+  const auto& record = cell.record;
+  auto level = record.level;
+  auto time = record.time;
+  auto key = record.format;
+  std::string message = format(record);
+  cell.sequence.store(position + RING_SIZE, std::memory_order_release);
+  m_dequeue.store(position + 1, std::memory_order_release);
+
+  auto dropped = m_dropped.load(std::memory_order_relaxed);
+  if (dropped != m_reportedDropped)
+  {
+    output(LogLevelWarning, time, "Logger : " + std::to_string(dropped - m_reportedDropped) + " messages dropped, ring full\n");
+    m_reportedDropped = dropped;
   }
-  
-  m_fileSize += (ret>0)?(unsigned int)(ret):0u;
-  _checkFileSize();
-  
-  va_end( args );
-}
-
-void Logger::debug( const std::string format, ...)
-{
-  #ifndef NDEBUG
-  
-  int ret=0;
-   
-  va_list args;
-  va_start( args, format );
-  
-  if (0 == m_fd) {
-    fprintf( stderr, "Logger : no output specify.\n");
-    ret = vfprintf( stderr, format.c_str(), args);     
-  } else {
-    ret = vfprintf( m_fd, format.c_str(), args);
+
+  if (m_rateLimit > 0u)
+  {
+    auto& rate = m_rates[key];
+    if (rate.count == 0u || time - rate.windowStart >= RateWindow)
+    {
+      if (rate.suppressed > 0u)
+        output(level, time, "Logger : previous message repeated " + std::to_string(rate.suppressed) + " more times\n");
+      rate.windowStart = time;
+      rate.count = 0u;
+      rate.suppressed = 0u;
+    }
+    if (++rate.count > m_rateLimit)
+    {
+      rate.suppressed++;
+      return true;
+    }
   }
-  
-  m_fileSize += (ret>0)?(unsigned int)(ret):0u;
-  _checkFileSize();
-  
-  va_end( args );
-  
-  #endif //NDEBUG
+
+  output(level, time, message);
+  return true;
+}
+
+void Logger::output( LogLevel level, int64_t time, const std::string& message )
+{
+  bool bNewline = !message.empty() && message.back() == '\n';
+
+  FILE* console = level >= LogLevelWarning ? stderr : stdout;
+  fputs(message.c_str(), console);
+  if (!bNewline)
+    fputc('\n', console);
+
+  if (0 == m_fd)
+    return;
+
+  int ret = fprintf(m_fd, "[%10.4f] %s %s%s", time / 1e9, LevelNames[level], message.c_str(), bNewline ? "" : "\n");
+  m_fileSize += (ret > 0) ? (std::size_t)ret : 0u;
+  if (m_fileSize >= m_maxFileSize)
+    rotate();
 }
 
-void Logger::_checkFileSize()
+void Logger::rotate()
 {
-  if (m_fileSize >= MAX_LOGGER_FILESIZE)
+  fclose(m_fd);
+  m_fd = 0;
+
+  // log -> log.1 -> log.2 ..., the oldest is overwritten
+  for (unsigned int i = MaxBackups; i > 0u; i--)
   {
-    fprintf( stderr, 
-             "\x1b[%i;3%im Logger : beware, max log size reached. File closed.\n\x1b[0m\n", 
-             1, 1);
-    close();
+    std::string from = i > 1u ? m_filename + "." + std::to_string(i - 1u) : m_filename;
+    std::string to = m_filename + "." + std::to_string(i);
+    std::remove(to.c_str());
+    std::rename(from.c_str(), to.c_str());
   }
+
+  m_fd = fopen(m_filename.c_str(), "w");
+  m_fileSize = 0u;
+  if (0 == m_fd)
+    fprintf(stderr, "Logger : can't reopen \"%s\" after rotation.\n", m_filename.c_str());
 }
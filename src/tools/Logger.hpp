@@ -1,13 +1,16 @@
 /**
- * 
+ *
  *    \file Logger.hpp
- * 
- *    \todo : # add date / time, 
- *            # add suffix to the output name,
- *            # use color, 
- *            # specify if ERR / STDOUT
- *            # m_fd = stderr by default ?
- *            # hashmap to handle perFrame msg one single time ?
+ *
+ *    Asynchronous logger. Calling threads only copy the format pointer and the
+ *    arguments into a bounded ring; a background thread formats and writes them,
+ *    so logging from render or worker loops never touches a file.
+ *
+ *    Formats must be string literals: only the pointer is kept until the
+ *    message is written. Strings passed as arguments are copied, up to
+ *    LogRecord::TextSize bytes per message.
+ *
+ *    \todo : # use color
  */
 
 
@@ -17,42 +20,215 @@
 #define LOGGER_HPP
 
 #include <cstdio>
+#include <cstdint>
+#include <cstring>
 #include <string>
-//#include <boost/time>
-#include "Singleton.hpp"
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
+#include <condition_variable>
 
 
-class Logger : public Singleton<Logger>
+enum LogLevel
+{
+  LogLevelDebug = 0,
+  LogLevelInfo,
+  LogLevelWarning,
+  LogLevelError,
+};
+
+#ifdef NDEBUG
+#define LOG_DEBUG(...) ((void)0)
+#else
+#define LOG_DEBUG(...) Logger::getInstance().log(LogLevelDebug, __VA_ARGS__)
+#endif
+#define LOG_INFO(...) Logger::getInstance().log(LogLevelInfo, __VA_ARGS__)
+#define LOG_WARNING(...) Logger::getInstance().log(LogLevelWarning, __VA_ARGS__)
+#define LOG_ERROR(...) Logger::getInstance().log(LogLevelError, __VA_ARGS__)
+
+
+struct LogArgument
+{
+  enum Type : uint8_t { Int, Uint, Double, String, Pointer };
+
+  Type type;
+  union
+  {
+    long long i;
+    unsigned long long u;
+    double d;
+    const void* p;
+    uint16_t offset;
+  };
+};
+
+struct LogRecord
+{
+  enum { MaxArguments = 8, TextSize = 192 };
+
+  int64_t time;
+  LogLevel level;
+  const char* format;
+  uint8_t count;
+  uint16_t textSize;
+  LogArgument arguments[MaxArguments];
+  char text[TextSize];
+
+  void add(const char* s) noexcept;
+
+  template<typename T>
+  typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type add(T value) noexcept
+  {
+    next(LogArgument::Int).i = value;
+  }
+
+  template<typename T>
+  typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value>::type add(T value) noexcept
+  {
+    next(LogArgument::Uint).u = value;
+  }
+
+  template<typename T>
+  typename std::enable_if<std::is_enum<T>::value>::type add(T value) noexcept
+  {
+    next(LogArgument::Int).i = (long long)value;
+  }
+
+  template<typename T>
+  typename std::enable_if<std::is_floating_point<T>::value>::type add(T value) noexcept
+  {
+    next(LogArgument::Double).d = value;
+  }
+
+  template<typename T>
+  void add(const T* pointer) noexcept
+  {
+    next(LogArgument::Pointer).p = pointer;
+  }
+
+  void add(char* s) noexcept { add((const char*)s); }
+  void add(const std::string& s) noexcept { add(s.c_str()); }
+
+private:
+
+  LogArgument& next(LogArgument::Type type) noexcept;
+};
+
+
+class Logger
 {
-  friend class Singleton<Logger>;
-  
-  protected:
-    FILE *m_fd;    
-    unsigned int m_fileSize;
-    
-    static const unsigned int MAX_LOGGER_FILESIZE = 32u * 1024u * 1024u; // 32 Mo    
-        
   public:
-    Logger() 
-      : m_fd(0),
-        m_fileSize(0u)
-    {}
-    
-    ~Logger() { close(); }    
-    
+    static const unsigned int MAX_LOGGER_FILESIZE = 32u * 1024u * 1024u; // 32 Mo
+    static const unsigned int RING_SIZE = 4096u;
+
+    Logger();
+    ~Logger();
+
+    static Logger& getInstance();
+
+    // Also written to the console; the file is rotated to '.1', '.2'... once over the size limit
     void open( const std::string filename );
     void close();
-    
-    void write( const std::string s, ...);
-    
+
+    // Blocks until everything logged so far is written
+    void flush();
+
+    void setLevel( LogLevel level );
+    void setMaxFileSize( std::size_t size );
+    // Messages of one format beyond this many per second are counted, not written
+    void setRateLimit( unsigned int count );
+
+    template<typename... Args>
+    void log( LogLevel level, const char* format, const Args&... args )
+    {
+      if (level < m_level.load(std::memory_order_relaxed))
+        return;
+
+      std::size_t position = 0;
+      LogRecord* record = acquire(position);
+      if (!record)
+        return;
+      record->level = level;
+      record->format = format;
+      record->count = 0;
+      record->textSize = 0;
+      pack(*record, args...);
+      publish(position, level);
+    }
+
+    template<typename... Args>
+    void write( const char* format, const Args&... args )
+    {
+      log(LogLevelInfo, format, args...);
+    }
+
     /** Like write, but disable when NDEBUG not define */
-    void debug( const std::string s, ...);    
-  
+    template<typename... Args>
+    void debug( const char* format, const Args&... args )
+    {
+#ifndef NDEBUG
+      log(LogLevelDebug, format, args...);
+#endif
+    }
+
   private:
     Logger(const Logger&);
     Logger& operator =(const Logger&) const;
-    
-    void _checkFileSize();
+
+    struct Cell
+    {
+      std::atomic<std::size_t> sequence;
+      LogRecord record;
+    };
+
+    struct RateState
+    {
+      int64_t windowStart;
+      unsigned int count;
+      unsigned int suppressed;
+    };
+
+    static void pack( LogRecord& ) {}
+
+    template<typename T, typename... Args>
+    static void pack( LogRecord& record, const T& value, const Args&... args )
+    {
+      record.add(value);
+      pack(record, args...);
+    }
+
+    LogRecord* acquire( std::size_t& position );
+    void publish( std::size_t position, LogLevel level );
+
+    void start();
+    void run();
+    bool consume();
+    void output( LogLevel level, int64_t time, const std::string& message );
+    void rotate();
+
+    std::unique_ptr<Cell[]> m_cells;
+    std::atomic<std::size_t> m_enqueue;
+    std::atomic<std::size_t> m_dequeue;
+    std::atomic<std::size_t> m_dropped;
+    std::atomic<int> m_level;
+    std::size_t m_reportedDropped;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wakeCondition;
+    std::condition_variable m_flushCondition;
+    std::thread m_thread;
+    bool m_bQuit;
+
+    // Owned by the writing thread once started
+    FILE *m_fd;
+    std::string m_filename;
+    std::size_t m_fileSize;
+    std::size_t m_maxFileSize;
+    unsigned int m_rateLimit;
+    std::unordered_map<const char*, RateState> m_rates;
 };
 
 // Colored terminal output
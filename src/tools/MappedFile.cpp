@@ -0,0 +1,171 @@
+#include <tools/MappedFile.h>
+
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+MappedFile::MappedFile() noexcept
+    : m_Data(nullptr)
+    , m_Size(0)
+    , m_bOpen(false)
+#ifdef _WIN32
+    , m_File(nullptr)
+    , m_Mapping(nullptr)
+#endif
+{
+}
+
+MappedFile::MappedFile(const std::string& filename) noexcept
+    : MappedFile()
+{
+    open(filename);
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : MappedFile()
+{
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other)
+    {
+        close();
+        std::swap(m_Data, other.m_Data);
+        std::swap(m_Size, other.m_Size);
+        std::swap(m_bOpen, other.m_bOpen);
+#ifdef _WIN32
+        std::swap(m_File, other.m_File);
+        std::swap(m_Mapping, other.m_Mapping);
+#endif
+    }
+    return *this;
+}
+
+MappedFile::~MappedFile() noexcept
+{
+    close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string& filename) noexcept
+{
+    close();
+
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size))
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    m_File = file;
+    m_Size = static_cast<std::size_t>(size.QuadPart);
+    m_bOpen = true;
+    if (m_Size == 0)
+        return true;
+
+    m_Mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (m_Mapping)
+        m_Data = static_cast<const char*>(MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!m_Data)
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::close() noexcept
+{
+    if (m_Data)
+        UnmapViewOfFile(m_Data);
+    if (m_Mapping)
+        CloseHandle(m_Mapping);
+    if (m_File)
+        CloseHandle(m_File);
+    m_Data = nullptr;
+    m_Mapping = nullptr;
+    m_File = nullptr;
+    m_Size = 0;
+    m_bOpen = false;
+}
+
+#else
+
+bool MappedFile::open(const std::string& filename) noexcept
+{
+    close();
+
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat status;
+    if (fstat(fd, &status) != 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    m_Size = static_cast<std::size_t>(status.st_size);
+    m_bOpen = true;
+    if (m_Size > 0)
+    {
+        void* data = mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED)
+        {
+            ::close(fd);
+            m_Size = 0;
+            m_bOpen = false;
+            return false;
+        }
+        // Whole files are usually read front to back
+        madvise(data, m_Size, MADV_SEQUENTIAL);
+        m_Data = static_cast<const char*>(data);
+    }
+
+    // The mapping keeps its own reference to the file
+    ::close(fd);
+    return true;
+}
+
+void MappedFile::close() noexcept
+{
+    if (m_Data)
+        munmap(const_cast<char*>(m_Data), m_Size);
+    m_Data = nullptr;
+    m_Size = 0;
+    m_bOpen = false;
+}
+
+#endif
+
+bool MappedFile::isOpen() const noexcept
+{
+    return m_bOpen;
+}
+
+const char* MappedFile::data() const noexcept
+{
+    return m_Data;
+}
+
+std::size_t MappedFile::size() const noexcept
+{
+    return m_Size;
+}
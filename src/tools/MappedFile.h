@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+// Read-only view of a whole file, mapped into memory instead of copied.
+// The view stays valid until 'close' or destruction.
+class MappedFile final
+{
+public:
+
+    MappedFile() noexcept;
+    explicit MappedFile(const std::string& filename) noexcept;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    ~MappedFile() noexcept;
+
+    bool open(const std::string& filename) noexcept;
+    void close() noexcept;
+    bool isOpen() const noexcept;
+
+    // Null for an empty file
+    const char* data() const noexcept;
+    std::size_t size() const noexcept;
+
+private:
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* m_Data;
+    std::size_t m_Size;
+    bool m_bOpen;
+#ifdef _WIN32
+    void* m_File;
+    void* m_Mapping;
+#endif
+};
@@ -1,201 +1,541 @@
 #include <tools/Profile.h>
-#include <string>
-#include <cassert>
-#include <vector>
-
-#include <GL/glew.h>
-#include <glfw3.h>
+#include <tools/Logger.hpp>
+#include <mutex>
+#include <atomic>
 #include <memory>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <cassert>
+#include <algorithm>
+#include <unordered_map>
 
 using std::chrono::high_resolution_clock;
 
 namespace profiler
 {
-    // Use code 'dj_opengl'
-    struct ProfileQuery final
+    class History final
+    {
+    public:
+
+        History() : m_Next(0), m_Count(0)
+        {
+            m_Samples.resize(HistorySize);
+        }
+
+        void push(float sample)
+        {
+            m_Samples[m_Next] = sample;
+            m_Next = (m_Next + 1) % HistorySize;
+            m_Count = std::min<uint32_t>(m_Count + 1, HistorySize);
+        }
+
+        ZoneStats compute() const
+        {
+            ZoneStats stats;
+            stats.samples = m_Count;
+            if (m_Count == 0)
+                return stats;
+
+            std::vector<float> sorted(m_Samples.begin(), m_Samples.begin() + m_Count);
+            std::sort(sorted.begin(), sorted.end());
+
+            float sum = 0.f;
+            for (auto sample : sorted)
+                sum += sample;
+
+            auto p99 = (uint32_t)std::ceil(0.99f * m_Count) - 1;
+            stats.last = m_Samples[(m_Next + HistorySize - 1) % HistorySize];
+            stats.min = sorted.front();
+            stats.max = sorted.back();
+            stats.avg = sum / m_Count;
+            stats.p99 = sorted[p99];
+            return stats;
+        }
+
+    private:
+
+        std::vector<float> m_Samples;
+        uint32_t m_Next;
+        uint32_t m_Count;
+    };
+
+    struct Zone
+    {
+        std::string name;
+        uint32_t parent;
+        uint32_t depth;
+        std::vector<uint32_t> children;
+
+        // Accumulated over the current frame
+        double cpuTime = 0.0;
+        double gpuTime = 0.0;
+        uint32_t calls = 0;
+        uint32_t lastCalls = 0;
+        uint32_t gpuSamples = 0;
+        bool bGpu = false;
+
+        History cpuHistory;
+        History gpuHistory;
+    };
+
+    struct TraceEvent
     {
-        ProfileQuery();
-        ~ProfileQuery();
+        uint32_t zone;
+        int64_t start;
+        int64_t duration;
+    };
 
-        void start();
-        void stop();
-        void tick();
+    // Written only by its own thread, read by the exporter up to 'count'
+    struct TraceBuffer
+    {
+        enum { Capacity = 1 << 16 };
 
-        double cpuTicks() const;
-        double gpuTicks() const;
+        TraceBuffer() : events(Capacity), count(0), begin(0), tid(0) {}
 
-        GLdouble cpu_ticks = 0.0, gpu_ticks = 0.0;
-        GLint64 cpu_start_ticks = 0;
-        GLuint queries[QueryCount];
-        GLint is_gpu_ticking = GL_FALSE;
-        GLint is_cpu_ticking = GL_FALSE;
-        GLint is_gpu_ready = GL_TRUE;
+        std::vector<TraceEvent> events;
+        std::atomic<uint64_t> count;
+        uint64_t begin;
+        uint32_t tid;
+        std::string name;
     };
 
-    std::vector<ProfileQuery> m_Queries;
+    // Filled by its own thread without the global lock, merged into 's_Zones' by 'endFrame'
+    struct ThreadZones
+    {
+        struct Time
+        {
+            double cpuTime = 0.0;
+            uint32_t calls = 0;
+            bool bGpu = false;
+        };
+
+        // Only contended while 'endFrame' merges
+        std::mutex mutex;
+        std::vector<Time> times;
+        uint32_t generation = 0;
+
+        // Children by name, only used by the owning thread
+        std::vector<std::unordered_map<std::string, uint32_t>> children;
+    };
+
+    const uint32_t RootZone = 0;
+
+    std::mutex s_Mutex;
+    std::vector<Zone> s_Zones;
+    // Changed by every 'initialize', zero while shut down; zone indices are only valid within one
+    std::atomic<uint32_t> s_Generation(0);
+    uint32_t s_Initializations = 0;
+    GpuTimer* s_GpuTimer = nullptr;
+    uint64_t s_FrameCount = 0;
+    high_resolution_clock::time_point s_FrameStart;
+
+    // Buffers outlive their threads and the profiler, so 't_TraceBuffer' never dangles
+    std::vector<std::unique_ptr<TraceBuffer>> s_TraceBuffers;
+    std::vector<std::unique_ptr<ThreadZones>> s_ThreadZones;
+    std::atomic<bool> s_bTracing(false);
+    uint32_t s_TracePending = 0;
+    uint32_t s_TraceFrames = 0;
+    std::string s_TraceFile;
+    const high_resolution_clock::time_point s_Epoch = high_resolution_clock::now();
+
+    thread_local uint32_t t_Current = RootZone;
+    thread_local TraceBuffer* t_TraceBuffer = nullptr;
+    thread_local ThreadZones* t_Zones = nullptr;
+    thread_local std::string t_ThreadName;
+
+    void resetZones()
+    {
+        s_Zones.clear();
+        s_Zones.emplace_back();
+        s_Zones[RootZone].name = "Frame";
+        s_Zones[RootZone].parent = RootZone;
+        s_Zones[RootZone].depth = 0;
+    }
+
+    uint32_t findZone(uint32_t parent, const char* name)
+    {
+        for (auto child : s_Zones[parent].children)
+        {
+            if (std::strcmp(s_Zones[child].name.c_str(), name) == 0)
+                return child;
+        }
+
+        auto zone = (uint32_t)s_Zones.size();
+        s_Zones.emplace_back();
+        s_Zones[zone].name = name;
+        s_Zones[zone].parent = parent;
+        s_Zones[zone].depth = s_Zones[parent].depth + 1;
+        s_Zones[parent].children.push_back(zone);
+        return zone;
+    }
+
+    ThreadZones& getThreadZones(uint32_t generation)
+    {
+        if (!t_Zones)
+        {
+            std::unique_ptr<ThreadZones> zones(new ThreadZones);
+            std::lock_guard<std::mutex> lock(s_Mutex);
+            t_Zones = zones.get();
+            s_ThreadZones.push_back(std::move(zones));
+        }
+
+        // Indices of an earlier 'initialize' name other zones now
+        auto& zones = *t_Zones;
+        if (zones.generation != generation)
+        {
+            std::lock_guard<std::mutex> lock(zones.mutex);
+            zones.times.clear();
+            zones.children.clear();
+            zones.generation = generation;
+        }
+        return zones;
+    }
+
+    // Returns RootZone when the profiler is not running
+    uint32_t lookupZone(uint32_t parent, const char* name, uint32_t generation)
+    {
+        auto& zones = getThreadZones(generation);
+        if (parent < zones.children.size())
+        {
+            auto it = zones.children[parent].find(name);
+            if (it != zones.children[parent].end())
+                return it->second;
+        }
+
+        uint32_t zone = RootZone;
+        {
+            std::lock_guard<std::mutex> lock(s_Mutex);
+            if (s_Zones.empty() || s_Generation != generation)
+                return RootZone;
+            zone = findZone(parent < s_Zones.size() ? parent : RootZone, name);
+        }
+
+        if (parent >= zones.children.size())
+            zones.children.resize(parent + 1);
+        zones.children[parent].emplace(name, zone);
+        return zone;
+    }
+
+    int64_t sinceEpoch(high_resolution_clock::time_point time)
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(time - s_Epoch).count();
+    }
+
+    void record(uint32_t zone, high_resolution_clock::time_point start, high_resolution_clock::time_point stop)
+    {
+        if (!t_TraceBuffer)
+        {
+            std::unique_ptr<TraceBuffer> buffer(new TraceBuffer);
+            std::lock_guard<std::mutex> lock(s_Mutex);
+            buffer->tid = (uint32_t)s_TraceBuffers.size() + 1;
+            buffer->name = t_ThreadName;
+            t_TraceBuffer = buffer.get();
+            s_TraceBuffers.push_back(std::move(buffer));
+        }
+
+        auto& buffer = *t_TraceBuffer;
+        auto index = buffer.count.load(std::memory_order_relaxed);
+        auto& event = buffer.events[index % TraceBuffer::Capacity];
+        event.zone = zone;
+        event.start = sinceEpoch(start);
+        event.duration = sinceEpoch(stop) - event.start;
+        buffer.count.store(index + 1, std::memory_order_release);
+    }
+
+    void writeEscaped(FILE* file, const std::string& text)
+    {
+        for (auto c : text)
+        {
+            if (c == '"' || c == '\\')
+                fputc('\\', file);
+            if ((unsigned char)c >= 0x20)
+                fputc(c, file);
+        }
+    }
+
+    // Called with 's_Mutex' held, once recording has stopped
+    bool writeTrace(const std::string& filename)
+    {
+        FILE* file = fopen(filename.c_str(), "w");
+        if (!file)
+        {
+            LOG_WARNING("profiler : failed to open %s\n", filename);
+            return false;
+        }
+
+        uint64_t dropped = 0;
+        const char* separator = "";
+        fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+        for (auto& buffer : s_TraceBuffers)
+        {
+            // The slot after the last event may be mid write if a zone closed as recording stopped
+            auto end = buffer->count.load(std::memory_order_acquire);
+            auto begin = buffer->begin;
+            if (end - begin >= TraceBuffer::Capacity)
+            {
+                dropped += end - begin - (TraceBuffer::Capacity - 1);
+                begin = end - (TraceBuffer::Capacity - 1);
+            }
+            if (begin == end)
+                continue;
+
+            fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"", separator, buffer->tid);
+            if (buffer->name.empty())
+                fprintf(file, "thread %u", buffer->tid);
+            else
+                writeEscaped(file, buffer->name);
+            fprintf(file, "\"}}");
+            separator = ",\n";
+
+            for (auto i = begin; i < end; i++)
+            {
+                const auto& event = buffer->events[i % TraceBuffer::Capacity];
+                if (event.zone >= s_Zones.size())
+                    continue;
+                fprintf(file, ",\n{\"name\":\"");
+                writeEscaped(file, s_Zones[event.zone].name);
+                fprintf(file, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                    buffer->tid, event.start / 1e3, event.duration / 1e3);
+            }
+        }
+        fprintf(file, "\n]}\n");
+        fclose(file);
+
+        if (dropped > 0)
+            LOG_WARNING("profiler : %u events did not fit in the trace buffers\n", dropped);
+        LOG_INFO("profiler : wrote %s\n", filename);
+        return true;
+    }
+
+    void collect(uint32_t zone, std::vector<ZoneReport>& report)
+    {
+        const auto& entry = s_Zones[zone];
+        ZoneReport item;
+        item.name = entry.name;
+        item.depth = entry.depth;
+        item.calls = entry.lastCalls;
+        item.bGpu = entry.bGpu;
+        item.cpu = entry.cpuHistory.compute();
+        item.gpu = entry.gpuHistory.compute();
+        report.push_back(item);
+
+        for (auto child : entry.children)
+            collect(child, report);
+    }
 }
 
-void profiler::initialize()
+void profiler::initialize(GpuTimer* gpuTimer)
 {
-    m_Queries.resize(MaxQuery);
+    std::lock_guard<std::mutex> lock(s_Mutex);
+    resetZones();
+    s_Generation = ++s_Initializations;
+    s_GpuTimer = gpuTimer;
+    s_FrameCount = 0;
+    s_FrameStart = high_resolution_clock::now();
 }
 
 void profiler::shutdown()
 {
-    m_Queries.clear();
+    std::lock_guard<std::mutex> lock(s_Mutex);
+    s_bTracing = false;
+    s_TracePending = 0;
+    s_Generation = 0;
+    s_Zones.clear();
+    s_GpuTimer = nullptr;
 }
 
-void profiler::start(uint32_t idx)
+void profiler::endFrame()
 {
-    assert(idx < MaxQuery);
-    m_Queries[idx].start();
-}
+    if (s_GpuTimer)
+        s_GpuTimer->endFrame();
 
-void profiler::stop(uint32_t idx)
-{
-    assert(idx < MaxQuery);
-    m_Queries[idx].stop();
-}
+    using namespace std::chrono;
 
-void profiler::tick(uint32_t idx)
-{
-    m_Queries[idx].tick();
-    auto tcpu = m_Queries[idx].cpuTicks();
-    auto tgpu = m_Queries[idx].gpuTicks();
+    auto now = high_resolution_clock::now();
+    if (s_bTracing)
+        record(RootZone, s_FrameStart, now);
+
+    std::lock_guard<std::mutex> lock(s_Mutex);
+    if (s_Zones.empty())
+        return;
 
-    printf("CPU : %10.5f ms\n", tcpu);
-    printf("GPU : %10.5f ms\n", tgpu);
+    if (s_bTracing && --s_TraceFrames == 0)
+    {
+        s_bTracing = false;
+        writeTrace(s_TraceFile);
+    }
+
+    // Starts on a frame boundary so the first frame is whole
+    if (s_TracePending > 0 && !s_bTracing)
+    {
+        for (auto& buffer : s_TraceBuffers)
+            buffer->begin = buffer->count.load(std::memory_order_acquire);
+        s_TraceFrames = s_TracePending;
+        s_TracePending = 0;
+        s_bTracing = true;
+    }
+
+    // Zones closed on any thread since the last frame
+    for (auto& thread : s_ThreadZones)
+    {
+        std::lock_guard<std::mutex> threadLock(thread->mutex);
+        if (thread->generation != s_Generation)
+            continue;
+        auto count = std::min(thread->times.size(), s_Zones.size());
+        for (std::size_t i = 0; i < count; i++)
+        {
+            auto& time = thread->times[i];
+            if (time.calls == 0)
+                continue;
+            s_Zones[i].cpuTime += time.cpuTime;
+            s_Zones[i].calls += time.calls;
+            s_Zones[i].bGpu |= time.bGpu;
+            time = ThreadZones::Time();
+        }
+    }
+
+    auto& root = s_Zones[RootZone];
+    root.cpuTime = duration_cast<duration<double, std::milli>>(now - s_FrameStart).count();
+    root.calls = 1;
+    s_FrameStart = now;
+
+    // Zones that did not run this frame keep their history untouched
+    for (auto& zone : s_Zones)
+    {
+        if (zone.calls > 0)
+            zone.cpuHistory.push((float)zone.cpuTime);
+        if (zone.gpuSamples > 0)
+            zone.gpuHistory.push((float)zone.gpuTime);
+        zone.lastCalls = zone.calls;
+        zone.cpuTime = 0.0;
+        zone.gpuTime = 0.0;
+        zone.calls = 0;
+        zone.gpuSamples = 0;
+    }
+    s_FrameCount++;
 }
 
-void profiler::tick(uint32_t idx, float& cpuTime, float& gpuTime)
+uint64_t profiler::getFrameCount()
 {
-    m_Queries[idx].tick();
-    cpuTime = (float)m_Queries[idx].cpuTicks();
-    gpuTime = (float)m_Queries[idx].gpuTicks();
+    std::lock_guard<std::mutex> lock(s_Mutex);
+    return s_FrameCount;
 }
 
-using namespace profiler;
-
-ProfileQuery::ProfileQuery()
+void profiler::addGpuTime(uint32_t zone, float milliseconds)
 {
-    glGenQueries(QueryCount, queries);
-    glQueryCounter(queries[QueryStart], GL_TIMESTAMP);
-    glQueryCounter(queries[QueryStop], GL_TIMESTAMP);
+    std::lock_guard<std::mutex> lock(s_Mutex);
+    if (zone >= s_Zones.size())
+        return;
+    s_Zones[zone].gpuTime += milliseconds;
+    s_Zones[zone].gpuSamples++;
 }
 
-ProfileQuery::~ProfileQuery()
+bool profiler::captureTrace(const std::string& filename, uint32_t frameCount)
 {
-    glDeleteQueries(QueryCount, queries);
-    queries[QueryStart] = GL_ZERO;
-    queries[QueryStop] = GL_ZERO;
+    std::lock_guard<std::mutex> lock(s_Mutex);
+    if (s_Zones.empty() || frameCount == 0 || s_bTracing || s_TracePending > 0)
+        return false;
+    s_TraceFile = filename;
+    s_TracePending = frameCount;
+    return true;
 }
 
-void ProfileQuery::start()
+bool profiler::isCapturing()
 {
-    if (!is_cpu_ticking)
-    {
-        is_cpu_ticking = GL_TRUE;
-        glGetInteger64v(GL_TIMESTAMP, &cpu_start_ticks);
-    }
-    if (!is_gpu_ticking && is_gpu_ready)
-    {
-        glQueryCounter(queries[QueryStart], GL_TIMESTAMP);
-        is_gpu_ticking = GL_TRUE;
-    }
+    std::lock_guard<std::mutex> lock(s_Mutex);
+    return s_bTracing || s_TracePending > 0;
 }
 
-void ProfileQuery::stop()
+void profiler::setThreadName(const char* name)
 {
-    if (is_cpu_ticking)
+    t_ThreadName = name;
+    if (t_TraceBuffer)
     {
-        GLint64 now = 0;
-
-        glGetInteger64v(GL_TIMESTAMP, &now);
-        cpu_ticks = (now - cpu_start_ticks) / 1e6;
-        is_cpu_ticking = GL_FALSE;
-    }
-    if (is_gpu_ticking && is_gpu_ready)
-    {
-        glQueryCounter(queries[QueryStop], GL_TIMESTAMP);
-        is_gpu_ticking = GL_FALSE;
+        std::lock_guard<std::mutex> lock(s_Mutex);
+        t_TraceBuffer->name = name;
     }
 }
 
-void ProfileQuery::tick()
+std::vector<profiler::ZoneReport> profiler::getReport()
 {
-    if (!is_gpu_ticking)
-    {
-        glGetQueryObjectiv(queries[QueryStop],
-            GL_QUERY_RESULT_AVAILABLE,
-            &is_gpu_ready);
-        if (is_gpu_ready)
-        {
-            GLuint64 start, stop;
-
-            glGetQueryObjectui64v(queries[QueryStart],
-                GL_QUERY_RESULT,
-                &start);
-            glGetQueryObjectui64v(queries[QueryStop],
-                GL_QUERY_RESULT,
-                &stop);
-            gpu_ticks = (stop - start) / 1e6;
-        }
-    }
+    std::vector<ZoneReport> report;
+
+    std::lock_guard<std::mutex> lock(s_Mutex);
+    if (!s_Zones.empty())
+        collect(RootZone, report);
+    return report;
 }
 
-double profiler::ProfileQuery::cpuTicks() const
+using namespace profiler;
+
+ScopedZone::ScopedZone(const char* name, bool bGpu) noexcept
+    : m_Zone(RootZone)
+    , m_Parent(t_Current)
+    , m_bGpu(false)
 {
-    return cpu_ticks;
+    auto generation = s_Generation.load();
+    if (generation == 0)
+        return;
+    m_Zone = lookupZone(m_Parent, name, generation);
+    begin(bGpu);
 }
 
-double profiler::ProfileQuery::gpuTicks() const
+ScopedZone::ScopedZone(CallSite& site, const char* name, bool bGpu) noexcept
+    : m_Zone(RootZone)
+    , m_Parent(t_Current)
+    , m_bGpu(false)
 {
-    return gpu_ticks;
+    auto generation = s_Generation.load();
+    if (generation == 0)
+        return;
+
+    if (site.generation == generation && site.parent == m_Parent && site.name == name)
+    {
+        m_Zone = site.zone;
+    }
+    else
+    {
+        m_Zone = lookupZone(m_Parent, name, generation);
+        site.name = name;
+        site.generation = generation;
+        site.parent = m_Parent;
+        site.zone = m_Zone;
+    }
+    begin(bGpu);
 }
 
-ProfileBusyWait::ProfileBusyWait(const std::string& name) : 
-	m_name(name)
+void ScopedZone::begin(bool bGpu) noexcept
 {
-	m_queryCPU[QueryStart] = high_resolution_clock::now();
-	// generate two queries
-	glGenQueries(QueryCount, m_queryID);
-
-	// issue the first query
-	// Records the time only after all previous 
-	// commands have been completed
-	glQueryCounter(m_queryID[QueryStart], GL_TIMESTAMP);
+    if (m_Zone == RootZone)
+        return;
+    t_Current = m_Zone;
+
+    m_bGpu = bGpu && s_GpuTimer != nullptr;
+    if (m_bGpu)
+        s_GpuTimer->begin(m_Zone);
+    m_Start = high_resolution_clock::now();
 }
 
-ProfileBusyWait::~ProfileBusyWait()
+ScopedZone::~ScopedZone() noexcept
 {
-	using namespace std::chrono;
-	using millisec = duration<float, std::milli>;
-
-	m_queryCPU[QueryStop] = high_resolution_clock::now();
-	auto cpuTime = duration_cast<millisec>(m_queryCPU[QueryStop] - m_queryCPU[QueryStart]);
-
-	// issue the second query
-	// records the time when the sequence of OpenGL 
-	// commands has been fully executed
-	glQueryCounter(m_queryID[QueryStop], GL_TIMESTAMP);
-
-	// wait until the results are available
-	GLint stopTimerAvailable = 0;
-	while(!stopTimerAvailable) {
-		glGetQueryObjectiv(m_queryID[QueryStop],
-				GL_QUERY_RESULT_AVAILABLE,
-				&stopTimerAvailable);
-	}
-
-	// get query results
-	GLuint64 startTime, stopTime;
-	glGetQueryObjectui64v(m_queryID[QueryStart], GL_QUERY_RESULT, &startTime);
-	glGetQueryObjectui64v(m_queryID[QueryStop], GL_QUERY_RESULT, &stopTime);
-
-	printf("Time spent on the CPU %s: %f ms\n", m_name.c_str(), cpuTime.count());
-	printf("Time spent on the GPU %s: %f ms\n", m_name.c_str(), (stopTime - startTime) / 1000000.0);
-
-	fflush(stdout);
-	glDeleteQueries(QueryCount, m_queryID);
+    using namespace std::chrono;
+
+    auto stop = high_resolution_clock::now();
+    if (m_Zone == RootZone)
+        return;
+
+    if (m_bGpu)
+        s_GpuTimer->end(m_Zone);
+    t_Current = m_Parent;
+    if (s_bTracing)
+        record(m_Zone, m_Start, stop);
+
+    std::lock_guard<std::mutex> lock(t_Zones->mutex);
+    auto& times = t_Zones->times;
+    if (m_Zone >= times.size())
+        times.resize(m_Zone + 1);
+    times[m_Zone].cpuTime += duration_cast<duration<double, std::milli>>(stop - m_Start).count();
+    times[m_Zone].calls++;
+    times[m_Zone].bGpu |= m_bGpu;
 }
-
@@ -1,35 +1,109 @@
+#pragma once
+
 #include <chrono>
 #include <string>
+#include <vector>
+#include <cstdint>
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
 
-#define ProfileOnce(name) ProfileBusyWait __profile(name)
+// Times the enclosing scope as a child of the zone open on this thread
+#define PROFILE_SCOPE(name) \
+    static thread_local profiler::CallSite PROFILE_CONCAT(__profileSite, __LINE__); \
+    profiler::ScopedZone PROFILE_CONCAT(__profileZone, __LINE__)(PROFILE_CONCAT(__profileSite, __LINE__), name)
+// Also brackets the GL commands of the scope with timestamps; render thread only
+#define PROFILE_GPU_SCOPE(name) \
+    static thread_local profiler::CallSite PROFILE_CONCAT(__profileSite, __LINE__); \
+    profiler::ScopedZone PROFILE_CONCAT(__profileZone, __LINE__)(PROFILE_CONCAT(__profileSite, __LINE__), name, true)
 
 namespace profiler
 {
-    enum QueryID
+    enum { HistorySize = 120 };
+
+    // Timings of the last 'HistorySize' frames a zone ran in, in milliseconds
+    struct ZoneStats
+    {
+        float last = 0.f;
+        float min = 0.f;
+        float avg = 0.f;
+        float max = 0.f;
+        float p99 = 0.f;
+        uint32_t samples = 0;
+    };
+
+    struct ZoneReport
     {
-        QueryStart = 0,
-        QueryStop,
-        QueryCount
+        std::string name;
+        uint32_t depth;
+        uint32_t calls;
+        bool bGpu;
+        ZoneStats cpu;
+        ZoneStats gpu;
     };
 
-    void initialize();
+    // Implemented by the graphics backend, so the CPU side needs no GL
+    class GpuTimer
+    {
+    public:
+
+        virtual ~GpuTimer() noexcept {}
+
+        virtual void begin(uint32_t zone) noexcept = 0;
+        virtual void end(uint32_t zone) noexcept = 0;
+
+        // Hands finished timings to 'addGpuTime' without waiting on the GPU
+        virtual void endFrame() noexcept = 0;
+    };
+
+    void initialize(GpuTimer* gpuTimer = nullptr);
     void shutdown();
 
-    enum { MaxQuery = 100 };
+    // Closes the frame: the time spent in every zone since the last call goes to its history
+    void endFrame();
+    uint64_t getFrameCount();
+
+    void addGpuTime(uint32_t zone, float milliseconds);
+
+    // Records every zone of the next 'frameCount' whole frames, then writes them
+    // as Chrome trace event JSON, for chrome://tracing or Perfetto
+    bool captureTrace(const std::string& filename, uint32_t frameCount);
+    bool isCapturing();
 
-    void start(uint32_t idx);
-    void stop(uint32_t idx);
-    void tick(uint32_t idx);
-    void tick(uint32_t idx, float& cpuTime, float& gpuTime);
+    // Labels the calling thread in traces
+    void setThreadName(const char* name);
 
-    class ProfileBusyWait final
+    // Depth first, children in order of first use; the frame itself is the root at depth 0
+    std::vector<ZoneReport> getReport();
+
+    // The zone a scope macro opened last on this thread. One site may pass
+    // several names, e.g. the frame graph passes, so the name is compared too
+    struct CallSite
+    {
+        std::string name;
+        uint32_t generation = 0;
+        uint32_t parent = 0;
+        uint32_t zone = 0;
+    };
+
+    class ScopedZone final
     {
     public:
-        ProfileBusyWait(const std::string& name);
-        ~ProfileBusyWait();
 
-        std::string m_name;
-        std::chrono::high_resolution_clock::time_point m_queryCPU[2];
-        unsigned int m_queryID[2];
+        ScopedZone(const char* name, bool bGpu = false) noexcept;
+        ScopedZone(CallSite& site, const char* name, bool bGpu = false) noexcept;
+        ~ScopedZone() noexcept;
+
+    private:
+
+        ScopedZone(const ScopedZone&) = delete;
+        ScopedZone& operator=(const ScopedZone&) = delete;
+
+        void begin(bool bGpu) noexcept;
+
+        uint32_t m_Zone;
+        uint32_t m_Parent;
+        bool m_bGpu;
+        std::chrono::high_resolution_clock::time_point m_Start;
     };
-}
\ No newline at end of file
+}
@@ -41,37 +41,15 @@
 
 using namespace rtti;
 
-__ImplementClass(Interface, "RTTI")
-
-// Global variable initialization order is undfined.
-// So, make sure to use it after initialization
-
-Rtti::Rtti(const std::string& name, RttiConstruct creator, const Rtti* parent) noexcept
-	: _name(name)
-	, _parent(parent)
-	, _construct(creator)
-{
-	Factory::instance()->add(this);
-}
-
-Rtti::~Rtti() noexcept
-{
-}
-
-const Rtti*
-rtti::Rtti::getParent() const noexcept
-{
-    return _parent;
-}
+__ImplementClass(Interface)
 
 bool
-Rtti::isDerivedFrom(const Rtti* other) const
+Rtti::isDerivedFrom(const std::string& name) const noexcept
 {
-	assert(other);
-
-	for (const Rtti* cur = this; cur != 0; cur = cur->getParent())
+	TypeId id = hash(name.c_str());
+	for (std::uint32_t i = 0; i < _depth; i++)
 	{
-		if (cur == other)
+		if (_chain[i] == id)
 		{
 			return true;
 		}
@@ -80,24 +58,10 @@ Rtti::isDerivedFrom(const Rtti* other) const
 	return false;
 }
 
-bool
-Rtti::isDerivedFrom(const Rtti& other) const
+Interface*
+Rtti::create() const noexcept
 {
-	return this->isDerivedFrom(&other);
-}
-
-bool
-Rtti::isDerivedFrom(const std::string& name) const
-{
-	for (const Rtti* cur = this; cur != 0; cur = cur->getParent())
-	{
-		if (cur->_name == name)
-		{
-			return true;
-		}
-	}
-
-	return false;
+	return _construct ? _construct() : nullptr;
 }
 
 
@@ -109,18 +73,6 @@ Interface::~Interface() noexcept
 {
 }
 
-bool
-Interface::isA(const Rtti* rtti) const noexcept
-{
-	return this->rtti()->isDerivedFrom(rtti);
-}
-
-bool
-Interface::isA(const Rtti& rtti) const noexcept
-{
-	return this->rtti()->isDerivedFrom(rtti);
-}
-
 bool
 Interface::isA(const std::string& rttiName) const noexcept
 {
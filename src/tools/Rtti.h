@@ -39,31 +39,81 @@
 #include <tools/RttiMacros.h>
 #include <memory>
 #include <string>
+#include <cstdint>
 #include <cassert>
 
 namespace rtti
 {
 	typedef std::shared_ptr<class Interface> InterfacePtr;
+	typedef std::uint32_t TypeId;
 
+	// FNV-1a of the class name, evaluated at compile time
+	constexpr TypeId hash(const char* name, TypeId value = 2166136261u) noexcept
+	{
+		return *name ? hash(name + 1, (value ^ TypeId(std::uint8_t(*name))) * 16777619u) : value;
+	}
+
+	// Each type keeps the ids of its whole parent chain, indexed by depth, so
+	// 'isDerivedFrom' is one compare. Built at compile time by the macros.
     class Rtti final
     {
 	public:
 		typedef Interface*(*RttiConstruct)();
+
+		enum { MaxDepth = 8 };
+
 	public:
-		Rtti(const std::string& name, RttiConstruct creator, const Rtti* parent) noexcept;
-		~Rtti() noexcept;
+		constexpr Rtti(const char* name, RttiConstruct creator) noexcept
+			: _name(name)
+			, _id(hash(name))
+			, _depth(1)
+			, _parent(nullptr)
+			, _construct(creator)
+			, _chain{ hash(name) }
+		{
+		}
 
-		const Rtti* getParent() const noexcept;
+		constexpr Rtti(const char* name, RttiConstruct creator, const Rtti& parent) noexcept
+			: _name(name)
+			, _id(hash(name))
+			, _depth(parent._depth + 1)
+			, _parent(&parent)
+			, _construct(creator)
+			, _chain{}
+		{
+			// Deeper than MaxDepth fails to compile
+			for (std::uint32_t i = 0; i < parent._depth; i++)
+				_chain[i] = parent._chain[i];
+			_chain[parent._depth] = _id;
+		}
 
-		bool isDerivedFrom(const Rtti* other) const;
-		bool isDerivedFrom(const Rtti& other) const;
-		bool isDerivedFrom(const std::string& name) const;
+		constexpr const char* getName() const noexcept { return _name; }
+		constexpr TypeId getId() const noexcept { return _id; }
+		constexpr const Rtti* getParent() const noexcept { return _parent; }
+
+		constexpr bool isDerivedFrom(const Rtti* other) const noexcept
+		{
+			assert(other);
+			return other->_depth <= _depth && _chain[other->_depth - 1] == other->_id;
+		}
+
+		constexpr bool isDerivedFrom(const Rtti& other) const noexcept
+		{
+			return this->isDerivedFrom(&other);
+		}
+
+		bool isDerivedFrom(const std::string& name) const noexcept;
+
+		Interface* create() const noexcept;
 
 	private:
 
-		std::string _name;
+		const char* _name;
+		TypeId _id;
+		std::uint32_t _depth;
 		const Rtti* _parent;
 		RttiConstruct _construct;
+		TypeId _chain[MaxDepth];
     };
 
 	class Interface : public std::enable_shared_from_this<Interface>
@@ -74,8 +124,16 @@ namespace rtti
 		Interface() noexcept;
 		virtual ~Interface() noexcept;
 
-		bool isA(const Rtti* rtti) const noexcept;
-		bool isA(const Rtti& rtti) const noexcept;
+		bool isA(const Rtti* rtti) const noexcept
+		{
+			return this->rtti()->isDerivedFrom(rtti);
+		}
+
+		bool isA(const Rtti& rtti) const noexcept
+		{
+			return this->rtti()->isDerivedFrom(rtti);
+		}
+
 		bool isA(const std::string& rttiName) const noexcept;
 
 		template<typename T>
@@ -84,12 +142,29 @@ namespace rtti
 			return this->isA(T::getRtti());
 		}
 
+		// Checked in debug builds only; classes derive from Interface without virtual bases
+		template<typename T>
+		T* downcast() noexcept
+		{
+			assert(this->isA<T>());
+			return static_cast<T*>(this);
+		}
+
+		template<typename T>
+		const T* downcast() const noexcept
+		{
+			assert(this->isA<T>());
+			return static_cast<const T*>(this);
+		}
+
 		template<typename T>
 		std::shared_ptr<T> downcast_pointer() noexcept
 		{
 			assert(this->isA<T>());
-			return std::dynamic_pointer_cast<T>(this->shared_from_this());
+			return std::static_pointer_cast<T>(this->shared_from_this());
 		}
 
     };
 }
+
+#include <tools/RttiFactory.h>
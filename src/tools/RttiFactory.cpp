@@ -36,11 +36,12 @@
 // +----------------------------------------------------------------------
 #include <tools/Rtti.h>
 #include <tools/RttiFactory.h>
+#include <tools/Logger.hpp>
+#include <cstdio>
+#include <cstring>
 
 using namespace rtti;
 
-__ImplementSingleton(Factory)
-
 Factory::Factory() noexcept
 {
 }
@@ -49,8 +50,40 @@ Factory::~Factory() noexcept
 {
 }
 
-bool rtti::Factory::add(class Rtti* rtti) noexcept
+Factory* Factory::instance() noexcept
+{
+	// Registration runs from static initializers of other translation units
+	static Factory factory;
+	return &factory;
+}
+
+bool Factory::add(const Rtti* rtti) noexcept
 {
-	_rttis.push_back(rtti);
+	auto result = _rttis.emplace(rtti->getId(), rtti);
+	if (!result.second && result.first->second != rtti)
+	{
+		LOG_ERROR("rtti::Factory : %s and %s share the id %08x\n",
+			result.first->second->getName(), rtti->getName(), rtti->getId());
+		assert(false);
+		return false;
+	}
 	return true;
 }
+
+const Rtti* Factory::getRtti(TypeId id) const noexcept
+{
+	auto it = _rttis.find(id);
+	return it != _rttis.end() ? it->second : nullptr;
+}
+
+const Rtti* Factory::getRtti(const char* name) const noexcept
+{
+	auto rtti = getRtti(hash(name));
+	return rtti && std::strcmp(rtti->getName(), name) == 0 ? rtti : nullptr;
+}
+
+Interface* Factory::create(TypeId id) const noexcept
+{
+	auto rtti = getRtti(id);
+	return rtti ? rtti->create() : nullptr;
+}
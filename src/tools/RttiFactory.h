@@ -36,23 +36,30 @@
 // +----------------------------------------------------------------------
 #pragma once
 
-#include <vector>
-#include <map>
-#include <tools/Singleton.h>
+#include <unordered_map>
+#include <tools/Rtti.h>
 
 namespace rtti
 {
+    // Every class implementing the Rtti macros, looked up by 'TypeId'
     class Factory final
     {
-		__DeclareSingleton(Factory)
 	public:
 		Factory() noexcept;
 		~Factory() noexcept;
 
-		bool add(class Rtti* rtti) noexcept;
+		static Factory* instance() noexcept;
+
+		// False when the id is taken, e.g. two classes of one name
+		bool add(const Rtti* rtti) noexcept;
+
+		const Rtti* getRtti(TypeId id) const noexcept;
+		const Rtti* getRtti(const char* name) const noexcept;
+
+		// nullptr unless the class was declared with __DeclareClass
+		Interface* create(TypeId id) const noexcept;
 
 	private:
-		mutable std::vector<Rtti*> _rttis;
-		mutable std::map<std::string, Rtti*> _rtti_lists;
+		std::unordered_map<TypeId, const Rtti*> _rttis;
     };
 }
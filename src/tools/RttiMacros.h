@@ -40,30 +40,32 @@ namespace rtti
 {
 #define _NAME 
 
+// The Rtti records are constant, so one may be used before any constructor
+// has run; the 'Registered' flags only add them to the factory.
 #define __DeclareSubInterface(Derived, Base)\
 public:\
-	static _NAME rtti::Rtti RTTI;\
-	static _NAME rtti::Rtti* getRtti() noexcept;\
-    virtual _NAME rtti::Rtti* rtti() const noexcept override;\
+	static constexpr _NAME rtti::Rtti RTTI = _NAME rtti::Rtti(#Derived, nullptr, Base::RTTI);\
+	static const _NAME rtti::Rtti* getRtti() noexcept { return &RTTI; }\
+    virtual const _NAME rtti::Rtti* rtti() const noexcept override;\
 private:
 
 #define __ImplementSubInterface(Derived, Base) \
-    _NAME rtti::Rtti Derived::RTTI = _NAME rtti::Rtti(#Derived, nullptr, Base::getRtti());\
-	_NAME rtti::Rtti* Derived::rtti() const noexcept { return &RTTI; }\
-	_NAME rtti::Rtti* Derived::getRtti() noexcept { return &RTTI; }
+    constexpr _NAME rtti::Rtti Derived::RTTI;\
+	const _NAME rtti::Rtti* Derived::rtti() const noexcept { return &RTTI; }\
+	static const bool Derived##Registered = _NAME rtti::Factory::instance()->add(&Derived::RTTI);
 
 #define __DeclareClass(Base) \
 public:\
-	static _NAME rtti::Rtti RTTI;\
-	static _NAME rtti::Rtti* getRtti() noexcept;\
 	static _NAME rtti::Interface* FactoryCreate(); \
-    virtual _NAME rtti::Rtti* rtti() const noexcept;\
+	static constexpr _NAME rtti::Rtti RTTI = _NAME rtti::Rtti(#Base, &Base::FactoryCreate);\
+	static const _NAME rtti::Rtti* getRtti() noexcept { return &RTTI; }\
+    virtual const _NAME rtti::Rtti* rtti() const noexcept;\
 private:
 
-#define __ImplementClass(Base, Name) \
-    _NAME rtti::Rtti Base::RTTI = _NAME rtti::Rtti(Name, Base::FactoryCreate, nullptr);\
-	_NAME rtti::Rtti* Base::rtti() const noexcept { return &RTTI; }\
-	_NAME rtti::Rtti* Base::getRtti() noexcept { return &RTTI; }\
+#define __ImplementClass(Base) \
+    constexpr _NAME rtti::Rtti Base::RTTI;\
+	const _NAME rtti::Rtti* Base::rtti() const noexcept { return &RTTI; }\
 	_NAME rtti::Interface* Base::FactoryCreate() { return new Base; }\
+	static const bool Base##Registered = _NAME rtti::Factory::instance()->add(&Base::RTTI);
 
 }
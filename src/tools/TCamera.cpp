@@ -22,6 +22,7 @@ TCamera::TCamera()
     m_fov = 45.0f;
     m_zNear = 0.1f;
     m_zFar = 1000.0f;
+    m_bDepthZeroToOne = false;
     setProjectionParams(m_fov, 1.0f, m_zNear, m_zFar);
 
     // Default view parameters
@@ -61,16 +62,43 @@ TCamera::TCamera()
 }
 
 void TCamera::setProjectionParams(float fov, float aspect, float zNear, float zFar)
+{
+    m_zFar = zFar;
+    setProjectionParams(fov, aspect, zNear);
+}
+
+void TCamera::setProjectionParams(float fov, float aspect, float zNear)
 {
     m_fov = fov;
     m_zNear = zNear;
-    m_zFar = zFar;
     m_aspect = aspect;
 
-    m_projectionMatrix = glm::perspective(m_fov, aspect, m_zNear, m_zFar);
+    // Same field of view as glm::perspective
+    const float focal = 1.f / std::tan(m_fov * 0.5f);
+
+    // z_ndc = near / -z_view, or twice that minus one for [-1, 1] depth
+    m_projectionMatrix = glm::mat4(0.f);
+    m_projectionMatrix[0][0] = focal / aspect;
+    m_projectionMatrix[1][1] = focal;
+    m_projectionMatrix[2][3] = -1.f;
+    if (m_bDepthZeroToOne)
+    {
+        m_projectionMatrix[3][2] = m_zNear;
+    }
+    else
+    {
+        m_projectionMatrix[2][2] = 1.f;
+        m_projectionMatrix[3][2] = 2.f * m_zNear;
+    }
     m_viewProjMatrix = m_projectionMatrix * m_viewMatrix;
 }
 
+void TCamera::setDepthZeroToOne(bool state)
+{
+    m_bDepthZeroToOne = state;
+    setProjectionParams(m_fov, m_aspect, m_zNear);
+}
+
 void TCamera::setViewParams(const glm::vec3 &pos, const glm::vec3 &target)
 {
     m_position = pos;
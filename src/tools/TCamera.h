@@ -46,6 +46,7 @@ protected:
     float m_aspect;
     float m_zNear;
     float m_zFar;
+    bool m_bDepthZeroToOne;             // clip space depth is [0, 1], see glClipControl
 
     // Look At parameters
     glm::vec3 m_position;               // camera (eye) position
@@ -87,7 +88,13 @@ public:
     void motionHandler(int x, int y, bool bClicked);
 
     // .SETTERS
+    // Reverse-Z with the far plane at infinity: depth is 1 at 'zNear' and
+    // reaches 0 at infinity. 'zFar' is only kept for getFar(), the projection
+    // ignores it, so callers with no use for it can leave it out.
     void setProjectionParams(float fov, float aspect, float zNear, float zFar);
+    void setProjectionParams(float fov, float aspect, float zNear);
+    // Without it, depth runs from 1 to -1 in clip space, halving the precision
+    void setDepthZeroToOne(bool state);
     void setViewParams(const glm::vec3 &pos, const glm::vec3 &target);
 
     void setMoveCoefficient(float coef) { m_moveCoef = coef; }
@@ -122,6 +129,7 @@ public:
     float getNear() const { return m_zNear; }
     float getFov() const { return m_fov; }
     float getAspect() const { return m_aspect; }
+    bool isDepthZeroToOne() const { return m_bDepthZeroToOne; }
 
     bool isXAxisLimited() const { return m_bLimitPitchAngle; }
     bool isXAxisInverted() const { return m_bInvertPitch; }
@@ -0,0 +1,124 @@
+#include <tools/ChunkedFile.h>
+#include <cstring>
+#include <cstdio>
+#include "Test.h"
+
+namespace
+{
+    const char* Filename = "ChunkedFileTest.zchk";
+
+    // Offsets in the layout described in ChunkedFile.h
+    const std::size_t ChunkSizeOffset = 8;
+    const std::size_t PlainSizeOffset = 16;
+    const std::size_t EntriesOffset = 24;
+    const std::size_t EntrySize = 16;
+
+    std::vector<char> makeData(std::size_t size)
+    {
+        std::vector<char> data(size);
+        for (std::size_t i = 0; i < size; i++)
+            data[i] = static_cast<char>((i * 7) ^ (i >> 5));
+        return data;
+    }
+
+    template<typename T>
+    void patch(util::BytesArray& file, std::size_t offset, T value)
+    {
+        std::memcpy(file->data() + offset, &value, sizeof(T));
+    }
+
+    bool isRejected(const util::BytesArray& file)
+    {
+        bool bDecompressed = !ChunkedFile::decompress(file->data(), file->size())->empty();
+
+        ChunkedFile chunked;
+        util::WriteFileSync(Filename, file);
+        bool bOpened = chunked.open(Filename);
+        return !bDecompressed && !bOpened;
+    }
+
+    void testRoundTrip()
+    {
+        const std::uint32_t chunkSize = 64;
+        for (std::size_t size : { 1, 63, 64, 65, 64 * 3 + 17 })
+        {
+            auto data = makeData(size);
+            auto file = ChunkedFile::compress(data.data(), data.size(), chunkSize);
+            CHECK(ChunkedFile::isChunked(file->data(), file->size()));
+
+            auto plain = ChunkedFile::decompress(file->data(), file->size());
+            CHECK(plain->size() == size && std::memcmp(plain->data(), data.data(), size) == 0);
+
+            ChunkedFile chunked;
+            CHECK(util::WriteFileSync(Filename, file));
+            CHECK(chunked.open(Filename));
+            CHECK_EQUAL(chunked.getSize(), std::uint64_t(size));
+            CHECK_EQUAL(chunked.getChunkCount(), std::uint32_t((size + chunkSize - 1) / chunkSize));
+
+            // A range across a block boundary, then reads past the end are cut short
+            std::vector<char> buffer(size);
+            std::size_t offset = size / 2;
+            CHECK_EQUAL(chunked.readAt(offset, buffer.data(), size), size - offset);
+            CHECK(std::memcmp(buffer.data(), data.data() + offset, size - offset) == 0);
+
+            CHECK(chunked.seek(0));
+            CHECK_EQUAL(chunked.read(buffer.data(), size), size);
+            CHECK(std::memcmp(buffer.data(), data.data(), size) == 0);
+            CHECK_EQUAL(chunked.read(buffer.data(), 1), 0u);
+        }
+    }
+
+    void testCorruptIndex()
+    {
+        // Two full blocks of 10 bytes
+        auto data = makeData(20);
+        auto file = ChunkedFile::compress(data.data(), data.size(), 10);
+        CHECK(!isRejected(file));
+
+        // Sizes that still add up, 5 + 10 = 15, would inflate the second block past the end
+        auto shortFirst = std::make_shared<util::FileContainer>(*file);
+        patch(shortFirst, PlainSizeOffset, std::uint64_t(15));
+        patch(shortFirst, EntriesOffset + 12, std::uint32_t(5));
+        CHECK(isRejected(shortFirst));
+
+        // A short last block that does not match the total
+        auto shortLast = std::make_shared<util::FileContainer>(*file);
+        patch(shortLast, EntriesOffset + EntrySize + 12, std::uint32_t(5));
+        CHECK(isRejected(shortLast));
+
+        // More blocks than the plain size needs
+        auto extraBlock = std::make_shared<util::FileContainer>(*file);
+        patch(extraBlock, PlainSizeOffset, std::uint64_t(10));
+        patch(extraBlock, EntriesOffset + EntrySize + 12, std::uint32_t(0));
+        CHECK(isRejected(extraBlock));
+
+        // A plain size that wraps around when rounded up to whole blocks
+        auto empty = ChunkedFile::compress(data.data(), 0, 10);
+        patch(empty, ChunkSizeOffset, std::uint32_t(2));
+        patch(empty, PlainSizeOffset, ~std::uint64_t(0));
+        CHECK(isRejected(empty));
+    }
+
+    void testTruncated()
+    {
+        auto data = makeData(1000);
+        auto file = ChunkedFile::compress(data.data(), data.size(), 100);
+
+        // Within the zlib streams, within the index and within the header
+        for (std::size_t size : { file->size() - 1, EntriesOffset + EntrySize * 3, std::size_t(20) })
+        {
+            auto truncated = std::make_shared<util::FileContainer>(file->begin(), file->begin() + size);
+            CHECK(isRejected(truncated));
+        }
+    }
+}
+
+int main()
+{
+    testRoundTrip();
+    testCorruptIndex();
+    testTruncated();
+
+    std::remove(Filename);
+    return test::result();
+}
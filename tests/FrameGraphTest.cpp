@@ -0,0 +1,303 @@
+#include <FrameGraph.h>
+#include <GL/glew.h>
+#include <GLType/GraphicsDevice.h>
+#include <GLType/GraphicsTexture.h>
+#include <gli/gli.hpp>
+#include <string>
+#include <vector>
+#include "Test.h"
+
+// Stands in for the GL device, so the graph runs without a context
+class MockTexture final : public GraphicsTexture
+{
+    __DeclareSubInterface(MockTexture, GraphicsTexture)
+public:
+
+    MockTexture(const GraphicsTextureDesc& desc) noexcept
+        : m_SamplerChanges(0)
+        , m_Desc(desc)
+    {
+    }
+
+    bool map(std::uint32_t, std::uint8_t**) noexcept override { return false; }
+    bool map(std::uint32_t, std::uint32_t, std::uint32_t, std::uint32_t, std::uint32_t, std::uint32_t, std::uint32_t, std::uint8_t**) noexcept override { return false; }
+    void unmap() noexcept override {}
+
+    const GraphicsTextureDesc& getGraphicsTextureDesc() const noexcept override { return m_Desc; }
+    const GraphicsFramebufferPtr& getGraphicsRenderTarget() const noexcept override { return m_RenderTarget; }
+
+    void setSamplerState(const GraphicsTextureDesc& desc) noexcept override
+    {
+        m_Desc.setWrapS(desc.getWrapS());
+        m_Desc.setWrapT(desc.getWrapT());
+        m_Desc.setWrapR(desc.getWrapR());
+        m_Desc.setMinFilter(desc.getMinFilter());
+        m_Desc.setMagFilter(desc.getMagFilter());
+        m_Desc.setAnisotropyLevel(desc.getAnisotropyLevel());
+        m_SamplerChanges++;
+    }
+
+    std::uint32_t m_SamplerChanges;
+
+private:
+
+    void setGraphicsRenderTarget(const GraphicsFramebufferPtr& target) noexcept override { m_RenderTarget = target; }
+
+    GraphicsTextureDesc m_Desc;
+    GraphicsFramebufferPtr m_RenderTarget;
+};
+
+class MockDevice final : public GraphicsDevice
+{
+    __DeclareSubInterface(MockDevice, GraphicsDevice)
+public:
+
+    MockDevice() noexcept
+        : m_TextureCount(0)
+    {
+    }
+
+    GraphicsDataPtr createGraphicsData(const GraphicsDataDesc&) noexcept override { return nullptr; }
+    GraphicsTexturePtr createTexture(const gli::texture&, bool) noexcept override { return nullptr; }
+    GraphicsFramebufferPtr createFramebuffer(const GraphicsFramebufferDesc&) noexcept override { return nullptr; }
+    void setFramebuffer(const GraphicsFramebufferPtr&) noexcept override {}
+    const GraphicsDeviceDesc& getGraphicsDeviceDesc() const noexcept override { return m_Desc; }
+
+    GraphicsTexturePtr createTexture(const GraphicsTextureDesc& desc) noexcept override
+    {
+        m_TextureCount++;
+        return std::make_shared<MockTexture>(desc);
+    }
+
+    std::uint32_t m_TextureCount;
+
+private:
+
+    GraphicsDeviceDesc m_Desc;
+};
+
+__ImplementSubInterface(MockTexture, GraphicsTexture)
+__ImplementSubInterface(MockDevice, GraphicsDevice)
+
+namespace
+{
+    GraphicsTextureDesc makeDesc(int32_t width, int32_t height, gli::format format, uint32_t wrap = GL_REPEAT)
+    {
+        GraphicsTextureDesc desc;
+        desc.setWidth(width);
+        desc.setHeight(height);
+        desc.setFormat(format);
+        desc.setWrapS(wrap);
+        desc.setWrapT(wrap);
+        return desc;
+    }
+
+    void noExecute(const FrameGraphResources&)
+    {
+    }
+
+    void testCulling()
+    {
+        FrameGraph graph;
+        auto desc = makeDesc(64, 64, gli::FORMAT_RGBA16_SFLOAT_PACK16);
+        auto imported = std::make_shared<MockTexture>(desc);
+
+        FrameGraphResource a, b, x, target;
+        target = graph.importTexture("Target", imported);
+        graph.addPass("A", [&](FrameGraphBuilder& builder) { a = builder.create("A", desc); }, noExecute);
+        graph.addPass("B", [&](FrameGraphBuilder& builder) { builder.read(a); b = builder.create("B", desc); }, noExecute);
+        graph.addPass("Present", [&](FrameGraphBuilder& builder) { builder.read(b); builder.setSideEffect(); }, noExecute);
+
+        // Nothing reads X or what is made from it
+        graph.addPass("Orphan", [&](FrameGraphBuilder& builder) { builder.read(a); x = builder.create("X", desc); }, noExecute);
+        graph.addPass("OrphanChild", [&](FrameGraphBuilder& builder) { builder.read(x); builder.create("Y", desc); }, noExecute);
+
+        // Writes to imported resources are seen outside of the graph
+        graph.addPass("Export", [&](FrameGraphBuilder& builder) { target = builder.write(target); }, noExecute);
+
+        CHECK(graph.compile());
+        CHECK(!graph.isCulled("A"));
+        CHECK(!graph.isCulled("B"));
+        CHECK(!graph.isCulled("Present"));
+        CHECK(graph.isCulled("Orphan"));
+        CHECK(graph.isCulled("OrphanChild"));
+        CHECK(!graph.isCulled("Export"));
+        CHECK_EQUAL(graph.getFirstPass(x), -1);
+    }
+
+    void testLifetime()
+    {
+        FrameGraph graph;
+        auto desc = makeDesc(64, 64, gli::FORMAT_RGBA16_SFLOAT_PACK16);
+
+        FrameGraphResource a, b, c;
+        graph.addPass("P0", [&](FrameGraphBuilder& builder) { a = builder.create("A", desc); }, noExecute);
+        graph.addPass("P1", [&](FrameGraphBuilder& builder) { builder.read(a); b = builder.create("B", desc); }, noExecute);
+        graph.addPass("P2", [&](FrameGraphBuilder& builder) { builder.read(b); c = builder.create("C", desc); }, noExecute);
+        graph.addPass("P3", [&](FrameGraphBuilder& builder) {
+            builder.read(a);
+            builder.read(c);
+            builder.setSideEffect();
+        }, noExecute);
+
+        CHECK(graph.compile());
+        CHECK_EQUAL(graph.getFirstPass(a), 0);
+        CHECK_EQUAL(graph.getLastPass(a), 3);
+        CHECK_EQUAL(graph.getFirstPass(b), 1);
+        CHECK_EQUAL(graph.getLastPass(b), 2);
+        CHECK_EQUAL(graph.getFirstPass(c), 2);
+        CHECK_EQUAL(graph.getLastPass(c), 3);
+
+        // A new version of a resource extends the lifetime of the entry
+        FrameGraphResource d, d2;
+        graph.reset();
+        graph.addPass("P0", [&](FrameGraphBuilder& builder) { d = builder.create("D", desc); }, noExecute);
+        graph.addPass("P1", [&](FrameGraphBuilder& builder) { builder.read(d); d2 = builder.write(d); }, noExecute);
+        graph.addPass("P2", [&](FrameGraphBuilder& builder) { builder.read(d2); builder.setSideEffect(); }, noExecute);
+
+        CHECK(graph.compile());
+        CHECK_EQUAL(graph.getFirstPass(d), 0);
+        CHECK_EQUAL(graph.getLastPass(d), 2);
+        CHECK_EQUAL(graph.getPhysicalIndex(d), graph.getPhysicalIndex(d2));
+    }
+
+    void testAliasing()
+    {
+        FrameGraph graph;
+        auto desc = makeDesc(64, 64, gli::FORMAT_RGBA16_SFLOAT_PACK16);
+        auto clampDesc = makeDesc(64, 64, gli::FORMAT_RGBA16_SFLOAT_PACK16, GL_CLAMP_TO_EDGE);
+        auto lumaDesc = makeDesc(64, 64, gli::FORMAT_R16_SFLOAT_PACK16);
+
+        // A [0, 1], B [1, 2], C [2, 3] and D [2, 3]
+        FrameGraphResource a, b, c, d;
+        graph.addPass("P0", [&](FrameGraphBuilder& builder) { a = builder.create("A", desc); }, noExecute);
+        graph.addPass("P1", [&](FrameGraphBuilder& builder) { builder.read(a); b = builder.create("B", desc); }, noExecute);
+        graph.addPass("P2", [&](FrameGraphBuilder& builder) {
+            builder.read(b);
+            c = builder.create("C", clampDesc);
+            d = builder.create("D", lumaDesc);
+        }, noExecute);
+        graph.addPass("P3", [&](FrameGraphBuilder& builder) {
+            builder.read(c);
+            builder.read(d);
+            builder.setSideEffect();
+        }, noExecute);
+
+        CHECK(graph.compile());
+
+        // Only the sampler state of C differs, it still takes the slot A left
+        CHECK_EQUAL(graph.getPhysicalIndex(a), graph.getPhysicalIndex(c));
+        CHECK(graph.getPhysicalIndex(a) != graph.getPhysicalIndex(b));
+        CHECK(graph.getPhysicalIndex(d) != graph.getPhysicalIndex(a));
+        CHECK(graph.getPhysicalIndex(d) != graph.getPhysicalIndex(b));
+        CHECK_EQUAL(graph.getPhysicalCount(), 3u);
+        CHECK(graph.getTransientMemory() < graph.getUnaliasedMemory());
+
+        // Slots not needed anymore are released, not only the trailing ones
+        FrameGraphResource e;
+        graph.reset();
+        graph.addPass("P0", [&](FrameGraphBuilder& builder) {
+            e = builder.create("E", lumaDesc);
+            builder.setSideEffect();
+        }, noExecute);
+
+        CHECK(graph.compile());
+        CHECK_EQUAL(graph.getPhysicalCount(), 1u);
+        CHECK_EQUAL(graph.getPhysicalIndex(e), 0u);
+        CHECK_EQUAL(graph.getTransientMemory(), graph.getUnaliasedMemory());
+    }
+
+    struct PassData
+    {
+        FrameGraphResource output;
+        int value;
+    };
+
+    void testExecute()
+    {
+        FrameGraph graph;
+        auto device = std::make_shared<MockDevice>();
+        auto desc = makeDesc(64, 64, gli::FORMAT_RGBA16_SFLOAT_PACK16);
+        auto clampDesc = makeDesc(64, 64, gli::FORMAT_RGBA16_SFLOAT_PACK16, GL_CLAMP_TO_EDGE);
+        auto captured = std::make_shared<int>(0);
+
+        std::vector<std::string> order;
+        std::vector<uint32_t> wraps;
+        const PassData* frameData[2] = {};
+        for (int frame = 0; frame < 2; frame++)
+        {
+            graph.reset();
+
+            auto& first = graph.addPass<PassData>("First",
+                [&](FrameGraphBuilder& builder, PassData& data) {
+                    data.output = builder.create("A", desc);
+                    data.value = frame + 1;
+                },
+                [&, captured](const PassData& data, const FrameGraphResources& resources) {
+                    order.push_back("First" + std::to_string(data.value));
+                    wraps.push_back(resources.getTexture(data.output)->getGraphicsTextureDesc().getWrapS());
+                });
+            frameData[frame] = &first;
+
+            graph.addPass<PassData>("Second",
+                [&](FrameGraphBuilder& builder, PassData& data) {
+                    builder.read(first.output);
+                    data.output = builder.create("B", desc);
+                    builder.setSideEffect();
+                },
+                [&](const PassData&, const FrameGraphResources&) { order.push_back("Second"); });
+
+            graph.addPass<PassData>("Culled",
+                [&](FrameGraphBuilder& builder, PassData& data) { data.output = builder.create("Unused", desc); },
+                [&](const PassData&, const FrameGraphResources&) { order.push_back("Culled"); });
+
+            graph.addPass<PassData>("Third",
+                [&](FrameGraphBuilder& builder, PassData& data) {
+                    builder.read(first.output);
+                    data.output = builder.create("C", clampDesc);
+                    builder.setSideEffect();
+                },
+                [&](const PassData& data, const FrameGraphResources& resources) {
+                    order.push_back("Third");
+                    wraps.push_back(resources.getTexture(data.output)->getGraphicsTextureDesc().getWrapS());
+                });
+
+            CHECK(graph.compile());
+            graph.execute(device);
+        }
+
+        // Culled passes do not run; the rest run in the order they were added
+        const char* expected[] = { "First1", "Second", "Third", "First2", "Second", "Third" };
+        CHECK_EQUAL(order.size(), 6u);
+        for (std::size_t i = 0; i < order.size() && i < 6; i++)
+            CHECK_EQUAL(order[i], expected[i]);
+
+        // A stable graph keeps its textures and its pass storage
+        CHECK_EQUAL(device->m_TextureCount, graph.getPhysicalCount());
+        CHECK_EQUAL(frameData[0], frameData[1]);
+
+        // The slot of B is taken by C with other wrap modes, and set back for B
+        const uint32_t expectedWraps[] = { GL_REPEAT, GL_CLAMP_TO_EDGE, GL_REPEAT, GL_CLAMP_TO_EDGE };
+        CHECK_EQUAL(wraps.size(), 4u);
+        for (std::size_t i = 0; i < wraps.size() && i < 4; i++)
+            CHECK_EQUAL(wraps[i], expectedWraps[i]);
+
+        auto& report = graph.getReport();
+        CHECK_EQUAL(report.size(), 4u);
+        CHECK(report.size() == 4u && report[2].bCulled);
+
+        // What the passes captured is released with them
+        CHECK(captured.use_count() > 1);
+        graph.reset();
+        CHECK_EQUAL(captured.use_count(), 1);
+    }
+}
+
+int main()
+{
+    testCulling();
+    testLifetime();
+    testAliasing();
+    testExecute();
+    return test::result();
+}
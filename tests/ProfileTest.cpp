@@ -0,0 +1,132 @@
+#include <tools/Profile.h>
+#include <thread>
+#include <cstring>
+#include "Test.h"
+
+namespace
+{
+    const profiler::ZoneReport* findZone(const std::vector<profiler::ZoneReport>& report, const std::string& name, uint32_t depth)
+    {
+        for (const auto& zone : report)
+        {
+            if (zone.name == name && zone.depth == depth)
+                return &zone;
+        }
+        return nullptr;
+    }
+
+    uint32_t getCalls(const std::vector<profiler::ZoneReport>& report, const std::string& name, uint32_t depth)
+    {
+        auto zone = findZone(report, name, depth);
+        return zone ? zone->calls : 0;
+    }
+
+    // One call site, several names, like the frame graph passes
+    void runPass(const char* name)
+    {
+        PROFILE_SCOPE(name);
+    }
+
+    void work(uint32_t count)
+    {
+        for (uint32_t i = 0; i < count; i++)
+        {
+            PROFILE_SCOPE("Work");
+            runPass("Inner");
+        }
+    }
+
+    void testCallSiteNames()
+    {
+        profiler::initialize();
+        runPass("A");
+        runPass("B");
+        runPass("A");
+
+        // The same buffer holding another name is another zone
+        char buffer[8];
+        std::strcpy(buffer, "C");
+        runPass(buffer);
+        std::strcpy(buffer, "D");
+        runPass(buffer);
+        profiler::endFrame();
+
+        auto report = profiler::getReport();
+        CHECK_EQUAL(report.size(), 5u);
+        CHECK_EQUAL(getCalls(report, "Frame", 0), 1u);
+        CHECK_EQUAL(getCalls(report, "A", 1), 2u);
+        CHECK_EQUAL(getCalls(report, "B", 1), 1u);
+        CHECK_EQUAL(getCalls(report, "C", 1), 1u);
+        CHECK_EQUAL(getCalls(report, "D", 1), 1u);
+
+        // Children are listed after their parent, in order of first use
+        CHECK(report[1].name == "A" && report[2].name == "B");
+
+        // Counts are per frame
+        runPass("B");
+        profiler::endFrame();
+        report = profiler::getReport();
+        CHECK_EQUAL(getCalls(report, "A", 1), 0u);
+        CHECK_EQUAL(getCalls(report, "B", 1), 1u);
+        profiler::shutdown();
+    }
+
+    void testThreads()
+    {
+        profiler::initialize();
+
+        // Each thread counts on its own, the frame sums them
+        const uint32_t threadCount = 4, count = 1000;
+        std::vector<std::thread> threads;
+        for (uint32_t i = 0; i < threadCount; i++)
+            threads.emplace_back(work, count);
+        for (auto& thread : threads)
+            thread.join();
+        work(count);
+        profiler::endFrame();
+
+        auto report = profiler::getReport();
+        CHECK_EQUAL(report.size(), 3u);
+        CHECK_EQUAL(getCalls(report, "Work", 1), (threadCount + 1) * count);
+        CHECK_EQUAL(getCalls(report, "Inner", 2), (threadCount + 1) * count);
+        CHECK(findZone(report, "Work", 1)->cpu.samples == 1);
+
+        // Exited threads have nothing left to add
+        profiler::endFrame();
+        CHECK_EQUAL(getCalls(profiler::getReport(), "Work", 1), 0u);
+        profiler::shutdown();
+    }
+
+    void testReinitialize()
+    {
+        // Cached call sites must not reuse the zones of the last run
+        profiler::initialize();
+        runPass("Other");
+        work(1);
+        profiler::endFrame();
+        profiler::shutdown();
+
+        // Nothing is recorded while shut down
+        work(1);
+        CHECK(profiler::getReport().empty());
+
+        profiler::initialize();
+        work(2);
+        profiler::endFrame();
+
+        auto report = profiler::getReport();
+        CHECK_EQUAL(report.size(), 3u);
+        CHECK_EQUAL(getCalls(report, "Work", 1), 2u);
+        CHECK_EQUAL(getCalls(report, "Inner", 2), 2u);
+        CHECK(findZone(report, "Other", 1) == nullptr);
+        profiler::shutdown();
+    }
+}
+
+int main()
+{
+    testCallSiteNames();
+    testThreads();
+    testReinitialize();
+    return test::result();
+}
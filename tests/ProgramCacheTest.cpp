@@ -0,0 +1,164 @@
+#include <GLType/ProgramCache.h>
+#include <tools/FileUtility.h>
+#include <cstdio>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include "Test.h"
+
+namespace
+{
+    const char* CacheDirectory = "ProgramCacheTest.cache";
+    const std::uint32_t VertexStage = 0x8B31;
+    const std::uint32_t FragmentStage = 0x8B30;
+
+    std::vector<ProgramCacheSource> makeSources(const std::string& vertex, const std::string& fragment)
+    {
+        return { { VertexStage, vertex }, { FragmentStage, fragment } };
+    }
+
+    bool exists(const std::string& path)
+    {
+        return std::ifstream(path).good();
+    }
+
+    // Rewrites one byte of an entry on disk
+    void corrupt(const std::string& path, std::size_t offset)
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekg(offset);
+        char c = 0;
+        file.read(&c, 1);
+        c ^= 0x5a;
+        file.seekp(offset);
+        file.write(&c, 1);
+    }
+
+    void truncate(const std::string& path, std::size_t size)
+    {
+        auto file = util::ReadFileSync(path);
+        auto shorter = std::make_shared<util::FileContainer>(file->begin(), file->begin() + std::min(size, file->size()));
+        util::WriteFileSync(path, shorter);
+    }
+
+    void testKey()
+    {
+        auto sources = makeSources("void main() {}", "out vec4 c; void main() { c = vec4(1); }");
+        auto key = ProgramCache::computeKey(sources, "#define A\n", "vendor 1.0");
+
+        // Stable for the same inputs, and across instances
+        CHECK_EQUAL(key, ProgramCache::computeKey(sources, "#define A\n", "vendor 1.0"));
+        ProgramCache cache;
+        cache.setDriver("vendor 1.0");
+        CHECK_EQUAL(key, cache.computeKey(sources, "#define A\n"));
+
+        // Any input changes it
+        CHECK(key != ProgramCache::computeKey(sources, "#define B\n", "vendor 1.0"));
+        CHECK(key != ProgramCache::computeKey(sources, "#define A\n", "vendor 1.1"));
+        CHECK(key != ProgramCache::computeKey(makeSources("void main() { }", sources[1].source), "#define A\n", "vendor 1.0"));
+
+        auto swapped = sources;
+        std::swap(swapped[0].stage, swapped[1].stage);
+        CHECK(key != ProgramCache::computeKey(swapped, "#define A\n", "vendor 1.0"));
+
+        // Text moved from one field to the next is not the same program
+        CHECK(ProgramCache::computeKey(makeSources("ab", "c"), "", "")
+            != ProgramCache::computeKey(makeSources("a", "bc"), "", ""));
+        CHECK(ProgramCache::computeKey(sources, "x", "")
+            != ProgramCache::computeKey(sources, "", "x"));
+    }
+
+    void testStoreAndReload()
+    {
+        const std::uint64_t key = 0x0123456789abcdefull;
+        const std::vector<std::uint8_t> binary = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+
+        ProgramCache cache;
+        CHECK(cache.create(CacheDirectory));
+        cache.remove(key);
+
+        std::uint32_t format = 0;
+        std::vector<std::uint8_t> loaded;
+        CHECK(!cache.load(key, format, loaded));
+
+        // Written under a temporary name and renamed, none is left behind
+        CHECK(cache.store(key, 42, binary));
+        CHECK(exists(cache.getPath(key)));
+        CHECK(!exists(cache.getPath(key) + ".tmp"));
+
+        CHECK(cache.load(key, format, loaded));
+        CHECK_EQUAL(format, 42u);
+        CHECK(loaded == binary);
+
+        // Another run finds it, and a newer binary replaces it
+        ProgramCache reloaded;
+        CHECK(reloaded.create(CacheDirectory));
+        loaded.clear();
+        CHECK(reloaded.load(key, format, loaded));
+        CHECK(loaded == binary);
+
+        const std::vector<std::uint8_t> newer = { 9, 8, 7 };
+        CHECK(reloaded.store(key, 43, newer));
+        CHECK(cache.load(key, format, loaded));
+        CHECK_EQUAL(format, 43u);
+        CHECK(loaded == newer);
+
+        cache.remove(key);
+        CHECK(!exists(cache.getPath(key)));
+        CHECK(!cache.load(key, format, loaded));
+
+        // Without a directory nothing is cached
+        ProgramCache disabled;
+        CHECK(!disabled.store(key, 42, binary));
+        CHECK(!disabled.load(key, format, loaded));
+    }
+
+    void testMismatch()
+    {
+        const std::uint64_t key = 0xfedcba9876543210ull;
+        const std::vector<std::uint8_t> binary(256, 0xab);
+
+        ProgramCache cache;
+        CHECK(cache.create(CacheDirectory));
+
+        // Each failure makes 'ProgramShader::link' compile from source instead
+        std::uint32_t format = 0;
+        std::vector<std::uint8_t> loaded;
+        auto path = cache.getPath(key);
+
+        // Damaged binary, past the 32 byte header
+        CHECK(cache.store(key, 1, binary));
+        corrupt(path, 32 + 100);
+        CHECK(!cache.load(key, format, loaded));
+
+        // Damaged header
+        CHECK(cache.store(key, 1, binary));
+        corrupt(path, 0);
+        CHECK(!cache.load(key, format, loaded));
+
+        // Torn write
+        CHECK(cache.store(key, 1, binary));
+        truncate(path, 100);
+        CHECK(!cache.load(key, format, loaded));
+        truncate(path, 8);
+        CHECK(!cache.load(key, format, loaded));
+
+        // An entry found under another key's name
+        const std::uint64_t otherKey = key + 1;
+        CHECK(cache.store(otherKey, 1, binary));
+        std::remove(path.c_str());
+        std::rename(cache.getPath(otherKey).c_str(), path.c_str());
+        CHECK(!cache.load(key, format, loaded));
+
+        CHECK(loaded.empty());
+        cache.remove(key);
+    }
+}
+
+int main()
+{
+    testKey();
+    testStoreAndReload();
+    testMismatch();
+    return test::result();
+}
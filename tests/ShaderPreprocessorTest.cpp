@@ -0,0 +1,137 @@
+#include <GLType/ShaderPreprocessor.h>
+#include <cstdio>
+#include <fstream>
+#include <algorithm>
+#include "Test.h"
+
+namespace
+{
+    // Include files live next to the test binary
+    const char* Outer = "ShaderPreprocessorTest_Outer.glsli";
+    const char* Inner = "ShaderPreprocessorTest_Inner.glsli";
+    const char* Missing = "ShaderPreprocessorTest_Missing.glsli";
+
+    void writeFile(const std::string& path, const std::string& content)
+    {
+        std::ofstream file(path, std::ios::binary);
+        file << content;
+    }
+
+    bool contains(const std::string& text, const std::string& part)
+    {
+        return text.find(part) != std::string::npos;
+    }
+
+    bool contains(const std::vector<std::string>& list, const std::string& item)
+    {
+        return std::find(list.begin(), list.end(), item) != list.end();
+    }
+
+    void testNestedIncludes()
+    {
+        writeFile(Inner, "float inner() { return 1.0; }\n");
+        writeFile(Outer, std::string("#include \"") + Inner + "\"\nfloat outer() { return inner(); }\n");
+
+        ShaderPreprocessor preprocessor;
+        preprocessor.setDirectories({ "." });
+        preprocessor.setLineMarker(ShaderLineMarkerNone);
+
+        const std::string source = std::string("void main() {}\n#version 330\n#include \"") + Outer + "\"\n";
+        auto text = preprocessor.process("Effect.Vertex", source, "#define A\n");
+
+        // '#version' comes first, then the defines, then the nested text in order
+        CHECK_EQUAL(text.compare(0, 13, "#version 330\n"), 0);
+        CHECK(contains(text, "#define A\n"));
+        CHECK(text.find("float inner()") < text.find("float outer()"));
+        CHECK(!contains(text, "#include"));
+
+        auto dependencies = preprocessor.getDependencies("Effect.Vertex");
+        CHECK_EQUAL(dependencies.size(), 2u);
+        CHECK(contains(dependencies, Outer));
+        CHECK(contains(dependencies, Inner));
+        CHECK_EQUAL(preprocessor.getFileReads(), 2u);
+
+        // Same input, cached expansion
+        CHECK(preprocessor.process("Effect.Vertex", source, "#define A\n") == text);
+        CHECK_EQUAL(preprocessor.getCacheHits(), 1u);
+        CHECK_EQUAL(preprocessor.getFileReads(), 2u);
+    }
+
+    void testInvalidate()
+    {
+        writeFile(Inner, "float inner() { return 1.0; }\n");
+        writeFile(Outer, std::string("#include \"") + Inner + "\"\n");
+
+        ShaderPreprocessor preprocessor;
+        preprocessor.setDirectories({ "." });
+        preprocessor.setLineMarker(ShaderLineMarkerNone);
+
+        const std::string source = std::string("#include \"") + Outer + "\"\n";
+        const std::string other = std::string("#include \"") + Inner + "\"\n";
+        preprocessor.process("A.Fragment", source, "");
+        preprocessor.process("B.Fragment", other, "");
+        preprocessor.process("C.Fragment", "void main() {}\n", "");
+
+        // Both shaders read the nested file, only one the outer
+        auto dependents = preprocessor.getDependents(Inner);
+        CHECK_EQUAL(dependents.size(), 2u);
+        CHECK(contains(dependents, "A.Fragment"));
+        CHECK(contains(dependents, "B.Fragment"));
+        CHECK_EQUAL(preprocessor.getDependents(Outer).size(), 1u);
+        // Paths are compared normalized
+        CHECK_EQUAL(preprocessor.getDependents(std::string("./") + Inner).size(), 2u);
+
+        // An edit of the nested file reaches the shader including it indirectly
+        writeFile(Inner, "float edited() { return 2.0; }\n");
+        CHECK(preprocessor.invalidate(Inner) == dependents);
+
+        auto reads = preprocessor.getFileReads();
+        auto text = preprocessor.process("A.Fragment", source, "");
+        CHECK(contains(text, "float edited()"));
+        CHECK(!contains(text, "float inner()"));
+        // The outer file is still cached, the edited one is read again
+        CHECK_EQUAL(preprocessor.getFileReads(), reads + 1);
+
+        CHECK(preprocessor.invalidate("Unrelated.glsli").empty());
+        preprocessor.clear();
+        CHECK(preprocessor.getDependencies("A.Fragment").empty());
+    }
+
+    void testMissingInclude()
+    {
+        std::remove(Missing);
+
+        ShaderPreprocessor preprocessor;
+        preprocessor.setDirectories({ ".", "./shaders" });
+        preprocessor.setLineMarker(ShaderLineMarkerNone);
+
+        const std::string source = std::string("#include \"") + Missing + "\"\nvoid main() {}\n";
+        auto text = preprocessor.process("Effect.Vertex", source, "");
+        CHECK(contains(text, "void main()"));
+
+        // Recorded under every directory searched
+        auto dependencies = preprocessor.getDependencies("Effect.Vertex");
+        CHECK(contains(dependencies, Missing));
+        CHECK(contains(dependencies, std::string("shaders/") + Missing));
+
+        // Creating it later rebuilds the shader with its content
+        writeFile(Missing, "float found() { return 1.0; }\n");
+        auto dependents = preprocessor.invalidate(Missing);
+        CHECK_EQUAL(dependents.size(), 1u);
+        CHECK(contains(dependents, "Effect.Vertex"));
+        CHECK(contains(preprocessor.process("Effect.Vertex", source, ""), "float found()"));
+
+        std::remove(Missing);
+    }
+}
+
+int main()
+{
+    testNestedIncludes();
+    testInvalidate();
+    testMissingInclude();
+
+    std::remove(Outer);
+    std::remove(Inner);
+    return test::result();
+}
@@ -0,0 +1,127 @@
+#include <GLType/Std140.h>
+#include <FrameConstants.h>
+#include <cstring>
+#include "Test.h"
+
+namespace
+{
+    template<typename T>
+    T readAt(const Std140Writer& writer, std::size_t offset)
+    {
+        T value;
+        std::memcpy(&value, writer.getData() + offset, sizeof(T));
+        return value;
+    }
+
+    void testScalarsAndVectors()
+    {
+        Std140Writer writer;
+        CHECK_EQUAL(writer.write(1.f), 0u);
+        // vec2 on 8 bytes, vec3 and vec4 on 16
+        CHECK_EQUAL(writer.write(glm::vec2(2.f)), 8u);
+        CHECK_EQUAL(writer.write(glm::vec3(3.f)), 16u);
+        // A scalar fills the last word of a vec3, a vector does not
+        CHECK_EQUAL(writer.write(4), 28u);
+        CHECK_EQUAL(writer.write(glm::vec3(5.f)), 32u);
+        CHECK_EQUAL(writer.write(glm::vec3(6.f)), 48u);
+        CHECK_EQUAL(writer.write(glm::vec2(7.f)), 64u);
+        CHECK_EQUAL(writer.write(glm::vec4(8.f)), 80u);
+        CHECK_EQUAL(writer.write(true), 96u);
+        CHECK_EQUAL(readAt<std::uint32_t>(writer, 96), 1u);
+        CHECK_EQUAL(writer.getOffset(), 100u);
+        // Rounded up to a vec4
+        CHECK_EQUAL(writer.getSize(), 112u);
+
+        writer.reset();
+        CHECK_EQUAL(writer.getOffset(), 0u);
+        CHECK_EQUAL(writer.getSize(), 0u);
+    }
+
+    void testArraysAndMatrices()
+    {
+        Std140Writer writer;
+        const float floats[3] = { 1.f, 2.f, 3.f };
+        const glm::vec2 vec2s[2] = { glm::vec2(4.f, 5.f), glm::vec2(6.f, 7.f) };
+
+        // Arrays start on a vec4 and every element takes a whole vec4
+        writer.write(0.f);
+        CHECK_EQUAL(writer.write(floats, 3), 16u);
+        CHECK_EQUAL(readAt<float>(writer, 16), 1.f);
+        CHECK_EQUAL(readAt<float>(writer, 32), 2.f);
+        CHECK_EQUAL(readAt<float>(writer, 48), 3.f);
+        // Nothing is packed after an array
+        CHECK_EQUAL(writer.write(0.f), 64u);
+
+        CHECK_EQUAL(writer.write(vec2s, 2), 80u);
+        CHECK_EQUAL(readAt<glm::vec2>(writer, 96), vec2s[1]);
+        CHECK_EQUAL(writer.getOffset(), 112u);
+
+        // Matrices are arrays of their columns
+        glm::mat3 m3(glm::vec3(1.f, 2.f, 3.f), glm::vec3(4.f, 5.f, 6.f), glm::vec3(7.f, 8.f, 9.f));
+        CHECK_EQUAL(writer.write(m3), 112u);
+        CHECK_EQUAL(readAt<glm::vec3>(writer, 112 + 16), m3[1]);
+        CHECK_EQUAL(readAt<glm::vec3>(writer, 112 + 32), m3[2]);
+        CHECK_EQUAL(writer.write(glm::mat4(2.f)), 160u);
+        CHECK_EQUAL(writer.getOffset(), 224u);
+
+        // Structures are aligned on both ends
+        writer.write(1.f);
+        CHECK_EQUAL(writer.beginStruct(), 240u);
+        CHECK_EQUAL(writer.write(1.f), 240u);
+        writer.endStruct();
+        CHECK_EQUAL(writer.write(1.f), 256u);
+    }
+
+    void testFrameConstants()
+    {
+        FrameConstants constants;
+        constants.view = glm::mat4(2.f);
+        constants.projection = glm::mat4(3.f);
+        constants.lutInputMat = glm::mat3(4.f);
+        constants.lutOutputMat = glm::mat3(5.f);
+        constants.sunDir = glm::vec3(6.f, 7.f, 8.f);
+        constants.cosSunAngularRadius = 9.f;
+        constants.sunColor = glm::vec3(10.f, 11.f, 12.f);
+        constants.exposure = 13.f;
+        constants.lutLogRange = glm::vec2(14.f, 15.f);
+        constants.keyValue = 16.f;
+        constants.lutSize = 17.f;
+        constants.exposureMode = 18;
+        constants.lutType = 19;
+        constants.bEnableSun = true;
+
+        Std140Writer writer;
+        constants.write(writer);
+
+        // Offsets of shaders/FrameConstants.glsli, as GL reports them
+        CHECK_EQUAL(readAt<glm::mat4>(writer, 0), constants.view);
+        CHECK_EQUAL(readAt<glm::mat4>(writer, 64), constants.projection);
+        CHECK_EQUAL(readAt<glm::vec3>(writer, 128), constants.lutInputMat[0]);
+        CHECK_EQUAL(readAt<glm::vec3>(writer, 160), constants.lutInputMat[2]);
+        CHECK_EQUAL(readAt<glm::vec3>(writer, 176), constants.lutOutputMat[0]);
+        CHECK_EQUAL(readAt<glm::vec3>(writer, 208), constants.lutOutputMat[2]);
+        CHECK_EQUAL(readAt<glm::vec3>(writer, 224), constants.sunDir);
+        CHECK_EQUAL(readAt<float>(writer, 236), constants.cosSunAngularRadius);
+        CHECK_EQUAL(readAt<glm::vec3>(writer, 240), constants.sunColor);
+        CHECK_EQUAL(readAt<float>(writer, 252), constants.exposure);
+        CHECK_EQUAL(readAt<glm::vec2>(writer, 256), constants.lutLogRange);
+        CHECK_EQUAL(readAt<float>(writer, 264), constants.keyValue);
+        CHECK_EQUAL(readAt<float>(writer, 268), constants.lutSize);
+        CHECK_EQUAL(readAt<std::int32_t>(writer, 272), constants.exposureMode);
+        CHECK_EQUAL(readAt<std::int32_t>(writer, 276), constants.lutType);
+        CHECK_EQUAL(readAt<std::uint32_t>(writer, 280), 1u);
+        CHECK_EQUAL(writer.getSize(), 288u);
+
+        // Writing again starts over
+        constants.write(writer);
+        CHECK_EQUAL(writer.getSize(), 288u);
+    }
+}
+
+int main()
+{
+    testScalarsAndVectors();
+    testArraysAndMatrices();
+    testFrameConstants();
+    return test::result();
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdio>
+
+// Minimal checks for the CPU tests run by ctest; a test returns non zero when one failed
+namespace test
+{
+    static int s_Failures = 0;
+
+    inline int result()
+    {
+        if (s_Failures > 0)
+            fprintf(stderr, "%d check(s) failed\n", s_Failures);
+        return s_Failures > 0 ? 1 : 0;
+    }
+}
+
+#define CHECK(expr) \
+    do { \
+        if (!(expr)) { \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #expr); \
+            test::s_Failures++; \
+        } \
+    } while (0)
+
+#define CHECK_EQUAL(a, b) CHECK((a) == (b))